@@ -17,6 +17,8 @@ let
 
   python_ext = pkgs.python312.withPackages (python-pkgs: [
     python-pkgs.bleak
+    python-pkgs.pyserial
+    python-pkgs.matplotlib
   ]);
 in
 pkgs.mkShellNoCC {
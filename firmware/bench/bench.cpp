@@ -0,0 +1,329 @@
+// Host microbenchmarks for the control hot path.
+//
+//   program [--json PATH] [--baseline PATH] [--threshold PERCENT] [--noise-ns NS]
+//
+// Writes the results to --json (bench_results.json by default). With a
+// baseline (a results file from an earlier run) every benchmark whose
+// fastest sample is more than --threshold percent (default 30) and more
+// than --noise-ns nanoseconds (default 5) slower than its baseline fails
+// the run. A baseline file that does not exist yet skips the comparison;
+// record one on this machine first with `just bench-baseline`.
+// Exit status: 0 ok, 1 regression, 2 bad arguments or unreadable files.
+//
+// Built by the native_bench env; see the justfile for the usual runs.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AdvertisementMatcher.h"
+#include "ArduinoUtils.h"
+#include "Benchmark.h"
+#include "DriveMixer.h"
+#include "FlightRecorder.h"
+#include "InputShaper.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+static const Benchmark::Config BENCH_CONFIG = {15, 20000};
+
+// Two reports that differ, so each one is decoded rather than deduplicated
+static void makeReports(uint8_t reports[2][16])
+{
+  for (int r = 0; r < 2; r++)
+  {
+    memset(reports[r], 0, 16);
+    uint16_t lx = r ? 50000 : 12000;
+    uint16_t lt = r ? 700 : 200;
+    reports[r][0] = lx & 0xFF;
+    reports[r][1] = lx >> 8;
+    reports[r][3] = 0x80;
+    reports[r][8] = lt & 0xFF;
+    reports[r][9] = lt >> 8;
+    reports[r][12] = r ? 3 : 0;
+    reports[r][13] = r ? 0x41 : 0x00;
+  }
+}
+
+struct Session
+{
+  SimulatedBLETransport transport;
+  XboxBLEController controller;
+  uint8_t reports[2][16];
+
+  Session() : controller(transport)
+  {
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true,
+                                      true, -50};
+    transport.addPeripheral(advertisement);
+    makeReports(reports);
+  }
+
+  bool connect() { return controller.begin() && controller.scanAndConnect(1000); }
+};
+
+// Notification path (through the simulated transport's delivery lock)
+// including parseReport, the snapshot publish and the button edge queue
+static void benchParseReport(void *context, uint32_t iterations)
+{
+  Session &session = *static_cast<Session *>(context);
+  XboxBLEController::ButtonEvent event;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    session.transport.emit(session.reports[i & 1], 16);
+    while (session.controller.pollButtonEvent(event))
+      ;
+  }
+}
+
+// Same path for a repeated report, which skips the decode
+static void benchRepeatReport(void *context, uint32_t iterations)
+{
+  Session &session = *static_cast<Session *>(context);
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    session.transport.emit(session.reports[0], 16);
+  }
+}
+
+static void benchNormalized(void *context, uint32_t iterations)
+{
+  const XboxBLEController &controller = static_cast<Session *>(context)->controller;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    float sum = controller.getLeftStickXNormalized() + controller.getLeftStickYNormalized() +
+                controller.getLeftTriggerNormalized() + controller.getRightTriggerNormalized();
+    Benchmark::keep(sum);
+  }
+}
+
+static void benchSnapshot(void *context, uint32_t iterations)
+{
+  const XboxBLEController &controller = static_cast<Session *>(context)->controller;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    XboxBLEController::ControllerState state = controller.snapshot();
+    Benchmark::keep(state);
+  }
+}
+
+static XboxBLEController::ControllerState sweepState(uint32_t i)
+{
+  XboxBLEController::ControllerState state = {(int16_t)(i * 977), (int16_t)(i * 1303), 0, 0,
+                                              (uint16_t)(i & 0xFF), (uint16_t)((i * 7) & 0xFF), 0, 0,
+                                              true, 0};
+  return state;
+}
+
+// The tank mix of the control step, per arithmetic policy
+template <typename Signal>
+static void benchMix(void *context, uint32_t iterations)
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    typename BasicDriveMixer<Signal>::Output output =
+        BasicDriveMixer<Signal>::mix(BasicDriveMixer<Signal>::normalize(sweepState(i)));
+    Benchmark::keep(output);
+  }
+}
+
+// Deadzone, expo and slew with the firmware's profiles
+static void benchShape(void *context, uint32_t iterations)
+{
+  InputShaper &shaper = *static_cast<InputShaper *>(context);
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    XboxBLEController::ControllerState shaped = shaper.shape(sweepState(i), 20000);
+    Benchmark::keep(shaped);
+  }
+}
+
+static void discardLine(const char *line)
+{
+}
+
+// log() plus formatting the record when it is enabled; levels above
+// DEBUG_LEVEL only cost the runtime check
+template <LogLevel LEVEL>
+static void benchLog(void *context, uint32_t iterations)
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    log(LEVEL, "Benchmark message");
+    logDrain(1);
+  }
+}
+
+struct MatchSet
+{
+  AdvertisementMatcher matcher;
+  BLEAdvertisement advertisements[64];
+};
+
+// A crowded scan: unnamed beacons, other named devices, a few controllers
+static void makeAdvertisements(MatchSet &set)
+{
+  static const char *const NAMES[] = {"", "LE-Bose QC35", "Pixel 7", "Xbox Wireless Controller", "Tile",
+                                      "[TV] Samsung", "MX Master 3", "xbox wireless controller"};
+  for (uint8_t i = 0; i < 64; i++)
+  {
+    BLEAdvertisement &advertisement = set.advertisements[i];
+    memset(&advertisement, 0, sizeof(advertisement));
+    for (uint8_t b = 0; b < 6; b++)
+      advertisement.address.bytes[b] = (uint8_t)(i * 31 + b * 7);
+    const char *name = NAMES[i % 8];
+    advertisement.haveName = name[0] != '\0';
+    strncpy(advertisement.name, name, sizeof(advertisement.name) - 1);
+    advertisement.advertisesHidService = i % 16 == 6;
+    advertisement.rssi = (int8_t)(-40 - i);
+  }
+}
+
+static void benchMatch(void *context, uint32_t iterations)
+{
+  const MatchSet &set = *static_cast<MatchSet *>(context);
+  uint32_t matched = 0;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    matched += set.matcher.matches(set.advertisements[i & 63]) ? 1 : 0;
+  }
+  Benchmark::keep(matched);
+}
+
+static void benchRecordReport(void *context, uint32_t iterations)
+{
+  FlightRecorder &recorder = *static_cast<FlightRecorder *>(context);
+  uint8_t report[16] = {0};
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    report[0] = (uint8_t)i;
+    recorder.recordReport(0, i, report, sizeof(report));
+  }
+}
+
+// Only a file that is not there at all; an unreadable one still fails the run
+static bool fileMissing(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return errno == ENOENT;
+  fclose(file);
+  return false;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: bench [--json PATH] [--baseline PATH] [--threshold PERCENT] [--noise-ns NS]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *jsonPath = "bench_results.json";
+  const char *baselinePath = nullptr;
+  double threshold = 30.0;
+  double noiseNs = 5.0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--json") == 0)
+      jsonPath = argv[++i];
+    else if (i + 1 < argc && strcmp(argv[i], "--baseline") == 0)
+      baselinePath = argv[++i];
+    else if (i + 1 < argc && strcmp(argv[i], "--threshold") == 0)
+      threshold = atof(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--noise-ns") == 0)
+      noiseNs = atof(argv[++i]);
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  std::vector<Benchmark::Result> baseline;
+  if (baselinePath && fileMissing(baselinePath))
+  {
+    printf("No baseline at %s, skipping the comparison (record one with `just bench-baseline`)\n", baselinePath);
+    baselinePath = nullptr;
+  }
+  if (baselinePath && !Benchmark::readJson(baselinePath, baseline))
+  {
+    fprintf(stderr, "Cannot read baseline %s\n", baselinePath);
+    return 2;
+  }
+
+  Session session;
+  if (!session.connect())
+  {
+    fprintf(stderr, "Simulated controller did not connect\n");
+    return 2;
+  }
+  logSetSink(discardLine);
+
+  InputShaper shaper;
+  const InputShaper::AxisProfile steer = {2621, 9830, 0};
+  const InputShaper::AxisProfile drive = {2621, 9830, 65534};
+  const InputShaper::AxisProfile trigger = {1311, 0, 65534};
+  shaper.setProfile(InputShaper::AXIS_STICK_X, steer);
+  shaper.setProfile(InputShaper::AXIS_STICK_Y, drive);
+  shaper.setProfile(InputShaper::AXIS_LEFT_TRIGGER, trigger);
+  shaper.setProfile(InputShaper::AXIS_RIGHT_TRIGGER, trigger);
+
+  MatchSet defaultMatch;
+  makeAdvertisements(defaultMatch);
+  MatchSet prefixMatch;
+  makeAdvertisements(prefixMatch);
+  static const uint8_t VENDOR[] = {0x98, 0x7A, 0x14};
+  prefixMatch.matcher.clear();
+  prefixMatch.matcher.addNamePrefix("Xbox");
+  prefixMatch.matcher.addNamePrefix("Controller");
+  prefixMatch.matcher.addAddressPrefix(VENDOR, sizeof(VENDOR));
+
+  FlightRecorder *recorder = new FlightRecorder();
+
+  Benchmark bench(BENCH_CONFIG);
+  bench.run("parse_report", benchParseReport, &session);
+  bench.run("repeat_report", benchRepeatReport, &session);
+  bench.run("normalized_getters", benchNormalized, &session);
+  bench.run("snapshot", benchSnapshot, &session);
+  bench.run("drive_mix_q15", benchMix<Q15Signal>, nullptr);
+  bench.run("drive_mix_float", benchMix<FloatSignal>, nullptr);
+  bench.run("input_shape", benchShape, &shaper);
+  bench.run("log_error", benchLog<LogLevel::ERROR>, nullptr);
+  bench.run("log_warn", benchLog<LogLevel::WARN>, nullptr);
+  bench.run("log_info", benchLog<LogLevel::INFO>, nullptr);
+  bench.run("log_debug", benchLog<LogLevel::DEBUG>, nullptr);
+  bench.run("log_verbose", benchLog<LogLevel::VERBOSE>, nullptr);
+  bench.run("advertisement_match_default", benchMatch, &defaultMatch);
+  bench.run("advertisement_match_prefixes", benchMatch, &prefixMatch);
+  bench.run("flight_record_report", benchRecordReport, recorder);
+  session.controller.disconnect();
+  delete recorder;
+
+  const std::vector<Benchmark::Result> &results = bench.getResults();
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    printf("%-30s %10.1f ns/op (min %.1f, %u x %u)\n", results[i].name.c_str(), results[i].nsPerOp,
+           results[i].minNsPerOp, (unsigned)results[i].samples, (unsigned)results[i].iterations);
+  }
+  if (!bench.writeJson(jsonPath))
+  {
+    fprintf(stderr, "Cannot write %s\n", jsonPath);
+    return 2;
+  }
+
+  if (!baselinePath)
+    return 0;
+  std::vector<Benchmark::Regression> regressions;
+  if (bench.compare(baseline, threshold, noiseNs, regressions) == 0)
+  {
+    printf("No regressions over %.1f%% (%.1f ns) against %s\n", threshold, noiseNs, baselinePath);
+    return 0;
+  }
+  for (size_t i = 0; i < regressions.size(); i++)
+  {
+    printf("REGRESSION %s: min %.1f ns/op, baseline %.1f (+%.1f%%)\n", regressions[i].name.c_str(),
+           regressions[i].nsPerOp, regressions[i].baselineNsPerOp, regressions[i].percent);
+  }
+  return 1;
+}
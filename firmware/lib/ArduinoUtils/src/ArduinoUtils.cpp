@@ -1,7 +1,79 @@
 #include "ArduinoUtils.h"
-#include <Arduino.h>
+#include "LockFreeQueue.h"
 
-bool log_ready = false;
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef ARDUINO
+#include <chrono>
+#include <thread>
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+uint32_t millis(void)
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+uint32_t micros(void)
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+void delay(uint32_t ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+#endif
+
+// A log call as captured on the hot path; formatted only when drained
+struct LogRecord
+{
+  const char *format;
+  uint32_t timestamp;
+  uint8_t level;
+  uint8_t argCount;
+  LogArg args[LOG_MAX_ARGS];
+};
+
+static LockFreeQueue<LogRecord, LOG_QUEUE_SIZE> logQueue;
+static std::atomic<uint32_t> logDropped(0);
+static uint32_t logDropsReported = 0;
+
+static void defaultLogSink(const char *line)
+{
+#ifdef ARDUINO
+  Serial.print(line);
+#else
+  fputs(line, stdout);
+#endif
+}
+
+static LogSink logSink = defaultLogSink;
+
+#ifdef ARDUINO_ARCH_ESP32
+static const uint32_t LOG_DRAIN_PERIOD_MS = 20;
+
+static void logDrainTask(void *parameter)
+{
+  while (true)
+  {
+    logDrain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+  }
+}
+#endif
 
 const char *getLogLevelName(const LogLevel level)
 {
@@ -22,22 +94,212 @@ const char *getLogLevelName(const LogLevel level)
   }
 }
 
-void log(const LogLevel level, const char *msg)
+bool logBegin(void)
+{
+#if defined(ARDUINO) && DEBUG_LEVEL > -1
+  // Do not wait for a host: output is dropped until one listens
+  Serial.begin(BAND_RATE);
+#endif
+#if defined(ARDUINO_ARCH_ESP32) && DEBUG_LEVEL > -1
+  static TaskHandle_t drainTask = nullptr;
+  if (drainTask == nullptr &&
+      xTaskCreate(logDrainTask, "log", 3072, nullptr, tskIDLE_PRIORITY + 1, &drainTask) != pdPASS)
+  {
+    return false;
+  }
+#endif
+  return true;
+}
+
+bool logPush(const LogLevel level, const char *format, const LogArg *args, uint8_t argCount)
+{
+  LogRecord record;
+  record.format = format;
+  record.timestamp = millis();
+  record.level = (uint8_t)level;
+  record.argCount = argCount;
+  memcpy(record.args, args, argCount * sizeof(LogArg));
+
+  if (!logQueue.push(record))
+  {
+    logDropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+// Append printf output to line, keeping it terminated when truncated
+static void appendFormatted(char *line, size_t capacity, size_t &length, const char *spec, ...)
 {
-#if DEBUG_LEVEL > -1
-  if (!log_ready) {
-    Serial.begin(BAND_RATE);
-    while (!Serial);
-    log_ready = true;
+  if (length >= capacity - 1)
+    return;
+  va_list ap;
+  va_start(ap, spec);
+  int written = vsnprintf(line + length, capacity - length, spec, ap);
+  va_end(ap);
+  if (written > 0)
+  {
+    length += (size_t)written;
+    if (length > capacity - 1)
+      length = capacity - 1;
+  }
+}
+
+// Expand one conversion of the record's format using its captured argument.
+// Length modifiers in the format are ignored: arguments were widened to 32
+// bits on capture and are printed as long/unsigned long/double.
+static void appendArg(char *line, size_t capacity, size_t &length,
+                      const char *flags, size_t flagsLength, char conversion, const LogArg *arg)
+{
+  char spec[16];
+  if (flagsLength > sizeof(spec) - 4)
+    flagsLength = sizeof(spec) - 4;
+  spec[0] = '%';
+  memcpy(spec + 1, flags, flagsLength);
+  char *tail = spec + 1 + flagsLength;
+
+  if (arg == nullptr)
+  {
+    appendFormatted(line, capacity, length, "%s", "<?>");
+    return;
   }
 
+  switch (conversion)
+  {
+  case 'd':
+  case 'i':
+    tail[0] = 'l';
+    tail[1] = 'd';
+    tail[2] = '\0';
+    appendFormatted(line, capacity, length, spec,
+                    arg->type == LogArg::ARG_INT     ? (long)arg->value.i
+                    : arg->type == LogArg::ARG_FLOAT ? (long)arg->value.f
+                                                     : (long)arg->value.u);
+    break;
+  case 'u':
+  case 'x':
+  case 'X':
+  case 'o':
+    tail[0] = 'l';
+    tail[1] = conversion;
+    tail[2] = '\0';
+    appendFormatted(line, capacity, length, spec,
+                    arg->type == LogArg::ARG_INT     ? (unsigned long)arg->value.i
+                    : arg->type == LogArg::ARG_FLOAT ? (unsigned long)arg->value.f
+                                                     : (unsigned long)arg->value.u);
+    break;
+  case 'c':
+    tail[0] = 'c';
+    tail[1] = '\0';
+    appendFormatted(line, capacity, length, spec, (int)arg->value.i);
+    break;
+  case 'f':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+    tail[0] = conversion;
+    tail[1] = '\0';
+    appendFormatted(line, capacity, length, spec,
+                    arg->type == LogArg::ARG_FLOAT ? (double)arg->value.f
+                    : arg->type == LogArg::ARG_INT ? (double)arg->value.i
+                                                   : (double)arg->value.u);
+    break;
+  case 's':
+    tail[0] = 's';
+    tail[1] = '\0';
+    appendFormatted(line, capacity, length, spec,
+                    arg->type == LogArg::ARG_STRING && arg->value.s ? arg->value.s : "<?>");
+    break;
+  default:
+    appendFormatted(line, capacity, length, "%s", "<?>");
+    break;
+  }
+}
+
+static size_t formatRecord(const LogRecord &record, char *line, size_t capacity)
+{
+  size_t length = 0;
+  appendFormatted(line, capacity, length, "[%lu] [%s] ", (unsigned long)record.timestamp,
+                  getLogLevelName((LogLevel)record.level));
+
+  uint8_t argIndex = 0;
+  const char *p = record.format;
+  while (*p != '\0' && length < capacity - 1)
+  {
+    if (*p != '%')
+    {
+      line[length++] = *p++;
+      continue;
+    }
+    p++;
+    if (*p == '%')
+    {
+      line[length++] = *p++;
+      continue;
+    }
+
+    // Flags, width and precision are passed through, length modifiers dropped
+    const char *flags = p;
+    while (*p != '\0' && strchr("-+ #0123456789.", *p) != nullptr)
+      p++;
+    size_t flagsLength = (size_t)(p - flags);
+    while (*p != '\0' && strchr("hlLzjt", *p) != nullptr)
+      p++;
+    if (*p == '\0')
+      break;
+
+    const LogArg *arg = argIndex < record.argCount ? &record.args[argIndex] : nullptr;
+    argIndex++;
+    appendArg(line, capacity, length, flags, flagsLength, *p++, arg);
+  }
+
+  if (length > capacity - 2)
+    length = capacity - 2;
+  line[length++] = '\n';
+  line[length] = '\0';
+  return length;
+}
+
+size_t logDrain(size_t maxRecords)
+{
+  char line[160];
+  size_t drained = 0;
+
+  uint32_t dropped = logDropped.load(std::memory_order_relaxed);
+  if (dropped != logDropsReported)
+  {
+    snprintf(line, sizeof(line), "[WARN] %lu log records dropped\n",
+             (unsigned long)(dropped - logDropsReported));
+    logSink(line);
+    logDropsReported = dropped;
+  }
+
+  LogRecord record;
+  while (drained < maxRecords && logQueue.pop(record))
+  {
+    formatRecord(record, line, sizeof(line));
+    logSink(line);
+    drained++;
+  }
+  return drained;
+}
+
+void logSetSink(LogSink sink)
+{
+  logSink = sink != nullptr ? sink : defaultLogSink;
+}
+
+uint32_t logDroppedCount(void)
+{
+  return logDropped.load(std::memory_order_relaxed);
+}
+
+void log(const LogLevel level, const char *msg)
+{
   if (level > DEBUG_LEVEL)
     return;
-  char combined[255];
-  sprintf(combined, "[%s] %s\n",
-          getLogLevelName(level), msg);
-  Serial.print(combined);
-#endif
+  logDeferred(level, "%s", msg);
 }
 
 void sleep_forever(void)
@@ -1,6 +1,36 @@
 #ifndef ARDUINO_UTILS_H
 #define ARDUINO_UTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+
+// Host stand-ins for the Arduino timing API so libraries build on the native env
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+#endif
+
+#ifndef DEBUG_LEVEL
+#define DEBUG_LEVEL -1
+#endif
+
+#ifndef BAND_RATE
+#define BAND_RATE 115200
+#endif
+
+// Number of log records buffered between producers and the drain (power of two)
+#ifndef LOG_QUEUE_SIZE
+#define LOG_QUEUE_SIZE 64
+#endif
+
+#define LOG_MAX_ARGS 4
+
 typedef enum {
   ERROR   = 0,
   WARN    = 1,
@@ -9,7 +39,136 @@ typedef enum {
   VERBOSE = 4
 } LogLevel;
 
+// Logging macros. Levels above DEBUG_LEVEL compile to nothing, arguments
+// included. Enabled levels only copy the format pointer and up to
+// LOG_MAX_ARGS scalar arguments into a lock-free queue; formatting and the
+// serial write happen later in logDrain(), so these are safe to call from
+// the BLE callback and the control loop.
+//
+// The format string and any %s arguments must outlive the record: pass
+// string literals or other static strings only.
+#if DEBUG_LEVEL >= 0
+#define LOG_ERROR(...) logDeferred(LogLevel::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if DEBUG_LEVEL >= 1
+#define LOG_WARN(...) logDeferred(LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if DEBUG_LEVEL >= 2
+#define LOG_INFO(...) logDeferred(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if DEBUG_LEVEL >= 3
+#define LOG_DEBUG(...) logDeferred(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if DEBUG_LEVEL >= 4
+#define LOG_VERBOSE(...) logDeferred(LogLevel::VERBOSE, __VA_ARGS__)
+#else
+#define LOG_VERBOSE(...) ((void)0)
+#endif
+
+// One captured log argument. Integers are widened to 32 bits, floating point
+// is narrowed to float.
+struct LogArg
+{
+  enum Type : uint8_t
+  {
+    ARG_NONE,
+    ARG_INT,
+    ARG_UINT,
+    ARG_FLOAT,
+    ARG_STRING
+  };
+
+  Type type;
+  union
+  {
+    int32_t i;
+    uint32_t u;
+    float f;
+    const char *s;
+  } value;
+};
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, LogArg>::type
+makeLogArg(T value)
+{
+  LogArg arg;
+  arg.type = LogArg::ARG_INT;
+  arg.value.i = (int32_t)value;
+  return arg;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, LogArg>::type
+makeLogArg(T value)
+{
+  LogArg arg;
+  arg.type = LogArg::ARG_UINT;
+  arg.value.u = (uint32_t)value;
+  return arg;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, LogArg>::type
+makeLogArg(T value)
+{
+  LogArg arg;
+  arg.type = LogArg::ARG_FLOAT;
+  arg.value.f = (float)value;
+  return arg;
+}
+
+inline LogArg makeLogArg(const char *value)
+{
+  LogArg arg;
+  arg.type = LogArg::ARG_STRING;
+  arg.value.s = value;
+  return arg;
+}
+
+// Queue one record; returns false (and counts a drop) when the queue is full
+bool logPush(const LogLevel level, const char *format, const LogArg *args, uint8_t argCount);
+
+template <typename... Args>
+inline bool logDeferred(const LogLevel level, const char *format, Args... args)
+{
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+  const LogArg list[sizeof...(Args) + 1] = {makeLogArg(args)...};
+  return logPush(level, format, list, (uint8_t)sizeof...(Args));
+}
+
+// Receives each formatted line, newline included
+typedef void (*LogSink)(const char *line);
+
+// Open the serial port without waiting for a host and, on ESP32, start the
+// low-priority task that drains the log queue. Other boards must call
+// logDrain() from loop().
+bool logBegin(void);
+
+// Format and write up to maxRecords queued records; returns the number written
+size_t logDrain(size_t maxRecords = LOG_QUEUE_SIZE);
+
+// Replace the output (Serial on Arduino, stdout on the host)
+void logSetSink(LogSink sink);
+
+// Records discarded because the queue was full
+uint32_t logDroppedCount(void);
+
 const char* getLogLevelName(const LogLevel level);
+
+// Runtime-filtered form of the LOG_* macros; msg must be a static string
 void log(const LogLevel level, const char* msg);
 void sleep_forever(void);
 
@@ -0,0 +1,106 @@
+#ifndef LOCK_FREE_QUEUE_H
+#define LOCK_FREE_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded multi-producer, multi-consumer queue (Vyukov's sequence-per-cell
+// design). push() and pop() never block or allocate; push() fails when the
+// queue is full so callers can count drops instead of stalling.
+//
+// Capacity must be a power of two. Elements are copied in and out, so keep
+// T small and trivially copyable.
+template <typename T, size_t Capacity>
+class LockFreeQueue
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "LockFreeQueue capacity must be a power of two");
+
+public:
+  LockFreeQueue() : enqueuePos(0), dequeuePos(0)
+  {
+    for (size_t i = 0; i < Capacity; i++)
+    {
+      cells[i].sequence.store((uint32_t)i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(const T &value)
+  {
+    Cell *cell;
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      cell = &cells[pos & (Capacity - 1)];
+      uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0)
+      {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false; // full
+      }
+      else
+      {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &value)
+  {
+    Cell *cell;
+    uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      cell = &cells[pos & (Capacity - 1)];
+      uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - (pos + 1));
+      if (diff == 0)
+      {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false; // empty
+      }
+      else
+      {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+    value = cell->data;
+    cell->sequence.store(pos + Capacity, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of queued elements
+  size_t size() const
+  {
+    return (size_t)(enqueuePos.load(std::memory_order_relaxed) -
+                    dequeuePos.load(std::memory_order_relaxed));
+  }
+
+  static size_t capacity() { return Capacity; }
+
+private:
+  struct Cell
+  {
+    std::atomic<uint32_t> sequence;
+    T data;
+  };
+
+  Cell cells[Capacity];
+  std::atomic<uint32_t> enqueuePos;
+  std::atomic<uint32_t> dequeuePos;
+};
+
+#endif // LOCK_FREE_QUEUE_H
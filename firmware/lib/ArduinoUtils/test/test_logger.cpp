@@ -0,0 +1,137 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ArduinoUtils.h"
+#include "LockFreeQueue.h"
+
+// Capture drained lines instead of printing them
+static std::vector<std::string> lines;
+
+static void captureSink(const char *line) { lines.push_back(line); }
+
+// Strip the "[timestamp] " prefix so tests can compare the rest
+static std::string body(const std::string &line)
+{
+    size_t pos = line.find("] ");
+    return pos == std::string::npos ? line : line.substr(pos + 2);
+}
+
+void setUp(void) {
+    logSetSink(captureSink);
+    while (logDrain() > 0) {
+    }
+    lines.clear();
+}
+
+void tearDown(void) {
+    logSetSink(nullptr);
+}
+
+// Test arguments are captured on push and formatted on drain
+void test_deferred_formatting(void) {
+    int16_t x = -1200;
+    uint16_t trigger = 255;
+    TEST_ASSERT_TRUE(logDeferred(LogLevel::INFO, "X=%d T=%u f=%.2f s=%s 100%%",
+                                 x, trigger, 1.5f, "ok"));
+    TEST_ASSERT_EQUAL_UINT32(0, lines.size());
+
+    TEST_ASSERT_EQUAL_UINT32(1, logDrain());
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("[INFO] X=-1200 T=255 f=1.50 s=ok 100%\n", body(lines[0]).c_str());
+}
+
+// Test length modifiers and missing arguments do not break formatting
+void test_length_modifiers_and_missing_args(void) {
+    uint32_t big = 4000000000UL;
+    logDeferred(LogLevel::WARN, "a=%lu h=%04hx b=%d", big, 0xBEEFu);
+    logDrain();
+    TEST_ASSERT_EQUAL_STRING("[WARN] a=4000000000 h=beef b=<?>\n", body(lines[0]).c_str());
+}
+
+// Test a full queue drops records and the drain reports how many
+void test_drops_are_counted(void) {
+    uint32_t droppedBefore = logDroppedCount();
+    for (size_t i = 0; i < LOG_QUEUE_SIZE + 5; i++) {
+        logDeferred(LogLevel::DEBUG, "record %u", (unsigned)i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, logDroppedCount() - droppedBefore);
+
+    TEST_ASSERT_EQUAL_UINT32(LOG_QUEUE_SIZE, logDrain());
+    TEST_ASSERT_EQUAL_UINT32(LOG_QUEUE_SIZE + 1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("[WARN] 5 log records dropped\n", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("[DEBUG] record 0\n", body(lines[1]).c_str());
+}
+
+// Test disabled levels are compiled out, arguments included
+void test_disabled_levels_not_evaluated(void) {
+    int evaluated = 0;
+#if DEBUG_LEVEL < 4
+    LOG_VERBOSE("%d", ++evaluated);
+    TEST_ASSERT_EQUAL_INT(0, evaluated);
+    TEST_ASSERT_EQUAL_UINT32(0, logDrain());
+#else
+    LOG_VERBOSE("%d", ++evaluated);
+    TEST_ASSERT_EQUAL_INT(1, evaluated);
+#endif
+}
+
+// Test concurrent producers lose nothing while the queue has room
+void test_multiple_producers(void) {
+    LockFreeQueue<uint32_t, 1024> queue;
+    const int PRODUCERS = 4;
+    const uint32_t PER_PRODUCER = 200;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.push_back(std::thread([&queue, p, PER_PRODUCER]() {
+            for (uint32_t i = 0; i < PER_PRODUCER; i++) {
+                TEST_ASSERT_TRUE(queue.push(p * PER_PRODUCER + i));
+            }
+        }));
+    }
+    for (size_t i = 0; i < producers.size(); i++) {
+        producers[i].join();
+    }
+
+    std::vector<bool> seen(PRODUCERS * PER_PRODUCER, false);
+    uint32_t value;
+    uint32_t count = 0;
+    while (queue.pop(value)) {
+        TEST_ASSERT_FALSE(seen[value]);
+        seen[value] = true;
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(PRODUCERS * PER_PRODUCER, count);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_deferred_formatting);
+    RUN_TEST(test_length_modifiers_and_missing_args);
+    RUN_TEST(test_drops_are_counted);
+    RUN_TEST(test_disabled_levels_not_evaluated);
+    RUN_TEST(test_multiple_producers);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
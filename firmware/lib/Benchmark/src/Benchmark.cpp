@@ -0,0 +1,182 @@
+#ifndef ARDUINO
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t MAX_ITERATIONS = 1u << 30;
+
+Benchmark::Benchmark(const Config &config, ClockFn clock) : config(config), clock(clock)
+{
+  if (this->config.samples == 0)
+  {
+    this->config.samples = 1;
+  }
+}
+
+uint64_t Benchmark::steadyClockNs(void)
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t Benchmark::timeCall(BenchFn fn, void *context, uint32_t iterations)
+{
+  uint64_t start = clock();
+  fn(context, iterations);
+  return clock() - start;
+}
+
+const Benchmark::Result &Benchmark::run(const char *name, BenchFn fn, void *context)
+{
+  // Calibrate: grow the call until it is long enough to time reliably
+  const uint64_t minSampleNs = (uint64_t)config.minSampleUs * 1000;
+  uint32_t iterations = 1;
+  uint64_t elapsed = timeCall(fn, context, iterations);
+  while (elapsed < minSampleNs && iterations < MAX_ITERATIONS)
+  {
+    uint64_t scale = elapsed > 0 ? minSampleNs / elapsed + 1 : 10;
+    if (scale > 10)
+      scale = 10;
+    if (scale < 2)
+      scale = 2;
+    iterations = (uint32_t)std::min<uint64_t>((uint64_t)iterations * scale, MAX_ITERATIONS);
+    elapsed = timeCall(fn, context, iterations);
+  }
+
+  std::vector<double> perOp(config.samples);
+  for (uint32_t i = 0; i < config.samples; i++)
+  {
+    perOp[i] = (double)timeCall(fn, context, iterations) / iterations;
+  }
+  std::sort(perOp.begin(), perOp.end());
+
+  Result result;
+  result.name = name;
+  result.iterations = iterations;
+  result.samples = config.samples;
+  result.nsPerOp = perOp[perOp.size() / 2];
+  result.minNsPerOp = perOp[0];
+  results.push_back(result);
+  return results.back();
+}
+
+bool Benchmark::writeJson(const char *path) const
+{
+  FILE *file = fopen(path, "w");
+  if (!file)
+  {
+    return false;
+  }
+
+  fprintf(file, "{\"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const Result &result = results[i];
+    fprintf(file,
+            "  {\"name\": \"%s\", \"iterations\": %u, \"samples\": %u, \"ns_per_op\": %.3f, "
+            "\"min_ns_per_op\": %.3f}%s\n",
+            result.name.c_str(), (unsigned)result.iterations, (unsigned)result.samples, result.nsPerOp,
+            result.minNsPerOp, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "]}\n");
+  return fclose(file) == 0;
+}
+
+// Value that follows "key": in text, from offset on; nullptr if none
+static const char *findValue(const std::string &text, const char *key, size_t &offset)
+{
+  std::string quoted = std::string("\"") + key + "\"";
+  size_t at = text.find(quoted, offset);
+  if (at == std::string::npos)
+    return nullptr;
+  at = text.find(':', at + quoted.size());
+  if (at == std::string::npos)
+    return nullptr;
+  at++;
+  while (at < text.size() && text[at] == ' ')
+    at++;
+  offset = at;
+  return text.c_str() + at;
+}
+
+bool Benchmark::readJson(const char *path, std::vector<Result> &out)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+  {
+    return false;
+  }
+  std::string text;
+  char buffer[256];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    text.append(buffer, read);
+  }
+  fclose(file);
+
+  // Only the layout writeJson() produces is understood
+  out.clear();
+  size_t offset = 0;
+  const char *value;
+  while ((value = findValue(text, "name", offset)) != nullptr)
+  {
+    if (*value != '"')
+      return false;
+    const char *end = strchr(value + 1, '"');
+    if (!end)
+      return false;
+
+    Result result;
+    result.name.assign(value + 1, end);
+    const char *fields[] = {"iterations", "samples", "ns_per_op", "min_ns_per_op"};
+    double numbers[4];
+    for (size_t i = 0; i < 4; i++)
+    {
+      value = findValue(text, fields[i], offset);
+      if (!value)
+        return false;
+      numbers[i] = strtod(value, nullptr);
+    }
+    result.iterations = (uint32_t)numbers[0];
+    result.samples = (uint32_t)numbers[1];
+    result.nsPerOp = numbers[2];
+    result.minNsPerOp = numbers[3];
+    out.push_back(result);
+  }
+  return true;
+}
+
+size_t Benchmark::compare(const std::vector<Result> &baseline, double thresholdPercent, double noiseFloorNs,
+                          std::vector<Regression> &regressions) const
+{
+  size_t found = 0;
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    for (size_t j = 0; j < baseline.size(); j++)
+    {
+      if (baseline[j].name != results[i].name || baseline[j].minNsPerOp <= 0)
+        continue;
+
+      double before = baseline[j].minNsPerOp;
+      double after = results[i].minNsPerOp;
+      double percent = (after / before - 1.0) * 100.0;
+      if (percent > thresholdPercent && after - before > noiseFloorNs)
+      {
+        Regression regression = {results[i].name, before, after, percent};
+        regressions.push_back(regression);
+        found++;
+      }
+      break;
+    }
+  }
+  return found;
+}
+
+#endif // ARDUINO
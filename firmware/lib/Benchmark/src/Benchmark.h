@@ -0,0 +1,95 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#ifndef ARDUINO
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Host microbenchmarks for the hot paths, with regression checks.
+//
+// run() calls the function under test with a growing iteration count until
+// one call takes at least minSampleUs, then times `samples` calls of that
+// size and keeps the median and the fastest per-operation time. The fastest
+// is what gets compared: noise only ever adds time, so the minimum moves
+// least between runs of unchanged code.
+//
+// Results are written as JSON:
+//
+//   {"benchmarks": [
+//     {"name": "...", "iterations": N, "samples": S, "ns_per_op": M, "min_ns_per_op": F},
+//     ...
+//   ]}
+//
+// A results file doubles as a baseline: compare() flags every benchmark
+// whose fastest time is more than thresholdPercent and more than
+// noiseFloorNs above the baseline's; the floor keeps a few nanoseconds of
+// jitter on the cheapest operations from reading as a large percentage.
+// Benchmarks missing from either side are not compared.
+class Benchmark
+{
+public:
+  // Perform the operation `iterations` times
+  typedef void (*BenchFn)(void *context, uint32_t iterations);
+  typedef uint64_t (*ClockFn)(void); // monotonic nanoseconds
+
+  struct Config
+  {
+    uint32_t samples;     // timed calls per benchmark, odd for a true median
+    uint32_t minSampleUs; // shortest timed call
+  };
+
+  struct Result
+  {
+    std::string name;
+    uint32_t iterations; // per sample
+    uint32_t samples;
+    double nsPerOp;      // median
+    double minNsPerOp;
+  };
+
+  struct Regression
+  {
+    std::string name;
+    double baselineNsPerOp; // fastest samples
+    double nsPerOp;
+    double percent;         // slowdown over the baseline
+  };
+
+  // clock defaults to std::chrono::steady_clock; tests inject a fake one
+  explicit Benchmark(const Config &config, ClockFn clock = steadyClockNs);
+
+  const Result &run(const char *name, BenchFn fn, void *context);
+
+  const std::vector<Result> &getResults() const { return results; }
+
+  bool writeJson(const char *path) const;
+
+  // Read a file written by writeJson(); false if it cannot be read
+  static bool readJson(const char *path, std::vector<Result> &out);
+
+  // Append regressions beyond both limits; returns how many
+  size_t compare(const std::vector<Result> &baseline, double thresholdPercent, double noiseFloorNs,
+                 std::vector<Regression> &regressions) const;
+
+  // Keep the compiler from discarding a computed value
+  template <typename T>
+  static void keep(const T &value)
+  {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+
+private:
+  Config config;
+  ClockFn clock;
+  std::vector<Result> results;
+
+  static uint64_t steadyClockNs(void);
+  uint64_t timeCall(BenchFn fn, void *context, uint32_t iterations);
+};
+
+#endif // ARDUINO
+
+#endif // BENCHMARK_H
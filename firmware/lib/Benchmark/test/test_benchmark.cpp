@@ -0,0 +1,138 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <stdio.h>
+#include "Benchmark.h"
+
+static const char *RESULTS_PATH = "test_benchmark_results.json";
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+    remove(RESULTS_PATH);
+}
+
+static void spin(void *context, uint32_t iterations) {
+    uint32_t work = *(uint32_t *)context;
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t w = 0; w < work; w++)
+            value = value * 1664525u + 1013904223u;
+        Benchmark::keep(value);
+    }
+}
+
+static const Benchmark::Config CONFIG = {5, 2000};
+
+// Fake clock advanced only by tick(), so timings are exact
+static uint64_t fakeNs = 0;
+
+static uint64_t fakeClock(void) {
+    return fakeNs;
+}
+
+// Take `cost` fake nanoseconds per operation
+static void tick(void *context, uint32_t iterations) {
+    fakeNs += (uint64_t)iterations * *(uint32_t *)context;
+}
+
+// Test calibration reaches the minimum sample time and per-op times come from the clock
+void test_run_calibrates(void) {
+    Benchmark bench(CONFIG, fakeClock);
+    uint32_t light = 10;
+    uint32_t heavy = 1000;
+    const Benchmark::Result &fast = bench.run("light", tick, &light);
+    TEST_ASSERT_EQUAL_UINT32(5, fast.samples);
+    TEST_ASSERT_TRUE(fast.iterations > 1);
+    TEST_ASSERT_TRUE(fast.iterations * 10ull >= 2000 * 1000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 10, fast.nsPerOp);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 10, fast.minNsPerOp);
+    uint32_t lightIterations = fast.iterations;
+
+    const Benchmark::Result &slow = bench.run("heavy", tick, &heavy);
+    TEST_ASSERT_TRUE(slow.iterations < lightIterations);
+    TEST_ASSERT_TRUE(slow.iterations * 1000ull >= 2000 * 1000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1000, slow.nsPerOp);
+    TEST_ASSERT_EQUAL_UINT32(2, bench.getResults().size());
+}
+
+// Test results written as JSON read back unchanged
+void test_json_round_trip(void) {
+    Benchmark bench(CONFIG);
+    uint32_t work = 50;
+    bench.run("first", spin, &work);
+    bench.run("second_one", spin, &work);
+    TEST_ASSERT_TRUE(bench.writeJson(RESULTS_PATH));
+
+    std::vector<Benchmark::Result> loaded;
+    TEST_ASSERT_TRUE(Benchmark::readJson(RESULTS_PATH, loaded));
+    TEST_ASSERT_EQUAL_UINT32(2, loaded.size());
+    for (size_t i = 0; i < 2; i++) {
+        const Benchmark::Result &written = bench.getResults()[i];
+        TEST_ASSERT_EQUAL_STRING(written.name.c_str(), loaded[i].name.c_str());
+        TEST_ASSERT_EQUAL_UINT32(written.iterations, loaded[i].iterations);
+        TEST_ASSERT_EQUAL_UINT32(written.samples, loaded[i].samples);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, written.nsPerOp, loaded[i].nsPerOp);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, written.minNsPerOp, loaded[i].minNsPerOp);
+    }
+
+    TEST_ASSERT_FALSE(Benchmark::readJson("no_such_baseline.json", loaded));
+}
+
+// Test only slowdowns of the fastest sample beyond both limits are regressions
+void test_compare_against_baseline(void) {
+    Benchmark bench(CONFIG);
+    uint32_t work = 50;
+    bench.run("steady", spin, &work);
+    bench.run("slower", spin, &work);
+    bench.run("new", spin, &work);
+
+    std::vector<Benchmark::Result> baseline = bench.getResults();
+    baseline.pop_back();                   // "new" has no baseline
+    baseline[0].minNsPerOp *= 1.05;        // 5% faster than the baseline now
+    baseline[1].minNsPerOp /= 1.25;        // 25% slower now
+    baseline[0].nsPerOp /= 2.0;            // medians are not compared
+    Benchmark::Result gone = baseline[0];  // in the baseline only
+    gone.name = "removed";
+    baseline.push_back(gone);
+
+    std::vector<Benchmark::Regression> regressions;
+    TEST_ASSERT_EQUAL_UINT32(1, bench.compare(baseline, 10.0, 0.0, regressions));
+    TEST_ASSERT_EQUAL_STRING("slower", regressions[0].name.c_str());
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 25.0, regressions[0].percent);
+
+    regressions.clear();
+    TEST_ASSERT_EQUAL_UINT32(0, bench.compare(baseline, 30.0, 0.0, regressions));
+    TEST_ASSERT_EQUAL_UINT32(0, regressions.size());
+
+    // A slowdown under the noise floor is not a regression at any percentage
+    double slowdownNs = bench.getResults()[1].minNsPerOp - baseline[1].minNsPerOp;
+    TEST_ASSERT_EQUAL_UINT32(0, bench.compare(baseline, 10.0, slowdownNs + 1.0, regressions));
+    TEST_ASSERT_EQUAL_UINT32(1, bench.compare(baseline, 10.0, slowdownNs - 1.0, regressions));
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_run_calibrates);
+    RUN_TEST(test_json_round_trip);
+    RUN_TEST(test_compare_against_baseline);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
@@ -0,0 +1,144 @@
+#include "CurrentMonitor.h"
+
+#include <string.h>
+
+CurrentMonitor::CurrentMonitor(const Config &config)
+    : config(config),
+      maPerCountQ16(0),
+      tripped(false),
+      tripCount(0),
+      tripHandler(nullptr),
+      tripContext(nullptr)
+{
+  if (this->config.decimation == 0)
+  {
+    this->config.decimation = 1;
+  }
+  if (this->config.windowSamples == 0)
+  {
+    this->config.windowSamples = 1;
+  }
+  if (this->config.tripSamples == 0)
+  {
+    this->config.tripSamples = 1;
+  }
+
+  // mA per count = fullScaleMv * 1000 / (maxCount * mvPerAmp), in Q16
+  uint32_t maxCount = (1UL << this->config.adcBits) - 1;
+  if (maxCount > 0 && this->config.mvPerAmp > 0)
+  {
+    maPerCountQ16 = (uint32_t)(((uint64_t)this->config.fullScaleMv * 1000 << 16) /
+                               ((uint64_t)maxCount * this->config.mvPerAmp));
+  }
+
+  memset(state, 0, sizeof(state));
+  memset(&working, 0, sizeof(working));
+  published.write(working);
+}
+
+void CurrentMonitor::setTripHandler(TripHandler handler, void *context)
+{
+  tripContext = context;
+  tripHandler = handler;
+}
+
+uint16_t CurrentMonitor::toMilliamps(uint16_t raw) const
+{
+  uint32_t ma = (uint32_t)(((uint64_t)raw * maPerCountQ16 + 0x8000) >> 16);
+  return ma > UINT16_MAX ? UINT16_MAX : (uint16_t)ma;
+}
+
+void CurrentMonitor::addSample(uint8_t channel, uint16_t raw)
+{
+  if (channel >= CHANNEL_COUNT)
+  {
+    return;
+  }
+  ChannelState &s = state[channel];
+  s.decimationSum += raw;
+  if (++s.decimationCount < config.decimation)
+  {
+    return;
+  }
+
+  uint16_t average = (uint16_t)((s.decimationSum + config.decimation / 2) / config.decimation);
+  s.decimationSum = 0;
+  s.decimationCount = 0;
+  addDecimated(channel, toMilliamps(average));
+}
+
+void CurrentMonitor::addDecimated(uint8_t channel, uint16_t currentMa)
+{
+  ChannelState &s = state[channel];
+
+  // Trip path first: it is what has to be fast
+  if (currentMa >= config.tripMa)
+  {
+    if (s.overCount < config.tripSamples)
+    {
+      s.overCount++;
+    }
+    if (s.overCount == config.tripSamples && !tripped.load(std::memory_order_relaxed))
+    {
+      tripped.store(true, std::memory_order_release);
+      tripCount.fetch_add(1, std::memory_order_relaxed);
+      if (tripHandler)
+      {
+        tripHandler(tripContext, channel, currentMa);
+      }
+    }
+  }
+  else
+  {
+    s.overCount = 0;
+  }
+
+  s.filteredQ8 += (((int32_t)currentMa << 8) - s.filteredQ8) >> config.filterShift;
+  s.squareSum += (uint32_t)currentMa * currentMa;
+  if (currentMa > s.peakMa)
+  {
+    s.peakMa = currentMa;
+  }
+  if (++s.windowCount < config.windowSamples)
+  {
+    return;
+  }
+
+  ChannelStats &out = working.channels[channel];
+  out.filteredMa = (uint16_t)((s.filteredQ8 + 0x80) >> 8);
+  out.rmsMa = isqrt((uint32_t)(s.squareSum / s.windowCount));
+  out.peakMa = s.peakMa;
+  if (channel == 0)
+  {
+    working.windows++;
+  }
+  s.squareSum = 0;
+  s.windowCount = 0;
+  s.peakMa = 0;
+  published.write(working);
+}
+
+uint16_t CurrentMonitor::isqrt(uint32_t value)
+{
+  // Bitwise integer square root, rounded down
+  uint32_t result = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (value >= result + bit)
+    {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else
+    {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint16_t)result;
+}
@@ -0,0 +1,102 @@
+#ifndef CURRENT_MONITOR_H
+#define CURRENT_MONITOR_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "SeqLock.h"
+
+// Motor current from the shield's sense outputs (A0/A1, 1.65 V/A).
+//
+// Raw ADC samples of both channels are fed in by a background sampler (the
+// ESP32 continuous ADC task) and run through, per channel:
+//   - a boxcar decimator averaging `decimation` raw samples, which also
+//     averages out the PWM ripple of the sense signal
+//   - a first-order low-pass (filtered += (x - filtered) >> filterShift)
+//   - RMS and peak over `windowSamples` decimated samples, published at the
+//     end of every window
+//   - the overcurrent trip: `tripSamples` decimated samples in a row at or
+//     above tripMa latch the trip and call the trip handler right away, on
+//     the sampler's context, without waiting for the control loop
+//
+// addSample() must be called from one context only; getStats(), isTripped()
+// and reset() are safe from any task.
+class CurrentMonitor
+{
+public:
+  static const uint8_t CHANNEL_COUNT = 2;
+
+  // Called on the sampler's context when a channel trips. Must not block.
+  typedef void (*TripHandler)(void *context, uint8_t channel, uint16_t currentMa);
+
+  struct Config
+  {
+    uint16_t fullScaleMv;   // input voltage at the maximum ADC reading
+    uint8_t adcBits;        // ADC resolution
+    uint16_t mvPerAmp;      // sense gain (1650 on the Motor Shield Rev3)
+    uint8_t decimation;     // raw samples per decimated sample
+    uint8_t filterShift;    // low-pass strength, 0 = no filtering
+    uint16_t windowSamples; // decimated samples per RMS/peak window
+    uint16_t tripMa;        // overcurrent threshold
+    uint8_t tripSamples;    // consecutive decimated samples over the threshold
+  };
+
+  struct ChannelStats
+  {
+    uint16_t filteredMa; // low-pass output at the end of the window
+    uint16_t rmsMa;      // over the last complete window
+    uint16_t peakMa;     // largest decimated sample in the last window
+    uint16_t reserved;
+  };
+
+  struct Stats
+  {
+    ChannelStats channels[CHANNEL_COUNT];
+    uint32_t windows; // windows completed on channel 0
+  };
+
+  explicit CurrentMonitor(const Config &config);
+
+  void setTripHandler(TripHandler handler, void *context);
+
+  // Feed one raw ADC reading of a channel
+  void addSample(uint8_t channel, uint16_t raw);
+
+  // Raw ADC reading -> milliamps
+  uint16_t toMilliamps(uint16_t raw) const;
+
+  Stats getStats() const { return published.read(); }
+
+  bool isTripped() const { return tripped.load(std::memory_order_acquire); }
+  uint32_t getTripCount() const { return tripCount.load(std::memory_order_relaxed); }
+
+  // Clear the trip latch (the counters keep running)
+  void reset() { tripped.store(false, std::memory_order_release); }
+
+private:
+  struct ChannelState
+  {
+    uint32_t decimationSum;
+    uint8_t decimationCount;
+    uint8_t overCount;
+    int32_t filteredQ8; // low-pass state, mA << 8
+    uint64_t squareSum;
+    uint16_t windowCount;
+    uint16_t peakMa;
+  };
+
+  Config config;
+  uint32_t maPerCountQ16;
+  ChannelState state[CHANNEL_COUNT];
+  Stats working;
+  SeqLock<Stats> published;
+  std::atomic<bool> tripped;
+  std::atomic<uint32_t> tripCount;
+  TripHandler tripHandler;
+  void *tripContext;
+
+  void addDecimated(uint8_t channel, uint16_t currentMa);
+  static uint16_t isqrt(uint32_t value);
+};
+
+#endif // CURRENT_MONITOR_H
@@ -0,0 +1,97 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include "ESP32CurrentSampler.h"
+
+#include <string.h>
+
+ESP32CurrentSampler::ESP32CurrentSampler(CurrentMonitor &monitor)
+    : monitor(monitor),
+      sampleCount(0)
+{
+  memset(channels, 0, sizeof(channels));
+}
+
+bool ESP32CurrentSampler::begin(const adc1_channel_t newChannels[CurrentMonitor::CHANNEL_COUNT],
+                                uint32_t rateHz, UBaseType_t priority, BaseType_t core)
+{
+  memcpy(channels, newChannels, sizeof(channels));
+
+  adc_digi_init_config_t init = {};
+  init.max_store_buf_size = FRAME_BYTES * 4;
+  init.conv_num_each_intr = FRAME_BYTES;
+  for (uint8_t i = 0; i < CurrentMonitor::CHANNEL_COUNT; i++)
+  {
+    init.adc1_chan_mask |= BIT(channels[i]);
+  }
+  if (adc_digi_initialize(&init) != ESP_OK)
+  {
+    return false;
+  }
+
+  // 11 dB attenuation: ~0-3.1 V, i.e. up to ~1.9 A at 1.65 V/A
+  adc_digi_pattern_config_t pattern[CurrentMonitor::CHANNEL_COUNT] = {};
+  for (uint8_t i = 0; i < CurrentMonitor::CHANNEL_COUNT; i++)
+  {
+    pattern[i].atten = ADC_ATTEN_DB_11;
+    pattern[i].channel = channels[i];
+    pattern[i].unit = 0; // ADC1
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_digi_configuration_t digital = {};
+  digital.conv_limit_en = 1; // required on the ESP32
+  digital.conv_limit_num = 250;
+  digital.pattern_num = CurrentMonitor::CHANNEL_COUNT;
+  digital.adc_pattern = pattern;
+  digital.sample_freq_hz = rateHz;
+  digital.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digital.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if (adc_digi_controller_configure(&digital) != ESP_OK)
+  {
+    adc_digi_deinitialize();
+    return false;
+  }
+  if (adc_digi_start() != ESP_OK)
+  {
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  return xTaskCreatePinnedToCore(task, "current", 3072, this, priority, nullptr, core) == pdPASS;
+}
+
+void ESP32CurrentSampler::task(void *parameter)
+{
+  static_cast<ESP32CurrentSampler *>(parameter)->run();
+}
+
+void ESP32CurrentSampler::run()
+{
+  uint8_t frame[FRAME_BYTES];
+  while (true)
+  {
+    uint32_t length = 0;
+    esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &length, ADC_MAX_DELAY);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+      // ESP_ERR_INVALID_STATE: the driver dropped old data, keep reading
+      continue;
+    }
+
+    for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES)
+    {
+      const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&frame[offset];
+      for (uint8_t i = 0; i < CurrentMonitor::CHANNEL_COUNT; i++)
+      {
+        if (result->type1.channel == channels[i])
+        {
+          monitor.addSample(i, result->type1.data);
+          break;
+        }
+      }
+    }
+    sampleCount += length / SOC_ADC_DIGI_RESULT_BYTES;
+  }
+}
+
+#endif // ARDUINO_ARCH_ESP32
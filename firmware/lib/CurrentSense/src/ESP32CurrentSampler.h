@@ -0,0 +1,42 @@
+#ifndef ESP32_CURRENT_SAMPLER_H
+#define ESP32_CURRENT_SAMPLER_H
+
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <driver/adc.h>
+
+#include "CurrentMonitor.h"
+
+// Samples both current sense inputs with the ESP32 continuous (DMA) ADC and
+// feeds a CurrentMonitor from a dedicated task. The ADC alternates between
+// the two ADC1 channels on its own; the task only drains the DMA ring
+// buffer, so nothing in the control loop ever waits for a conversion.
+class ESP32CurrentSampler
+{
+public:
+  // Bytes per DMA frame; SOC_ADC_DIGI_RESULT_BYTES (2 on the ESP32) per conversion
+  static const uint32_t FRAME_BYTES = 256;
+
+  explicit ESP32CurrentSampler(CurrentMonitor &monitor);
+
+  // channels[i] feeds CurrentMonitor channel i; rateHz is the total
+  // conversion rate, shared by both channels
+  bool begin(const adc1_channel_t channels[CurrentMonitor::CHANNEL_COUNT], uint32_t rateHz,
+             UBaseType_t priority, BaseType_t core);
+
+  // Conversions read so far
+  uint32_t getSampleCount() const { return sampleCount; }
+
+private:
+  CurrentMonitor &monitor;
+  adc1_channel_t channels[CurrentMonitor::CHANNEL_COUNT];
+  volatile uint32_t sampleCount;
+
+  static void task(void *parameter);
+  void run();
+};
+
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // ESP32_CURRENT_SAMPLER_H
@@ -0,0 +1,147 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "CurrentMonitor.h"
+
+// 12-bit ADC over 0..3300 mV at 1.65 V/A: 4095 counts = 2000 mA
+static CurrentMonitor::Config makeConfig(void) {
+    CurrentMonitor::Config config = {3300, 12, 1650, 10, 2, 100, 1800, 2};
+    return config;
+}
+
+static uint16_t countsFor(uint16_t ma) {
+    return (uint16_t)(((uint32_t)ma * 4095 + 1000) / 2000);
+}
+
+static uint32_t trips;
+static uint8_t trippedChannel;
+static uint16_t trippedMa;
+
+static void onTrip(void *context, uint8_t channel, uint16_t currentMa) {
+    trips++;
+    trippedChannel = channel;
+    trippedMa = currentMa;
+}
+
+void setUp(void) {
+    trips = 0;
+    trippedChannel = 0xFF;
+    trippedMa = 0;
+}
+
+void tearDown(void) {
+}
+
+// Test raw readings convert with the shield's sense gain
+void test_conversion(void) {
+    CurrentMonitor monitor(makeConfig());
+    TEST_ASSERT_EQUAL_UINT16(0, monitor.toMilliamps(0));
+    TEST_ASSERT_EQUAL_UINT16(2000, monitor.toMilliamps(4095));
+    TEST_ASSERT_UINT32_WITHIN(1, 1000, monitor.toMilliamps(2048));
+}
+
+// Test a steady current settles the filter, RMS and peak on it
+void test_steady_current(void) {
+    CurrentMonitor monitor(makeConfig());
+    for (int i = 0; i < 1000; i++) {
+        monitor.addSample(0, countsFor(1000));
+        monitor.addSample(1, countsFor(500));
+    }
+    CurrentMonitor::Stats stats = monitor.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.windows);
+    TEST_ASSERT_UINT32_WITHIN(2, 1000, stats.channels[0].filteredMa);
+    TEST_ASSERT_UINT32_WITHIN(2, 1000, stats.channels[0].rmsMa);
+    TEST_ASSERT_UINT32_WITHIN(2, 1000, stats.channels[0].peakMa);
+    TEST_ASSERT_UINT32_WITHIN(2, 500, stats.channels[1].rmsMa);
+    TEST_ASSERT_FALSE(monitor.isTripped());
+}
+
+// Test a square wave: mean on the filter, RMS above it, peak at the top
+void test_square_wave_rms_and_peak(void) {
+    CurrentMonitor monitor(makeConfig());
+    // 0 mA / 1600 mA alternating every decimated sample
+    for (int d = 0; d < 200; d++) {
+        uint16_t raw = (d & 1) ? countsFor(1600) : 0;
+        for (int i = 0; i < 10; i++) {
+            monitor.addSample(0, raw);
+        }
+    }
+    CurrentMonitor::Stats stats = monitor.getStats();
+    TEST_ASSERT_EQUAL_UINT32(2, stats.windows);
+    TEST_ASSERT_UINT32_WITHIN(3, 1131, stats.channels[0].rmsMa); // 1600 / sqrt(2)
+    TEST_ASSERT_UINT32_WITHIN(2, 1600, stats.channels[0].peakMa);
+    TEST_ASSERT_UINT32_WITHIN(400, 800, stats.channels[0].filteredMa);
+}
+
+// Test overcurrent trips within tripSamples decimated samples, on channel B
+void test_overcurrent_trips_fast(void) {
+    CurrentMonitor monitor(makeConfig());
+    monitor.setTripHandler(onTrip, nullptr);
+    for (int i = 0; i < 100; i++) {
+        monitor.addSample(1, countsFor(1000));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, trips);
+
+    int raw = 0;
+    while (trips == 0 && raw < 1000) {
+        monitor.addSample(1, countsFor(1950));
+        raw++;
+    }
+    // 2 decimated samples of 10 raw each: at 10 kHz per channel that is 2 ms
+    TEST_ASSERT_EQUAL_INT(20, raw);
+    TEST_ASSERT_TRUE(monitor.isTripped());
+    TEST_ASSERT_EQUAL_UINT8(1, trippedChannel);
+    TEST_ASSERT_UINT32_WITHIN(2, 1950, trippedMa);
+
+    // Latched: further samples do not call the handler again
+    for (int i = 0; i < 100; i++) {
+        monitor.addSample(1, countsFor(1950));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, trips);
+
+    // Reset while still over the limit trips again at once
+    monitor.reset();
+    for (int i = 0; i < 10; i++) {
+        monitor.addSample(1, countsFor(1950));
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, monitor.getTripCount());
+}
+
+// Test a single-sample spike is absorbed by the decimator
+void test_spike_does_not_trip(void) {
+    CurrentMonitor monitor(makeConfig());
+    monitor.setTripHandler(onTrip, nullptr);
+    for (int i = 0; i < 1000; i++) {
+        monitor.addSample(0, (i % 10 == 3) ? 4095 : countsFor(1000));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, trips);
+    TEST_ASSERT_FALSE(monitor.isTripped());
+    TEST_ASSERT_UINT32_WITHIN(5, 1100, monitor.getStats().channels[0].peakMa);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_conversion);
+    RUN_TEST(test_steady_current);
+    RUN_TEST(test_square_wave_rms_and_peak);
+    RUN_TEST(test_overcurrent_trips_fast);
+    RUN_TEST(test_spike_does_not_trip);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
@@ -0,0 +1,34 @@
+#include "DriveMixer.h"
+
+template <typename Signal>
+typename BasicDriveMixer<Signal>::Input BasicDriveMixer<Signal>::normalize(
+    const XboxBLEController::ControllerState &state)
+{
+  Input input;
+  input.stickX = Signal::fromStick(state.leftStickX);
+  input.stickY = Signal::fromStick(state.leftStickY);
+  input.leftTrigger = Signal::fromTrigger(state.leftTrigger);
+  input.rightTrigger = Signal::fromTrigger(state.rightTrigger);
+  return input;
+}
+
+template <typename Signal>
+typename BasicDriveMixer<Signal>::Output BasicDriveMixer<Signal>::mix(const Input &input)
+{
+  Value forward = Signal::negate(input.stickY); // Invert Y (up is positive)
+  Value turn = input.stickX;
+
+  Output output;
+  output.left = Signal::clampUnit(Signal::add(forward, turn));
+  output.right = Signal::clampUnit(Signal::sub(forward, turn));
+
+  // Apply trigger modulation
+  Value throttle = Signal::abs(Signal::sub(input.rightTrigger, input.leftTrigger));
+  output.left = Signal::mul(output.left, throttle);
+  output.right = Signal::mul(output.right, throttle);
+  return output;
+}
+
+// Both pipelines are built everywhere so they can be compared on the host
+template class BasicDriveMixer<FloatSignal>;
+template class BasicDriveMixer<Q15Signal>;
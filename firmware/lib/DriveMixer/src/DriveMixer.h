@@ -0,0 +1,40 @@
+#ifndef DRIVE_MIXER_H
+#define DRIVE_MIXER_H
+
+#include "DriveSignal.h"
+#include "XboxBLEController.h"
+
+// Tank drive: left stick steers and sets direction, the triggers scale the
+// result (right = throttle, left = brake).
+//
+// Signal is an arithmetic policy from DriveSignal.h; DriveMixer below is
+// the one selected at compile time.
+template <typename Signal>
+class BasicDriveMixer
+{
+public:
+  typedef typename Signal::Value Value;
+
+  // Controller input scaled to -1..1 (sticks) and 0..1 (triggers)
+  struct Input
+  {
+    Value stickX;       // steering, right positive
+    Value stickY;       // forward/back, down positive (raw HID orientation)
+    Value leftTrigger;  // brake
+    Value rightTrigger; // throttle
+  };
+
+  // Motor commands, -1 to 1
+  struct Output
+  {
+    Value left;
+    Value right;
+  };
+
+  static Input normalize(const XboxBLEController::ControllerState &state);
+  static Output mix(const Input &input);
+};
+
+typedef BasicDriveMixer<DriveSignal> DriveMixer;
+
+#endif // DRIVE_MIXER_H
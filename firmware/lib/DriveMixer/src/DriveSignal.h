@@ -0,0 +1,77 @@
+#ifndef DRIVE_SIGNAL_H
+#define DRIVE_SIGNAL_H
+
+#include <stdint.h>
+
+// Arithmetic policies for the drive pipeline (normalize -> mix -> clamp ->
+// throttle scale). BasicDriveMixer is written once against this interface
+// and instantiated with either policy.
+//
+// Q15Signal is integer only: no float, no divide, and every rounding step
+// is spelled out, so its results depend only on GCC's arithmetic >> on
+// negative values. test_q15_bit_exact pins a hash of a full input sweep:
+// the native env checks it on the host and `platformio test -e genuino101`
+// on the Arduino 101. FloatSignal is the original float math.
+
+struct FloatSignal
+{
+  typedef float Value;
+
+  static Value fromStick(int16_t raw) { return raw / 32768.0f; }
+  static Value fromTrigger(uint16_t raw) { return raw / 255.0f; }
+  static Value negate(Value a) { return -a; }
+  static Value add(Value a, Value b) { return a + b; }
+  static Value sub(Value a, Value b) { return a - b; }
+  static Value mul(Value a, Value b) { return a * b; }
+  static Value abs(Value a) { return a < 0.0f ? -a : a; }
+  static Value clampUnit(Value a) { return a > 1.0f ? 1.0f : (a < -1.0f ? -1.0f : a); }
+
+  // Saturating, to the -32767..32767 range MotorShield and telemetry take
+  static int16_t toQ15(Value a)
+  {
+    a = clampUnit(a);
+    return (int16_t)(a * 32767.0f + (a < 0.0f ? -0.5f : 0.5f));
+  }
+};
+
+struct Q15Signal
+{
+  // Q15 in an int32_t: 32768 = 1.0; wide enough that sums cannot overflow
+  // before clampUnit()
+  typedef int32_t Value;
+
+  static Value fromStick(int16_t raw) { return raw; }
+
+  // 0..255 -> 0..32767 exactly: t * 128.5 without a divide
+  static Value fromTrigger(uint16_t raw)
+  {
+    if (raw > 255)
+      raw = 255;
+    return ((int32_t)raw << 7) | (raw >> 1);
+  }
+
+  static Value negate(Value a) { return -a; }
+  static Value add(Value a, Value b) { return a + b; }
+  static Value sub(Value a, Value b) { return a - b; }
+
+  // Rounded to nearest, halves towards +infinity
+  static Value mul(Value a, Value b) { return (a * b + (1 << 14)) >> 15; }
+
+  static Value abs(Value a) { return a < 0 ? -a : a; }
+  static Value clampUnit(Value a) { return a > 32767 ? 32767 : (a < -32767 ? -32767 : a); }
+  static int16_t toQ15(Value a) { return (int16_t)clampUnit(a); }
+};
+
+// Signal the firmware is built with. Fixed point unless DRIVE_FIXED_POINT=0,
+// so every target, FPU or not, runs the same integer pipeline.
+#ifndef DRIVE_FIXED_POINT
+#define DRIVE_FIXED_POINT 1
+#endif
+
+#if DRIVE_FIXED_POINT
+typedef Q15Signal DriveSignal;
+#else
+typedef FloatSignal DriveSignal;
+#endif
+
+#endif // DRIVE_SIGNAL_H
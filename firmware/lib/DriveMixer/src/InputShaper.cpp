@@ -0,0 +1,124 @@
+#include "InputShaper.h"
+
+static const InputShaper::AxisProfile LINEAR_PROFILE = {0, 0, 0};
+
+InputShaper::InputShaper()
+{
+  for (uint8_t axis = 0; axis < AXIS_COUNT; axis++)
+  {
+    for (uint8_t bank = 0; bank < 2; bank++)
+    {
+      banks[axis][bank].profile = LINEAR_PROFILE;
+      buildTable(LINEAR_PROFILE, banks[axis][bank].lut);
+    }
+    active[axis].store(0, std::memory_order_relaxed);
+    last[axis] = 0;
+  }
+}
+
+void InputShaper::setProfile(Axis axis, const AxisProfile &profile)
+{
+  if (axis >= AXIS_COUNT)
+    return;
+
+  // Fill the table the loop isn't reading, then switch it over
+  uint8_t idle = active[axis].load(std::memory_order_relaxed) ^ 1;
+  Bank &bank = banks[axis][idle];
+  bank.profile = profile;
+  buildTable(profile, bank.lut);
+  active[axis].store(idle, std::memory_order_release);
+}
+
+const InputShaper::AxisProfile &InputShaper::getProfile(Axis axis) const
+{
+  return banks[axis][active[axis].load(std::memory_order_acquire)].profile;
+}
+
+XboxBLEController::ControllerState InputShaper::shape(const XboxBLEController::ControllerState &state,
+                                                      uint32_t dtUs)
+{
+  XboxBLEController::ControllerState shaped = state;
+  shaped.leftStickX = shapeAxis(AXIS_STICK_X, state.leftStickX, dtUs);
+  shaped.leftStickY = shapeAxis(AXIS_STICK_Y, state.leftStickY, dtUs);
+
+  // Triggers are 0..255; widen to Q15 the same way the fixed-point mixer
+  // does, so a linear profile hands back the raw value unchanged
+  uint16_t triggers[2] = {state.leftTrigger, state.rightTrigger};
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    uint16_t raw = triggers[i] > 255 ? 255 : triggers[i];
+    int16_t value = (int16_t)((raw << 7) | (raw >> 1));
+    triggers[i] = (uint16_t)(shapeAxis((Axis)(AXIS_LEFT_TRIGGER + i), value, dtUs) >> 7);
+  }
+  shaped.leftTrigger = triggers[0];
+  shaped.rightTrigger = triggers[1];
+  return shaped;
+}
+
+int16_t InputShaper::shapeAxis(Axis axis, int16_t value, uint32_t dtUs)
+{
+  const Bank &bank = banks[axis][active[axis].load(std::memory_order_acquire)];
+
+  uint16_t magnitude = value < 0 ? (uint16_t)(-(int32_t)value) : (uint16_t)value;
+  int32_t target = lookup(bank.lut, magnitude);
+  if (value < 0)
+    target = -target;
+
+  if (bank.profile.slewQ15PerSec != 0)
+    target = slew(last[axis], target, bank.profile.slewQ15PerSec, dtUs);
+  last[axis] = target;
+  return (int16_t)target;
+}
+
+void InputShaper::reset()
+{
+  for (uint8_t axis = 0; axis < AXIS_COUNT; axis++)
+    last[axis] = 0;
+}
+
+void InputShaper::buildTable(const AxisProfile &profile, uint16_t *lut)
+{
+  float deadzone = profile.deadzoneQ15 / 32768.0f;
+  float expo = profile.expoQ15 / 32767.0f;
+  for (uint16_t i = 0; i <= LUT_SEGMENTS; i++)
+  {
+    float x = (float)i / LUT_SEGMENTS;
+    float y = 0.0f;
+    if (x > deadzone)
+    {
+      float t = (x - deadzone) / (1.0f - deadzone);
+      y = (1.0f - expo) * t + expo * t * t * t;
+    }
+    lut[i] = (uint16_t)(y * 32768.0f + 0.5f);
+  }
+}
+
+int16_t InputShaper::lookup(const uint16_t *lut, uint16_t magnitude)
+{
+  // Full deflection always reaches full scale
+  if (magnitude >= 32767)
+    return lut[LUT_SEGMENTS] > 32767 ? 32767 : (int16_t)lut[LUT_SEGMENTS];
+
+  // 128 input steps per segment; the last point is 32768, clamp after
+  uint16_t index = magnitude >> 7;
+  int32_t fraction = magnitude & 0x7F;
+  int32_t low = lut[index];
+  int32_t high = lut[index + 1];
+  int32_t value = low + (((high - low) * fraction) >> 7);
+  return (int16_t)(value > 32767 ? 32767 : value);
+}
+
+int32_t InputShaper::slew(int32_t from, int32_t to, uint32_t slewQ15PerSec, uint32_t dtUs)
+{
+  // Always allow at least one LSB so a short period can't freeze the output
+  uint32_t maxStep = (uint32_t)(((uint64_t)slewQ15PerSec * dtUs) / 1000000);
+  if (maxStep == 0)
+    maxStep = 1;
+
+  int32_t delta = to - from;
+  if (delta > (int32_t)maxStep)
+    return from + (int32_t)maxStep;
+  if (delta < -(int32_t)maxStep)
+    return from - (int32_t)maxStep;
+  return to;
+}
@@ -0,0 +1,78 @@
+#ifndef INPUT_SHAPER_H
+#define INPUT_SHAPER_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "XboxBLEController.h"
+
+// Per-axis input shaping between the controller and the mixer:
+//   - deadzone: magnitudes below it read as zero, the rest is rescaled so
+//     the output still starts at zero and reaches full scale
+//   - expo: blend of linear and cubic response for fine control near center
+//   - slew limit: the output moves at most slewQ15PerSec per second, scaled
+//     by the control period passed to shape()
+//
+// Deadzone and expo are baked into a 257-point lookup table per axis
+// (magnitude in, magnitude out, linear interpolation between points), so
+// shape() costs the same every tick whatever the profile.
+//
+// Each axis has two tables. setProfile() rebuilds the idle one and then
+// publishes it, so profiles can be swapped while the loop runs without
+// allocating. It must be called from one task, at most once per axis per
+// control tick; shape() and reset() belong to the control loop.
+class InputShaper
+{
+public:
+  enum Axis
+  {
+    AXIS_STICK_X,
+    AXIS_STICK_Y,
+    AXIS_LEFT_TRIGGER,
+    AXIS_RIGHT_TRIGGER,
+    AXIS_COUNT
+  };
+
+  struct AxisProfile
+  {
+    uint16_t deadzoneQ15;   // 0 = none, 3277 = ~10% of full scale
+    uint16_t expoQ15;       // 0 = linear, 32767 = fully cubic
+    uint32_t slewQ15PerSec; // full scale is 32767; 0 = unlimited
+  };
+
+  static const uint16_t LUT_SEGMENTS = 256;
+
+  // Every axis starts linear, without deadzone or slew limit
+  InputShaper();
+
+  void setProfile(Axis axis, const AxisProfile &profile);
+  const AxisProfile &getProfile(Axis axis) const;
+
+  // Shape the sticks and triggers of a state; the other fields are copied.
+  // dtUs is the time since the previous call.
+  XboxBLEController::ControllerState shape(const XboxBLEController::ControllerState &state, uint32_t dtUs);
+
+  // Shape one axis value in Q15 (-32768..32767, triggers 0..32767)
+  int16_t shapeAxis(Axis axis, int16_t value, uint32_t dtUs);
+
+  // Drop the slew state so the next shape() starts from zero, e.g. after
+  // the input was lost
+  void reset();
+
+private:
+  struct Bank
+  {
+    AxisProfile profile;
+    uint16_t lut[LUT_SEGMENTS + 1]; // magnitudes, full scale 32768
+  };
+
+  Bank banks[AXIS_COUNT][2];
+  std::atomic<uint8_t> active[AXIS_COUNT];
+  int32_t last[AXIS_COUNT];
+
+  static void buildTable(const AxisProfile &profile, uint16_t *lut);
+  static int16_t lookup(const uint16_t *lut, uint16_t magnitude);
+  static int32_t slew(int32_t from, int32_t to, uint32_t slewQ15PerSec, uint32_t dtUs);
+};
+
+#endif // INPUT_SHAPER_H
@@ -0,0 +1,195 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <stdio.h>
+#include "DriveMixer.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+typedef BasicDriveMixer<FloatSignal> FloatMixer;
+typedef BasicDriveMixer<Q15Signal> Q15Mixer;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static FloatMixer::Input makeInput(float x, float y, float lt, float rt) {
+    FloatMixer::Input input = {x, y, lt, rt};
+    return input;
+}
+
+static XboxBLEController::ControllerState makeState(int16_t x, int16_t y, uint16_t lt, uint16_t rt) {
+    XboxBLEController::ControllerState state = {x, y, 0, 0, lt, rt, 0, 0, true, 0};
+    return state;
+}
+
+// Test stick up with full throttle drives both motors forward
+void test_mix_forward(void) {
+    FloatMixer::Output output = FloatMixer::mix(makeInput(0.0f, -1.0f, 0.0f, 1.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0f, output.left);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0f, output.right);
+
+    Q15Mixer::Output fixed = Q15Mixer::mix(Q15Mixer::normalize(makeState(0, -32768, 0, 255)));
+    TEST_ASSERT_EQUAL_INT32(32766, fixed.left); // 0x7FFF * 0x7FFF loses one LSB in Q15
+    TEST_ASSERT_EQUAL_INT32(32766, fixed.right);
+}
+
+// Test turning is clamped per side and scaled by the trigger difference
+void test_mix_turn_clamped_and_scaled(void) {
+    FloatMixer::Output output = FloatMixer::mix(makeInput(0.5f, -1.0f, 0.25f, 0.75f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.5f, output.left);   // min(1.5, 1) * 0.5
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.25f, output.right); // 0.5 * 0.5
+
+    // Brake harder than throttle still scales by the magnitude
+    output = FloatMixer::mix(makeInput(-1.0f, 0.0f, 1.0f, 0.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -1.0f, output.left);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0f, output.right);
+}
+
+// Test normalization of a raw controller state
+void test_normalize_state(void) {
+    FloatMixer::Input input = FloatMixer::normalize(makeState(-32768, 16384, 255, 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -1.0f, input.stickX);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.5f, input.stickY);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0f, input.leftTrigger);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.0f, input.rightTrigger);
+
+    Q15Mixer::Input fixed = Q15Mixer::normalize(makeState(-32768, 16384, 255, 128));
+    TEST_ASSERT_EQUAL_INT32(-32768, fixed.stickX);
+    TEST_ASSERT_EQUAL_INT32(16384, fixed.stickY);
+    TEST_ASSERT_EQUAL_INT32(32767, fixed.leftTrigger);
+    TEST_ASSERT_EQUAL_INT32(16448, fixed.rightTrigger); // 128 * 128.5
+}
+
+// Walk a grid of raw inputs through a mixer, calling visit for each output
+template <typename Mixer, typename Visitor>
+static void sweep(Visitor &visit) {
+    for (int32_t x = -32768; x <= 32767; x += 4099) {
+        for (int32_t y = -32768; y <= 32767; y += 3989) {
+            for (uint16_t lt = 0; lt <= 255; lt += 51) {
+                for (uint16_t rt = 0; rt <= 255; rt += 17) {
+                    XboxBLEController::ControllerState state = makeState((int16_t)x, (int16_t)y, lt, rt);
+                    visit(state, Mixer::mix(Mixer::normalize(state)));
+                }
+            }
+        }
+    }
+}
+
+struct ErrorVisitor {
+    int32_t maxError;
+    uint32_t samples;
+    void operator()(const XboxBLEController::ControllerState &state, const Q15Mixer::Output &fixed) {
+        FloatMixer::Output reference = FloatMixer::mix(FloatMixer::normalize(state));
+        int32_t errors[2] = {fixed.left - FloatSignal::toQ15(reference.left),
+                             fixed.right - FloatSignal::toQ15(reference.right)};
+        for (int i = 0; i < 2; i++) {
+            int32_t e = errors[i] < 0 ? -errors[i] : errors[i];
+            if (e > maxError) {
+                maxError = e;
+            }
+        }
+        samples++;
+    }
+};
+
+// Test the fixed-point path stays within a few LSB of the float path
+void test_q15_matches_float(void) {
+    ErrorVisitor visitor = {0, 0};
+    sweep<Q15Mixer>(visitor);
+    printf("  %u samples, max |q15 - float| = %d LSB\n", (unsigned)visitor.samples, (int)visitor.maxError);
+    TEST_ASSERT_TRUE(visitor.samples > 10000);
+    TEST_ASSERT_TRUE(visitor.maxError <= 3);
+}
+
+struct HashVisitor {
+    uint32_t hash;
+    void operator()(const XboxBLEController::ControllerState &state, const Q15Mixer::Output &fixed) {
+        // FNV-1a over the output bits
+        uint32_t values[2] = {(uint32_t)fixed.left, (uint32_t)fixed.right};
+        for (int i = 0; i < 2; i++) {
+            for (int b = 0; b < 32; b += 8) {
+                hash = (hash ^ ((values[i] >> b) & 0xFF)) * 16777619u;
+            }
+        }
+    }
+};
+
+// Test the fixed-point path is bit-exact: the same hash on every target
+void test_q15_bit_exact(void) {
+    HashVisitor visitor = {2166136261u};
+    sweep<Q15Mixer>(visitor);
+    printf("  q15 sweep hash 0x%08x\n", (unsigned)visitor.hash);
+    TEST_ASSERT_EQUAL_HEX32(0x7D2F2AFDu, visitor.hash);
+}
+
+static uint32_t clockTicks(void) {
+#ifdef ARDUINO_ARCH_ESP32
+    return ESP.getCycleCount();
+#elif defined(ARDUINO)
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+template <typename Mixer>
+static float benchmark(volatile int32_t &sink) {
+    const int ROUNDS = 200000;
+    uint32_t start = clockTicks();
+    for (int i = 0; i < ROUNDS; i++) {
+        XboxBLEController::ControllerState state = makeState((int16_t)(i * 7), (int16_t)(i * 13), i & 0xFF, (i >> 3) & 0xFF);
+        typename Mixer::Output output = Mixer::mix(Mixer::normalize(state));
+        sink = sink + (int32_t)(output.left > 0) + (int32_t)(output.right > 0);
+    }
+    return (float)(clockTicks() - start) / ROUNDS;
+}
+
+// Benchmark: ns per tick on the host, cycles per tick on the ESP32
+void test_benchmark_float_vs_q15(void) {
+    volatile int32_t sink = 0;
+    float floatCost = benchmark<FloatMixer>(sink);
+    float fixedCost = benchmark<Q15Mixer>(sink);
+#ifdef ARDUINO_ARCH_ESP32
+    const char *unit = "cycles";
+#elif defined(ARDUINO)
+    const char *unit = "us";
+#else
+    const char *unit = "ns";
+#endif
+    printf("  normalize+mix: float %.2f %s, q15 %.2f %s\n", floatCost, unit, fixedCost, unit);
+    TEST_ASSERT_TRUE(fixedCost > 0.0f);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mix_forward);
+    RUN_TEST(test_mix_turn_clamped_and_scaled);
+    RUN_TEST(test_normalize_state);
+    RUN_TEST(test_q15_matches_float);
+    RUN_TEST(test_q15_bit_exact);
+    RUN_TEST(test_benchmark_float_vs_q15);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
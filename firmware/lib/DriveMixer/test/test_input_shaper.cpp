@@ -0,0 +1,156 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "InputShaper.h"
+
+static const uint32_t TICK_US = 20000; // 50 Hz control loop
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static XboxBLEController::ControllerState makeState(int16_t x, int16_t y, uint16_t lt, uint16_t rt) {
+    XboxBLEController::ControllerState state = {x, y, 0, 0, lt, rt, 0, 0, true, 0};
+    return state;
+}
+
+// Test the default profile passes every input through unchanged
+void test_linear_is_identity(void) {
+    InputShaper shaper;
+    for (int32_t v = -32768; v <= 32767; v += 7) {
+        int16_t expected = v == -32768 ? -32767 : (int16_t)v;
+        TEST_ASSERT_EQUAL_INT16(expected, shaper.shapeAxis(InputShaper::AXIS_STICK_X, (int16_t)v, TICK_US));
+    }
+    for (uint16_t t = 0; t <= 255; t++) {
+        XboxBLEController::ControllerState shaped = shaper.shape(makeState(0, 0, t, 255 - t), TICK_US);
+        TEST_ASSERT_EQUAL_UINT16(t, shaped.leftTrigger);
+        TEST_ASSERT_EQUAL_UINT16(255 - t, shaped.rightTrigger);
+    }
+}
+
+// Test the deadzone zeroes small inputs and keeps the output continuous
+void test_deadzone(void) {
+    InputShaper shaper;
+    InputShaper::AxisProfile profile = {3277, 0, 0}; // ~10%
+    shaper.setProfile(InputShaper::AXIS_STICK_X, profile);
+
+    TEST_ASSERT_EQUAL_INT16(0, shaper.shapeAxis(InputShaper::AXIS_STICK_X, 3000, TICK_US));
+    TEST_ASSERT_EQUAL_INT16(0, shaper.shapeAxis(InputShaper::AXIS_STICK_X, -3000, TICK_US));
+    TEST_ASSERT_TRUE(shaper.shapeAxis(InputShaper::AXIS_STICK_X, 3500, TICK_US) < 400);
+    TEST_ASSERT_INT32_WITHIN(2, 16384, shaper.shapeAxis(InputShaper::AXIS_STICK_X, 18022, TICK_US)); // halfway past the deadzone
+    TEST_ASSERT_EQUAL_INT16(32767, shaper.shapeAxis(InputShaper::AXIS_STICK_X, 32767, TICK_US));
+    TEST_ASSERT_EQUAL_INT16(-32767, shaper.shapeAxis(InputShaper::AXIS_STICK_X, -32768, TICK_US));
+
+    // Other axes are untouched
+    TEST_ASSERT_EQUAL_INT16(3000, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, 3000, TICK_US));
+}
+
+// Test expo softens the center and stays monotonic
+void test_expo_curve(void) {
+    InputShaper shaper;
+    InputShaper::AxisProfile profile = {0, 32767, 0}; // fully cubic
+    shaper.setProfile(InputShaper::AXIS_STICK_Y, profile);
+
+    TEST_ASSERT_INT32_WITHIN(16, 4096, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, 16384, TICK_US));
+    TEST_ASSERT_INT32_WITHIN(16, -4096, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, -16384, TICK_US));
+
+    int16_t previous = -32767;
+    for (int32_t v = -32767; v <= 32767; v += 13) {
+        int16_t shaped = shaper.shapeAxis(InputShaper::AXIS_STICK_Y, (int16_t)v, TICK_US);
+        TEST_ASSERT_TRUE(shaped >= previous);
+        previous = shaped;
+    }
+}
+
+// Test the slew limit scales with the control period
+void test_slew_limit(void) {
+    InputShaper shaper;
+    InputShaper::AxisProfile profile = {0, 0, 65534}; // full scale in 0.5 s
+    shaper.setProfile(InputShaper::AXIS_STICK_Y, profile);
+
+    // 20 ms allows 1310 per tick
+    TEST_ASSERT_EQUAL_INT16(1310, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, 32767, TICK_US));
+    TEST_ASSERT_EQUAL_INT16(2620, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, 32767, TICK_US));
+    // 10 ms allows half as much
+    TEST_ASSERT_EQUAL_INT16(3275, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, 32767, TICK_US / 2));
+
+    // A full reversal takes about a second instead of one tick
+    uint16_t ticks = 0;
+    while (shaper.shapeAxis(InputShaper::AXIS_STICK_Y, -32767, TICK_US) != -32767)
+        ticks++;
+    TEST_ASSERT_UINT32_WITHIN(2, 27, ticks);
+
+    // Small changes pass straight through
+    TEST_ASSERT_EQUAL_INT16(-32000, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, -32000, TICK_US));
+
+    shaper.reset();
+    TEST_ASSERT_EQUAL_INT16(-1310, shaper.shapeAxis(InputShaper::AXIS_STICK_Y, -32767, TICK_US));
+}
+
+// Test the trigger path goes through the same stages
+void test_trigger_shaping(void) {
+    InputShaper shaper;
+    InputShaper::AxisProfile profile = {1638, 0, 32767}; // ~5% deadzone, full scale in 1 s
+    shaper.setProfile(InputShaper::AXIS_RIGHT_TRIGGER, profile);
+
+    XboxBLEController::ControllerState shaped = shaper.shape(makeState(100, -100, 10, 10), TICK_US);
+    TEST_ASSERT_EQUAL_INT16(100, shaped.leftStickX);
+    TEST_ASSERT_EQUAL_INT16(-100, shaped.leftStickY);
+    TEST_ASSERT_EQUAL_UINT16(10, shaped.leftTrigger);
+    TEST_ASSERT_EQUAL_UINT16(0, shaped.rightTrigger);
+    TEST_ASSERT_TRUE(shaped.connected);
+
+    uint16_t ticks = 0;
+    while (shaper.shape(makeState(0, 0, 0, 255), TICK_US).rightTrigger != 255)
+        ticks++;
+    TEST_ASSERT_UINT32_WITHIN(2, 50, ticks);
+}
+
+// Test a profile swap takes effect on the next call and keeps the tables in place
+void test_runtime_swap(void) {
+    InputShaper shaper;
+    const InputShaper::AxisProfile *before = &shaper.getProfile(InputShaper::AXIS_STICK_X);
+
+    InputShaper::AxisProfile soft = {0, 32767, 0};
+    InputShaper::AxisProfile coarse = {8192, 0, 0};
+    for (int round = 0; round < 4; round++) {
+        shaper.setProfile(InputShaper::AXIS_STICK_X, soft);
+        TEST_ASSERT_INT32_WITHIN(16, 4096, shaper.shapeAxis(InputShaper::AXIS_STICK_X, 16384, TICK_US));
+        shaper.setProfile(InputShaper::AXIS_STICK_X, coarse);
+        TEST_ASSERT_EQUAL_INT16(0, shaper.shapeAxis(InputShaper::AXIS_STICK_X, 8000, TICK_US));
+        TEST_ASSERT_EQUAL_UINT16(8192, shaper.getProfile(InputShaper::AXIS_STICK_X).deadzoneQ15);
+    }
+
+    // Two banks per axis, alternated
+    TEST_ASSERT_TRUE(&shaper.getProfile(InputShaper::AXIS_STICK_X) == before);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_linear_is_identity);
+    RUN_TEST(test_deadzone);
+    RUN_TEST(test_expo_curve);
+    RUN_TEST(test_slew_limit);
+    RUN_TEST(test_trigger_shaping);
+    RUN_TEST(test_runtime_swap);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
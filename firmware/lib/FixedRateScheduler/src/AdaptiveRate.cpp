@@ -0,0 +1,172 @@
+#include "AdaptiveRate.h"
+
+uint16_t AdaptiveRate::Stats::dutyPermille() const
+{
+  if (elapsedUs == 0)
+  {
+    return 0;
+  }
+  return (uint16_t)(busyUs * 1000 / elapsedUs);
+}
+
+uint32_t AdaptiveRate::Stats::meanWakeLatencyUs() const
+{
+  if (wakeups == 0)
+  {
+    return 0;
+  }
+  return (uint32_t)(totalWakeLatencyUs / wakeups);
+}
+
+AdaptiveRate::AdaptiveRate(const Config &config, FixedRateScheduler::ClockFn clock,
+                           FixedRateScheduler::SleepFn sleep)
+    : config(config),
+      clock(clock),
+      scheduler(config.activeHz, clock, sleep),
+      mode(MODE_ACTIVE),
+      wakePending(false),
+      wakeRequestUs(0),
+      tickUs(0),
+      lastChangeUs(0),
+      lastActivityUs(0),
+      recentChange(false),
+      recentActivity(true),
+      started(false),
+      measuring(false)
+{
+  resetStats();
+}
+
+bool AdaptiveRate::waitForNextTick()
+{
+  if (measuring)
+  {
+    stats.busyUs += clock() - tickUs;
+  }
+
+  // A wake() that found the loop outside idle, just before update() went
+  // idle, is still pending: end the idle wait before it sleeps. Pairs with
+  // the store-then-load order in wake(), so one side always sees the other.
+  if (getMode() == MODE_IDLE && wakePending.load())
+  {
+    scheduler.wake();
+  }
+
+  bool woken = scheduler.waitForNextTick();
+  uint32_t now = clock();
+  if (measuring)
+  {
+    // The time since the last tick went by in the mode chosen after it
+    uint32_t span = now - tickUs;
+    stats.elapsedUs += span;
+    stats.modeUs[getMode()] += span;
+  }
+  if (!started)
+  {
+    // Quiescence is timed from the first tick
+    lastActivityUs = now;
+    started = true;
+  }
+  measuring = true;
+  tickUs = now;
+
+  if (woken)
+  {
+    stats.wakeups++;
+    uint32_t latency = now - wakeRequestUs.load(std::memory_order_relaxed);
+    stats.totalWakeLatencyUs += latency;
+    if (latency > stats.maxWakeLatencyUs)
+      stats.maxWakeLatencyUs = latency;
+
+    // Only input changes wake the loop
+    lastChangeUs = now;
+    lastActivityUs = now;
+    recentChange = true;
+    recentActivity = true;
+    setMode(MODE_BOOST);
+  }
+  wakePending.store(false, std::memory_order_relaxed);
+  stats.ticks[getMode()]++;
+  return woken;
+}
+
+void AdaptiveRate::update(Activity activity)
+{
+  if (activity == ACTIVITY_CHANGING)
+  {
+    lastChangeUs = tickUs;
+    recentChange = true;
+  }
+  if (activity != ACTIVITY_NONE)
+  {
+    lastActivityUs = tickUs;
+    recentActivity = true;
+  }
+
+  // Ticks come at least once a second, long before the differences wrap
+  if (recentChange && tickUs - lastChangeUs >= config.boostHoldMs * 1000)
+    recentChange = false;
+  if (recentActivity && tickUs - lastActivityUs >= config.quiescentMs * 1000)
+    recentActivity = false;
+
+  setMode(recentChange ? MODE_BOOST : recentActivity ? MODE_ACTIVE : MODE_IDLE);
+}
+
+bool AdaptiveRate::wake()
+{
+  // The first request since the last tick sets the latency reference
+  uint32_t now = clock();
+  if (!wakePending.exchange(true))
+  {
+    wakeRequestUs.store(now, std::memory_order_relaxed);
+  }
+  if (mode.load() != MODE_IDLE)
+  {
+    return false;
+  }
+  scheduler.wake();
+  return true;
+}
+
+const char *AdaptiveRate::modeName(Mode mode)
+{
+  switch (mode)
+  {
+  case MODE_IDLE:
+    return "idle";
+  case MODE_ACTIVE:
+    return "active";
+  case MODE_BOOST:
+    return "boost";
+  default:
+    return "unknown";
+  }
+}
+
+void AdaptiveRate::resetStats()
+{
+  for (uint8_t i = 0; i < MODE_COUNT; i++)
+  {
+    stats.ticks[i] = 0;
+    stats.modeUs[i] = 0;
+  }
+  stats.busyUs = 0;
+  stats.elapsedUs = 0;
+  stats.switches = 0;
+  stats.wakeups = 0;
+  stats.maxWakeLatencyUs = 0;
+  stats.totalWakeLatencyUs = 0;
+  measuring = false;
+}
+
+void AdaptiveRate::setMode(Mode next)
+{
+  if (next == getMode())
+  {
+    return;
+  }
+  const uint16_t rates[MODE_COUNT] = {config.idleHz, config.activeHz, config.boostHz};
+  scheduler.setRateHz(rates[next]);
+  mode.store(next);
+  stats.switches++;
+}
@@ -0,0 +1,113 @@
+#ifndef ADAPTIVE_RATE_H
+#define ADAPTIVE_RATE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "FixedRateScheduler.h"
+
+// Picks the tick rate of a FixedRateScheduler from what the loop is doing.
+//
+// The loop reports its activity after every tick with update(). While the
+// input changes it ticks at boostHz, and for boostHoldMs after the last
+// change; while it holds a non-zero command, at activeHz. Once nothing has
+// happened for quiescentMs it drops to idleHz and the CPU idles between the
+// sparse ticks.
+//
+// wake(), from the input notification path, ends an idle wait at once and
+// switches to boostHz, so a change in input is acted on when its report
+// arrives rather than up to an idle period later. Outside idle the regular
+// ticks are frequent enough, but the request is kept until the next tick
+// starts: a report that lands while the loop is switching to idle ends the
+// first idle wait before it sleeps.
+//
+// The duty cycle (time inside ticks over time elapsed), the share of time
+// and ticks per mode and the wake latency (wake() to the start of the tick)
+// show the power/latency tradeoff.
+class AdaptiveRate
+{
+public:
+  enum Activity
+  {
+    ACTIVITY_NONE,     // zero command, input unchanged
+    ACTIVITY_HOLDING,  // non-zero command, input unchanged
+    ACTIVITY_CHANGING, // input changed since the last tick
+  };
+
+  enum Mode
+  {
+    MODE_IDLE,
+    MODE_ACTIVE,
+    MODE_BOOST,
+    MODE_COUNT
+  };
+
+  struct Config
+  {
+    uint16_t idleHz;
+    uint16_t activeHz;
+    uint16_t boostHz;
+    uint32_t boostHoldMs; // boost kept after the last change
+    uint32_t quiescentMs; // no activity this long before idling
+  };
+
+  struct Stats
+  {
+    uint32_t ticks[MODE_COUNT];
+    uint64_t modeUs[MODE_COUNT]; // time spent in each mode
+    uint64_t busyUs;             // from tick starts to the following waits
+    uint64_t elapsedUs;          // since the first tick after the reset
+    uint32_t switches;           // mode changes
+    uint32_t wakeups;            // idle waits ended by wake()
+    uint32_t maxWakeLatencyUs;
+    uint64_t totalWakeLatencyUs;
+
+    uint16_t dutyPermille() const;
+    uint32_t meanWakeLatencyUs() const;
+  };
+
+  // Starts at activeHz
+  AdaptiveRate(const Config &config, FixedRateScheduler::ClockFn clock, FixedRateScheduler::SleepFn sleep);
+
+  // Block until the next tick; true when wake() started it early
+  bool waitForNextTick();
+
+  // What the tick just run did; may change the rate from the next tick
+  void update(Activity activity);
+
+  // Input changed: end an idle wait now (safe from any task). Returns
+  // false outside idle, when there is no wait to signal; the loop still
+  // picks the request up if it goes idle before its next tick.
+  bool wake();
+
+  Mode getMode() const { return (Mode)mode.load(std::memory_order_relaxed); }
+  uint16_t getRateHz() const { return scheduler.getRateHz(); }
+  static const char *modeName(Mode mode);
+
+  // Jitter and overruns at the current rate; reset by every mode change
+  FixedRateScheduler &getScheduler() { return scheduler; }
+  const FixedRateScheduler &getScheduler() const { return scheduler; }
+
+  const Stats &getStats() const { return stats; }
+  void resetStats();
+
+private:
+  Config config;
+  FixedRateScheduler::ClockFn clock;
+  FixedRateScheduler scheduler;
+  std::atomic<uint8_t> mode;
+  std::atomic<bool> wakePending;
+  std::atomic<uint32_t> wakeRequestUs;
+  uint32_t tickUs;
+  uint32_t lastChangeUs;
+  uint32_t lastActivityUs;
+  bool recentChange;   // within boostHoldMs of lastChangeUs
+  bool recentActivity; // within quiescentMs of lastActivityUs
+  bool started;
+  bool measuring;      // tickUs is a tick since the stats reset
+  Stats stats;
+
+  void setMode(Mode next);
+};
+
+#endif // ADAPTIVE_RATE_H
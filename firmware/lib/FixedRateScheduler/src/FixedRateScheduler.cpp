@@ -0,0 +1,168 @@
+#include "FixedRateScheduler.h"
+
+uint32_t FixedRateScheduler::Stats::meanPeriodUs() const
+{
+  if (periods == 0)
+  {
+    return 0;
+  }
+  return (uint32_t)(totalPeriodUs / periods);
+}
+
+FixedRateScheduler::FixedRateScheduler(uint16_t rateHz, ClockFn clock, SleepFn sleep)
+    : clock(clock),
+      sleep(sleep),
+      rateHz(0),
+      periodUs(0),
+      nextDeadlineUs(0),
+      lastTickUs(0),
+      started(false),
+      wakeRequested(false)
+{
+  if (!setRateHz(rateHz))
+  {
+    setRateHz(MIN_RATE_HZ);
+  }
+}
+
+bool FixedRateScheduler::setRateHz(uint16_t newRateHz)
+{
+  if (newRateHz < MIN_RATE_HZ || newRateHz > MAX_RATE_HZ)
+  {
+    return false;
+  }
+
+  rateHz = newRateHz;
+  periodUs = 1000000UL / newRateHz;
+  if (started)
+  {
+    nextDeadlineUs = lastTickUs + periodUs;
+  }
+  resetStats();
+  return true;
+}
+
+bool FixedRateScheduler::waitForNextTick()
+{
+  uint32_t now = clock();
+  bool overran = false;
+  bool woken = false;
+  if (started)
+  {
+    int32_t remaining = (int32_t)(nextDeadlineUs - now);
+    overran = remaining < 0;
+    while (remaining > 0)
+    {
+      if (wakeRequested.load(std::memory_order_acquire))
+      {
+        woken = true;
+        break;
+      }
+      sleep((uint32_t)remaining);
+      now = clock();
+      remaining = (int32_t)(nextDeadlineUs - now);
+    }
+  }
+  // The tick about to run sees whatever the request was for
+  wakeRequested.store(false, std::memory_order_relaxed);
+  recordTick(now, overran, woken);
+  return woken;
+}
+
+void FixedRateScheduler::restart()
+{
+  started = false;
+  resetStats();
+}
+
+void FixedRateScheduler::resetStats()
+{
+  stats.ticks = 0;
+  stats.overruns = 0;
+  stats.missedDeadlines = 0;
+  stats.wakeups = 0;
+  stats.periods = 0;
+  stats.minPeriodUs = UINT32_MAX;
+  stats.maxPeriodUs = 0;
+  stats.totalPeriodUs = 0;
+  stats.maxLatenessUs = 0;
+}
+
+int32_t FixedRateScheduler::getMinJitterUs() const
+{
+  if (stats.periods == 0)
+  {
+    return 0;
+  }
+  return (int32_t)(stats.minPeriodUs - periodUs);
+}
+
+int32_t FixedRateScheduler::getMaxJitterUs() const
+{
+  if (stats.periods == 0)
+  {
+    return 0;
+  }
+  return (int32_t)(stats.maxPeriodUs - periodUs);
+}
+
+int32_t FixedRateScheduler::getMeanJitterUs() const
+{
+  if (stats.periods == 0)
+  {
+    return 0;
+  }
+  return (int32_t)(stats.meanPeriodUs() - periodUs);
+}
+
+void FixedRateScheduler::recordTick(uint32_t nowUs, bool overran, bool woken)
+{
+  if (!started || woken)
+  {
+    // First tick runs immediately and anchors the deadline sequence; a
+    // woken tick starts a new one
+    if (woken)
+      stats.wakeups++;
+    started = true;
+    lastTickUs = nowUs;
+    nextDeadlineUs = nowUs + periodUs;
+    stats.ticks++;
+    return;
+  }
+
+  uint32_t period = nowUs - lastTickUs;
+  if (stats.ticks > 0)
+  {
+    if (period < stats.minPeriodUs)
+      stats.minPeriodUs = period;
+    if (period > stats.maxPeriodUs)
+      stats.maxPeriodUs = period;
+    stats.totalPeriodUs += period;
+    stats.periods++;
+  }
+  else
+  {
+    // First tick after a reset only anchors the period measurement
+    nextDeadlineUs = nowUs;
+  }
+  stats.ticks++;
+  lastTickUs = nowUs;
+
+  if (overran)
+  {
+    stats.overruns++;
+  }
+
+  uint32_t lateness = nowUs - nextDeadlineUs;
+  if ((int32_t)lateness > 0)
+  {
+    if (lateness > stats.maxLatenessUs)
+      stats.maxLatenessUs = lateness;
+
+    // Skip deadlines that have already passed instead of bursting through them
+    uint32_t missed = lateness / periodUs;
+    stats.missedDeadlines += missed;
+    nextDeadlineUs += missed * periodUs;
+  }
+  nextDeadlineUs += periodUs;
+}
@@ -0,0 +1,87 @@
+#ifndef FIXED_RATE_SCHEDULER_H
+#define FIXED_RATE_SCHEDULER_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Runs a periodic step on absolute deadlines instead of "work, then delay".
+//
+// Deadlines advance by exactly one period per tick, so the time spent doing
+// the work does not stretch the period. When a tick starts after its deadline
+// it is counted as an overrun; if a whole period or more was lost the missed
+// deadlines are skipped rather than run back to back.
+//
+// wake() cuts the wait short for an event that must not wait for the next
+// deadline; the woken tick starts a new deadline sequence.
+//
+// Time comes from an injected microsecond clock and sleep function so the
+// scheduler can run against a fake clock in native unit tests.
+class FixedRateScheduler
+{
+public:
+  typedef uint32_t (*ClockFn)(void);        // free running microseconds (may wrap)
+  typedef void (*SleepFn)(uint32_t sleepUs); // may return early or late, e.g. on wake()
+
+  static const uint16_t MIN_RATE_HZ = 1;
+  static const uint16_t MAX_RATE_HZ = 1000;
+
+  struct Stats
+  {
+    uint32_t ticks;           // ticks run since the last reset
+    uint32_t overruns;        // ticks whose predecessor ran past their deadline
+    uint32_t missedDeadlines; // deadlines skipped after large overruns
+    uint32_t wakeups;         // ticks started early by wake()
+    uint32_t periods;         // measured periods; woken ticks are not measured
+    uint32_t minPeriodUs;     // shortest measured tick-to-tick period
+    uint32_t maxPeriodUs;     // longest measured tick-to-tick period
+    uint64_t totalPeriodUs;   // sum of measured periods
+    uint32_t maxLatenessUs;   // worst start time past the deadline
+
+    uint32_t meanPeriodUs() const;
+  };
+
+  FixedRateScheduler(uint16_t rateHz, ClockFn clock, SleepFn sleep);
+
+  // Change the tick rate (MIN_RATE_HZ..MAX_RATE_HZ). Takes effect from the
+  // next deadline and resets the statistics. Returns false if out of range.
+  bool setRateHz(uint16_t rateHz);
+  uint16_t getRateHz() const { return rateHz; }
+  uint32_t getPeriodUs() const { return periodUs; }
+
+  // Block until the next deadline or a wake(), then account for the tick.
+  // Returns true when wake() started the tick before its deadline.
+  bool waitForNextTick();
+
+  // Start the next tick now instead of at its deadline; safe from any task.
+  // Ends a wait in progress the next time the sleep function returns, so
+  // the sleep should return early on the same event (a task notification
+  // on ESP32). A request made while the tick is running starts the next
+  // one as soon as it waits.
+  void wake() { wakeRequested.store(true, std::memory_order_release); }
+
+  // Restart the deadline sequence (and statistics) from the next tick
+  void restart();
+
+  const Stats &getStats() const { return stats; }
+  void resetStats();
+
+  // Period jitter relative to the nominal period
+  int32_t getMinJitterUs() const;
+  int32_t getMaxJitterUs() const;
+  int32_t getMeanJitterUs() const;
+
+private:
+  ClockFn clock;
+  SleepFn sleep;
+  uint16_t rateHz;
+  uint32_t periodUs;
+  uint32_t nextDeadlineUs;
+  uint32_t lastTickUs;
+  bool started;
+  std::atomic<bool> wakeRequested;
+  Stats stats;
+
+  void recordTick(uint32_t nowUs, bool overran, bool woken);
+};
+
+#endif // FIXED_RATE_SCHEDULER_H
@@ -0,0 +1,304 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <string.h>
+#include "AdaptiveRate.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+// Idle at 10 Hz, 50 Hz while a command is held, 100 Hz for 0.2 s after a
+// change, idle after 1 s without activity
+static const AdaptiveRate::Config CONFIG = {10, 50, 100, 200, 1000};
+
+// Fake clock. Reports of the simulated controller are due at set times;
+// sleeping or working past one delivers it, and a report that wakes the
+// loop ends the sleep WAKE_DELAY_US later (the task switch).
+static const uint32_t WAKE_DELAY_US = 50;
+static uint32_t fakeNowUs;
+static SimulatedBLETransport *transport;
+static uint32_t nextReportUs;
+static bool wakeSignalled;
+
+static uint32_t fakeClock(void) { return fakeNowUs; }
+
+// Controller script: 100 reports/s; the stick is pushed at pushUs and
+// released at releaseUs, repeats in between
+static uint32_t pushUs;
+static uint32_t releaseUs;
+static const uint32_t REPORT_PERIOD_US = 10000;
+
+static void emitReport(uint32_t atUs) {
+    uint8_t report[16];
+    memset(report, 0, sizeof(report));
+    uint16_t ly = atUs >= pushUs && atUs < releaseUs ? 0 : 32768;
+    report[0] = 0x00; report[1] = 0x80; // lx centered
+    report[2] = ly & 0xFF; report[3] = ly >> 8;
+    transport->emit(report, sizeof(report));
+}
+
+// Deliver the reports due up to untilUs; true when one of them woke the loop
+static bool deliverReports(uint32_t untilUs) {
+    while (transport && (int32_t)(untilUs - nextReportUs) >= 0) {
+        fakeNowUs = nextReportUs;
+        wakeSignalled = false;
+        emitReport(nextReportUs);
+        nextReportUs += REPORT_PERIOD_US;
+        if (wakeSignalled)
+            return true;
+    }
+    return false;
+}
+
+static void fakeSleep(uint32_t us) {
+    uint32_t targetUs = fakeNowUs + us;
+    if (deliverReports(targetUs)) {
+        fakeNowUs += WAKE_DELAY_US;
+        return;
+    }
+    fakeNowUs = targetUs;
+}
+
+static void work(uint32_t us) {
+    uint32_t targetUs = fakeNowUs + us;
+    while (deliverReports(targetUs)) {
+    }
+    fakeNowUs = targetUs;
+}
+
+static void inputChanged(void *context, uint32_t arrivalUs) {
+    if (static_cast<AdaptiveRate *>(context)->wake())
+        wakeSignalled = true;
+}
+
+void setUp(void) {
+    fakeNowUs = 1000;
+    transport = nullptr;
+    wakeSignalled = false;
+}
+
+void tearDown(void) {
+}
+
+// Test the rate follows the activity reported after each tick
+void test_mode_follows_activity(void) {
+    AdaptiveRate rate(CONFIG, fakeClock, fakeSleep);
+    rate.waitForNextTick();
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_ACTIVE, rate.getMode());
+    TEST_ASSERT_EQUAL_UINT16(50, rate.getRateHz());
+
+    rate.update(AdaptiveRate::ACTIVITY_CHANGING);
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_BOOST, rate.getMode());
+    uint32_t changeUs = fakeNowUs;
+    rate.waitForNextTick();
+    TEST_ASSERT_EQUAL_UINT32(changeUs + 10000, fakeNowUs);
+
+    // Boost is held for 0.2 s after the change, then a held command stays active
+    rate.update(AdaptiveRate::ACTIVITY_HOLDING);
+    while (rate.getMode() == AdaptiveRate::MODE_BOOST) {
+        rate.waitForNextTick();
+        rate.update(AdaptiveRate::ACTIVITY_HOLDING);
+    }
+    TEST_ASSERT_EQUAL_UINT32(changeUs + 200000, fakeNowUs);
+    for (int i = 0; i < 100; i++) {
+        rate.update(AdaptiveRate::ACTIVITY_HOLDING);
+        rate.waitForNextTick();
+    }
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_ACTIVE, rate.getMode());
+
+    // Idle 1 s after the last activity
+    uint32_t quietUs = fakeNowUs;
+    while (rate.getMode() == AdaptiveRate::MODE_ACTIVE) {
+        rate.waitForNextTick();
+        rate.update(AdaptiveRate::ACTIVITY_NONE);
+    }
+    TEST_ASSERT_UINT32_WITHIN(20000, quietUs + 1000000, fakeNowUs);
+    TEST_ASSERT_EQUAL_UINT16(10, rate.getRateHz());
+
+    // A held command without a wake() brings the rate back up at the next idle tick
+    rate.waitForNextTick();
+    rate.update(AdaptiveRate::ACTIVITY_HOLDING);
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_ACTIVE, rate.getMode());
+
+    const AdaptiveRate::Stats &stats = rate.getStats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.switches);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.wakeups);
+    TEST_ASSERT_TRUE(stats.ticks[AdaptiveRate::MODE_IDLE] >= 1);
+}
+
+// Test wake() ends an idle wait and is ignored while the loop ticks fast
+void test_wake_only_ends_idle_waits(void) {
+    AdaptiveRate rate(CONFIG, fakeClock, fakeSleep);
+    rate.waitForNextTick();
+    TEST_ASSERT_FALSE(rate.wake());
+    uint32_t tickUs = fakeNowUs;
+    TEST_ASSERT_FALSE(rate.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(tickUs + 20000, fakeNowUs);
+
+    while (rate.getMode() != AdaptiveRate::MODE_IDLE) {
+        rate.update(AdaptiveRate::ACTIVITY_NONE);
+        rate.waitForNextTick();
+    }
+
+    // A report during the idle tick's work: the next wait ends at once
+    fakeNowUs += 300;
+    uint32_t requestUs = fakeNowUs;
+    TEST_ASSERT_TRUE(rate.wake());
+    fakeNowUs += 200;
+    TEST_ASSERT_TRUE(rate.waitForNextTick());
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_BOOST, rate.getMode());
+    TEST_ASSERT_EQUAL_UINT16(100, rate.getRateHz());
+
+    const AdaptiveRate::Stats &stats = rate.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(fakeNowUs - requestUs, stats.maxWakeLatencyUs);
+    TEST_ASSERT_EQUAL_UINT32(200, stats.meanWakeLatencyUs());
+
+    // Back at the boost rate from the woken tick
+    tickUs = fakeNowUs;
+    rate.update(AdaptiveRate::ACTIVITY_CHANGING);
+    TEST_ASSERT_FALSE(rate.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(tickUs + 10000, fakeNowUs);
+}
+
+// Test a wake() that lands just before the loop goes idle ends the first
+// idle wait instead of being lost
+void test_wake_while_going_idle(void) {
+    AdaptiveRate rate(CONFIG, fakeClock, fakeSleep);
+    do {
+        rate.waitForNextTick();
+        // A report during the tick's work, while the loop is still active
+        TEST_ASSERT_FALSE(rate.wake());
+        rate.update(AdaptiveRate::ACTIVITY_NONE);
+    } while (rate.getMode() != AdaptiveRate::MODE_IDLE);
+
+    uint32_t idleUs = fakeNowUs;
+    TEST_ASSERT_TRUE(rate.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(idleUs, fakeNowUs);
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_BOOST, rate.getMode());
+    TEST_ASSERT_EQUAL_UINT32(1, rate.getStats().wakeups);
+
+    // Taken by that tick: the boost wait runs its full period
+    rate.update(AdaptiveRate::ACTIVITY_NONE);
+    TEST_ASSERT_FALSE(rate.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(idleUs + 10000, fakeNowUs);
+}
+
+struct Run {
+    AdaptiveRate::Stats stats;
+    uint32_t pushReactionUs;   // push report to the first tick that saw it
+    uint32_t releaseReactionUs;
+    AdaptiveRate::Mode finalMode;
+};
+
+// Park, drive and park again on the simulated controller for durationUs.
+// Every tick takes 400 us of work.
+static Run runSession(const AdaptiveRate::Config &config, uint32_t durationUs) {
+    SimulatedBLETransport simulated;
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    simulated.addPeripheral(advertisement);
+    XboxBLEController controller(simulated);
+    AdaptiveRate rate(config, fakeClock, fakeSleep);
+    controller.setInputHandler(inputChanged, &rate);
+    TEST_ASSERT_TRUE(controller.begin());
+    TEST_ASSERT_TRUE(controller.scanAndConnect(100));
+    transport = &simulated;
+    nextReportUs = fakeNowUs + 5000;
+
+    Run run = {};
+    int16_t lastStickY = 0;
+    bool pushSeen = false;
+    bool releaseSeen = false;
+    uint32_t endUs = fakeNowUs + durationUs;
+    while ((int32_t)(endUs - fakeNowUs) > 0) {
+        rate.waitForNextTick();
+        uint32_t tickUs = fakeNowUs;
+        XboxBLEController::ControllerState state = controller.snapshot();
+        if (!pushSeen && state.leftStickY != 0) {
+            pushSeen = true;
+            run.pushReactionUs = tickUs - pushUs;
+        }
+        if (pushSeen && !releaseSeen && state.leftStickY == 0) {
+            releaseSeen = true;
+            run.releaseReactionUs = tickUs - releaseUs;
+        }
+        work(400);
+
+        if (state.leftStickY != lastStickY)
+            rate.update(AdaptiveRate::ACTIVITY_CHANGING);
+        else
+            rate.update(state.leftStickY != 0 ? AdaptiveRate::ACTIVITY_HOLDING : AdaptiveRate::ACTIVITY_NONE);
+        lastStickY = state.leftStickY;
+    }
+    TEST_ASSERT_TRUE(pushSeen && releaseSeen);
+
+    transport = nullptr;
+    controller.disconnect();
+    run.stats = rate.getStats();
+    run.finalMode = rate.getMode();
+    return run;
+}
+
+// Test a parked rover idles at a fraction of the fixed rate's CPU time and
+// still reacts to the stick within one report
+void test_parked_session_on_simulated_controller(void) {
+    // Reports every 10 ms at 5 ms past the 10 ms grid; pushed mid idle period
+    pushUs = 1000 + 5000 + 1000 * REPORT_PERIOD_US;
+    releaseUs = pushUs + 150 * REPORT_PERIOD_US;
+
+    // The fixed 50 Hz loop: never idles within the session
+    const AdaptiveRate::Config fixedConfig = {50, 50, 50, 0, 3600000};
+    Run fixed = runSession(fixedConfig, 22000000);
+    fakeNowUs = 1000;
+    Run adaptive = runSession(CONFIG, 22000000);
+
+    char buffer[120];
+    sprintf(buffer, "duty %u vs %u permille, reaction %u vs %u us, idle %u%% of the time",
+            (unsigned)adaptive.stats.dutyPermille(), (unsigned)fixed.stats.dutyPermille(),
+            (unsigned)adaptive.pushReactionUs, (unsigned)fixed.pushReactionUs,
+            (unsigned)(adaptive.stats.modeUs[AdaptiveRate::MODE_IDLE] * 100 / adaptive.stats.elapsedUs));
+    TEST_MESSAGE(buffer);
+
+    // 400 us every 20 ms
+    TEST_ASSERT_UINT32_WITHIN(1, 20, fixed.stats.dutyPermille());
+    TEST_ASSERT_EQUAL_UINT32(0, fixed.stats.wakeups);
+
+    // Parked for ~18 of the 22 s, at a third of the fixed loop's CPU time
+    TEST_ASSERT_TRUE(adaptive.stats.modeUs[AdaptiveRate::MODE_IDLE] > 17000000);
+    TEST_ASSERT_TRUE(adaptive.stats.dutyPermille() * 3 < fixed.stats.dutyPermille());
+
+    // The push woke the idle loop as the report arrived, the release was
+    // seen at the boost or active rate
+    TEST_ASSERT_EQUAL_UINT32(1, adaptive.stats.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(WAKE_DELAY_US, adaptive.stats.maxWakeLatencyUs);
+    TEST_ASSERT_EQUAL_UINT32(WAKE_DELAY_US, adaptive.pushReactionUs);
+    TEST_ASSERT_TRUE(adaptive.releaseReactionUs <= 20000);
+    TEST_ASSERT_TRUE(fixed.pushReactionUs <= 20000);
+    TEST_ASSERT_EQUAL(AdaptiveRate::MODE_IDLE, adaptive.finalMode);
+    TEST_ASSERT_TRUE(adaptive.stats.ticks[AdaptiveRate::MODE_BOOST] >= 40);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mode_follows_activity);
+    RUN_TEST(test_wake_only_ends_idle_waits);
+    RUN_TEST(test_wake_while_going_idle);
+    RUN_TEST(test_parked_session_on_simulated_controller);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
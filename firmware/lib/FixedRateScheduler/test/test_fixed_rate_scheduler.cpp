@@ -0,0 +1,232 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "FixedRateScheduler.h"
+
+// Fake clock: sleeping advances time exactly, work is simulated with advance()
+static uint32_t fakeNowUs;
+static uint32_t sleepCalls;
+
+static uint32_t fakeClock(void) { return fakeNowUs; }
+static void fakeSleep(uint32_t us)
+{
+    sleepCalls++;
+    fakeNowUs += us;
+}
+static void advance(uint32_t us) { fakeNowUs += us; }
+
+static FixedRateScheduler *wakeTarget;
+static uint32_t wakeAtUs;
+
+void setUp(void) {
+    fakeNowUs = 1000;
+    sleepCalls = 0;
+    wakeTarget = nullptr;
+}
+
+void tearDown(void) {
+}
+
+// Test the work time does not stretch the period
+void test_period_is_absolute(void) {
+    FixedRateScheduler scheduler(50, fakeClock, fakeSleep);
+    TEST_ASSERT_EQUAL_UINT32(20000, scheduler.getPeriodUs());
+
+    scheduler.waitForNextTick();
+    uint32_t first = fakeNowUs;
+    for (int i = 0; i < 10; i++) {
+        advance(7000); // work
+        scheduler.waitForNextTick();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(first + 10 * 20000, fakeNowUs);
+    const FixedRateScheduler::Stats &stats = scheduler.getStats();
+    TEST_ASSERT_EQUAL_UINT32(11, stats.ticks);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(20000, stats.minPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(20000, stats.maxPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(20000, stats.meanPeriodUs());
+    TEST_ASSERT_EQUAL_INT32(0, scheduler.getMaxJitterUs());
+}
+
+// Test a slow tick is counted and the following deadlines stay on the grid
+void test_overrun_keeps_phase(void) {
+    FixedRateScheduler scheduler(100, fakeClock, fakeSleep);
+    scheduler.waitForNextTick();
+    uint32_t first = fakeNowUs;
+
+    advance(15000); // overruns the 10 ms period by 5 ms
+    scheduler.waitForNextTick();
+    TEST_ASSERT_EQUAL_UINT32(first + 15000, fakeNowUs);
+
+    advance(1000);
+    scheduler.waitForNextTick();
+    TEST_ASSERT_EQUAL_UINT32(first + 20000, fakeNowUs);
+
+    const FixedRateScheduler::Stats &stats = scheduler.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.missedDeadlines);
+    TEST_ASSERT_EQUAL_UINT32(5000, stats.maxLatenessUs);
+    TEST_ASSERT_EQUAL_UINT32(5000, stats.minPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(15000, stats.maxPeriodUs);
+    TEST_ASSERT_EQUAL_INT32(5000, scheduler.getMaxJitterUs());
+    TEST_ASSERT_EQUAL_INT32(-5000, scheduler.getMinJitterUs());
+}
+
+// Test missed deadlines are skipped instead of run back to back
+void test_long_stall_skips_deadlines(void) {
+    FixedRateScheduler scheduler(100, fakeClock, fakeSleep);
+    scheduler.waitForNextTick();
+    uint32_t first = fakeNowUs;
+
+    advance(35000); // 3.5 periods
+    scheduler.waitForNextTick();
+    sleepCalls = 0;
+    scheduler.waitForNextTick();
+
+    TEST_ASSERT_EQUAL_UINT32(first + 40000, fakeNowUs);
+    TEST_ASSERT_EQUAL_UINT32(1, sleepCalls);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getStats().overruns);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getStats().missedDeadlines);
+}
+
+// Test deadlines survive the 32-bit microsecond counter wrapping
+void test_clock_wraparound(void) {
+    fakeNowUs = 0xFFFFFFFFUL - 25000;
+    FixedRateScheduler scheduler(100, fakeClock, fakeSleep);
+    for (int i = 0; i < 6; i++) {
+        advance(2000);
+        scheduler.waitForNextTick();
+    }
+
+    const FixedRateScheduler::Stats &stats = scheduler.getStats();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(10000, stats.minPeriodUs);
+    TEST_ASSERT_EQUAL_UINT32(10000, stats.maxPeriodUs);
+}
+
+// Test rate changes at runtime and the 1 kHz limit
+void test_runtime_rate_change(void) {
+    FixedRateScheduler scheduler(50, fakeClock, fakeSleep);
+    scheduler.waitForNextTick();
+
+    TEST_ASSERT_FALSE(scheduler.setRateHz(0));
+    TEST_ASSERT_FALSE(scheduler.setRateHz(1001));
+    TEST_ASSERT_EQUAL_UINT16(50, scheduler.getRateHz());
+
+    TEST_ASSERT_TRUE(scheduler.setRateHz(1000));
+    uint32_t start = fakeNowUs;
+    for (int i = 0; i < 100; i++) {
+        advance(300);
+        scheduler.waitForNextTick();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(start + 100 * 1000, fakeNowUs);
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler.getStats().meanPeriodUs());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats().overruns);
+}
+
+// Test a sleep that returns early is retried until the deadline
+void test_early_wakeup_is_absorbed(void) {
+    FixedRateScheduler scheduler(
+        100, fakeClock, [](uint32_t us) { sleepCalls++; fakeNowUs += us / 2 + 1; });
+    scheduler.waitForNextTick();
+    uint32_t first = fakeNowUs;
+    scheduler.waitForNextTick();
+
+    TEST_ASSERT_EQUAL_UINT32(first + 10000, fakeNowUs);
+    TEST_ASSERT_GREATER_THAN_UINT32(1, sleepCalls);
+}
+
+// Sleep that lets another task call wake() partway through
+static void wakingSleep(uint32_t us) {
+    sleepCalls++;
+    if (wakeTarget && fakeNowUs + us >= wakeAtUs) {
+        fakeNowUs = wakeAtUs;
+        wakeTarget->wake();
+        wakeTarget = nullptr;
+        return;
+    }
+    fakeNowUs += us;
+}
+
+// Test wake() ends the wait early and restarts the deadlines from there
+void test_wake_starts_tick_early(void) {
+    FixedRateScheduler scheduler(10, fakeClock, wakingSleep);
+    scheduler.waitForNextTick();
+    uint32_t first = fakeNowUs;
+    TEST_ASSERT_FALSE(scheduler.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(first + 100000, fakeNowUs);
+
+    wakeTarget = &scheduler;
+    wakeAtUs = fakeNowUs + 30000;
+    TEST_ASSERT_TRUE(scheduler.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(first + 130000, fakeNowUs);
+
+    TEST_ASSERT_FALSE(scheduler.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(first + 230000, fakeNowUs);
+
+    // The woken tick's short period is not measured
+    const FixedRateScheduler::Stats &stats = scheduler.getStats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.ticks);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.periods);
+    TEST_ASSERT_EQUAL_UINT32(100000, stats.minPeriodUs);
+    TEST_ASSERT_EQUAL_INT32(0, scheduler.getMeanJitterUs());
+}
+
+// Test a wake() during the work starts the next tick at once, only once
+void test_wake_during_work(void) {
+    FixedRateScheduler scheduler(10, fakeClock, fakeSleep);
+    scheduler.waitForNextTick();
+    uint32_t first = fakeNowUs;
+
+    advance(2000);
+    scheduler.wake();
+    sleepCalls = 0;
+    TEST_ASSERT_TRUE(scheduler.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(first + 2000, fakeNowUs);
+    TEST_ASSERT_EQUAL_UINT32(0, sleepCalls);
+
+    TEST_ASSERT_FALSE(scheduler.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(first + 102000, fakeNowUs);
+
+    // A request made while the tick was already due is served by that tick
+    advance(150000);
+    scheduler.wake();
+    TEST_ASSERT_FALSE(scheduler.waitForNextTick());
+    TEST_ASSERT_FALSE(scheduler.waitForNextTick());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.getStats().wakeups);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_period_is_absolute);
+    RUN_TEST(test_overrun_keeps_phase);
+    RUN_TEST(test_long_stall_skips_deadlines);
+    RUN_TEST(test_clock_wraparound);
+    RUN_TEST(test_runtime_rate_change);
+    RUN_TEST(test_early_wakeup_is_absorbed);
+    RUN_TEST(test_wake_starts_tick_early);
+    RUN_TEST(test_wake_during_work);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
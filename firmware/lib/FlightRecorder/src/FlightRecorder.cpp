@@ -0,0 +1,308 @@
+#include "FlightRecorder.h"
+
+#include <string.h>
+
+// Largest encoded record: 5-byte varint, type, length, mask, payload
+static const size_t MAX_ENCODED = 5 + 2 + (FlightRecorder::MAX_PAYLOAD + 7) / 8 + FlightRecorder::MAX_PAYLOAD;
+static const size_t CHUNK_SIZE = 128;
+static const uint8_t MAGIC0 = 'F';
+static const uint8_t MAGIC1 = 'R';
+
+// Last payload per type and source, the reference for the next delta. The
+// encoder and decoder must evolve it identically.
+class DeltaTable
+{
+public:
+  DeltaTable() : count(0) {}
+
+  // Reference payload for key, adjusted to length; nullptr when the table
+  // is full and key is new (encoded against zeros, not remembered)
+  uint8_t *reference(uint8_t key, uint8_t length)
+  {
+    Entry *entry = nullptr;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (entries[i].key == key)
+        entry = &entries[i];
+    }
+    if (!entry)
+    {
+      if (count == MAX_KEYS)
+        return nullptr;
+      entry = &entries[count++];
+      entry->key = key;
+      entry->length = length;
+      memset(entry->data, 0, sizeof(entry->data));
+    }
+    if (entry->length != length)
+    {
+      entry->length = length;
+      memset(entry->data, 0, sizeof(entry->data));
+    }
+    return entry->data;
+  }
+
+private:
+  static const uint8_t MAX_KEYS = 8;
+
+  struct Entry
+  {
+    uint8_t key;
+    uint8_t length;
+    uint8_t data[FlightRecorder::MAX_PAYLOAD];
+  };
+
+  Entry entries[MAX_KEYS];
+  uint8_t count;
+};
+
+static size_t putVarint(uint8_t *out, uint32_t value)
+{
+  size_t n = 0;
+  while (value >= 0x80)
+  {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+FlightRecorder::FlightRecorder()
+    : head(0),
+      triggered(false),
+      truncated(0),
+      skipped(0)
+{
+  for (size_t i = 0; i < CAPACITY; i++)
+  {
+    slots[i].sequence.store(0, std::memory_order_relaxed);
+    for (size_t w = 0; w < WORDS; w++)
+    {
+      slots[i].words[w].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void FlightRecorder::record(uint8_t type, uint8_t source, uint32_t timestampUs, const uint8_t *data,
+                            size_t length)
+{
+  if (length > MAX_PAYLOAD)
+  {
+    truncated.fetch_add(1, std::memory_order_relaxed);
+    length = MAX_PAYLOAD;
+  }
+
+  Record entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.timestampUs = timestampUs;
+  entry.type = type;
+  entry.source = source;
+  entry.length = (uint8_t)length;
+  memcpy(entry.data, data, length);
+  uint32_t buffer[WORDS];
+  memcpy(buffer, &entry, sizeof(entry));
+
+  // Claim the next index; the slot is rewritten every CAPACITY records
+  uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = slots[index & (CAPACITY - 1)];
+  slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t w = 0; w < WORDS; w++)
+  {
+    slot.words[w].store(buffer[w], std::memory_order_relaxed);
+  }
+  slot.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+void FlightRecorder::recordReport(uint8_t source, uint32_t timestampUs, const uint8_t *report, size_t length)
+{
+  record(RECORD_REPORT, source, timestampUs, report, length);
+}
+
+void FlightRecorder::recordMotorQ15(uint8_t source, uint32_t timestampUs, int16_t left, int16_t right)
+{
+  uint8_t payload[4] = {(uint8_t)left, (uint8_t)((uint16_t)left >> 8), (uint8_t)right,
+                        (uint8_t)((uint16_t)right >> 8)};
+  record(RECORD_MOTOR, source, timestampUs, payload, sizeof(payload));
+}
+
+void FlightRecorder::trigger(uint8_t reason, uint32_t timestampUs)
+{
+  record(RECORD_MARK, NO_SOURCE, timestampUs, &reason, 1);
+  triggered.store(true, std::memory_order_release);
+}
+
+bool FlightRecorder::readSlot(uint32_t index, Record &record) const
+{
+  const Slot &slot = slots[index & (CAPACITY - 1)];
+  uint32_t expected = index * 2 + 2;
+  if (slot.sequence.load(std::memory_order_acquire) != expected)
+  {
+    return false;
+  }
+
+  uint32_t buffer[WORDS];
+  for (size_t w = 0; w < WORDS; w++)
+  {
+    buffer[w] = slot.words[w].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.sequence.load(std::memory_order_relaxed) != expected)
+  {
+    return false;
+  }
+  memcpy(&record, buffer, sizeof(record));
+  return true;
+}
+
+bool FlightRecorder::encode(WriteFn write, void *context, uint32_t &records) const
+{
+  records = 0;
+  uint8_t chunk[CHUNK_SIZE];
+  size_t used = 0;
+  chunk[used++] = MAGIC0;
+  chunk[used++] = MAGIC1;
+  chunk[used++] = VERSION;
+
+  DeltaTable table;
+  uint32_t previousUs = 0;
+  uint32_t end = head.load(std::memory_order_acquire);
+  uint32_t begin = end > CAPACITY ? end - CAPACITY : 0;
+
+  for (uint32_t index = begin; index != end; index++)
+  {
+    Record entry;
+    if (!readSlot(index, entry) || entry.length > MAX_PAYLOAD)
+    {
+      skipped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    if (used + MAX_ENCODED > CHUNK_SIZE)
+    {
+      if (!write(context, chunk, used))
+        return false;
+      used = 0;
+    }
+
+    used += putVarint(&chunk[used], zigzag((int32_t)(entry.timestampUs - previousUs)));
+    previousUs = entry.timestampUs;
+    chunk[used++] = (uint8_t)((entry.type & 0x0F) | (entry.source << 4));
+    chunk[used++] = entry.length;
+
+    uint8_t *reference = table.reference(chunk[used - 2], entry.length);
+    uint8_t *mask = &chunk[used];
+    size_t maskBytes = (entry.length + 7) / 8;
+    memset(mask, 0, maskBytes);
+    used += maskBytes;
+    for (uint8_t i = 0; i < entry.length; i++)
+    {
+      uint8_t before = reference ? reference[i] : 0;
+      if (entry.data[i] != before)
+      {
+        mask[i / 8] |= (uint8_t)(1 << (i % 8));
+        chunk[used++] = entry.data[i];
+      }
+    }
+    if (reference)
+      memcpy(reference, entry.data, entry.length);
+    records++;
+  }
+
+  return write(context, chunk, used);
+}
+
+bool FlightRecorder::decode(const uint8_t *data, size_t length, RecordFn callback, void *context)
+{
+  if (length < HEADER_SIZE || data[0] != MAGIC0 || data[1] != MAGIC1 || data[2] != VERSION)
+  {
+    return false;
+  }
+
+  DeltaTable table;
+  uint32_t previousUs = 0;
+  size_t offset = HEADER_SIZE;
+  while (offset < length)
+  {
+    uint32_t delta = 0;
+    uint8_t shift = 0;
+    while (true)
+    {
+      if (offset >= length || shift > 28)
+        return false;
+      uint8_t byte = data[offset++];
+      delta |= (uint32_t)(byte & 0x7F) << shift;
+      shift += 7;
+      if ((byte & 0x80) == 0)
+        break;
+    }
+    if (offset + 2 > length)
+      return false;
+
+    Record entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.timestampUs = previousUs + (uint32_t)unzigzag(delta);
+    previousUs = entry.timestampUs;
+    uint8_t key = data[offset++];
+    entry.type = key & 0x0F;
+    entry.source = key >> 4;
+    entry.length = data[offset++];
+    size_t maskBytes = (entry.length + 7) / 8;
+    if (entry.length > MAX_PAYLOAD || offset + maskBytes > length)
+      return false;
+
+    const uint8_t *mask = &data[offset];
+    offset += maskBytes;
+    uint8_t *reference = table.reference(key, entry.length);
+    for (uint8_t i = 0; i < entry.length; i++)
+    {
+      if (mask[i / 8] & (1 << (i % 8)))
+      {
+        if (offset >= length)
+          return false;
+        entry.data[i] = data[offset++];
+      }
+      else
+      {
+        entry.data[i] = reference ? reference[i] : 0;
+      }
+    }
+    if (reference)
+      memcpy(reference, entry.data, entry.length);
+    callback(context, entry);
+  }
+  return true;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+
+static bool writeFile(void *context, const uint8_t *data, size_t length)
+{
+  return static_cast<fs::File *>(context)->write(data, length) == length;
+}
+
+bool FlightRecorder::flushToFile(fs::FS &fs, const char *path, uint32_t &records) const
+{
+  fs::File file = fs.open(path, "w");
+  if (!file)
+  {
+    records = 0;
+    return false;
+  }
+  bool written = encode(writeFile, &file, records);
+  file.close();
+  return written;
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,136 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <FS.h>
+#endif
+
+// Continuous recorder of what the rover was told and what it did.
+//
+// Producers append fixed-size records (raw input reports from the
+// notification path, motor commands from the control step, fault marks) to
+// a RAM ring that always holds the most recent CAPACITY records. A record
+// costs one atomic increment and a 32-byte copy; nothing blocks and the
+// oldest records are overwritten. Each slot carries its own sequence, like
+// a SeqLock, so a reader skips slots that are being rewritten instead of
+// returning torn records.
+//
+// trigger() marks a fault (or an operator request) and asks for a flush.
+// A low-priority task then encodes the ring oldest first into a compact
+// stream (all fields little endian):
+//
+//   offset  size  field
+//   0       2     magic 'F' 'R'
+//   2       1     format version (VERSION)
+//   3       ...   records, until the end of the stream
+//
+// and per record:
+//
+//   varint  zigzag timestamp delta, us since the previous record (from 0)
+//   1       type in the low nibble, source in the high nibble
+//   1       payload length N (0..MAX_PAYLOAD)
+//   (N+7)/8 mask, bit i set when payload byte i differs from the previous
+//           record of the same type and source (zeros if none, or if the
+//           length changed)
+//   ...     the changed bytes, in order
+//
+// A controller repeating its report while the sticks rest encodes to about
+// six bytes instead of the 32 it takes in RAM. decode() reverses the
+// format; FlightReplay feeds a decoded recording back through the
+// controller and the drive pipeline on the host.
+class FlightRecorder
+{
+public:
+  enum RecordType
+  {
+    RECORD_REPORT = 0x01, // raw HID input report, source = controller index
+    RECORD_MOTOR = 0x02,  // int16 Q15 left, right as commanded, source = selected controller
+    RECORD_MARK = 0x03    // uint8 Reason, source unused
+  };
+
+  enum Reason
+  {
+    REASON_COMMAND = 0x01,     // operator asked for a recording
+    REASON_OVERCURRENT = 0x02,
+    REASON_LINK_STALE = 0x03
+  };
+
+  static const size_t CAPACITY = 512; // records, power of two (16 KiB)
+  static const size_t MAX_PAYLOAD = 24;
+  static const uint8_t NO_SOURCE = 0x0F;
+  static const uint8_t VERSION = 1;
+  static const size_t HEADER_SIZE = 3;
+
+  struct Record
+  {
+    uint32_t timestampUs;
+    uint8_t type;
+    uint8_t source; // 0..14, NO_SOURCE when none applies
+    uint8_t length;
+    uint8_t reserved;
+    uint8_t data[MAX_PAYLOAD];
+  };
+
+  // Receives encoded bytes; false aborts the flush
+  typedef bool (*WriteFn)(void *context, const uint8_t *data, size_t length);
+  // Receives decoded records in recording order
+  typedef void (*RecordFn)(void *context, const Record &record);
+
+  FlightRecorder();
+
+  // Append a record; payloads over MAX_PAYLOAD are cut short (and counted).
+  // Safe from any task and the notification path.
+  void record(uint8_t type, uint8_t source, uint32_t timestampUs, const uint8_t *data, size_t length);
+
+  void recordReport(uint8_t source, uint32_t timestampUs, const uint8_t *report, size_t length);
+  void recordMotorQ15(uint8_t source, uint32_t timestampUs, int16_t left, int16_t right);
+
+  // Record a mark and request a flush
+  void trigger(uint8_t reason, uint32_t timestampUs);
+
+  // True once per trigger(); the flushing task polls this
+  bool takeTrigger() { return triggered.exchange(false, std::memory_order_acq_rel); }
+
+  // Encode the ring as it is now, oldest record first. Producers keep
+  // recording meanwhile; slots they overwrite before being read are
+  // skipped. records receives the number of records written.
+  bool encode(WriteFn write, void *context, uint32_t &records) const;
+
+#ifdef ARDUINO_ARCH_ESP32
+  // Encode into path on fs (e.g. LittleFS), replacing the file
+  bool flushToFile(fs::FS &fs, const char *path, uint32_t &records) const;
+#endif
+
+  // Parse an encoded stream; false if it is not one or is cut short (the
+  // records before the cut have been delivered)
+  static bool decode(const uint8_t *data, size_t length, RecordFn callback, void *context);
+
+  // Records appended since start-up
+  uint32_t getRecordedCount() const { return head.load(std::memory_order_relaxed); }
+  uint32_t getTruncatedCount() const { return truncated.load(std::memory_order_relaxed); }
+  // Slots that changed under encode() and were left out
+  uint32_t getSkippedCount() const { return skipped.load(std::memory_order_relaxed); }
+
+private:
+  static const size_t WORDS = sizeof(Record) / sizeof(uint32_t);
+
+  struct Slot
+  {
+    std::atomic<uint32_t> sequence; // 2 * index + 2 once record index is complete
+    std::atomic<uint32_t> words[WORDS];
+  };
+
+  Slot slots[CAPACITY];
+  std::atomic<uint32_t> head;
+  std::atomic<bool> triggered;
+  std::atomic<uint32_t> truncated;
+  mutable std::atomic<uint32_t> skipped;
+
+  bool readSlot(uint32_t index, Record &record) const;
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,110 @@
+#ifndef ARDUINO
+
+#include "FlightReplay.h"
+
+#include <stdio.h>
+
+#include "SimulatedBLETransport.h"
+
+void FlightReplay::collect(void *context, const FlightRecorder::Record &record)
+{
+  static_cast<std::vector<FlightRecorder::Record> *>(context)->push_back(record);
+}
+
+bool FlightReplay::load(const uint8_t *data, size_t length)
+{
+  records.clear();
+  return FlightRecorder::decode(data, length, collect, &records);
+}
+
+bool FlightReplay::loadFile(const char *path)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+  {
+    records.clear();
+    return false;
+  }
+
+  std::vector<uint8_t> data;
+  uint8_t buffer[256];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    data.insert(data.end(), buffer, buffer + read);
+  }
+  fclose(file);
+  return load(data.empty() ? nullptr : &data[0], data.size());
+}
+
+static int16_t getI16(const uint8_t *in)
+{
+  return (int16_t)(in[0] | (in[1] << 8));
+}
+
+static uint16_t difference(int16_t a, int16_t b)
+{
+  int32_t d = (int32_t)a - b;
+  return (uint16_t)(d < 0 ? -d : d);
+}
+
+bool FlightReplay::run(uint8_t source, StepFn step, void *context, Result &result) const
+{
+  result.reports = 0;
+  result.ticks = 0;
+  result.mismatches = 0;
+  result.firstMismatch = -1;
+  result.maxError = 0;
+
+  SimulatedBLETransport transport;
+  BLEAdvertisement advertisement = {{{0xF1, 0x1C, 0x47, 0x00, 0x00, 0x01}}, "Xbox Replay", true, true, -40};
+  transport.addPeripheral(advertisement);
+  XboxBLEController controller(transport);
+  if (!controller.begin() || !controller.scanAndConnect(100))
+  {
+    return false;
+  }
+
+  bool ticked = false;
+  uint32_t lastTickUs = 0;
+  for (size_t i = 0; i < records.size(); i++)
+  {
+    const FlightRecorder::Record &record = records[i];
+    if (record.source != source)
+      continue;
+
+    if (record.type == FlightRecorder::RECORD_REPORT)
+    {
+      transport.emit(record.data, record.length);
+      result.reports++;
+    }
+    else if (record.type == FlightRecorder::RECORD_MOTOR && record.length >= 4)
+    {
+      uint32_t dtUs = ticked ? record.timestampUs - lastTickUs : 0;
+      ticked = true;
+      lastTickUs = record.timestampUs;
+
+      int16_t left = 0;
+      int16_t right = 0;
+      step(context, controller.snapshot(), dtUs, left, right);
+
+      uint16_t errorLeft = difference(left, getI16(&record.data[0]));
+      uint16_t errorRight = difference(right, getI16(&record.data[2]));
+      uint16_t error = errorLeft > errorRight ? errorLeft : errorRight;
+      if (error > 0)
+      {
+        if (result.firstMismatch < 0)
+          result.firstMismatch = (int32_t)result.ticks;
+        result.mismatches++;
+      }
+      if (error > result.maxError)
+        result.maxError = error;
+      result.ticks++;
+    }
+  }
+
+  controller.disconnect();
+  return true;
+}
+
+#endif // ARDUINO
@@ -0,0 +1,60 @@
+#ifndef FLIGHT_REPLAY_H
+#define FLIGHT_REPLAY_H
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <vector>
+
+#include "FlightRecorder.h"
+#include "XboxBLEController.h"
+
+// Plays a flight recording back on the host, so a field incident becomes a
+// regression test.
+//
+// run() opens a fresh controller session on a SimulatedBLETransport and
+// walks the recording in order: every report of the chosen source is
+// emitted through the normal notification path (and so parsed exactly as
+// on the rover), and every motor record that source was in charge of calls
+// the step function with the controller's snapshot at that point. The step
+// runs the drive pipeline under test and its command is compared with the
+// recorded one. Nothing depends on the host's timing, so a run gives the
+// same result every time.
+//
+// Reports are parsed with the default report map.
+class FlightReplay
+{
+public:
+  // One control tick; dtUs is the recorded time since the previous tick
+  // (0 for the first)
+  typedef void (*StepFn)(void *context, const XboxBLEController::ControllerState &state, uint32_t dtUs,
+                         int16_t &left, int16_t &right);
+
+  struct Result
+  {
+    uint32_t reports;      // reports emitted to the controller
+    uint32_t ticks;        // motor records replayed
+    uint32_t mismatches;   // ticks whose command differs from the recording
+    int32_t firstMismatch; // tick index of the first mismatch, -1 if none
+    uint16_t maxError;     // largest difference on either channel, Q15
+  };
+
+  // Decode a recording; replaces any loaded before
+  bool load(const uint8_t *data, size_t length);
+  bool loadFile(const char *path);
+
+  const std::vector<FlightRecorder::Record> &getRecords() const { return records; }
+
+  // Replay one controller's session; false if the simulated controller
+  // could not be connected
+  bool run(uint8_t source, StepFn step, void *context, Result &result) const;
+
+private:
+  std::vector<FlightRecorder::Record> records;
+
+  static void collect(void *context, const FlightRecorder::Record &record);
+};
+
+#endif // ARDUINO
+
+#endif // FLIGHT_REPLAY_H
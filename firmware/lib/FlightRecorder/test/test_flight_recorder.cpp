@@ -0,0 +1,296 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "DriveMixer.h"
+#include "FlightRecorder.h"
+#include "FlightReplay.h"
+#include "InputShaper.h"
+#include "SimulatedBLETransport.h"
+
+static const uint32_t TICK_US = 20000; // 50 Hz control loop
+
+FlightRecorder* recorder;
+
+void setUp(void) {
+    recorder = new FlightRecorder();
+}
+
+void tearDown(void) {
+    delete recorder;
+}
+
+static bool appendBytes(void *context, const uint8_t *data, size_t length) {
+    std::vector<uint8_t> *out = static_cast<std::vector<uint8_t> *>(context);
+    out->insert(out->end(), data, data + length);
+    return true;
+}
+
+static void collectRecord(void *context, const FlightRecorder::Record &record) {
+    static_cast<std::vector<FlightRecorder::Record> *>(context)->push_back(record);
+}
+
+static std::vector<uint8_t> encodeAll(uint32_t &records) {
+    std::vector<uint8_t> encoded;
+    TEST_ASSERT_TRUE(recorder->encode(appendBytes, &encoded, records));
+    return encoded;
+}
+
+static std::vector<FlightRecorder::Record> decodeAll(const std::vector<uint8_t> &encoded) {
+    std::vector<FlightRecorder::Record> records;
+    TEST_ASSERT_TRUE(FlightRecorder::decode(&encoded[0], encoded.size(), collectRecord, &records));
+    return records;
+}
+
+// Build a raw Xbox input report (sticks unsigned, centered at 32768)
+static size_t makeReport(uint8_t *report, uint16_t lx, uint16_t ly, uint16_t lt, uint16_t rt) {
+    memset(report, 0, 16);
+    report[0] = lx & 0xFF; report[1] = lx >> 8;
+    report[2] = ly & 0xFF; report[3] = ly >> 8;
+    report[8] = lt & 0xFF; report[9] = lt >> 8;
+    report[10] = rt & 0xFF; report[11] = rt >> 8;
+    return 16;
+}
+
+// Test every kind of record survives encode and decode, and repeats stay small
+void test_round_trip(void) {
+    uint8_t report[16];
+    makeReport(report, 40000, 20000, 0, 1023);
+    recorder->recordReport(0, 1000, report, 16);
+    recorder->recordReport(1, 1500, report, 16);
+    recorder->recordMotorQ15(0, 2000, -12345, 32767);
+    makeReport(report, 40001, 20000, 0, 1023);
+    recorder->recordReport(0, 2100, report, 16);
+    recorder->recordReport(0, 2050, report, 8); // shorter, and earlier than the one before
+    recorder->trigger(FlightRecorder::REASON_OVERCURRENT, 0xFFFFFFF0);
+
+    uint32_t count;
+    std::vector<FlightRecorder::Record> records = decodeAll(encodeAll(count));
+    TEST_ASSERT_EQUAL_UINT32(6, count);
+    TEST_ASSERT_EQUAL_UINT32(6, records.size());
+
+    TEST_ASSERT_EQUAL_UINT32(1000, records[0].timestampUs);
+    TEST_ASSERT_EQUAL_UINT8(FlightRecorder::RECORD_REPORT, records[0].type);
+    TEST_ASSERT_EQUAL_UINT8(0, records[0].source);
+    TEST_ASSERT_EQUAL_UINT8(16, records[0].length);
+    TEST_ASSERT_EQUAL_UINT8(1, records[1].source);
+    TEST_ASSERT_EQUAL_HEX8(0x40, records[1].data[0]);
+
+    TEST_ASSERT_EQUAL_UINT8(FlightRecorder::RECORD_MOTOR, records[2].type);
+    TEST_ASSERT_EQUAL_INT16(-12345, (int16_t)(records[2].data[0] | (records[2].data[1] << 8)));
+    TEST_ASSERT_EQUAL_INT16(32767, (int16_t)(records[2].data[2] | (records[2].data[3] << 8)));
+
+    TEST_ASSERT_EQUAL_HEX8(0x41, records[3].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, records[3].data[11]);
+    TEST_ASSERT_EQUAL_UINT32(2050, records[4].timestampUs);
+    TEST_ASSERT_EQUAL_UINT8(8, records[4].length);
+    TEST_ASSERT_EQUAL_HEX8(0x41, records[4].data[0]);
+
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0, records[5].timestampUs);
+    TEST_ASSERT_EQUAL_UINT8(FlightRecorder::RECORD_MARK, records[5].type);
+    TEST_ASSERT_EQUAL_UINT8(FlightRecorder::NO_SOURCE, records[5].source);
+    TEST_ASSERT_EQUAL_UINT8(FlightRecorder::REASON_OVERCURRENT, records[5].data[0]);
+
+    // A resting controller repeating itself at 100 Hz
+    delete recorder;
+    recorder = new FlightRecorder();
+    for (uint32_t i = 0; i < 100; i++)
+        recorder->recordReport(0, i * 10000, report, 16);
+    std::vector<uint8_t> encoded = encodeAll(count);
+    TEST_ASSERT_TRUE(encoded.size() < 100 * 8);
+}
+
+// Test the ring keeps the latest CAPACITY records, oldest first
+void test_ring_keeps_latest(void) {
+    const uint32_t extra = 10;
+    for (uint32_t i = 0; i < FlightRecorder::CAPACITY + extra; i++)
+        recorder->recordMotorQ15(0, i, (int16_t)i, 0);
+
+    uint32_t count;
+    std::vector<FlightRecorder::Record> records = decodeAll(encodeAll(count));
+    TEST_ASSERT_EQUAL_UINT32(FlightRecorder::CAPACITY, count);
+    TEST_ASSERT_EQUAL_UINT32(extra, records.front().timestampUs);
+    TEST_ASSERT_EQUAL_UINT32(FlightRecorder::CAPACITY + extra - 1, records.back().timestampUs);
+    TEST_ASSERT_EQUAL_UINT32(FlightRecorder::CAPACITY + extra, recorder->getRecordedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, recorder->getSkippedCount());
+
+    // Oversized payloads are cut short, not dropped
+    uint8_t big[40] = {0};
+    recorder->record(FlightRecorder::RECORD_REPORT, 0, 0, big, sizeof(big));
+    TEST_ASSERT_EQUAL_UINT32(1, recorder->getTruncatedCount());
+
+    // A trigger is taken once
+    TEST_ASSERT_FALSE(recorder->takeTrigger());
+    recorder->trigger(FlightRecorder::REASON_COMMAND, 0);
+    TEST_ASSERT_TRUE(recorder->takeTrigger());
+    TEST_ASSERT_FALSE(recorder->takeTrigger());
+}
+
+// Test damaged streams are refused
+void test_decode_rejects_bad_streams(void) {
+    uint8_t report[16];
+    makeReport(report, 1, 2, 3, 4);
+    recorder->recordReport(0, 100, report, 16);
+    uint32_t count;
+    std::vector<uint8_t> encoded = encodeAll(count);
+
+    std::vector<FlightRecorder::Record> records;
+    TEST_ASSERT_FALSE(FlightRecorder::decode(&encoded[0], encoded.size() - 1, collectRecord, &records));
+    encoded[2] = FlightRecorder::VERSION + 1;
+    TEST_ASSERT_FALSE(FlightRecorder::decode(&encoded[0], encoded.size(), collectRecord, &records));
+
+    // An empty recording is just the header
+    delete recorder;
+    recorder = new FlightRecorder();
+    encoded = encodeAll(count);
+    TEST_ASSERT_EQUAL_UINT32(FlightRecorder::HEADER_SIZE, encoded.size());
+    TEST_ASSERT_EQUAL_UINT32(0, decodeAll(encoded).size());
+}
+
+// Test encoding while two tasks record never yields a torn record
+void test_encode_while_recording(void) {
+    std::atomic<bool> running(true);
+    std::thread producers[2];
+    for (uint8_t p = 0; p < 2; p++) {
+        producers[p] = std::thread([p, &running]() {
+            uint32_t i = 0;
+            while (running.load()) {
+                // Every byte of a record carries its counter
+                uint8_t payload[FlightRecorder::MAX_PAYLOAD];
+                memset(payload, (uint8_t)i, sizeof(payload));
+                recorder->record(FlightRecorder::RECORD_REPORT, p, i, payload, sizeof(payload));
+                i++;
+            }
+        });
+    }
+
+    for (int pass = 0; pass < 50; pass++) {
+        uint32_t count;
+        std::vector<FlightRecorder::Record> records = decodeAll(encodeAll(count));
+        TEST_ASSERT_EQUAL_UINT32(count, records.size());
+        uint32_t last[2] = {0, 0};
+        bool seen[2] = {false, false};
+        for (size_t r = 0; r < records.size(); r++) {
+            const FlightRecorder::Record &record = records[r];
+            TEST_ASSERT_TRUE(record.source < 2);
+            for (size_t b = 0; b < FlightRecorder::MAX_PAYLOAD; b++)
+                TEST_ASSERT_EQUAL_UINT8((uint8_t)record.timestampUs, record.data[b]);
+            if (seen[record.source])
+                TEST_ASSERT_TRUE(record.timestampUs > last[record.source]);
+            last[record.source] = record.timestampUs;
+            seen[record.source] = true;
+        }
+    }
+    running.store(false);
+    producers[0].join();
+    producers[1].join();
+}
+
+// The pipeline under test: shaping and the tank mix, as in controlStep()
+struct Pipeline {
+    InputShaper shaper;
+};
+
+static void pipelineStep(void *context, const XboxBLEController::ControllerState &state, uint32_t dtUs,
+                         int16_t &left, int16_t &right) {
+    Pipeline *pipeline = static_cast<Pipeline *>(context);
+    DriveMixer::Output command = DriveMixer::mix(DriveMixer::normalize(pipeline->shaper.shape(state, TICK_US)));
+    left = DriveSignal::toQ15(command.left);
+    right = DriveSignal::toQ15(command.right);
+}
+
+static void recorderTap(void *context, const uint8_t *data, size_t length, uint32_t arrivalUs) {
+    static_cast<FlightRecorder *>(context)->recordReport(0, arrivalUs, data, length);
+}
+
+static void configure(Pipeline &pipeline, uint32_t slew) {
+    InputShaper::AxisProfile drive = {2621, 9830, slew};
+    pipeline.shaper.setProfile(InputShaper::AXIS_STICK_Y, drive);
+}
+
+// Test a recorded session replays to the same motor commands, and a changed
+// pipeline is caught
+void test_replay_matches_recording(void) {
+    // Live session: reports through the tap, commands from the pipeline
+    SimulatedBLETransport transport;
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport.addPeripheral(advertisement);
+    XboxBLEController controller(transport);
+    controller.setReportTap(recorderTap, recorder);
+    TEST_ASSERT_TRUE(controller.begin());
+    TEST_ASSERT_TRUE(controller.scanAndConnect(1000));
+
+    Pipeline live;
+    configure(live, 65534);
+    uint8_t report[16];
+    for (uint32_t tick = 0; tick < 150; tick++) {
+        // A stick sweep with a full reversal and throttle pumps, two reports per tick
+        uint16_t ly = tick < 75 ? (uint16_t)(tick * 873) : (uint16_t)(65535 - (tick - 75) * 873);
+        for (int r = 0; r < 2; r++) {
+            makeReport(report, (uint16_t)(32768 + (tick % 40) * 500), ly, 0, (uint16_t)((tick * 37 + r) % 1024));
+            transport.emit(report, 16);
+        }
+        int16_t left, right;
+        pipelineStep(&live, controller.snapshot(), TICK_US, left, right);
+        recorder->recordMotorQ15(0, tick * TICK_US, left, right);
+    }
+    controller.disconnect();
+
+    uint32_t count;
+    std::vector<uint8_t> encoded = encodeAll(count);
+    TEST_ASSERT_EQUAL_UINT32(450, count);
+
+    FlightReplay replay;
+    TEST_ASSERT_TRUE(replay.load(&encoded[0], encoded.size()));
+    TEST_ASSERT_EQUAL_UINT32(450, replay.getRecords().size());
+
+    Pipeline same;
+    configure(same, 65534);
+    FlightReplay::Result result;
+    TEST_ASSERT_TRUE(replay.run(0, pipelineStep, &same, result));
+    TEST_ASSERT_EQUAL_UINT32(300, result.reports);
+    TEST_ASSERT_EQUAL_UINT32(150, result.ticks);
+    TEST_ASSERT_EQUAL_UINT32(0, result.mismatches);
+    TEST_ASSERT_EQUAL_INT32(-1, result.firstMismatch);
+
+    // Twice the slew rate diverges on the first ramp
+    Pipeline faster;
+    configure(faster, 32767);
+    TEST_ASSERT_TRUE(replay.run(0, pipelineStep, &faster, result));
+    TEST_ASSERT_TRUE(result.mismatches > 0);
+    TEST_ASSERT_TRUE(result.firstMismatch >= 0 && result.firstMismatch < 75);
+    TEST_ASSERT_TRUE(result.maxError > 0);
+
+    // Nothing was recorded for another source
+    TEST_ASSERT_TRUE(replay.run(1, pipelineStep, &same, result));
+    TEST_ASSERT_EQUAL_UINT32(0, result.ticks);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_ring_keeps_latest);
+    RUN_TEST(test_decode_rejects_bad_streams);
+    RUN_TEST(test_encode_while_recording);
+    RUN_TEST(test_replay_matches_recording);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
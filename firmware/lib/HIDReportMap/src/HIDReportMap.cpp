@@ -0,0 +1,523 @@
+#include "HIDReportMap.h"
+
+#include <limits.h>
+#include <string.h>
+
+// Input report 1 of the Xbox Wireless Controller (BLE, firmware 5.x). Output
+// (rumble) reports are omitted since only the input layout is compiled.
+const uint8_t HIDReportMap::XBOX_DEFAULT_REPORT_MAP[] = {
+    0x05, 0x01,                   // Usage Page (Generic Desktop)
+    0x09, 0x05,                   // Usage (Game Pad)
+    0xA1, 0x01,                   // Collection (Application)
+    0x85, 0x01,                   //   Report ID (1)
+    0x09, 0x01,                   //   Usage (Pointer)
+    0xA1, 0x00,                   //   Collection (Physical)
+    0x09, 0x30,                   //     Usage (X)
+    0x09, 0x31,                   //     Usage (Y)
+    0x15, 0x00,                   //     Logical Minimum (0)
+    0x27, 0xFF, 0xFF, 0x00, 0x00, //     Logical Maximum (65535)
+    0x95, 0x02,                   //     Report Count (2)
+    0x75, 0x10,                   //     Report Size (16)
+    0x81, 0x02,                   //     Input (Data, Var, Abs)
+    0xC0,                         //   End Collection
+    0x09, 0x01,                   //   Usage (Pointer)
+    0xA1, 0x00,                   //   Collection (Physical)
+    0x09, 0x32,                   //     Usage (Z)
+    0x09, 0x35,                   //     Usage (Rz)
+    0x15, 0x00,                   //     Logical Minimum (0)
+    0x27, 0xFF, 0xFF, 0x00, 0x00, //     Logical Maximum (65535)
+    0x95, 0x02,                   //     Report Count (2)
+    0x75, 0x10,                   //     Report Size (16)
+    0x81, 0x02,                   //     Input (Data, Var, Abs)
+    0xC0,                         //   End Collection
+    0x05, 0x02,                   //   Usage Page (Simulation Controls)
+    0x09, 0xC5,                   //   Usage (Brake)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x26, 0xFF, 0x03,             //   Logical Maximum (1023)
+    0x95, 0x01,                   //   Report Count (1)
+    0x75, 0x0A,                   //   Report Size (10)
+    0x81, 0x02,                   //   Input (Data, Var, Abs)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x00,                   //   Logical Maximum (0)
+    0x75, 0x06,                   //   Report Size (6)
+    0x95, 0x01,                   //   Report Count (1)
+    0x81, 0x03,                   //   Input (Const, Var, Abs)
+    0x05, 0x02,                   //   Usage Page (Simulation Controls)
+    0x09, 0xC4,                   //   Usage (Accelerator)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x26, 0xFF, 0x03,             //   Logical Maximum (1023)
+    0x95, 0x01,                   //   Report Count (1)
+    0x75, 0x0A,                   //   Report Size (10)
+    0x81, 0x02,                   //   Input (Data, Var, Abs)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x00,                   //   Logical Maximum (0)
+    0x75, 0x06,                   //   Report Size (6)
+    0x95, 0x01,                   //   Report Count (1)
+    0x81, 0x03,                   //   Input (Const, Var, Abs)
+    0x05, 0x01,                   //   Usage Page (Generic Desktop)
+    0x09, 0x39,                   //   Usage (Hat switch)
+    0x15, 0x01,                   //   Logical Minimum (1)
+    0x25, 0x08,                   //   Logical Maximum (8)
+    0x35, 0x00,                   //   Physical Minimum (0)
+    0x46, 0x3B, 0x01,             //   Physical Maximum (315)
+    0x66, 0x14, 0x00,             //   Unit (Degrees)
+    0x75, 0x04,                   //   Report Size (4)
+    0x95, 0x01,                   //   Report Count (1)
+    0x81, 0x42,                   //   Input (Data, Var, Abs, Null State)
+    0x75, 0x04,                   //   Report Size (4)
+    0x95, 0x01,                   //   Report Count (1)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x00,                   //   Logical Maximum (0)
+    0x35, 0x00,                   //   Physical Minimum (0)
+    0x45, 0x00,                   //   Physical Maximum (0)
+    0x65, 0x00,                   //   Unit (None)
+    0x81, 0x03,                   //   Input (Const, Var, Abs)
+    0x05, 0x09,                   //   Usage Page (Button)
+    0x19, 0x01,                   //   Usage Minimum (1)
+    0x29, 0x0F,                   //   Usage Maximum (15)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x01,                   //   Logical Maximum (1)
+    0x75, 0x01,                   //   Report Size (1)
+    0x95, 0x0F,                   //   Report Count (15)
+    0x81, 0x02,                   //   Input (Data, Var, Abs)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x00,                   //   Logical Maximum (0)
+    0x75, 0x01,                   //   Report Size (1)
+    0x95, 0x01,                   //   Report Count (1)
+    0x81, 0x03,                   //   Input (Const, Var, Abs)
+    0x05, 0x0C,                   //   Usage Page (Consumer)
+    0x0A, 0x24, 0x02,             //   Usage (AC Back)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x01,                   //   Logical Maximum (1)
+    0x95, 0x01,                   //   Report Count (1)
+    0x75, 0x01,                   //   Report Size (1)
+    0x81, 0x02,                   //   Input (Data, Var, Abs)
+    0x15, 0x00,                   //   Logical Minimum (0)
+    0x25, 0x00,                   //   Logical Maximum (0)
+    0x75, 0x07,                   //   Report Size (7)
+    0x95, 0x01,                   //   Report Count (1)
+    0x81, 0x03,                   //   Input (Const, Var, Abs)
+    0xC0,                         // End Collection
+};
+
+const size_t HIDReportMap::XBOX_DEFAULT_REPORT_MAP_LENGTH = sizeof(XBOX_DEFAULT_REPORT_MAP);
+
+namespace
+{
+  const uint16_t PAGE_GENERIC_DESKTOP = 0x01;
+  const uint16_t PAGE_SIMULATION = 0x02;
+  const uint16_t PAGE_BUTTON = 0x09;
+  const uint16_t PAGE_CONSUMER = 0x0C;
+  const uint16_t USAGE_AC_BACK = 0x224;
+
+  const uint8_t MAX_FIELD_BITS = 24;
+  const size_t MAX_USAGES = 16;
+  const size_t MAX_REPORT_IDS = 8;
+  const size_t MAX_GLOBAL_STACK = 4;
+
+  struct GlobalItems
+  {
+    uint16_t usagePage;
+    int32_t logicalMin;
+    int32_t logicalMax;
+    uint32_t reportSize;
+    uint32_t reportCount;
+    uint8_t reportId;
+  };
+
+  // Map a (page, usage) pair to the control it drives, or -1 if unused
+  int mapUsage(uint16_t page, uint16_t usage)
+  {
+    if (page == PAGE_GENERIC_DESKTOP)
+    {
+      switch (usage)
+      {
+      case 0x30: // X
+        return HIDReportMap::LEFT_STICK_X;
+      case 0x31: // Y
+        return HIDReportMap::LEFT_STICK_Y;
+      case 0x32: // Z
+      case 0x33: // Rx
+        return HIDReportMap::RIGHT_STICK_X;
+      case 0x35: // Rz
+      case 0x34: // Ry
+        return HIDReportMap::RIGHT_STICK_Y;
+      case 0x39: // Hat switch
+        return HIDReportMap::HAT_SWITCH;
+      }
+    }
+    else if (page == PAGE_SIMULATION)
+    {
+      switch (usage)
+      {
+      case 0xC5: // Brake
+        return HIDReportMap::LEFT_TRIGGER;
+      case 0xC4: // Accelerator
+        return HIDReportMap::RIGHT_TRIGGER;
+      }
+    }
+    return -1;
+  }
+
+  int32_t itemSigned(const uint8_t *data, uint8_t size)
+  {
+    switch (size)
+    {
+    case 1:
+      return (int8_t)data[0];
+    case 2:
+      return (int16_t)(data[0] | (data[1] << 8));
+    case 4:
+      return (int32_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                       ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+    default:
+      return 0;
+    }
+  }
+
+  uint32_t itemUnsigned(const uint8_t *data, uint8_t size)
+  {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++)
+    {
+      value |= (uint32_t)data[i] << (8 * i);
+    }
+    return value;
+  }
+}
+
+HIDReportMap::HIDReportMap()
+    : fieldCount(0),
+      reportLength(0),
+      reportId(0)
+{
+}
+
+bool HIDReportMap::loadDefault()
+{
+  return parse(XBOX_DEFAULT_REPORT_MAP, XBOX_DEFAULT_REPORT_MAP_LENGTH, 1);
+}
+
+bool HIDReportMap::hasTarget(Target target) const
+{
+  for (size_t i = 0; i < fieldCount; i++)
+  {
+    if (fields[i].target == target)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HIDReportMap::parse(const uint8_t *descriptor, size_t length, uint8_t wantedReportId)
+{
+  Field parsed[MAX_FIELDS];
+  size_t parsedCount = 0;
+  size_t parsedLength = 0;
+
+  GlobalItems global;
+  memset(&global, 0, sizeof(global));
+  GlobalItems globalStack[MAX_GLOBAL_STACK];
+  size_t globalDepth = 0;
+
+  // Local items, cleared after every main item
+  uint32_t usages[MAX_USAGES];
+  size_t usageCount = 0;
+  uint32_t usageMin = 0;
+  uint32_t usageMax = 0;
+  bool haveUsageRange = false;
+
+  // Input bit offset of every report ID seen so far
+  uint8_t offsetIds[MAX_REPORT_IDS];
+  uint32_t offsetBits[MAX_REPORT_IDS];
+  size_t offsetCount = 0;
+
+  bool selected = wantedReportId != 0;
+  uint8_t selectedId = wantedReportId;
+
+  size_t pos = 0;
+  while (pos < length)
+  {
+    uint8_t prefix = descriptor[pos++];
+
+    // Long items carry no information we use
+    if (prefix == 0xFE)
+    {
+      if (pos + 2 > length)
+        break;
+      pos += 2 + descriptor[pos];
+      continue;
+    }
+
+    uint8_t size = prefix & 0x03;
+    if (size == 3)
+      size = 4;
+    uint8_t type = (prefix >> 2) & 0x03;
+    uint8_t tag = prefix >> 4;
+    if (pos + size > length)
+      break;
+    const uint8_t *data = descriptor + pos;
+    pos += size;
+
+    if (type == 1) // Global
+    {
+      switch (tag)
+      {
+      case 0x0:
+        global.usagePage = (uint16_t)itemUnsigned(data, size);
+        break;
+      case 0x1:
+        global.logicalMin = itemSigned(data, size);
+        break;
+      case 0x2:
+        global.logicalMax = itemSigned(data, size);
+        break;
+      case 0x7:
+        global.reportSize = itemUnsigned(data, size);
+        break;
+      case 0x8:
+        global.reportId = (uint8_t)itemUnsigned(data, size);
+        break;
+      case 0x9:
+        global.reportCount = itemUnsigned(data, size);
+        break;
+      case 0xA:
+        if (globalDepth < MAX_GLOBAL_STACK)
+          globalStack[globalDepth++] = global;
+        break;
+      case 0xB:
+        if (globalDepth > 0)
+          global = globalStack[--globalDepth];
+        break;
+      }
+      continue;
+    }
+
+    if (type == 2) // Local
+    {
+      uint32_t value = itemUnsigned(data, size);
+      // A 4-byte usage carries its own usage page in the upper half
+      if (size < 4)
+        value |= (uint32_t)global.usagePage << 16;
+      switch (tag)
+      {
+      case 0x0:
+        if (usageCount < MAX_USAGES)
+          usages[usageCount++] = value;
+        break;
+      case 0x1:
+        usageMin = value;
+        haveUsageRange = true;
+        break;
+      case 0x2:
+        usageMax = value;
+        haveUsageRange = true;
+        break;
+      }
+      continue;
+    }
+
+    if (type != 0) // Reserved
+      continue;
+
+    if (tag == 0x8) // Input
+    {
+      uint32_t flags = itemUnsigned(data, size);
+      bool constant = flags & 0x01;
+      bool variable = flags & 0x02;
+
+      if (!selected)
+      {
+        selected = true;
+        selectedId = global.reportId;
+      }
+
+      // Locate the running bit offset of this report ID
+      size_t slot = 0;
+      while (slot < offsetCount && offsetIds[slot] != global.reportId)
+        slot++;
+      if (slot == offsetCount)
+      {
+        if (offsetCount == MAX_REPORT_IDS)
+          return false;
+        offsetIds[slot] = global.reportId;
+        offsetBits[slot] = 0;
+        offsetCount++;
+      }
+      uint32_t bitOffset = offsetBits[slot];
+      offsetBits[slot] += global.reportSize * global.reportCount;
+
+      if (global.reportId != selectedId || constant || !variable)
+      {
+        usageCount = 0;
+        usageMin = 0;
+        usageMax = 0;
+        haveUsageRange = false;
+        continue;
+      }
+
+      // HID: a non-negative minimum means the maximum is unsigned
+      int32_t logicalMin = global.logicalMin;
+      int32_t logicalMax = global.logicalMax;
+      if (logicalMin >= 0 && logicalMax < logicalMin)
+        logicalMax = (int32_t)(global.logicalMax & (global.reportSize >= 32 ? 0xFFFFFFFFu : ((1u << global.reportSize) - 1)));
+
+      for (uint32_t i = 0; i < global.reportCount; i++)
+      {
+        uint32_t usage;
+        if (haveUsageRange)
+        {
+          // Bits past the end of the range have no usage
+          if (usageMax < usageMin || i > usageMax - usageMin)
+            break;
+          usage = usageMin + i;
+        }
+        else if (usageCount > 0)
+          usage = usages[i < usageCount ? i : usageCount - 1];
+        else
+          break;
+
+        uint16_t page = usage >> 16;
+        uint16_t id = usage & 0xFFFF;
+        uint32_t fieldOffset = bitOffset + i * global.reportSize;
+        uint32_t bitSize = global.reportSize;
+        uint8_t outShift = 0;
+        int target;
+
+        if (page == PAGE_BUTTON && bitSize == 1)
+        {
+          // The whole run of buttons becomes a single bitmask field
+          if (id == 0)
+            break;
+          target = BUTTONS;
+          outShift = (uint8_t)(id - 1);
+          bitSize = global.reportCount - i;
+          if (haveUsageRange && bitSize > usageMax - usage + 1)
+            bitSize = usageMax - usage + 1;
+          if (bitSize > MAX_FIELD_BITS)
+            bitSize = MAX_FIELD_BITS;
+          i = global.reportCount;
+        }
+        else if (page == PAGE_CONSUMER && id == USAGE_AC_BACK && bitSize == 1)
+        {
+          // Firmware 5.x reports View here rather than as a button
+          target = BUTTONS;
+          outShift = AC_BACK_BUTTON - 1;
+        }
+        else
+        {
+          target = mapUsage(page, id);
+        }
+
+        if (target < 0 || bitSize == 0 || bitSize > MAX_FIELD_BITS || parsedCount == MAX_FIELDS)
+          continue;
+
+
+        Field &field = parsed[parsedCount++];
+        field.byteOffset = (uint16_t)(fieldOffset / 8);
+        field.bitShift = (uint8_t)(fieldOffset % 8);
+        field.bitSize = (uint8_t)bitSize;
+        field.byteSpan = (uint8_t)((field.bitShift + bitSize + 7) / 8);
+        field.target = (uint8_t)target;
+        field.outShift = outShift;
+        field.signExtend = logicalMin < 0;
+        field.mask = (1u << bitSize) - 1;
+        field.logicalMin = logicalMin;
+        field.logicalMax = logicalMax;
+
+        int32_t outMin;
+        int32_t outMax;
+        if (target <= RIGHT_STICK_Y)
+        {
+          outMin = -32768;
+          outMax = 32767;
+        }
+        else if (target <= RIGHT_TRIGGER)
+        {
+          outMin = 0;
+          outMax = 255;
+        }
+        else
+        {
+          // Hat and buttons pass through unchanged
+          outMin = logicalMin;
+          outMax = logicalMax;
+        }
+
+        if (target >= HAT_SWITCH || logicalMax <= logicalMin)
+        {
+          field.outMin = logicalMin;
+          field.scale = 1 << 16;
+          field.clampLo = INT32_MIN;
+          field.clampHi = INT32_MAX;
+        }
+        else
+        {
+          int64_t scale = ((int64_t)(outMax - outMin) << 16) / ((int64_t)logicalMax - logicalMin);
+          field.outMin = outMin;
+          field.scale = scale > INT32_MAX ? INT32_MAX : (int32_t)scale;
+          field.clampLo = outMin;
+          field.clampHi = outMax;
+        }
+
+        size_t end = field.byteOffset + field.byteSpan;
+        if (end > parsedLength)
+          parsedLength = end;
+      }
+    }
+    // Output, Feature and Collection items carry no input layout information
+
+    usageCount = 0;
+    usageMin = 0;
+    usageMax = 0;
+    haveUsageRange = false;
+  }
+
+  if (parsedCount == 0)
+  {
+    return false;
+  }
+
+  memcpy(fields, parsed, sizeof(Field) * parsedCount);
+  fieldCount = parsedCount;
+  reportLength = parsedLength;
+  reportId = selectedId;
+  return true;
+}
+
+bool HIDReportMap::decode(const uint8_t *report, size_t length, int32_t out[TARGET_COUNT]) const
+{
+  if (fieldCount == 0 || length < reportLength)
+  {
+    return false;
+  }
+
+  for (size_t t = 0; t < TARGET_COUNT; t++)
+  {
+    out[t] = 0;
+  }
+
+  for (size_t i = 0; i < fieldCount; i++)
+  {
+    const Field &f = fields[i];
+    const uint8_t *p = report + f.byteOffset;
+
+    uint32_t word = 0;
+    for (uint8_t b = 0; b < f.byteSpan; b++)
+    {
+      word |= (uint32_t)p[b] << (8 * b);
+    }
+    uint32_t raw = (word >> f.bitShift) & f.mask;
+
+    uint8_t unused = 32 - f.bitSize;
+    int32_t value = f.signExtend ? (int32_t)(raw << unused) >> unused : (int32_t)raw;
+
+    int32_t mapped = f.outMin + (int32_t)(((int64_t)(value - f.logicalMin) * f.scale + 0x8000) >> 16);
+    mapped = mapped < f.clampLo ? f.clampLo : mapped;
+    mapped = mapped > f.clampHi ? f.clampHi : mapped;
+
+    out[f.target] |= (int32_t)((uint32_t)mapped << f.outShift);
+  }
+  return true;
+}
@@ -0,0 +1,94 @@
+#ifndef HID_REPORT_MAP_H
+#define HID_REPORT_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parses a HID Report Map (report descriptor) once and compiles the input
+// report of interest into a compact field-extraction table.
+//
+// Each gamepad control the rover cares about (sticks, triggers, hat, buttons)
+// becomes one entry holding its bit position, width, signedness and an affine
+// mapping from its logical range onto a canonical range:
+//   sticks   -> -32768..32767
+//   triggers -> 0..255
+//   hat      -> raw value (0 = released on Xbox controllers)
+//   buttons  -> bitmask, button 1 in bit 0; Consumer AC Back (how
+//               firmware 5.x reports View) in button AC_BACK_BUTTON's bit
+// decode() then runs the same straight-line extraction for every entry, so
+// differing controller firmware layouts only change the table contents.
+class HIDReportMap
+{
+public:
+  enum Target
+  {
+    LEFT_STICK_X = 0,
+    LEFT_STICK_Y,
+    RIGHT_STICK_X,
+    RIGHT_STICK_Y,
+    LEFT_TRIGGER,
+    RIGHT_TRIGGER,
+    HAT_SWITCH,
+    BUTTONS,
+    TARGET_COUNT
+  };
+
+  struct Field
+  {
+    uint16_t byteOffset; // first byte holding the field
+    uint8_t bitShift;    // bit position within that byte
+    uint8_t bitSize;     // width in bits (1..24)
+    uint8_t byteSpan;    // bytes touched by the field
+    uint8_t target;      // Target the value is written to
+    uint8_t outShift;    // left shift applied before OR-ing into the target
+    uint8_t signExtend;  // logical minimum is negative
+    uint32_t mask;       // (1 << bitSize) - 1
+    int32_t logicalMin;
+    int32_t logicalMax;
+    int32_t outMin;  // canonical value for logicalMin
+    int32_t scale;   // Q16 canonical units per logical unit
+    int32_t clampLo; // canonical clamp
+    int32_t clampHi;
+  };
+
+  static const size_t MAX_FIELDS = 16;
+
+  // Button number Consumer AC Back decodes as (View on Xbox controllers)
+  static const uint8_t AC_BACK_BUTTON = 11;
+
+  HIDReportMap();
+
+  // Parse a report descriptor and compile the input report with reportId
+  // (0 selects the first input report declared). Returns false if no
+  // gamepad control was found, leaving the previous table untouched.
+  bool parse(const uint8_t *descriptor, size_t length, uint8_t reportId = 0);
+
+  // Load the layout of current Xbox Wireless Controller firmware (5.x)
+  bool loadDefault();
+
+  // Decode one input report into out[TARGET_COUNT]. Targets without a field
+  // decode as 0. Returns false (and leaves out untouched) if the report is
+  // shorter than getReportLength().
+  bool decode(const uint8_t *report, size_t length, int32_t out[TARGET_COUNT]) const;
+
+  bool isValid() const { return fieldCount > 0; }
+  size_t getFieldCount() const { return fieldCount; }
+  const Field &getField(size_t index) const { return fields[index]; }
+  bool hasTarget(Target target) const;
+
+  // Bytes an input report must have to cover every field (without report ID)
+  size_t getReportLength() const { return reportLength; }
+  uint8_t getReportId() const { return reportId; }
+
+  // Built-in descriptor used by loadDefault()
+  static const uint8_t XBOX_DEFAULT_REPORT_MAP[];
+  static const size_t XBOX_DEFAULT_REPORT_MAP_LENGTH;
+
+private:
+  Field fields[MAX_FIELDS];
+  size_t fieldCount;
+  size_t reportLength;
+  uint8_t reportId;
+};
+
+#endif // HID_REPORT_MAP_H
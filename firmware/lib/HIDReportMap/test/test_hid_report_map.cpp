@@ -0,0 +1,266 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "ArduinoUtils.h"
+#include "HIDReportMap.h"
+
+HIDReportMap* reportMap;
+
+void setUp(void) {
+    reportMap = new HIDReportMap();
+}
+
+void tearDown(void) {
+    delete reportMap;
+}
+
+// Input report in the default Xbox layout
+static void makeXboxReport(uint8_t *report, uint16_t lx, uint16_t ly, uint16_t rx, uint16_t ry,
+                           uint16_t lt, uint16_t rt, uint8_t hat, uint16_t buttons) {
+    memset(report, 0, 16);
+    report[0] = lx & 0xFF; report[1] = lx >> 8;
+    report[2] = ly & 0xFF; report[3] = ly >> 8;
+    report[4] = rx & 0xFF; report[5] = rx >> 8;
+    report[6] = ry & 0xFF; report[7] = ry >> 8;
+    report[8] = lt & 0xFF; report[9] = lt >> 8;
+    report[10] = rt & 0xFF; report[11] = rt >> 8;
+    report[12] = hat & 0x0F;
+    report[13] = buttons & 0xFF; report[14] = (buttons >> 8) & 0x7F;
+}
+
+// Older layout: report ID 3, 8-bit triggers first, signed sticks on X/Y/Rx/Ry,
+// 10 buttons packed right after the triggers and no hat switch
+static const uint8_t ALTERNATE_REPORT_MAP[] = {
+    0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+    0x85, 0x03,                         // Report ID (3)
+    0x05, 0x02, 0x09, 0xC5, 0x09, 0xC4, // Brake, Accelerator
+    0x15, 0x00, 0x26, 0xFF, 0x00,       // Logical 0..255
+    0x75, 0x08, 0x95, 0x02, 0x81, 0x02,
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x0A, // Buttons 1..10
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0A, 0x81, 0x02,
+    0x75, 0x06, 0x95, 0x01, 0x81, 0x03, // padding
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x33, 0x09, 0x34,
+    0x16, 0x00, 0x80, 0x26, 0xFF, 0x7F, // Logical -32768..32767
+    0x75, 0x10, 0x95, 0x04, 0x81, 0x02,
+    0xC0,
+};
+
+// Test the built-in Xbox layout compiles to one entry per control
+void test_default_layout(void) {
+    TEST_ASSERT_TRUE(reportMap->loadDefault());
+    TEST_ASSERT_EQUAL_UINT8(1, reportMap->getReportId());
+    TEST_ASSERT_EQUAL(9, reportMap->getFieldCount());
+    TEST_ASSERT_EQUAL(16, reportMap->getReportLength());
+    for (int t = 0; t < HIDReportMap::TARGET_COUNT; t++) {
+        TEST_ASSERT_TRUE(reportMap->hasTarget((HIDReportMap::Target)t));
+    }
+
+    const HIDReportMap::Field &lt = reportMap->getField(4);
+    TEST_ASSERT_EQUAL_UINT8(HIDReportMap::LEFT_TRIGGER, lt.target);
+    TEST_ASSERT_EQUAL_UINT16(8, lt.byteOffset);
+    TEST_ASSERT_EQUAL_UINT8(10, lt.bitSize);
+    TEST_ASSERT_EQUAL_INT32(1023, lt.logicalMax);
+}
+
+// Test decoding maps logical ranges onto the canonical ranges
+void test_decode_default_layout(void) {
+    TEST_ASSERT_TRUE(reportMap->loadDefault());
+
+    uint8_t report[16];
+    int32_t out[HIDReportMap::TARGET_COUNT];
+
+    makeXboxReport(report, 32768, 65535, 0, 49152, 1023, 512, 3, 0x4001);
+    TEST_ASSERT_TRUE(reportMap->decode(report, sizeof(report), out));
+    TEST_ASSERT_EQUAL_INT32(0, out[HIDReportMap::LEFT_STICK_X]);
+    TEST_ASSERT_EQUAL_INT32(32767, out[HIDReportMap::LEFT_STICK_Y]);
+    TEST_ASSERT_EQUAL_INT32(-32768, out[HIDReportMap::RIGHT_STICK_X]);
+    TEST_ASSERT_EQUAL_INT32(16384, out[HIDReportMap::RIGHT_STICK_Y]);
+    TEST_ASSERT_EQUAL_INT32(255, out[HIDReportMap::LEFT_TRIGGER]);
+    TEST_ASSERT_EQUAL_INT32(128, out[HIDReportMap::RIGHT_TRIGGER]);
+    TEST_ASSERT_EQUAL_INT32(3, out[HIDReportMap::HAT_SWITCH]);
+    TEST_ASSERT_EQUAL_INT32(0x4001, out[HIDReportMap::BUTTONS]);
+
+    // Released hat (null state) decodes as 0
+    makeXboxReport(report, 0, 0, 0, 0, 0, 0, 0, 0);
+    TEST_ASSERT_TRUE(reportMap->decode(report, sizeof(report), out));
+    TEST_ASSERT_EQUAL_INT32(0, out[HIDReportMap::HAT_SWITCH]);
+    TEST_ASSERT_EQUAL_INT32(0, out[HIDReportMap::LEFT_TRIGGER]);
+}
+
+// Test reports too short for the table are rejected instead of over-read
+void test_short_report_rejected(void) {
+    TEST_ASSERT_TRUE(reportMap->loadDefault());
+
+    uint8_t report[16];
+    int32_t out[HIDReportMap::TARGET_COUNT];
+    makeXboxReport(report, 1, 2, 3, 4, 5, 6, 7, 8);
+    out[0] = 1234;
+
+    TEST_ASSERT_FALSE(reportMap->decode(report, 12, out));
+    TEST_ASSERT_EQUAL_INT32(1234, out[0]);
+    TEST_ASSERT_FALSE(reportMap->decode(report, 15, out));
+    TEST_ASSERT_TRUE(reportMap->decode(report, 16, out));
+}
+
+// Test View, sent as Consumer AC Back in byte 15, lands on button 11's bit
+void test_decode_view_from_consumer_page(void) {
+    TEST_ASSERT_TRUE(reportMap->loadDefault());
+
+    uint8_t report[16];
+    int32_t out[HIDReportMap::TARGET_COUNT];
+    makeXboxReport(report, 32768, 32768, 32768, 32768, 0, 0, 0, 0x0001);
+    report[15] = 0x01;
+    TEST_ASSERT_TRUE(reportMap->decode(report, sizeof(report), out));
+    TEST_ASSERT_EQUAL_INT32(0x0001 | (1 << (HIDReportMap::AC_BACK_BUTTON - 1)), out[HIDReportMap::BUTTONS]);
+
+    // The padding above it is not a control
+    report[15] = 0xFE;
+    TEST_ASSERT_TRUE(reportMap->decode(report, sizeof(report), out));
+    TEST_ASSERT_EQUAL_INT32(0x0001, out[HIDReportMap::BUTTONS]);
+}
+
+// Test a different firmware layout through the same decode path
+void test_alternate_layout(void) {
+    TEST_ASSERT_TRUE(reportMap->parse(ALTERNATE_REPORT_MAP, sizeof(ALTERNATE_REPORT_MAP)));
+    TEST_ASSERT_EQUAL_UINT8(3, reportMap->getReportId());
+    TEST_ASSERT_EQUAL(7, reportMap->getFieldCount());
+    TEST_ASSERT_EQUAL(12, reportMap->getReportLength());
+    TEST_ASSERT_FALSE(reportMap->hasTarget(HIDReportMap::HAT_SWITCH));
+
+    uint8_t report[12] = {
+        0xFF, 0x40,             // triggers
+        0x05, 0x02,             // buttons 1, 3 and 10
+        0x00, 0x80, 0xFF, 0x7F, // left stick -32768, 32767
+        0x00, 0x00, 0x00, 0x40, // right stick 0, 16384
+    };
+    int32_t out[HIDReportMap::TARGET_COUNT];
+    TEST_ASSERT_TRUE(reportMap->decode(report, sizeof(report), out));
+    TEST_ASSERT_EQUAL_INT32(255, out[HIDReportMap::LEFT_TRIGGER]);
+    TEST_ASSERT_EQUAL_INT32(64, out[HIDReportMap::RIGHT_TRIGGER]);
+    TEST_ASSERT_EQUAL_INT32(0x205, out[HIDReportMap::BUTTONS]);
+    TEST_ASSERT_EQUAL_INT32(-32768, out[HIDReportMap::LEFT_STICK_X]);
+    TEST_ASSERT_EQUAL_INT32(32767, out[HIDReportMap::LEFT_STICK_Y]);
+    TEST_ASSERT_EQUAL_INT32(0, out[HIDReportMap::RIGHT_STICK_X]);
+    TEST_ASSERT_EQUAL_INT32(16384, out[HIDReportMap::RIGHT_STICK_Y]);
+    TEST_ASSERT_EQUAL_INT32(0, out[HIDReportMap::HAT_SWITCH]);
+}
+
+// Test a Report Count beyond the usage range leaves the extra bits unmapped
+void test_report_count_beyond_usage_range(void) {
+    static const uint8_t descriptor[] = {
+        0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+        0x05, 0x09, 0x19, 0x01, 0x29, 0x04, 0x15, 0x00, 0x25, 0x01,
+        0x75, 0x01, 0x95, 0x08, 0x81, 0x02, // buttons 1-4 over 8 bits
+        0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x00, 0x26, 0xFF, 0x00,
+        0x75, 0x08, 0x95, 0x02, 0x81, 0x02,
+        0xC0,
+    };
+    TEST_ASSERT_TRUE(reportMap->parse(descriptor, sizeof(descriptor)));
+    TEST_ASSERT_EQUAL(3, reportMap->getFieldCount());
+    TEST_ASSERT_EQUAL(3, reportMap->getReportLength());
+
+    const uint8_t report[] = {0xFF, 0x00, 0xFF};
+    int32_t out[HIDReportMap::TARGET_COUNT];
+    TEST_ASSERT_TRUE(reportMap->decode(report, sizeof(report), out));
+    TEST_ASSERT_EQUAL_INT32(0x0F, out[HIDReportMap::BUTTONS]);
+    TEST_ASSERT_EQUAL_INT32(-32768, out[HIDReportMap::LEFT_STICK_X]);
+    TEST_ASSERT_EQUAL_INT32(32767, out[HIDReportMap::LEFT_STICK_Y]);
+}
+
+// Test a descriptor without gamepad controls leaves the table untouched
+void test_non_gamepad_descriptor(void) {
+    static const uint8_t keyboard[] = {
+        0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,
+        0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01,
+        0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+        0xC0,
+    };
+    TEST_ASSERT_TRUE(reportMap->loadDefault());
+    TEST_ASSERT_FALSE(reportMap->parse(keyboard, sizeof(keyboard)));
+    TEST_ASSERT_EQUAL(9, reportMap->getFieldCount());
+
+    // Truncated descriptors parse what they can without reading past the end
+    HIDReportMap truncated;
+    TEST_ASSERT_FALSE(truncated.parse(HIDReportMap::XBOX_DEFAULT_REPORT_MAP, 20));
+    TEST_ASSERT_FALSE(truncated.isValid());
+}
+
+// Hard-coded decode of the default layout, for comparison
+static void decodeFixedOffsets(const uint8_t *data, int32_t *out) {
+    out[0] = (int16_t)((data[0] | (data[1] << 8)) - 32768);
+    out[1] = (int16_t)((data[2] | (data[3] << 8)) - 32768);
+    out[2] = (int16_t)((data[4] | (data[5] << 8)) - 32768);
+    out[3] = (int16_t)((data[6] | (data[7] << 8)) - 32768);
+    out[4] = (data[8] | (data[9] << 8)) >> 2;
+    out[5] = (data[10] | (data[11] << 8)) >> 2;
+    out[6] = data[12] & 0x0F;
+    out[7] = (data[13] | (data[14] << 8)) & 0x7FFF;
+}
+
+// Microbenchmark: table-driven decode against fixed offsets
+void test_decode_benchmark(void) {
+    const uint32_t ITERATIONS = 200000;
+    TEST_ASSERT_TRUE(reportMap->loadDefault());
+
+    uint8_t reports[16][16];
+    for (int i = 0; i < 16; i++) {
+        makeXboxReport(reports[i], i * 4000, 65535 - i * 4000, i * 100, i * 200,
+                       i * 60, 1023 - i * 60, i % 9, 1 << i);
+    }
+
+    int32_t out[HIDReportMap::TARGET_COUNT];
+    volatile int32_t sink = 0;
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        reportMap->decode(reports[i & 15], 16, out);
+        sink += out[i & 7];
+    }
+    uint32_t tableUs = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        decodeFixedOffsets(reports[i & 15], out);
+        sink += out[i & 7];
+    }
+    uint32_t fixedUs = micros() - start;
+
+    char buffer[96];
+    sprintf(buffer, "table decode %.1f ns/report, fixed offsets %.1f ns/report",
+            tableUs * 1000.0 / ITERATIONS, fixedUs * 1000.0 / ITERATIONS);
+    TEST_MESSAGE(buffer);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_default_layout);
+    RUN_TEST(test_decode_default_layout);
+    RUN_TEST(test_short_report_rejected);
+    RUN_TEST(test_decode_view_from_consumer_page);
+    RUN_TEST(test_alternate_layout);
+    RUN_TEST(test_report_count_beyond_usage_range);
+    RUN_TEST(test_non_gamepad_descriptor);
+    RUN_TEST(test_decode_benchmark);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
@@ -0,0 +1,91 @@
+#include "LatencyHistogram.h"
+
+#include <string.h>
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+uint8_t LatencyHistogram::bucketIndex(uint32_t latencyUs)
+{
+  if (latencyUs == 0)
+  {
+    return 0;
+  }
+  // Bit length of the value: 1 -> 1, 2..3 -> 2, 4..7 -> 3, ...
+  uint8_t index = (uint8_t)(32 - __builtin_clz(latencyUs));
+  return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+}
+
+uint32_t LatencyHistogram::bucketUpperUs(uint8_t index)
+{
+  if (index >= BUCKET_COUNT - 1)
+  {
+    return UINT32_MAX;
+  }
+  return 1UL << index;
+}
+
+void LatencyHistogram::record(uint32_t latencyUs)
+{
+  buckets[bucketIndex(latencyUs)]++;
+  count++;
+  totalUs += latencyUs;
+  if (latencyUs < minUs)
+  {
+    minUs = latencyUs;
+  }
+  if (latencyUs > maxUs)
+  {
+    maxUs = latencyUs;
+  }
+}
+
+void LatencyHistogram::reset()
+{
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  minUs = UINT32_MAX;
+  maxUs = 0;
+  totalUs = 0;
+}
+
+uint32_t LatencyHistogram::getMeanUs() const
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+  return (uint32_t)(totalUs / count);
+}
+
+uint32_t LatencyHistogram::percentileUs(uint8_t percent) const
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+  if (percent > 100)
+  {
+    percent = 100;
+  }
+
+  // Smallest number of samples that covers the percentile (rounded up)
+  uint32_t needed = (uint32_t)(((uint64_t)count * percent + 99) / 100);
+  if (needed == 0)
+  {
+    needed = 1;
+  }
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += buckets[i];
+    if (seen >= needed)
+    {
+      uint32_t upper = bucketUpperUs(i);
+      return upper < maxUs ? upper : maxUs;
+    }
+  }
+  return maxUs;
+}
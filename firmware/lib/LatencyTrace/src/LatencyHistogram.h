@@ -0,0 +1,47 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Fixed-size latency histogram with power-of-two microsecond buckets.
+//
+// Bucket 0 counts 0 us, bucket i (1..BUCKET_COUNT-2) counts [2^(i-1), 2^i) us
+// and the last bucket everything from 2^(BUCKET_COUNT-2) us up. Recording is
+// a count-leading-zeros and a few adds, with no allocation, so it can run on
+// every control tick. Exact min, max and mean are kept alongside.
+//
+// Not synchronized: record and query from the same task.
+class LatencyHistogram
+{
+public:
+  static const uint8_t BUCKET_COUNT = 20; // last bucket starts at ~262 ms
+
+  LatencyHistogram();
+
+  void record(uint32_t latencyUs);
+  void reset();
+
+  uint32_t getCount() const { return count; }
+  uint32_t getBucket(uint8_t index) const { return index < BUCKET_COUNT ? buckets[index] : 0; }
+  uint32_t getMinUs() const { return count ? minUs : 0; }
+  uint32_t getMaxUs() const { return maxUs; }
+  uint32_t getMeanUs() const;
+
+  // Upper bound on the given percentile (0..100): the end of the bucket
+  // holding it, capped at getMaxUs()
+  uint32_t percentileUs(uint8_t percent) const;
+
+  static uint8_t bucketIndex(uint32_t latencyUs);
+
+  // Exclusive upper bound of a bucket in us (UINT32_MAX for the last one)
+  static uint32_t bucketUpperUs(uint8_t index);
+
+private:
+  uint32_t buckets[BUCKET_COUNT];
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+};
+
+#endif // LATENCY_HISTOGRAM_H
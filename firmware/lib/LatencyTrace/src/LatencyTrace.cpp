@@ -0,0 +1,63 @@
+#include "LatencyTrace.h"
+
+LatencyTrace::LatencyTrace()
+{
+  reset();
+}
+
+bool LatencyTrace::consume(uint32_t arrivalUs, uint32_t nowUs)
+{
+  if (arrivalUs == 0)
+  {
+    return false;
+  }
+  if (arrivalUs == lastArrivalUs)
+  {
+    repeatCount++;
+    return false;
+  }
+
+  lastArrivalUs = arrivalUs;
+  consumeUs = nowUs;
+  applyPending = true;
+  histograms[ARRIVAL_TO_CONSUME].record(nowUs - arrivalUs);
+  return true;
+}
+
+void LatencyTrace::apply(uint32_t nowUs)
+{
+  if (!applyPending)
+  {
+    return;
+  }
+  applyPending = false;
+  histograms[CONSUME_TO_APPLY].record(nowUs - consumeUs);
+  histograms[ARRIVAL_TO_APPLY].record(nowUs - lastArrivalUs);
+}
+
+void LatencyTrace::reset()
+{
+  for (uint8_t i = 0; i < STAGE_COUNT; i++)
+  {
+    histograms[i].reset();
+  }
+  lastArrivalUs = 0;
+  consumeUs = 0;
+  applyPending = false;
+  repeatCount = 0;
+}
+
+const char *LatencyTrace::stageName(Stage stage)
+{
+  switch (stage)
+  {
+  case ARRIVAL_TO_CONSUME:
+    return "arrival->consume";
+  case CONSUME_TO_APPLY:
+    return "consume->apply";
+  case ARRIVAL_TO_APPLY:
+    return "arrival->apply";
+  default:
+    return "?";
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+
+#include "LatencyHistogram.h"
+
+// Input-to-actuation latency of controller reports.
+//
+// Each report carries the micros() stamp taken when its notification
+// arrived (ControllerState::arrivalUs). The control loop calls consume()
+// with that stamp when it reads a snapshot and apply() once the motor
+// command derived from it has been written. Every report is counted once,
+// on the tick that first sees it, so a loop faster than the report rate
+// does not skew the histograms towards short latencies.
+//
+// Owned by the control loop: call and query from that task only.
+class LatencyTrace
+{
+public:
+  enum Stage
+  {
+    ARRIVAL_TO_CONSUME, // notification -> read by the control loop
+    CONSUME_TO_APPLY,   // read -> motor command applied
+    ARRIVAL_TO_APPLY,   // end to end
+    STAGE_COUNT
+  };
+
+  LatencyTrace();
+
+  // The control loop read a snapshot stamped arrivalUs at nowUs. Returns
+  // true if that report is new; 0 means no report has arrived yet.
+  bool consume(uint32_t arrivalUs, uint32_t nowUs);
+
+  // The command computed from the last consumed report took effect at
+  // nowUs. Only the first apply() after a new report is recorded.
+  void apply(uint32_t nowUs);
+
+  const LatencyHistogram &getHistogram(Stage stage) const { return histograms[stage]; }
+
+  // Ticks that consumed a report already seen on an earlier tick
+  uint32_t getRepeatCount() const { return repeatCount; }
+
+  void reset();
+
+  static const char *stageName(Stage stage);
+
+private:
+  LatencyHistogram histograms[STAGE_COUNT];
+  uint32_t lastArrivalUs;
+  uint32_t consumeUs;
+  bool applyPending;
+  uint32_t repeatCount;
+};
+
+#endif // LATENCY_TRACE_H
@@ -0,0 +1,159 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <stdio.h>
+#include "LatencyTrace.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Test samples land in power-of-two buckets
+void test_histogram_buckets(void) {
+    TEST_ASSERT_EQUAL_UINT8(0, LatencyHistogram::bucketIndex(0));
+    TEST_ASSERT_EQUAL_UINT8(1, LatencyHistogram::bucketIndex(1));
+    TEST_ASSERT_EQUAL_UINT8(2, LatencyHistogram::bucketIndex(3));
+    TEST_ASSERT_EQUAL_UINT8(11, LatencyHistogram::bucketIndex(1024));
+    TEST_ASSERT_EQUAL_UINT8(LatencyHistogram::BUCKET_COUNT - 1, LatencyHistogram::bucketIndex(UINT32_MAX));
+    TEST_ASSERT_EQUAL_UINT32(2048, LatencyHistogram::bucketUpperUs(11));
+
+    LatencyHistogram histogram;
+    histogram.record(1500);
+    histogram.record(1024);
+    histogram.record(300);
+    TEST_ASSERT_EQUAL_UINT32(3, histogram.getCount());
+    TEST_ASSERT_EQUAL_UINT32(2, histogram.getBucket(11));
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.getBucket(9));
+    TEST_ASSERT_EQUAL_UINT32(300, histogram.getMinUs());
+    TEST_ASSERT_EQUAL_UINT32(1500, histogram.getMaxUs());
+    TEST_ASSERT_EQUAL_UINT32(941, histogram.getMeanUs());
+
+    histogram.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.getCount());
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.getMinUs());
+    TEST_ASSERT_EQUAL_UINT32(0, histogram.percentileUs(50));
+}
+
+// Test percentiles report the end of the covering bucket, capped at the max
+void test_histogram_percentiles(void) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 90; i++) {
+        histogram.record(100); // bucket [64, 128)
+    }
+    for (int i = 0; i < 10; i++) {
+        histogram.record(5000); // bucket [4096, 8192)
+    }
+    TEST_ASSERT_EQUAL_UINT32(128, histogram.percentileUs(50));
+    TEST_ASSERT_EQUAL_UINT32(128, histogram.percentileUs(90));
+    TEST_ASSERT_EQUAL_UINT32(5000, histogram.percentileUs(91));
+    TEST_ASSERT_EQUAL_UINT32(5000, histogram.percentileUs(100));
+}
+
+// Test each report is counted once, however many ticks read it
+void test_trace_counts_each_report_once(void) {
+    LatencyTrace trace;
+    TEST_ASSERT_FALSE(trace.consume(0, 500)); // nothing arrived yet
+    trace.apply(600);
+    TEST_ASSERT_EQUAL_UINT32(0, trace.getHistogram(LatencyTrace::ARRIVAL_TO_APPLY).getCount());
+
+    TEST_ASSERT_TRUE(trace.consume(1000, 3000));
+    trace.apply(3200);
+    TEST_ASSERT_FALSE(trace.consume(1000, 23000)); // same report, next tick
+    trace.apply(23200);
+    TEST_ASSERT_TRUE(trace.consume(21000, 43000));
+    trace.apply(43500);
+
+    const LatencyHistogram &consume = trace.getHistogram(LatencyTrace::ARRIVAL_TO_CONSUME);
+    const LatencyHistogram &apply = trace.getHistogram(LatencyTrace::CONSUME_TO_APPLY);
+    const LatencyHistogram &total = trace.getHistogram(LatencyTrace::ARRIVAL_TO_APPLY);
+    TEST_ASSERT_EQUAL_UINT32(2, consume.getCount());
+    TEST_ASSERT_EQUAL_UINT32(22000, consume.getMaxUs());
+    TEST_ASSERT_EQUAL_UINT32(2, apply.getCount());
+    TEST_ASSERT_EQUAL_UINT32(200, apply.getMinUs());
+    TEST_ASSERT_EQUAL_UINT32(500, apply.getMaxUs());
+    TEST_ASSERT_EQUAL_UINT32(2200, total.getMinUs());
+    TEST_ASSERT_EQUAL_UINT32(22500, total.getMaxUs());
+    TEST_ASSERT_EQUAL_UINT32(1, trace.getRepeatCount());
+}
+
+static size_t rampReport(void *context, uint32_t index, uint8_t *report, size_t capacity) {
+    memset(report, 0, 16);
+    uint16_t lx = (uint16_t)(32768 + (index & 0x3FFF));
+    report[0] = lx & 0xFF;
+    report[1] = lx >> 8;
+    report[2] = 0x00;
+    report[3] = 0x80;
+    return 16;
+}
+
+// Test the trace end to end: simulated notifications at 500 Hz, 100 Hz loop
+void test_trace_with_simulated_transport(void) {
+    SimulatedBLETransport transport;
+    XboxBLEController controller(transport);
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport.addPeripheral(advertisement);
+    TEST_ASSERT_TRUE(controller.begin());
+    TEST_ASSERT_TRUE(controller.scanAndConnect(1000));
+
+    transport.setReportGenerator(rampReport, nullptr);
+    SimulatedBLETransport::StreamConfig config = {500, 1, 0};
+    TEST_ASSERT_TRUE(transport.startStreaming(config));
+
+    LatencyTrace trace;
+    uint32_t consumed = 0;
+    for (int tick = 0; tick < 50; tick++) {
+        delay(10);
+        XboxBLEController::ControllerState state = controller.snapshot();
+        if (trace.consume(state.arrivalUs, micros())) {
+            consumed++;
+        }
+        trace.apply(micros());
+    }
+    transport.stopStreaming();
+
+    const LatencyHistogram &consume = trace.getHistogram(LatencyTrace::ARRIVAL_TO_CONSUME);
+    const LatencyHistogram &total = trace.getHistogram(LatencyTrace::ARRIVAL_TO_APPLY);
+    TEST_ASSERT_TRUE(consumed > 40);
+    TEST_ASSERT_EQUAL_UINT32(consumed, consume.getCount());
+    TEST_ASSERT_EQUAL_UINT32(consumed, total.getCount());
+    TEST_ASSERT_TRUE(total.getMinUs() >= consume.getMinUs());
+    // Reports are at most one 2 ms period old when read; allow for scheduling
+    TEST_ASSERT_TRUE(consume.percentileUs(50) <= 8192);
+    TEST_ASSERT_TRUE(total.getMaxUs() < 50000);
+
+    for (uint8_t i = 0; i < LatencyTrace::STAGE_COUNT; i++) {
+        const LatencyHistogram &h = trace.getHistogram((LatencyTrace::Stage)i);
+        printf("  %s: p50 %u us, p99 %u us, max %u us\n", LatencyTrace::stageName((LatencyTrace::Stage)i),
+               (unsigned)h.percentileUs(50), (unsigned)h.percentileUs(99), (unsigned)h.getMaxUs());
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_buckets);
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_trace_counts_each_report_once);
+    RUN_TEST(test_trace_with_simulated_transport);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
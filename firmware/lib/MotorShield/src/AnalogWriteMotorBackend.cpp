@@ -0,0 +1,132 @@
+#if defined(ARDUINO) && !defined(ARDUINO_ARCH_ESP32)
+
+#include "AnalogWriteMotorBackend.h"
+
+#include <string.h>
+
+// analogWrite() carriers on these cores are in the low kHz range
+static const uint32_t CARRIER_PERIOD_US = 2000;
+
+AnalogWriteMotorBackend::AnalogWriteMotorBackend()
+    : started(false),
+      cut(false),
+      cutOffs(0),
+      seenCutOffs(0)
+{
+  memset(pins, 0, sizeof(pins));
+  memset(duty, 0, sizeof(duty));
+  memset(directionHigh, 0, sizeof(directionHigh));
+  memset(brakeHigh, 0, sizeof(brakeHigh));
+}
+
+bool AnalogWriteMotorBackend::begin(const MotorPins newPins[MOTOR_CHANNEL_COUNT], uint32_t frequencyHz,
+                                    uint8_t resolutionBits)
+{
+  // The carrier is the core's own; only the duty range can be checked
+  (void)frequencyHz;
+  if (resolutionBits != 8)
+  {
+    return false;
+  }
+  memcpy(pins, newPins, sizeof(pins));
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    pinMode(pins[i].direction, OUTPUT);
+    pinMode(pins[i].brake, OUTPUT);
+    pinMode(pins[i].pwm, OUTPUT);
+    digitalWrite(pins[i].direction, LOW);
+    digitalWrite(pins[i].brake, LOW);
+    analogWrite(pins[i].pwm, 0);
+  }
+  started = true;
+  return true;
+}
+
+void AnalogWriteMotorBackend::cutOff()
+{
+  cut = true;
+  cutOffs = cutOffs + 1;
+  if (!started)
+  {
+    return;
+  }
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    analogWrite(pins[i].pwm, 0);
+  }
+}
+
+void AnalogWriteMotorBackend::write(const MotorFrame &requested)
+{
+  if (!started)
+  {
+    return;
+  }
+
+  // cutOff() may have zeroed the pins behind the cached duties
+  bool resync = cutOffs != seenCutOffs;
+  seenCutOffs = cutOffs;
+  MotorFrame frame = requested;
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    if (cut)
+    {
+      frame.channels[i].duty = 0;
+    }
+    if (resync)
+    {
+      duty[i] = UINT16_MAX;
+    }
+  }
+
+  bool lowered = false;
+  bool pinsChange = false;
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    const MotorOutput &output = frame.channels[i];
+    if (output.duty < duty[i])
+    {
+      analogWrite(pins[i].pwm, output.duty);
+      duty[i] = output.duty;
+      lowered = true;
+    }
+    bool direction = output.mode == MotorOutput::FORWARD ||
+                     (output.mode != MotorOutput::REVERSE && directionHigh[i]);
+    bool brake = output.mode == MotorOutput::BRAKE;
+    pinsChange = pinsChange || direction != directionHigh[i] || brake != brakeHigh[i];
+  }
+
+  if (pinsChange && lowered)
+  {
+    delayMicroseconds(CARRIER_PERIOD_US);
+  }
+
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    const MotorOutput &output = frame.channels[i];
+    bool direction = output.mode == MotorOutput::FORWARD ||
+                     (output.mode != MotorOutput::REVERSE && directionHigh[i]);
+    bool brake = output.mode == MotorOutput::BRAKE;
+    if (direction != directionHigh[i])
+    {
+      digitalWrite(pins[i].direction, direction ? HIGH : LOW);
+      directionHigh[i] = direction;
+    }
+    if (brake != brakeHigh[i])
+    {
+      digitalWrite(pins[i].brake, brake ? HIGH : LOW);
+      brakeHigh[i] = brake;
+    }
+  }
+
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    if (frame.channels[i].duty > duty[i])
+    {
+      analogWrite(pins[i].pwm, frame.channels[i].duty);
+      duty[i] = frame.channels[i].duty;
+    }
+  }
+}
+
+#endif // ARDUINO && !ARDUINO_ARCH_ESP32
@@ -0,0 +1,38 @@
+#ifndef ANALOG_WRITE_MOTOR_BACKEND_H
+#define ANALOG_WRITE_MOTOR_BACKEND_H
+
+#if defined(ARDUINO) && !defined(ARDUINO_ARCH_ESP32)
+
+#include <Arduino.h>
+
+#include "MotorBackend.h"
+
+// MotorBackend for boards without a dedicated driver (e.g. the Arduino 101):
+// analogWrite() on the core's hardware PWM timers, at the carrier frequency
+// the core uses for those pins and 8-bit duty. begin() fails for any other
+// resolution. Same write ordering as ESP32MotorBackend.
+class AnalogWriteMotorBackend : public MotorBackend
+{
+public:
+  AnalogWriteMotorBackend();
+
+  bool begin(const MotorPins pins[MOTOR_CHANNEL_COUNT], uint32_t frequencyHz, uint8_t resolutionBits);
+  void write(const MotorFrame &frame);
+  void cutOff();
+  void restore() { cut = false; }
+  bool isCutOff() const { return cut; }
+
+private:
+  MotorPins pins[MOTOR_CHANNEL_COUNT];
+  uint16_t duty[MOTOR_CHANNEL_COUNT];
+  bool directionHigh[MOTOR_CHANNEL_COUNT];
+  bool brakeHigh[MOTOR_CHANNEL_COUNT];
+  bool started;
+  volatile bool cut;
+  volatile uint32_t cutOffs;
+  uint32_t seenCutOffs;
+};
+
+#endif // ARDUINO && !ARDUINO_ARCH_ESP32
+
+#endif // ANALOG_WRITE_MOTOR_BACKEND_H
@@ -0,0 +1,196 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include "ESP32MotorBackend.h"
+
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+
+ESP32MotorBackend::ESP32MotorBackend()
+    : periodUs(0),
+      started(false),
+      cut(false),
+      cutOffs(0),
+      seenCutOffs(0)
+{
+  portMUX_INITIALIZE(&dutyLock);
+  memset(pins, 0, sizeof(pins));
+  memset(duty, 0, sizeof(duty));
+  memset(directionHigh, 0, sizeof(directionHigh));
+  memset(brakeHigh, 0, sizeof(brakeHigh));
+}
+
+bool ESP32MotorBackend::begin(const MotorPins newPins[MOTOR_CHANNEL_COUNT], uint32_t frequencyHz,
+                              uint8_t resolutionBits)
+{
+  if (frequencyHz == 0)
+  {
+    return false;
+  }
+  memcpy(pins, newPins, sizeof(pins));
+
+  // Fails if the source clock cannot give this resolution at this frequency
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = LEDC_LOW_SPEED_MODE;
+  timer.duty_resolution = (ledc_timer_bit_t)resolutionBits;
+  timer.timer_num = TIMER;
+  timer.freq_hz = frequencyHz;
+  timer.clk_cfg = LEDC_AUTO_CLK;
+  if (ledc_timer_config(&timer) != ESP_OK)
+  {
+    return false;
+  }
+  periodUs = 1000000UL / frequencyHz + 1;
+
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    // Brake released, direction low, bridge off before PWM is attached
+    pinMode(pins[i].direction, OUTPUT);
+    pinMode(pins[i].brake, OUTPUT);
+    digitalWrite(pins[i].direction, LOW);
+    digitalWrite(pins[i].brake, LOW);
+
+    ledc_channel_config_t channel = {};
+    channel.gpio_num = pins[i].pwm;
+    channel.speed_mode = LEDC_LOW_SPEED_MODE;
+    channel.channel = (ledc_channel_t)(FIRST_CHANNEL + i);
+    channel.timer_sel = TIMER;
+    channel.duty = 0;
+    channel.hpoint = 0;
+    if (ledc_channel_config(&channel) != ESP_OK)
+    {
+      return false;
+    }
+    duty[i] = 0;
+    directionHigh[i] = false;
+    brakeHigh[i] = false;
+  }
+  started = true;
+  return true;
+}
+
+void ESP32MotorBackend::setDuty(uint8_t channel, uint16_t value)
+{
+  ledc_channel_t ledcChannel = (ledc_channel_t)(FIRST_CHANNEL + channel);
+  portENTER_CRITICAL(&dutyLock);
+  // A cut-off since write() checked wins over the frame
+  if (cut.load(std::memory_order_relaxed))
+  {
+    value = 0;
+  }
+  ledc_set_duty(LEDC_LOW_SPEED_MODE, ledcChannel, value);
+  ledc_update_duty(LEDC_LOW_SPEED_MODE, ledcChannel);
+  portEXIT_CRITICAL(&dutyLock);
+  duty[channel] = value;
+}
+
+void ESP32MotorBackend::writePins(uint64_t setMask, uint64_t clearMask)
+{
+  // GPIO 0-31 and 32-39 live in separate registers
+  if ((uint32_t)setMask)
+    REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)setMask);
+  if ((uint32_t)clearMask)
+    REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)clearMask);
+  if (setMask >> 32)
+    REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(setMask >> 32));
+  if (clearMask >> 32)
+    REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(clearMask >> 32));
+}
+
+void ESP32MotorBackend::cutOff()
+{
+  portENTER_CRITICAL(&dutyLock);
+  cut.store(true, std::memory_order_release);
+  cutOffs.fetch_add(1, std::memory_order_acq_rel);
+  if (started)
+  {
+    for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+    {
+      ledc_channel_t ledcChannel = (ledc_channel_t)(FIRST_CHANNEL + i);
+      ledc_set_duty(LEDC_LOW_SPEED_MODE, ledcChannel, 0);
+      ledc_update_duty(LEDC_LOW_SPEED_MODE, ledcChannel);
+    }
+  }
+  portEXIT_CRITICAL(&dutyLock);
+}
+
+void ESP32MotorBackend::write(const MotorFrame &requested)
+{
+  if (!started)
+  {
+    return;
+  }
+
+  // A cut-off since the last write left the hardware at zero behind the
+  // cached duties: force every duty to be rewritten
+  uint32_t offs = cutOffs.load(std::memory_order_acquire);
+  if (offs != seenCutOffs)
+  {
+    seenCutOffs = offs;
+    for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+    {
+      duty[i] = UINT16_MAX;
+    }
+  }
+
+  MotorFrame frame = requested;
+  if (isCutOff())
+  {
+    for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+    {
+      frame.channels[i].duty = 0;
+    }
+  }
+
+  uint64_t setMask = 0;
+  uint64_t clearMask = 0;
+  bool lowered = false;
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    const MotorOutput &output = frame.channels[i];
+
+    // COAST and BRAKE keep the last direction
+    bool direction = directionHigh[i];
+    if (output.mode == MotorOutput::FORWARD)
+      direction = true;
+    else if (output.mode == MotorOutput::REVERSE)
+      direction = false;
+    bool brake = output.mode == MotorOutput::BRAKE;
+
+    if (direction != directionHigh[i])
+    {
+      (direction ? setMask : clearMask) |= 1ULL << pins[i].direction;
+      directionHigh[i] = direction;
+    }
+    if (brake != brakeHigh[i])
+    {
+      (brake ? setMask : clearMask) |= 1ULL << pins[i].brake;
+      brakeHigh[i] = brake;
+    }
+
+    // Lower duties go out before any pin changes
+    if (output.duty < duty[i])
+    {
+      setDuty(i, output.duty);
+      lowered = true;
+    }
+  }
+
+  if (setMask | clearMask)
+  {
+    if (lowered)
+    {
+      delayMicroseconds(periodUs);
+    }
+    writePins(setMask, clearMask);
+  }
+
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    if (frame.channels[i].duty > duty[i])
+    {
+      setDuty(i, frame.channels[i].duty);
+    }
+  }
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,60 @@
+#ifndef ESP32_MOTOR_BACKEND_H
+#define ESP32_MOTOR_BACKEND_H
+
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+
+#include <atomic>
+
+#include "MotorBackend.h"
+
+// MotorBackend on the ESP32 LEDC peripheral: one hardware PWM channel per
+// motor sharing one timer, so both carriers run in phase at the same
+// frequency. Direction and brake pins of both channels are switched with one
+// write to the GPIO set and one to the clear register.
+//
+// Duty changes latch at the end of the current PWM period. When a frame
+// lowers a duty and changes pins at the same time, the lower duty is latched
+// first and the pins follow one period later, so a released brake or a
+// direction change never meets the old duty.
+//
+// cutOff() zeroes both duties directly in the LEDC peripheral, so it works
+// from the current sense task on the other core while the control task is
+// mid-write. Every duty write happens under the same lock as the cut-off and
+// writes zero once cut, so a write in flight cannot restore the old duty.
+class ESP32MotorBackend : public MotorBackend
+{
+public:
+  // LEDC resources, chosen clear of the ones the Arduino core hands out first
+  static const ledc_timer_t TIMER = LEDC_TIMER_3;
+  static const ledc_channel_t FIRST_CHANNEL = LEDC_CHANNEL_6;
+
+  ESP32MotorBackend();
+
+  bool begin(const MotorPins pins[MOTOR_CHANNEL_COUNT], uint32_t frequencyHz, uint8_t resolutionBits);
+  void write(const MotorFrame &frame);
+  void cutOff();
+  void restore() { cut.store(false, std::memory_order_release); }
+  bool isCutOff() const { return cut.load(std::memory_order_acquire); }
+
+private:
+  MotorPins pins[MOTOR_CHANNEL_COUNT];
+  uint32_t periodUs;
+  uint16_t duty[MOTOR_CHANNEL_COUNT];
+  bool directionHigh[MOTOR_CHANNEL_COUNT];
+  bool brakeHigh[MOTOR_CHANNEL_COUNT];
+  bool started;
+  std::atomic<bool> cut;
+  portMUX_TYPE dutyLock; // orders duty writes against cutOff()
+  std::atomic<uint32_t> cutOffs;
+  uint32_t seenCutOffs;
+
+  void setDuty(uint8_t channel, uint16_t value);
+  static void writePins(uint64_t setMask, uint64_t clearMask);
+};
+
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // ESP32_MOTOR_BACKEND_H
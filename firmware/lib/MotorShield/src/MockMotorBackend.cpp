@@ -0,0 +1,63 @@
+#ifndef ARDUINO
+
+#include "MockMotorBackend.h"
+
+#include <string.h>
+
+MockMotorBackend::MockMotorBackend()
+    : failBegin(false),
+      started(false),
+      frequencyHz(0),
+      resolutionBits(0),
+      glitches(0),
+      cut(false),
+      cutOffs(0)
+{
+  memset(pins, 0, sizeof(pins));
+}
+
+bool MockMotorBackend::begin(const MotorPins newPins[MOTOR_CHANNEL_COUNT], uint32_t newFrequencyHz,
+                             uint8_t newResolutionBits)
+{
+  if (failBegin)
+  {
+    return false;
+  }
+  memcpy(pins, newPins, sizeof(pins));
+  frequencyHz = newFrequencyHz;
+  resolutionBits = newResolutionBits;
+  started = true;
+  return true;
+}
+
+void MockMotorBackend::cutOff()
+{
+  cut = true;
+  cutOffs++;
+}
+
+void MockMotorBackend::write(const MotorFrame &requested)
+{
+  MotorFrame frame = requested;
+  for (uint8_t i = 0; cut && i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    frame.channels[i].duty = 0;
+  }
+
+  if (!frames.empty())
+  {
+    const MotorFrame &previous = frames.back();
+    for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+    {
+      uint8_t from = previous.channels[i].mode;
+      uint8_t to = frame.channels[i].mode;
+      if (from != to && from != MotorOutput::COAST && to != MotorOutput::COAST)
+      {
+        glitches++;
+      }
+    }
+  }
+  frames.push_back(frame);
+}
+
+#endif // ARDUINO
@@ -0,0 +1,56 @@
+#ifndef MOCK_MOTOR_BACKEND_H
+#define MOCK_MOTOR_BACKEND_H
+
+#ifndef ARDUINO
+
+#include <vector>
+
+#include "MotorBackend.h"
+
+// Host backend that records every frame, so the stick-to-duty pipeline and
+// the transition sequencing can be checked natively. Frames written while
+// cut off are recorded with zero duty, as the hardware would apply them.
+class MockMotorBackend : public MotorBackend
+{
+public:
+  MockMotorBackend();
+
+  bool begin(const MotorPins pins[MOTOR_CHANNEL_COUNT], uint32_t frequencyHz, uint8_t resolutionBits);
+  void write(const MotorFrame &frame);
+  void cutOff();
+  void restore() { cut = false; }
+  bool isCutOff() const { return cut; }
+
+  uint32_t getCutOffCount() const { return cutOffs; }
+
+  // Make begin() fail, e.g. for an unsupported carrier
+  void setFailBegin(bool fail) { failBegin = fail; }
+
+  bool isStarted() const { return started; }
+  uint32_t getFrequencyHz() const { return frequencyHz; }
+  uint8_t getResolutionBits() const { return resolutionBits; }
+  const MotorPins &getPins(uint8_t channel) const { return pins[channel]; }
+
+  uint32_t getWriteCount() const { return (uint32_t)frames.size(); }
+  const MotorFrame &getLastFrame() const { return frames.back(); }
+  const std::vector<MotorFrame> &getFrames() const { return frames; }
+
+  // Frames that flipped a channel between FORWARD and REVERSE (or left
+  // BRAKE) without a COAST frame in between
+  uint32_t getGlitchCount() const { return glitches; }
+
+private:
+  bool failBegin;
+  bool started;
+  uint32_t frequencyHz;
+  uint8_t resolutionBits;
+  MotorPins pins[MOTOR_CHANNEL_COUNT];
+  std::vector<MotorFrame> frames;
+  uint32_t glitches;
+  bool cut;
+  uint32_t cutOffs;
+};
+
+#endif // ARDUINO
+
+#endif // MOCK_MOTOR_BACKEND_H
@@ -0,0 +1,64 @@
+#ifndef MOTOR_BACKEND_H
+#define MOTOR_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pins of one H-bridge channel
+struct MotorPins
+{
+  uint8_t direction;
+  uint8_t pwm;
+  uint8_t brake;
+};
+
+// Motor Shield Rev3 (L298P), Arduino header numbering; see firmware/README.md
+static const MotorPins MOTOR_SHIELD_REV3_A = {12, 3, 9};
+static const MotorPins MOTOR_SHIELD_REV3_B = {13, 11, 8};
+
+// What one channel does until the next frame
+struct MotorOutput
+{
+  enum Mode : uint8_t
+  {
+    COAST,   // bridge disabled (duty 0), motor free-wheels
+    FORWARD, // direction high, duty drives
+    REVERSE, // direction low, duty drives
+    BRAKE    // brake high with the bridge enabled: both motor leads shorted
+  };
+
+  uint8_t mode;
+  uint16_t duty; // 0..(2^resolutionBits - 1)
+};
+
+static const uint8_t MOTOR_CHANNEL_COUNT = 2;
+
+// Outputs of every channel for one control tick
+struct MotorFrame
+{
+  MotorOutput channels[MOTOR_CHANNEL_COUNT];
+};
+
+// Drives the pins. write() gets a complete frame once per control tick and
+// applies both channels together; it never has to flip the direction of a
+// channel that is still driven, MotorShield inserts a coast tick first.
+class MotorBackend
+{
+public:
+  virtual ~MotorBackend() {}
+
+  // Configure pins and the PWM carrier. resolutionBits is the duty range
+  // the backend was asked for; returns false if it cannot provide it.
+  virtual bool begin(const MotorPins pins[MOTOR_CHANNEL_COUNT], uint32_t frequencyHz, uint8_t resolutionBits) = 0;
+
+  virtual void write(const MotorFrame &frame) = 0;
+
+  // Disable both bridges now, from any task or callback (e.g. an
+  // overcurrent trip). Frames written afterwards are applied with zero duty
+  // until restore().
+  virtual void cutOff() = 0;
+  virtual void restore() = 0;
+  virtual bool isCutOff() const = 0;
+};
+
+#endif // MOTOR_BACKEND_H
@@ -0,0 +1,118 @@
+#include "MotorShield.h"
+
+#include <string.h>
+
+MotorShield::MotorShield(MotorBackend &backend, const Config &config)
+    : backend(backend),
+      config(config),
+      maxDuty(0),
+      transitionCount(0)
+{
+  if (this->config.resolutionBits < 1 || this->config.resolutionBits > 16)
+  {
+    this->config.resolutionBits = 8;
+  }
+  if (this->config.reversalDeadTicks < 1)
+  {
+    this->config.reversalDeadTicks = 1;
+  }
+  maxDuty = (uint16_t)((1UL << this->config.resolutionBits) - 1);
+  memset(staged, 0, sizeof(staged));
+  memset(stagedBrake, 0, sizeof(stagedBrake));
+  memset(coastTicks, 0, sizeof(coastTicks));
+  memset(&frame, 0, sizeof(frame));
+}
+
+bool MotorShield::begin()
+{
+  if (!backend.begin(config.pins, config.pwmFrequencyHz, config.resolutionBits))
+  {
+    return false;
+  }
+  // Start from a known state: both channels coasting
+  memset(&frame, 0, sizeof(frame));
+  backend.write(frame);
+  return true;
+}
+
+void MotorShield::set(Channel channel, int16_t commandQ15)
+{
+  if (commandQ15 < -32767)
+  {
+    commandQ15 = -32767;
+  }
+  staged[channel] = commandQ15;
+  stagedBrake[channel] = false;
+}
+
+void MotorShield::setNormalized(Channel channel, float command)
+{
+  if (command > 1.0f)
+    command = 1.0f;
+  else if (command < -1.0f)
+    command = -1.0f;
+  set(channel, (int16_t)(command * 32767.0f));
+}
+
+void MotorShield::stop(bool brake)
+{
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    staged[i] = 0;
+    stagedBrake[i] = brake;
+  }
+}
+
+MotorOutput MotorShield::target(uint8_t channel) const
+{
+  MotorOutput output;
+  int16_t command = staged[channel];
+  uint32_t magnitude = command < 0 ? (uint32_t)(-(int32_t)command) : (uint32_t)command;
+
+  if (magnitude == 0 || magnitude < (uint32_t)config.deadbandQ15)
+  {
+    // The L298 only brakes with the bridge enabled
+    bool brake = stagedBrake[channel] || config.brakeOnZero;
+    output.mode = brake ? MotorOutput::BRAKE : MotorOutput::COAST;
+    output.duty = brake ? maxDuty : 0;
+    return output;
+  }
+
+  output.mode = command > 0 ? MotorOutput::FORWARD : MotorOutput::REVERSE;
+  // Round to nearest: full scale maps exactly onto maxDuty
+  output.duty = (uint16_t)((magnitude * maxDuty + 16383) / 32767);
+  return output;
+}
+
+void MotorShield::apply()
+{
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    MotorOutput next = target(i);
+    MotorOutput &current = frame.channels[i];
+
+    if (coastTicks[i] > 0)
+    {
+      // Still in the dead time of a mode change
+      coastTicks[i]--;
+      if (coastTicks[i] > 0 || next.mode == MotorOutput::COAST)
+      {
+        current.mode = MotorOutput::COAST;
+        current.duty = 0;
+        continue;
+      }
+    }
+    else if (current.mode != MotorOutput::COAST && next.mode != MotorOutput::COAST &&
+             current.mode != next.mode)
+    {
+      // Coast first; the new mode starts after the dead time
+      transitionCount++;
+      coastTicks[i] = config.reversalDeadTicks;
+      current.mode = MotorOutput::COAST;
+      current.duty = 0;
+      continue;
+    }
+    current = next;
+  }
+  backend.write(frame);
+}
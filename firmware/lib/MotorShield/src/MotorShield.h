@@ -0,0 +1,77 @@
+#ifndef MOTOR_SHIELD_H
+#define MOTOR_SHIELD_H
+
+#include <stdint.h>
+
+#include "MotorBackend.h"
+
+// Two-channel DC motor output for the L298P Motor Shield.
+//
+// The control loop stages a signed command per channel with set() and
+// commits both with one apply() per tick, which hands the backend a single
+// MotorFrame. Commands are Q15 (-32767..32767, sign = direction) and map
+// linearly onto the PWM duty range.
+//
+// Mode changes (forward, reverse, brake) go through COAST for
+// reversalDeadTicks ticks, so the direction pin never flips while the bridge
+// is driven and a released brake never meets a full-duty PWM.
+class MotorShield
+{
+public:
+  enum Channel
+  {
+    CHANNEL_A,
+    CHANNEL_B
+  };
+
+  struct Config
+  {
+    MotorPins pins[MOTOR_CHANNEL_COUNT];
+    uint32_t pwmFrequencyHz;   // PWM carrier, above hearing (e.g. 20 kHz)
+    uint8_t resolutionBits;    // duty range 0..2^bits - 1
+    int16_t deadbandQ15;       // |command| below this is treated as zero
+    bool brakeOnZero;          // zero command brakes instead of coasting
+    uint8_t reversalDeadTicks; // coast ticks between modes (at least 1)
+  };
+
+  MotorShield(MotorBackend &backend, const Config &config);
+
+  bool begin();
+
+  // Stage a command for the next apply()
+  void set(Channel channel, int16_t commandQ15);
+  void setNormalized(Channel channel, float command); // -1.0 to 1.0
+
+  // Stage zero on both channels (braking if brake is set)
+  void stop(bool brake);
+
+  // Commit the staged commands: one backend write per call
+  void apply();
+
+  // Emergency stop that bypasses the tick; see MotorBackend::cutOff()
+  void cutOff() { backend.cutOff(); }
+  void restore() { backend.restore(); }
+  bool isCutOff() const { return backend.isCutOff(); }
+
+  // Frame written by the last apply()
+  const MotorFrame &getFrame() const { return frame; }
+
+  uint16_t getMaxDuty() const { return maxDuty; }
+
+  // Mode changes that had to pass through a coast tick
+  uint32_t getTransitionCount() const { return transitionCount; }
+
+private:
+  MotorBackend &backend;
+  Config config;
+  uint16_t maxDuty;
+  int16_t staged[MOTOR_CHANNEL_COUNT];
+  bool stagedBrake[MOTOR_CHANNEL_COUNT];
+  uint8_t coastTicks[MOTOR_CHANNEL_COUNT];
+  MotorFrame frame;
+  uint32_t transitionCount;
+
+  MotorOutput target(uint8_t channel) const;
+};
+
+#endif // MOTOR_SHIELD_H
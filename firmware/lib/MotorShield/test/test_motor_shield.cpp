@@ -0,0 +1,215 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "DriveMixer.h"
+#include "MockMotorBackend.h"
+#include "MotorShield.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+static MotorShield::Config makeConfig(void) {
+    MotorShield::Config config = {{MOTOR_SHIELD_REV3_A, MOTOR_SHIELD_REV3_B}, 20000, 10, 0, false, 1};
+    return config;
+}
+
+MockMotorBackend* backend;
+
+void setUp(void) {
+    backend = new MockMotorBackend();
+}
+
+void tearDown(void) {
+    delete backend;
+}
+
+// Test begin() configures the carrier and starts both channels coasting
+void test_begin_configures_backend(void) {
+    MotorShield motors(*backend, makeConfig());
+    TEST_ASSERT_TRUE(motors.begin());
+    TEST_ASSERT_TRUE(backend->isStarted());
+    TEST_ASSERT_EQUAL_UINT32(20000, backend->getFrequencyHz());
+    TEST_ASSERT_EQUAL_UINT8(10, backend->getResolutionBits());
+    TEST_ASSERT_EQUAL_UINT8(11, backend->getPins(MotorShield::CHANNEL_B).pwm);
+    TEST_ASSERT_EQUAL_UINT16(1023, motors.getMaxDuty());
+    TEST_ASSERT_EQUAL_UINT32(1, backend->getWriteCount());
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::COAST, backend->getLastFrame().channels[0].mode);
+
+    MockMotorBackend failing;
+    failing.setFailBegin(true);
+    MotorShield unsupported(failing, makeConfig());
+    TEST_ASSERT_FALSE(unsupported.begin());
+}
+
+// Test commands map onto the duty range, with the deadband and brake option
+void test_command_to_duty(void) {
+    MotorShield::Config config = makeConfig();
+    config.deadbandQ15 = 1000;
+    MotorShield motors(*backend, config);
+    TEST_ASSERT_TRUE(motors.begin());
+
+    motors.set(MotorShield::CHANNEL_A, 32767);
+    motors.set(MotorShield::CHANNEL_B, 16384);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::FORWARD, backend->getLastFrame().channels[0].mode);
+    TEST_ASSERT_EQUAL_UINT16(1023, backend->getLastFrame().channels[0].duty);
+    TEST_ASSERT_EQUAL_UINT16(512, backend->getLastFrame().channels[1].duty);
+
+    motors.set(MotorShield::CHANNEL_A, 999); // inside the deadband
+    motors.setNormalized(MotorShield::CHANNEL_B, 0.25f);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::COAST, backend->getLastFrame().channels[0].mode);
+    TEST_ASSERT_EQUAL_UINT16(0, backend->getLastFrame().channels[0].duty);
+    TEST_ASSERT_EQUAL_UINT16(256, backend->getLastFrame().channels[1].duty);
+
+    motors.stop(true);
+    motors.apply(); // B goes through a coast tick before braking
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::BRAKE, backend->getLastFrame().channels[0].mode);
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::BRAKE, backend->getLastFrame().channels[1].mode);
+    TEST_ASSERT_EQUAL_UINT16(1023, backend->getLastFrame().channels[1].duty);
+}
+
+// Test staged commands reach the backend only on apply(), one frame per tick
+void test_one_write_per_apply(void) {
+    MotorShield motors(*backend, makeConfig());
+    TEST_ASSERT_TRUE(motors.begin());
+    uint32_t writes = backend->getWriteCount();
+
+    motors.set(MotorShield::CHANNEL_A, 10000);
+    motors.set(MotorShield::CHANNEL_B, -10000);
+    TEST_ASSERT_EQUAL_UINT32(writes, backend->getWriteCount());
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, backend->getWriteCount());
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::FORWARD, backend->getLastFrame().channels[0].mode);
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::REVERSE, backend->getLastFrame().channels[1].mode);
+}
+
+// Test a reversal coasts for the dead time before driving the other way
+void test_reversal_passes_through_coast(void) {
+    MotorShield::Config config = makeConfig();
+    config.reversalDeadTicks = 2;
+    MotorShield motors(*backend, config);
+    TEST_ASSERT_TRUE(motors.begin());
+
+    motors.set(MotorShield::CHANNEL_A, 20000);
+    motors.apply();
+    motors.set(MotorShield::CHANNEL_A, -20000);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::COAST, backend->getLastFrame().channels[0].mode);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::COAST, backend->getLastFrame().channels[0].mode);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::REVERSE, backend->getLastFrame().channels[0].mode);
+    TEST_ASSERT_EQUAL_UINT16(624, backend->getLastFrame().channels[0].duty);
+
+    // Releasing a brake into drive coasts too
+    motors.stop(true);
+    for (int i = 0; i < 3; i++) {
+        motors.apply();
+    }
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::BRAKE, backend->getLastFrame().channels[0].mode);
+    motors.set(MotorShield::CHANNEL_A, 20000);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::COAST, backend->getLastFrame().channels[0].mode);
+
+    TEST_ASSERT_EQUAL_UINT32(3, motors.getTransitionCount());
+    TEST_ASSERT_EQUAL_UINT32(0, backend->getGlitchCount());
+}
+
+// Test a stream of random sign flips never produces a glitching frame
+void test_random_commands_never_glitch(void) {
+    MotorShield motors(*backend, makeConfig());
+    TEST_ASSERT_TRUE(motors.begin());
+    uint32_t seed = 12345;
+    for (int i = 0; i < 1000; i++) {
+        seed = seed * 1103515245 + 12345;
+        motors.set(MotorShield::CHANNEL_A, (int16_t)(seed >> 16));
+        motors.set(MotorShield::CHANNEL_B, (int16_t)(seed >> 8));
+        if ((seed & 0x7) == 0) {
+            motors.stop((seed & 0x8) != 0);
+        }
+        motors.apply();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, backend->getGlitchCount());
+    TEST_ASSERT_TRUE(motors.getTransitionCount() > 0);
+}
+
+// Test a cut-off zeroes every frame until restored
+void test_cut_off_overrides_frames(void) {
+    MotorShield motors(*backend, makeConfig());
+    TEST_ASSERT_TRUE(motors.begin());
+    motors.set(MotorShield::CHANNEL_A, 32767);
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT16(1023, backend->getLastFrame().channels[0].duty);
+
+    motors.cutOff();
+    TEST_ASSERT_TRUE(motors.isCutOff());
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT16(0, backend->getLastFrame().channels[0].duty);
+
+    motors.restore();
+    motors.apply();
+    TEST_ASSERT_EQUAL_UINT16(1023, backend->getLastFrame().channels[0].duty);
+    TEST_ASSERT_EQUAL_UINT32(1, backend->getCutOffCount());
+}
+
+// Test stick report -> controller -> mixer -> PWM duty, all on the host
+void test_stick_to_duty_pipeline(void) {
+    SimulatedBLETransport transport;
+    XboxBLEController controller(transport);
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport.addPeripheral(advertisement);
+    TEST_ASSERT_TRUE(controller.begin());
+    TEST_ASSERT_TRUE(controller.scanAndConnect(1000));
+
+    MotorShield motors(*backend, makeConfig());
+    TEST_ASSERT_TRUE(motors.begin());
+
+    // Stick fully up, half right; right trigger fully pressed
+    uint8_t report[16] = {0};
+    uint16_t lx = 32768 + 16384, ly = 0, rt = 1023;
+    report[0] = lx & 0xFF; report[1] = lx >> 8;
+    report[2] = ly & 0xFF; report[3] = ly >> 8;
+    report[10] = rt & 0xFF; report[11] = rt >> 8;
+    TEST_ASSERT_TRUE(transport.emit(report, sizeof(report)));
+
+    DriveMixer::Output command = DriveMixer::mix(DriveMixer::normalize(controller.snapshot()));
+    motors.set(MotorShield::CHANNEL_A, DriveSignal::toQ15(command.left));
+    motors.set(MotorShield::CHANNEL_B, DriveSignal::toQ15(command.right));
+    motors.apply();
+
+    const MotorFrame &frame = backend->getLastFrame();
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::FORWARD, frame.channels[0].mode);
+    TEST_ASSERT_EQUAL_UINT8(MotorOutput::FORWARD, frame.channels[1].mode);
+    TEST_ASSERT_EQUAL_UINT16(1023, frame.channels[0].duty); // 1.5 clamped to full
+    TEST_ASSERT_UINT32_WITHIN(1, 512, frame.channels[1].duty);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_configures_backend);
+    RUN_TEST(test_command_to_duty);
+    RUN_TEST(test_one_write_per_apply);
+    RUN_TEST(test_reversal_passes_through_coast);
+    RUN_TEST(test_random_commands_never_glitch);
+    RUN_TEST(test_cut_off_overrides_frames);
+    RUN_TEST(test_stick_to_duty_pipeline);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
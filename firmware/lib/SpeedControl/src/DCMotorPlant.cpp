@@ -0,0 +1,63 @@
+#ifndef ARDUINO
+
+#include "DCMotorPlant.h"
+
+#include <math.h>
+
+static const double TWO_PI = 6.283185307179586;
+
+DCMotorPlant::DCMotorPlant(const Params &params)
+    : params(params),
+      load(0),
+      current(0),
+      speed(0),
+      position(0)
+{
+}
+
+double DCMotorPlant::getCountsPerSec() const
+{
+  return speed * params.countsPerRev / TWO_PI;
+}
+
+void DCMotorPlant::step(int16_t dutyQ15, uint32_t dtUs)
+{
+  while (dtUs > 0)
+  {
+    uint32_t stepUs = dtUs < MAX_SUBSTEP_US ? dtUs : MAX_SUBSTEP_US;
+    dtUs -= stepUs;
+    double dt = stepUs * 1e-6;
+
+    if (dutyQ15 == 0)
+    {
+      current = 0;
+    }
+    else
+    {
+      double volts = params.supplyVolts * dutyQ15 / 32767.0;
+      current += (volts - params.resistanceOhm * current - params.ke * speed) / params.inductanceH * dt;
+    }
+
+    // Dry friction holds a slow enough wheel still instead of reversing it
+    double driving = params.ke * current - params.viscous * speed - load;
+    double friction = params.coulomb;
+    double torque;
+    if (speed > 0)
+      torque = driving - friction;
+    else if (speed < 0)
+      torque = driving + friction;
+    else
+      torque = fabs(driving) <= friction ? 0 : driving - (driving > 0 ? friction : -friction);
+
+    double next = speed + torque / params.inertia * dt;
+    if ((speed > 0 && next < 0) || (speed < 0 && next > 0))
+    {
+      // Crossing zero: stop here and let the next sub-step decide
+      next = 0;
+    }
+    speed = next;
+    position += speed * params.countsPerRev / TWO_PI * dt;
+  }
+}
+
+#endif // ARDUINO
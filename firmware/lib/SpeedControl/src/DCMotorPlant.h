@@ -0,0 +1,63 @@
+#ifndef DC_MOTOR_PLANT_H
+#define DC_MOTOR_PLANT_H
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+
+// Simulated brushed DC gearmotor with a wheel encoder, for tuning and
+// testing the speed loop on the host.
+//
+// Everything is referred to the output shaft (gearbox included):
+//
+//   L di/dt = V - R i - ke w        V = supply * duty, in the duty's direction
+//   J dw/dt = kt i - b w - Tc sgn(w) - load
+//
+// A zero duty opens the bridge (the shield coasts): the current drops to
+// zero and the wheel runs down on friction alone. The encoder position is
+// the integral of w in counts. step() integrates with sub-steps of at most
+// MAX_SUBSTEP_US, so any control period can be simulated.
+class DCMotorPlant
+{
+public:
+  static const uint32_t MAX_SUBSTEP_US = 20;
+
+  struct Params
+  {
+    double supplyVolts;
+    double resistanceOhm;
+    double inductanceH;
+    double ke;            // back-EMF, V per rad/s (= kt in N m per A)
+    double inertia;       // kg m^2
+    double viscous;       // N m per rad/s
+    double coulomb;       // N m, dry friction
+    double countsPerRev;  // encoder counts per output revolution
+  };
+
+  explicit DCMotorPlant(const Params &params);
+
+  // Run for dtUs with dutyQ15 applied (-32767..32767)
+  void step(int16_t dutyQ15, uint32_t dtUs);
+
+  // Battery sag, terrain
+  void setSupplyVolts(double volts) { params.supplyVolts = volts; }
+  void setLoadTorque(double torque) { load = torque; }
+
+  double getSpeed() const { return speed; } // rad/s
+  double getCurrent() const { return current; }
+  int32_t getCount() const { return (int32_t)(int64_t)position; }
+  double getCountsPerSec() const;
+
+  const Params &getParams() const { return params; }
+
+private:
+  Params params;
+  double load;
+  double current;
+  double speed;
+  double position; // counts
+};
+
+#endif // ARDUINO
+
+#endif // DC_MOTOR_PLANT_H
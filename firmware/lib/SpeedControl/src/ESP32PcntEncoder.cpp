@@ -0,0 +1,99 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include "ESP32PcntEncoder.h"
+
+ESP32PcntEncoder::ESP32PcntEncoder(const Config &config)
+    : config(config)
+{
+  for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+  {
+    channels[i].index = i;
+    channels[i].overflow.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool ESP32PcntEncoder::begin()
+{
+  for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+  {
+    // Channel 0 counts edges of A, channel 1 edges of B; the other input
+    // decides the direction
+    pcnt_config_t unitConfig = {};
+    unitConfig.unit = unit(i);
+    unitConfig.counter_h_lim = LIMIT;
+    unitConfig.counter_l_lim = -LIMIT;
+
+    unitConfig.channel = PCNT_CHANNEL_0;
+    unitConfig.pulse_gpio_num = config.pins[i].a;
+    unitConfig.ctrl_gpio_num = config.pins[i].b;
+    unitConfig.pos_mode = config.invert[i] ? PCNT_COUNT_INC : PCNT_COUNT_DEC;
+    unitConfig.neg_mode = config.invert[i] ? PCNT_COUNT_DEC : PCNT_COUNT_INC;
+    unitConfig.lctrl_mode = PCNT_MODE_REVERSE;
+    unitConfig.hctrl_mode = PCNT_MODE_KEEP;
+    if (pcnt_unit_config(&unitConfig) != ESP_OK)
+      return false;
+
+    unitConfig.channel = PCNT_CHANNEL_1;
+    unitConfig.pulse_gpio_num = config.pins[i].b;
+    unitConfig.ctrl_gpio_num = config.pins[i].a;
+    unitConfig.pos_mode = config.invert[i] ? PCNT_COUNT_DEC : PCNT_COUNT_INC;
+    unitConfig.neg_mode = config.invert[i] ? PCNT_COUNT_INC : PCNT_COUNT_DEC;
+    if (pcnt_unit_config(&unitConfig) != ESP_OK)
+      return false;
+
+    if (config.filterApbCycles > 0)
+    {
+      pcnt_set_filter_value(unit(i), config.filterApbCycles);
+      pcnt_filter_enable(unit(i));
+    }
+    pcnt_event_enable(unit(i), PCNT_EVT_H_LIM);
+    pcnt_event_enable(unit(i), PCNT_EVT_L_LIM);
+    pcnt_counter_pause(unit(i));
+    pcnt_counter_clear(unit(i));
+  }
+
+  esp_err_t installed = pcnt_isr_service_install(0);
+  if (installed != ESP_OK && installed != ESP_ERR_INVALID_STATE)
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+  {
+    if (pcnt_isr_handler_add(unit(i), limitHandler, &channels[i]) != ESP_OK)
+      return false;
+    pcnt_intr_enable(unit(i));
+    pcnt_counter_resume(unit(i));
+  }
+  return true;
+}
+
+void IRAM_ATTR ESP32PcntEncoder::limitHandler(void *argument)
+{
+  Channel *channel = static_cast<Channel *>(argument);
+  uint32_t status = 0;
+  pcnt_get_event_status(unit(channel->index), &status);
+  if (status & PCNT_EVT_H_LIM)
+    channel->overflow.fetch_add(LIMIT, std::memory_order_relaxed);
+  else if (status & PCNT_EVT_L_LIM)
+    channel->overflow.fetch_sub(LIMIT, std::memory_order_relaxed);
+}
+
+int32_t ESP32PcntEncoder::read(uint8_t channel)
+{
+  if (channel >= CHANNEL_COUNT)
+  {
+    return 0;
+  }
+
+  // Retry if the limit interrupt moved the total between the two reads
+  int32_t before;
+  int16_t count;
+  do
+  {
+    before = channels[channel].overflow.load(std::memory_order_acquire);
+    pcnt_get_counter_value(unit(channel), &count);
+  } while (channels[channel].overflow.load(std::memory_order_acquire) != before);
+  return (int32_t)((uint32_t)before + (uint32_t)(int32_t)count);
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,62 @@
+#ifndef ESP32_PCNT_ENCODER_H
+#define ESP32_PCNT_ENCODER_H
+
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/pcnt.h>
+
+#include "EncoderCounter.h"
+
+// Quadrature wheel encoders on the ESP32 pulse counter.
+//
+// Each channel takes one PCNT unit with both of its inputs in use, so every
+// edge of A and B is counted (x4 decoding) by the hardware without a CPU
+// interrupt per edge. The unit's 16-bit counter is extended to 32 bits in
+// software: reaching +-LIMIT raises the only interrupt, which moves LIMIT
+// into an overflow total and lets the hardware restart from zero. Call
+// begin() on the core the reads happen on: the interrupt then always runs
+// before a read can see the restarted counter.
+class ESP32PcntEncoder : public EncoderCounter
+{
+public:
+  static const uint8_t CHANNEL_COUNT = 2;
+  static const int16_t LIMIT = 16384;
+
+  struct Pins
+  {
+    uint8_t a;
+    uint8_t b;
+  };
+
+  struct Config
+  {
+    Pins pins[CHANNEL_COUNT];
+    uint16_t filterApbCycles; // ignore pulses shorter than this (80 MHz APB, max 1023)
+    bool invert[CHANNEL_COUNT]; // count the other way, for the mirrored wheel
+  };
+
+  explicit ESP32PcntEncoder(const Config &config);
+
+  bool begin();
+  int32_t read(uint8_t channel);
+
+private:
+  // What the limit interrupt of one unit updates
+  struct Channel
+  {
+    uint8_t index;
+    std::atomic<int32_t> overflow;
+  };
+
+  Config config;
+  Channel channels[CHANNEL_COUNT];
+
+  static void IRAM_ATTR limitHandler(void *argument);
+  static pcnt_unit_t unit(uint8_t channel) { return (pcnt_unit_t)(PCNT_UNIT_0 + channel); }
+};
+
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // ESP32_PCNT_ENCODER_H
@@ -0,0 +1,20 @@
+#ifndef ENCODER_COUNTER_H
+#define ENCODER_COUNTER_H
+
+#include <stdint.h>
+
+// Wheel encoder positions, one counter per motor channel.
+class EncoderCounter
+{
+public:
+  virtual ~EncoderCounter() {}
+
+  virtual bool begin() = 0;
+
+  // Counts since begin(), signed with the direction of travel; wraps at 32
+  // bits, so the difference of two reads is always the distance between
+  // them. Read from the control task only.
+  virtual int32_t read(uint8_t channel) = 0;
+};
+
+#endif // ENCODER_COUNTER_H
@@ -0,0 +1,87 @@
+#include "SpeedController.h"
+
+#include <string.h>
+
+static const int32_t FULL_SCALE = 32767;
+
+static int32_t clamp(int64_t value, int32_t limit)
+{
+  return value > limit ? limit : (value < -limit ? -limit : (int32_t)value);
+}
+
+SpeedController::SpeedController(const Config &config)
+    : config(config)
+{
+  reset();
+  resetStats();
+}
+
+void SpeedController::reset()
+{
+  memset(&terms, 0, sizeof(terms));
+  speedQ15 = 0;
+  integralQ23 = 0;
+}
+
+void SpeedController::resetStats()
+{
+  saturatedCount = 0;
+}
+
+int16_t SpeedController::update(int16_t targetQ15, int32_t deltaCounts, uint32_t dtUs)
+{
+  if (dtUs == 0 || config.maxCountsPerSec <= 0)
+  {
+    return terms.output;
+  }
+
+  // Counts over dtUs as a fraction of full speed; twice full scale at most
+  int64_t rawSpeed = (int64_t)deltaCounts * 1000000 * FULL_SCALE / ((int64_t)dtUs * config.maxCountsPerSec);
+  int32_t measured = clamp(rawSpeed, 2 * FULL_SCALE);
+  int32_t previous = speedQ15;
+  if (config.speedAlphaQ15 >= FULL_SCALE)
+    speedQ15 = measured;
+  else
+    speedQ15 += (int32_t)(((int64_t)(measured - speedQ15) * config.speedAlphaQ15) >> 15);
+  terms.speedQ15 = speedQ15;
+
+  if (targetQ15 == 0)
+  {
+    integralQ23 = 0;
+    terms.feedForward = 0;
+    terms.proportional = 0;
+    terms.integral = 0;
+    terms.derivative = 0;
+    terms.output = 0;
+    terms.saturated = false;
+    return 0;
+  }
+
+  int32_t error = targetQ15 - speedQ15;
+  int32_t feedForward = (int32_t)(((int64_t)config.feedForwardQ12 * targetQ15) >> 12);
+  feedForward += targetQ15 > 0 ? config.staticDutyQ15 : -config.staticDutyQ15;
+  int32_t proportional = clamp(((int64_t)config.kpQ12 * error) >> 12, 4 * FULL_SCALE);
+  int32_t derivative =
+      clamp(-(((int64_t)config.kdQ12 * (speedQ15 - previous) * 1000 / dtUs) >> 12), 4 * FULL_SCALE);
+
+  // Integrate unless the output is already pinned in the same direction
+  int64_t step = ((int64_t)config.kiQ12 * error * dtUs << 8) / (4096LL * 1000000);
+  int32_t withoutStep = feedForward + proportional + (integralQ23 >> 8) + derivative;
+  bool pinned = (withoutStep >= FULL_SCALE && step > 0) || (withoutStep <= -FULL_SCALE && step < 0);
+  if (!pinned)
+  {
+    integralQ23 = clamp((int64_t)integralQ23 + step, (int32_t)config.integralLimitQ15 << 8);
+  }
+  int32_t integral = integralQ23 >> 8;
+
+  int32_t sum = feedForward + proportional + integral + derivative;
+  terms.feedForward = feedForward;
+  terms.proportional = proportional;
+  terms.integral = integral;
+  terms.derivative = derivative;
+  terms.saturated = sum > FULL_SCALE || sum < -FULL_SCALE;
+  terms.output = (int16_t)clamp(sum, FULL_SCALE);
+  if (terms.saturated)
+    saturatedCount++;
+  return terms.output;
+}
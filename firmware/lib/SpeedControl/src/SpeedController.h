@@ -0,0 +1,82 @@
+#ifndef SPEED_CONTROLLER_H
+#define SPEED_CONTROLLER_H
+
+#include <stdint.h>
+
+// Closed-loop speed of one wheel, in fixed point.
+//
+// The drive pipeline asks for a wheel speed as a Q15 fraction of
+// maxCountsPerSec instead of a duty cycle; update() turns the encoder counts
+// seen since the previous call into a measured speed (same scale, low-pass
+// filtered) and returns the duty that holds the target whatever the battery
+// voltage or the ground:
+//
+//   duty = feed-forward + P + I + D, clamped to +-32767
+//
+//   - feed-forward: feedForwardQ12 * target, plus staticDutyQ15 in the
+//     direction of the target to break static friction. With a good
+//     feed-forward the PI terms only correct the remainder.
+//   - P on the speed error, I on its integral over time
+//   - D on the measured speed only, so a step in the target does not kick
+//   - anti-windup: the integral stops growing while the output is saturated
+//     in the direction it would push, and is bounded by integralLimitQ15.
+//     A stalled wheel does not wind up an overshoot for when it frees.
+//
+// A zero target clears the integral and outputs zero: the wheel coasts down
+// instead of being held. Gains are Q12 (4096 = 1.0); every step is integer
+// math, so the loop gives the same bits on the rover and on the host.
+class SpeedController
+{
+public:
+  struct Config
+  {
+    int32_t maxCountsPerSec;  // wheel speed of a full-scale target
+    int32_t feedForwardQ12;   // duty per unit target
+    int16_t staticDutyQ15;    // friction offset, towards the target
+    int32_t kpQ12;            // duty per unit speed error
+    int32_t kiQ12;            // duty per unit speed error and second
+    int32_t kdQ12;            // duty per unit speed change per millisecond
+    int16_t integralLimitQ15; // bound of the I term
+    uint16_t speedAlphaQ15;   // measured speed low-pass, 32767 = unfiltered
+  };
+
+  // The parts of the last output, for tuning and telemetry
+  struct Terms
+  {
+    int32_t speedQ15; // measured, filtered
+    int32_t feedForward;
+    int32_t proportional;
+    int32_t integral;
+    int32_t derivative;
+    int16_t output;
+    bool saturated;
+  };
+
+  explicit SpeedController(const Config &config);
+
+  // One loop step: targetQ15 of maxCountsPerSec, deltaCounts counted over
+  // the dtUs since the previous call. Returns the duty, Q15.
+  int16_t update(int16_t targetQ15, int32_t deltaCounts, uint32_t dtUs);
+
+  // Forget the filter and integral state, e.g. after the bridge was cut.
+  // The saturation count is kept; resetStats() clears it.
+  void reset();
+
+  const Terms &getTerms() const { return terms; }
+
+  // Steps that ran into the output limit since the last resetStats()
+  uint32_t getSaturatedCount() const { return saturatedCount; }
+  void resetStats();
+
+  void setConfig(const Config &newConfig) { config = newConfig; }
+  const Config &getConfig() const { return config; }
+
+private:
+  Config config;
+  Terms terms;
+  int32_t speedQ15;
+  int32_t integralQ23; // I term, Q15 duty with 8 extra fraction bits
+  uint32_t saturatedCount;
+};
+
+#endif // SPEED_CONTROLLER_H
@@ -0,0 +1,190 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "DCMotorPlant.h"
+#include "SpeedController.h"
+
+static const uint32_t PERIOD_US = 4000; // 250 Hz speed loop
+
+// 12 V gearmotor, ~335 rpm no-load, 1320 counts per wheel revolution
+static const DCMotorPlant::Params PLANT = {12.0, 2.5, 0.002, 0.33, 0.002, 0.001, 0.02, 1320};
+static const int32_t MAX_CPS = 7000;
+
+static const SpeedController::Config TUNED = {MAX_CPS, 3700, 413, 8192, 65536, 0, 16384, 16384};
+
+static int32_t percentOf(double countsPerSec, int32_t targetCps) {
+    return (int32_t)(countsPerSec * 100.0 / targetCps + 0.5);
+}
+
+// Closed loop on the plant for durationMs; returns the fastest speed seen
+struct Loop {
+    SpeedController controller;
+    DCMotorPlant plant;
+    int32_t lastCount;
+
+    Loop(const SpeedController::Config &config) : controller(config), plant(PLANT), lastCount(0) {}
+
+    double run(int16_t targetQ15, uint32_t durationMs) {
+        double peak = 0;
+        for (uint32_t t = 0; t < durationMs * 1000; t += PERIOD_US) {
+            int32_t count = plant.getCount();
+            int16_t duty = controller.update(targetQ15, count - lastCount, PERIOD_US);
+            lastCount = count;
+            plant.step(duty, PERIOD_US);
+            if (plant.getCountsPerSec() > peak)
+                peak = plant.getCountsPerSec();
+        }
+        return peak;
+    }
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Test the plant runs up to its no-load speed and coasts down without reversing
+void test_plant_model(void) {
+    DCMotorPlant plant(PLANT);
+    for (int i = 0; i < 250; i++)
+        plant.step(32767, PERIOD_US);
+    // ke w + R (b w + Tc) / ke = V
+    TEST_ASSERT_INT32_WITHIN(100, 7374, (int32_t)plant.getCountsPerSec());
+    TEST_ASSERT_TRUE(plant.getCount() > 5000);
+
+    for (int i = 0; i < 1000; i++)
+        plant.step(0, PERIOD_US);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, plant.getSpeed());
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, plant.getCurrent());
+
+    // A sagging battery slows the open loop in proportion
+    plant.setSupplyVolts(9.0);
+    for (int i = 0; i < 250; i++)
+        plant.step(32767, PERIOD_US);
+    TEST_ASSERT_INT32_WITHIN(100, 5508, (int32_t)plant.getCountsPerSec());
+}
+
+// Test the feed-forward path, the zero target and the output limit
+void test_feed_forward_and_limits(void) {
+    SpeedController::Config config = {MAX_CPS, 3700, 413, 0, 0, 0, 16384, 32767};
+    SpeedController controller(config);
+
+    TEST_ASSERT_EQUAL_INT16((3700 * 16384 >> 12) + 413, controller.update(16384, 0, PERIOD_US));
+    TEST_ASSERT_EQUAL_INT16(-((3700 * 16384 >> 12) + 413), controller.update(-16384, 0, PERIOD_US));
+    TEST_ASSERT_EQUAL_INT16(0, controller.update(0, 0, PERIOD_US));
+
+    // 28 counts in 4 ms is 7000 counts/s: full scale
+    controller.update(16384, 28, PERIOD_US);
+    TEST_ASSERT_INT32_WITHIN(1, 32767, controller.getTerms().speedQ15);
+
+    // Proportional gain pushes the output into the limit
+    config.kpQ12 = 4096 * 8;
+    controller.setConfig(config);
+    TEST_ASSERT_EQUAL_INT16(32767, controller.update(32767, 0, PERIOD_US));
+    TEST_ASSERT_TRUE(controller.getTerms().saturated);
+    TEST_ASSERT_EQUAL_UINT32(1, controller.getSaturatedCount());
+    TEST_ASSERT_EQUAL_INT16(-32767, controller.update(-32767, 0, PERIOD_US));
+
+    // Coasting clears the loop state but not the count; resetStats() does
+    controller.reset();
+    TEST_ASSERT_EQUAL_UINT32(2, controller.getSaturatedCount());
+    controller.resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, controller.getSaturatedCount());
+    TEST_ASSERT_EQUAL_INT16(-32767, controller.update(-32767, 0, PERIOD_US));
+
+    // No time passed: the last output holds
+    TEST_ASSERT_EQUAL_INT16(-32767, controller.update(0, 100, 0));
+}
+
+// Test a step in the target settles quickly without much overshoot
+void test_step_response(void) {
+    Loop loop(TUNED);
+    const int32_t target = MAX_CPS / 2;
+    double peak = loop.run(16384, 300);
+    TEST_ASSERT_INT32_WITHIN(3, 100, percentOf(loop.plant.getCountsPerSec(), target));
+    TEST_ASSERT_TRUE(percentOf(peak, target) <= 110);
+
+    loop.run(16384, 700);
+    TEST_ASSERT_INT32_WITHIN(1, 100, percentOf(loop.plant.getCountsPerSec(), target));
+
+    // And back to rest: the wheel coasts down, no integral left over
+    loop.run(0, 1500);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, loop.plant.getSpeed());
+    TEST_ASSERT_EQUAL_INT32(0, loop.controller.getTerms().integral);
+}
+
+// Test the loop holds speed through battery sag and a load where feed-forward alone cannot
+void test_holds_speed_under_sag_and_load(void) {
+    SpeedController::Config openLoop = TUNED;
+    openLoop.kpQ12 = 0;
+    openLoop.kiQ12 = 0;
+    Loop closed(TUNED);
+    Loop open(openLoop);
+    const int32_t target = MAX_CPS / 2;
+    closed.run(16384, 1000);
+    open.run(16384, 1000);
+    TEST_ASSERT_INT32_WITHIN(5, 100, percentOf(open.plant.getCountsPerSec(), target));
+
+    // 12 V -> 9.5 V, plus a slope
+    closed.plant.setSupplyVolts(9.5);
+    closed.plant.setLoadTorque(0.05);
+    open.plant.setSupplyVolts(9.5);
+    open.plant.setLoadTorque(0.05);
+    closed.run(16384, 500);
+    open.run(16384, 500);
+
+    TEST_ASSERT_INT32_WITHIN(2, 100, percentOf(closed.plant.getCountsPerSec(), target));
+    TEST_ASSERT_TRUE(percentOf(open.plant.getCountsPerSec(), target) < 85);
+}
+
+// Test a stalled wheel does not wind up the integral into an overshoot
+void test_anti_windup(void) {
+    SpeedController::Config config = TUNED;
+    config.integralLimitQ15 = 32767; // leave it to the conditional integration
+    Loop loop(config);
+    const int32_t target = MAX_CPS / 2;
+
+    // Blocked: full duty (1.58 N m at stall) cannot overcome the load plus
+    // dry friction
+    loop.plant.setLoadTorque(1.57);
+    loop.run(16384, 1000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, loop.plant.getSpeed());
+    TEST_ASSERT_EQUAL_INT16(32767, loop.controller.getTerms().output);
+    TEST_ASSERT_TRUE(loop.controller.getSaturatedCount() > 200);
+    // Only what the error needs beyond feed-forward and P, not a second's worth
+    TEST_ASSERT_TRUE(loop.controller.getTerms().integral < 32767);
+
+    // Freed: back on target without a large overshoot
+    loop.plant.setLoadTorque(0.0);
+    double peak = loop.run(16384, 1000);
+    TEST_ASSERT_INT32_WITHIN(2, 100, percentOf(loop.plant.getCountsPerSec(), target));
+    TEST_ASSERT_TRUE(percentOf(peak, target) <= 125);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_plant_model);
+    RUN_TEST(test_feed_forward_and_limits);
+    RUN_TEST(test_step_response);
+    RUN_TEST(test_holds_speed_under_sag_and_load);
+    RUN_TEST(test_anti_windup);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
@@ -0,0 +1,160 @@
+#include "TaskMonitor.h"
+
+TaskMonitor::TaskMonitor(ClockFn clock)
+    : clock(clock),
+      count(0),
+      windowStartUs(clock()),
+      windowStartRunTime(0)
+{
+#if TASK_MONITOR_RUN_TIME
+  windowStartRunTime = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+#endif
+  for (uint8_t i = 0; i < MAX_TASKS; i++)
+  {
+    entries[i].handle = nullptr;
+    entries[i].runTime = 0;
+    entries[i].startUs = 0;
+    entries[i].busyUs.store(0, std::memory_order_relaxed);
+    entries[i].runs.store(0, std::memory_order_relaxed);
+    entries[i].maxRunUs.store(0, std::memory_order_relaxed);
+  }
+}
+
+int8_t TaskMonitor::add(const TaskConfig &config)
+{
+  if (count >= MAX_TASKS)
+  {
+    return NO_TASK;
+  }
+  entries[count].config = config;
+  return (int8_t)count++;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+bool TaskMonitor::start(int8_t id, TaskFunction_t function, void *parameter)
+{
+  if (id < 0 || id >= count)
+  {
+    return false;
+  }
+  const TaskConfig &config = entries[id].config;
+  TaskHandle_t handle = nullptr;
+  BaseType_t core = config.core == ANY_CORE ? tskNO_AFFINITY : config.core;
+  if (xTaskCreatePinnedToCore(function, config.name, config.stackBytes, parameter, config.priority, &handle,
+                              core) != pdPASS)
+  {
+    return false;
+  }
+  entries[id].handle = handle;
+#if TASK_MONITOR_RUN_TIME
+  entries[id].runTime = readRunTime(handle);
+#endif
+  return true;
+}
+
+void TaskMonitor::attach(int8_t id, TaskHandle_t handle)
+{
+  if (id >= 0 && id < count && handle != nullptr)
+  {
+    entries[id].handle = handle;
+#if TASK_MONITOR_RUN_TIME
+    entries[id].runTime = readRunTime(handle);
+#endif
+  }
+}
+#endif
+
+void TaskMonitor::begin(int8_t id)
+{
+  if (id >= 0 && id < count)
+  {
+    entries[id].startUs = clock();
+  }
+}
+
+void TaskMonitor::end(int8_t id)
+{
+  if (id < 0 || id >= count)
+  {
+    return;
+  }
+  Entry &entry = entries[id];
+  uint32_t elapsed = clock() - entry.startUs;
+  entry.busyUs.fetch_add(elapsed, std::memory_order_relaxed);
+  entry.runs.fetch_add(1, std::memory_order_relaxed);
+
+  // Only this task raises the max; sample() only clears it
+  if (elapsed > entry.maxRunUs.load(std::memory_order_relaxed))
+  {
+    entry.maxRunUs.store(elapsed, std::memory_order_relaxed);
+  }
+}
+
+uint8_t TaskMonitor::sample(TaskStats *stats, uint8_t capacity)
+{
+  uint32_t nowUs = clock();
+  uint32_t windowUs = nowUs - windowStartUs;
+  windowStartUs = nowUs;
+#if TASK_MONITOR_RUN_TIME
+  // Run time is counted per core; a window of it is one core's worth
+  uint32_t nowRunTime = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+  uint32_t windowRunTime = nowRunTime - windowStartRunTime;
+  windowStartRunTime = nowRunTime;
+#endif
+
+  uint8_t written = 0;
+  for (uint8_t i = 0; i < count && written < capacity; i++)
+  {
+    Entry &entry = entries[i];
+    TaskStats &out = stats[written++];
+    out.name = entry.config.name;
+    out.core = entry.config.core;
+    out.priority = entry.config.priority;
+    out.stackBytes = entry.config.stackBytes;
+    out.stackFreeBytes = readStackFree(entry);
+
+    // A run is counted when it ends, so one that straddles the window edge
+    // can push a share past 1000
+    uint32_t busyUs = entry.busyUs.exchange(0, std::memory_order_relaxed);
+    uint32_t permille = windowUs == 0 ? 0 : (uint32_t)((uint64_t)busyUs * 1000 / windowUs);
+    out.cpuFromScheduler = false;
+#if TASK_MONITOR_RUN_TIME
+    if (entry.handle != nullptr)
+    {
+      uint32_t runTime = readRunTime((TaskHandle_t)entry.handle);
+      uint32_t ran = runTime - entry.runTime;
+      entry.runTime = runTime;
+      permille = windowRunTime == 0 ? 0 : (uint32_t)((uint64_t)ran * 1000 / windowRunTime);
+      out.cpuFromScheduler = true;
+    }
+#endif
+    out.cpuPermille = (uint16_t)(permille < 1000 ? permille : 1000);
+    out.runs = entry.runs.exchange(0, std::memory_order_relaxed);
+    out.maxRunUs = entry.maxRunUs.exchange(0, std::memory_order_relaxed);
+  }
+  return written;
+}
+
+uint32_t TaskMonitor::readStackFree(const Entry &entry) const
+{
+#ifdef ARDUINO_ARCH_ESP32
+  // ESP-IDF counts stack in bytes
+  if (entry.handle != nullptr)
+  {
+    return (uint32_t)uxTaskGetStackHighWaterMark((TaskHandle_t)entry.handle);
+  }
+#else
+  (void)entry;
+#endif
+  return 0;
+}
+
+#if TASK_MONITOR_RUN_TIME
+uint32_t TaskMonitor::readRunTime(TaskHandle_t handle)
+{
+  // Skips the stack high-water scan; eInvalid has it look up the state
+  TaskStatus_t status;
+  vTaskGetInfo(handle, &status, pdFALSE, eInvalid);
+  return (uint32_t)status.ulRunTimeCounter;
+}
+#endif
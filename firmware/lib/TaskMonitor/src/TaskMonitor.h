@@ -0,0 +1,118 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <atomic>
+#include <stdint.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <Arduino.h>
+#endif
+
+// FreeRTOS keeps a run-time counter per task when built with both of these
+#if defined(ARDUINO_ARCH_ESP32) && configGENERATE_RUN_TIME_STATS == 1 && configUSE_TRACE_FACILITY == 1
+#define TASK_MONITOR_RUN_TIME 1
+#else
+#define TASK_MONITOR_RUN_TIME 0
+#endif
+
+// Registry of the firmware's tasks: where they run, and how much CPU and
+// stack they use.
+//
+// A task brackets each run of its work with begin()/end(). The busy time is
+// accumulated in atomics, so the calls are cheap enough for the control
+// loop. sample() turns the time since the previous sample into a share per
+// task and, on ESP32, reads each task's stack high-water mark: the numbers
+// needed to size the stacks and check the split across cores.
+//
+// The share is real CPU time when FreeRTOS keeps run-time stats
+// (TASK_MONITOR_RUN_TIME) and the task has a handle: what the scheduler
+// counted it running in the window. Otherwise it is bracketed wall time,
+// which includes any time the task spent blocked between begin() and end()
+// (a link step waiting on the BLE stack) and is 0 for a task that never
+// calls them. cpuFromScheduler tells the two apart.
+//
+// Tasks created elsewhere (the BLE host, the log drain) can be attached by
+// handle for their stack figures and scheduler CPU time.
+//
+// Time comes from an injected microsecond clock so the accounting can run
+// against a fake clock in native unit tests.
+class TaskMonitor
+{
+public:
+  typedef uint32_t (*ClockFn)(void); // free running microseconds (may wrap)
+
+  static const uint8_t MAX_TASKS = 8;
+  static const int8_t NO_TASK = -1;
+  static const int8_t ANY_CORE = -1;
+
+  struct TaskConfig
+  {
+    const char *name;    // static string
+    int8_t core;         // ANY_CORE to let the scheduler pick
+    uint8_t priority;
+    uint32_t stackBytes; // 0 = unknown (not created here)
+  };
+
+  struct TaskStats
+  {
+    const char *name;
+    int8_t core;
+    uint8_t priority;
+    uint32_t stackBytes;
+    uint32_t stackFreeBytes; // least free stack so far, 0 = unknown
+    uint16_t cpuPermille;    // busy share of the last window, 0-1000
+    bool cpuFromScheduler;   // cpuPermille is run time, not bracketed wall time
+    uint32_t runs;           // begin()/end() pairs in the last window
+    uint32_t maxRunUs;       // longest run in the last window
+  };
+
+  explicit TaskMonitor(ClockFn clock);
+
+  // Register a task; returns its id, or NO_TASK when the table is full.
+  // Call before the tasks start.
+  int8_t add(const TaskConfig &config);
+
+#ifdef ARDUINO_ARCH_ESP32
+  // Create a registered task with its core, priority and stack size
+  bool start(int8_t id, TaskFunction_t function, void *parameter);
+
+  // Monitor a task created elsewhere (nullptr is ignored)
+  void attach(int8_t id, TaskHandle_t handle);
+#endif
+
+  // Bracket one run of the task's work; call from that task only
+  void begin(int8_t id);
+  void end(int8_t id);
+
+  // Copy out every task's figures for the window since the previous
+  // sample() and start a new window. Call from one task. Returns the number
+  // of tasks written.
+  uint8_t sample(TaskStats *stats, uint8_t capacity);
+
+  uint8_t getTaskCount() const { return count; }
+
+private:
+  struct Entry
+  {
+    TaskConfig config;
+    void *handle;      // TaskHandle_t on ESP32
+    uint32_t runTime;  // scheduler run-time counter at the window start
+    uint32_t startUs;  // of the run in progress, owned by the task
+    std::atomic<uint32_t> busyUs;
+    std::atomic<uint32_t> runs;
+    std::atomic<uint32_t> maxRunUs;
+  };
+
+  ClockFn clock;
+  Entry entries[MAX_TASKS];
+  uint8_t count;
+  uint32_t windowStartUs;
+  uint32_t windowStartRunTime; // run-time clock, in its own units
+
+  uint32_t readStackFree(const Entry &entry) const;
+#if TASK_MONITOR_RUN_TIME
+  static uint32_t readRunTime(TaskHandle_t handle);
+#endif
+};
+
+#endif // TASK_MONITOR_H
@@ -0,0 +1,167 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <thread>
+#include "TaskMonitor.h"
+
+// Fake clock: work is simulated with advance()
+static uint32_t fakeNowUs;
+
+static uint32_t fakeClock(void) { return fakeNowUs; }
+static void advance(uint32_t us) { fakeNowUs += us; }
+
+static const TaskMonitor::TaskConfig CONTROL = {"control", 1, 10, 8192};
+static const TaskMonitor::TaskConfig LINK = {"link", 0, 2, 8192};
+
+void setUp(void) {
+    fakeNowUs = 1000;
+}
+
+void tearDown(void) {
+}
+
+// Test busy time becomes a per-window CPU share with run counts and the longest run
+void test_cpu_share_per_window(void) {
+    TaskMonitor monitor(fakeClock);
+    int8_t control = monitor.add(CONTROL);
+    int8_t link = monitor.add(LINK);
+    TEST_ASSERT_EQUAL_INT8(0, control);
+    TEST_ASSERT_EQUAL_INT8(1, link);
+
+    // 10 control runs of 2 ms (one of 3 ms) and a 20 ms link run in 100 ms
+    for (int i = 0; i < 10; i++) {
+        monitor.begin(control);
+        advance(i == 3 ? 3000 : 2000);
+        monitor.end(control);
+        advance(i == 3 ? 5000 : 6000);
+    }
+    monitor.begin(link);
+    advance(20000);
+    monitor.end(link);
+
+    TaskMonitor::TaskStats stats[TaskMonitor::MAX_TASKS];
+    TEST_ASSERT_EQUAL_UINT8(2, monitor.sample(stats, TaskMonitor::MAX_TASKS));
+    TEST_ASSERT_EQUAL_STRING("control", stats[0].name);
+    TEST_ASSERT_EQUAL_INT8(1, stats[0].core);
+    TEST_ASSERT_EQUAL_UINT8(10, stats[0].priority);
+    TEST_ASSERT_EQUAL_UINT32(8192, stats[0].stackBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[0].stackFreeBytes); // unknown on the host
+    TEST_ASSERT_EQUAL_UINT16(210, stats[0].cpuPermille);
+    TEST_ASSERT_FALSE(stats[0].cpuFromScheduler); // bracketed wall time
+    TEST_ASSERT_EQUAL_UINT32(10, stats[0].runs);
+    TEST_ASSERT_EQUAL_UINT32(3000, stats[0].maxRunUs);
+    TEST_ASSERT_EQUAL_UINT16(200, stats[1].cpuPermille);
+
+    // The next window starts empty
+    advance(50000);
+    monitor.sample(stats, TaskMonitor::MAX_TASKS);
+    TEST_ASSERT_EQUAL_UINT16(0, stats[0].cpuPermille);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[0].runs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[0].maxRunUs);
+}
+
+// Test a run straddling the window edge is capped, and a clock wrap is harmless
+void test_share_capped_and_wrap(void) {
+    fakeNowUs = 0xFFFFF000;
+    TaskMonitor monitor(fakeClock);
+    int8_t control = monitor.add(CONTROL);
+
+    monitor.begin(control);
+    advance(10000); // wraps
+    monitor.end(control);
+    TaskMonitor::TaskStats stats[1];
+    monitor.sample(stats, 1);
+    TEST_ASSERT_EQUAL_UINT16(1000, stats[0].cpuPermille);
+    TEST_ASSERT_EQUAL_UINT32(10000, stats[0].maxRunUs);
+
+    // Started in the previous window, counted whole in this one
+    monitor.begin(control);
+    advance(4000);
+    monitor.sample(stats, 1);
+    advance(2000);
+    monitor.end(control);
+    monitor.sample(stats, 1);
+    TEST_ASSERT_EQUAL_UINT16(1000, stats[0].cpuPermille);
+}
+
+// Test the table bounds: full registry, unknown ids, small output buffer
+void test_registry_bounds(void) {
+    TaskMonitor monitor(fakeClock);
+    for (uint8_t i = 0; i < TaskMonitor::MAX_TASKS; i++)
+        TEST_ASSERT_EQUAL_INT8(i, monitor.add(LINK));
+    TEST_ASSERT_EQUAL_INT8(TaskMonitor::NO_TASK, monitor.add(LINK));
+    TEST_ASSERT_EQUAL_UINT8(TaskMonitor::MAX_TASKS, monitor.getTaskCount());
+
+    monitor.begin(TaskMonitor::NO_TASK);
+    monitor.end(TaskMonitor::NO_TASK);
+    monitor.end(TaskMonitor::MAX_TASKS);
+
+    TaskMonitor::TaskStats stats[2];
+    TEST_ASSERT_EQUAL_UINT8(2, monitor.sample(stats, 2));
+}
+
+// Test runs reported from other threads while sampling are not lost
+void test_concurrent_runs(void) {
+    TaskMonitor monitor(fakeClock);
+    int8_t control = monitor.add(CONTROL);
+    int8_t link = monitor.add(LINK);
+    const uint32_t RUNS = 100000;
+
+    std::thread controlThread([&]() {
+        for (uint32_t i = 0; i < RUNS; i++) {
+            monitor.begin(control);
+            monitor.end(control);
+        }
+    });
+    std::thread linkThread([&]() {
+        for (uint32_t i = 0; i < RUNS; i++) {
+            monitor.begin(link);
+            monitor.end(link);
+        }
+    });
+
+    uint32_t controlRuns = 0;
+    uint32_t linkRuns = 0;
+    TaskMonitor::TaskStats stats[2];
+    for (int i = 0; i < 1000; i++) {
+        monitor.sample(stats, 2);
+        controlRuns += stats[0].runs;
+        linkRuns += stats[1].runs;
+    }
+    controlThread.join();
+    linkThread.join();
+    monitor.sample(stats, 2);
+    controlRuns += stats[0].runs;
+    linkRuns += stats[1].runs;
+
+    TEST_ASSERT_EQUAL_UINT32(RUNS, controlRuns);
+    TEST_ASSERT_EQUAL_UINT32(RUNS, linkRuns);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cpu_share_per_window);
+    RUN_TEST(test_share_capped_and_wrap);
+    RUN_TEST(test_registry_bounds);
+    RUN_TEST(test_concurrent_runs);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
@@ -0,0 +1,236 @@
+#include "Telemetry.h"
+
+#include <string.h>
+
+static void putU16(uint8_t *out, uint16_t value)
+{
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t *out, uint32_t value)
+{
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+TelemetryWriter::TelemetryWriter(TelemetrySink &sink)
+    : sink(sink),
+      sequence(0),
+      written(0),
+      dropped(0)
+{
+}
+
+bool TelemetryWriter::write(uint8_t type, uint32_t timestampUs, const uint8_t *payload, size_t length)
+{
+  if (length > MAX_PAYLOAD)
+  {
+    return false;
+  }
+
+  uint8_t frame[MAX_FRAME];
+  uint16_t seq = (uint16_t)sequence.fetch_add(1, std::memory_order_relaxed);
+  frame[0] = SYNC0;
+  frame[1] = SYNC1;
+  frame[2] = type;
+  frame[3] = (uint8_t)length;
+  putU16(&frame[4], seq);
+  putU32(&frame[6], timestampUs);
+  if (length > 0)
+  {
+    memcpy(&frame[HEADER_SIZE], payload, length);
+  }
+  putU16(&frame[HEADER_SIZE + length], crc16(&frame[2], HEADER_SIZE - 2 + length));
+
+  if (!sink.write(frame, HEADER_SIZE + length + CRC_SIZE))
+  {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  written.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool TelemetryWriter::writeReport(uint32_t timestampUs, const uint8_t *report, size_t length)
+{
+  return write(RECORD_REPORT, timestampUs, report, length);
+}
+
+bool TelemetryWriter::writeInput(uint32_t timestampUs, float stickX, float stickY,
+                                 float leftTrigger, float rightTrigger)
+{
+  return writeInputQ15(timestampUs, toQ15(stickX), toQ15(stickY), toQ15(leftTrigger), toQ15(rightTrigger));
+}
+
+bool TelemetryWriter::writeMotor(uint32_t timestampUs, float left, float right)
+{
+  return writeMotorQ15(timestampUs, toQ15(left), toQ15(right));
+}
+
+bool TelemetryWriter::writeInputQ15(uint32_t timestampUs, int16_t stickX, int16_t stickY,
+                                    int16_t leftTrigger, int16_t rightTrigger)
+{
+  uint8_t payload[8];
+  putU16(&payload[0], (uint16_t)stickX);
+  putU16(&payload[2], (uint16_t)stickY);
+  putU16(&payload[4], (uint16_t)leftTrigger);
+  putU16(&payload[6], (uint16_t)rightTrigger);
+  return write(RECORD_INPUT, timestampUs, payload, sizeof(payload));
+}
+
+bool TelemetryWriter::writeMotorQ15(uint32_t timestampUs, int16_t left, int16_t right)
+{
+  uint8_t payload[4];
+  putU16(&payload[0], (uint16_t)left);
+  putU16(&payload[2], (uint16_t)right);
+  return write(RECORD_MOTOR, timestampUs, payload, sizeof(payload));
+}
+
+bool TelemetryWriter::writeLoop(uint32_t timestampUs, uint32_t periodUs, uint32_t workUs, uint32_t overruns)
+{
+  uint8_t payload[12];
+  putU32(&payload[0], periodUs);
+  putU32(&payload[4], workUs);
+  putU32(&payload[8], overruns);
+  return write(RECORD_LOOP, timestampUs, payload, sizeof(payload));
+}
+
+uint16_t TelemetryWriter::crc16(const uint8_t *data, size_t length)
+{
+  // CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+void TelemetryWriter::setSequence(uint8_t *frame, size_t length, uint16_t sequence)
+{
+  putU16(&frame[4], sequence);
+  putU16(&frame[length - CRC_SIZE], crc16(&frame[2], length - CRC_SIZE - 2));
+}
+
+int16_t TelemetryWriter::toQ15(float value)
+{
+  if (value >= 1.0f)
+    return 32767;
+  if (value <= -1.0f)
+    return -32767;
+  return (int16_t)(value * 32767.0f);
+}
+
+QueuedTelemetrySink::QueuedTelemetrySink()
+    : refused(0),
+      full(0),
+      sequence(0)
+{
+}
+
+bool QueuedTelemetrySink::write(const uint8_t *frame, size_t length)
+{
+  if (length > TelemetryWriter::MAX_FRAME)
+  {
+    return false;
+  }
+  Frame entry;
+  entry.length = (uint8_t)length;
+  memcpy(entry.data, frame, length);
+  if (!queue.push(entry))
+  {
+    full.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+size_t QueuedTelemetrySink::drain(TelemetrySink &out, size_t maxFrames)
+{
+  size_t drained = 0;
+  Frame entry;
+  while (drained < maxFrames)
+  {
+    if (!queue.pop(entry))
+    {
+      // Everything queued before the refused pushes has gone out
+      sequence += full.exchange(0, std::memory_order_relaxed);
+      break;
+    }
+    TelemetryWriter::setSequence(entry.data, entry.length, (uint16_t)sequence++);
+    if (!out.write(entry.data, entry.length))
+    {
+      refused.fetch_add(1, std::memory_order_relaxed);
+    }
+    drained++;
+  }
+  return drained;
+}
+
+#ifdef ARDUINO
+bool StreamTelemetrySink::write(const uint8_t *frame, size_t length)
+{
+  if (out.availableForWrite() < (int)length)
+  {
+    return false;
+  }
+  return out.write(frame, length) == length;
+}
+#endif // ARDUINO
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <BLE2902.h>
+
+BLENotifyTelemetrySink::BLENotifyTelemetrySink()
+    : pCharacteristic(nullptr),
+      busy(false)
+{
+}
+
+bool BLENotifyTelemetrySink::begin()
+{
+  BLEServer *pServer = BLEDevice::createServer();
+  if (pServer == nullptr)
+  {
+    return false;
+  }
+  BLEService *pService = pServer->createService(TELEMETRY_SERVICE_UUID);
+  pCharacteristic = pService->createCharacteristic(
+      TELEMETRY_CHARACTERISTIC_UUID, BLECharacteristic::PROPERTY_NOTIFY);
+  pCharacteristic->addDescriptor(new BLE2902());
+  pService->start();
+
+  BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
+  pAdvertising->addServiceUUID(TELEMETRY_SERVICE_UUID);
+  pAdvertising->start();
+  return true;
+}
+
+bool BLENotifyTelemetrySink::write(const uint8_t *frame, size_t length)
+{
+  if (pCharacteristic == nullptr)
+  {
+    return false;
+  }
+
+  // setValue() and notify() share the characteristic's buffer: a frame
+  // arriving from another task while one is in flight is dropped
+  if (busy.exchange(true, std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  pCharacteristic->setValue((uint8_t *)frame, length);
+  pCharacteristic->notify();
+
+  busy.store(false, std::memory_order_release);
+  return true;
+}
+#endif // ARDUINO_ARCH_ESP32
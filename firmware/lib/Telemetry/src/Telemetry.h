@@ -0,0 +1,172 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LockFreeQueue.h"
+
+// Framed binary telemetry.
+//
+// Every record is one self-delimiting frame (all fields little endian):
+//
+//   offset  size  field
+//   0       2     sync 0xA5 0x5A
+//   2       1     record type (TelemetryWriter::RecordType)
+//   3       1     payload length N (0..MAX_PAYLOAD)
+//   4       2     sequence number, +1 per record, wraps
+//   6       4     timestamp, micros() when the record was produced
+//   10      N     payload
+//   10+N    2     CRC-16/CCITT-FALSE over bytes 2..10+N-1
+//
+// The sequence number advances even when the sink drops a frame, so a host
+// sees every loss (local or on the link) as a gap. Numbers are assigned in
+// the order frames enter the output: with several producing tasks that is a
+// QueuedTelemetrySink, which renumbers frames as it drains them. Decoders resynchronize by
+// searching for the sync bytes and checking the CRC, which also lets frames
+// share a serial port with text log lines.
+//
+// utils/ble_tool.py decode turns a captured stream into CSV or plots.
+
+// Destination for complete frames. write() is handed one whole frame and
+// must either send all of it or nothing; it must not block the caller.
+class TelemetrySink
+{
+public:
+  virtual ~TelemetrySink() {}
+  virtual bool write(const uint8_t *frame, size_t length) = 0;
+};
+
+class TelemetryWriter
+{
+public:
+  enum RecordType
+  {
+    RECORD_REPORT = 0x01, // raw HID input report bytes
+    RECORD_INPUT = 0x02,  // int16 Q15 stick X, stick Y, left trigger, right trigger
+    RECORD_MOTOR = 0x03,  // int16 Q15 left, right motor command
+    RECORD_LOOP = 0x04    // uint32 period us, work us, overrun count
+  };
+
+  static const uint8_t SYNC0 = 0xA5;
+  static const uint8_t SYNC1 = 0x5A;
+  static const size_t HEADER_SIZE = 10;
+  static const size_t CRC_SIZE = 2;
+  static const size_t MAX_PAYLOAD = 64;
+  static const size_t MAX_FRAME = HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE;
+
+  explicit TelemetryWriter(TelemetrySink &sink);
+
+  // Frame and send one record; false if the payload is too long or the
+  // sink dropped it. Safe to call from several tasks.
+  bool write(uint8_t type, uint32_t timestampUs, const uint8_t *payload, size_t length);
+
+  bool writeReport(uint32_t timestampUs, const uint8_t *report, size_t length);
+  bool writeInput(uint32_t timestampUs, float stickX, float stickY, float leftTrigger, float rightTrigger);
+  bool writeMotor(uint32_t timestampUs, float left, float right);
+  // Same records from values already in Q15
+  bool writeInputQ15(uint32_t timestampUs, int16_t stickX, int16_t stickY, int16_t leftTrigger, int16_t rightTrigger);
+  bool writeMotorQ15(uint32_t timestampUs, int16_t left, int16_t right);
+  bool writeLoop(uint32_t timestampUs, uint32_t periodUs, uint32_t workUs, uint32_t overruns);
+
+  uint16_t getSequence() const { return (uint16_t)sequence.load(std::memory_order_relaxed); }
+  uint32_t getWrittenCount() const { return written.load(std::memory_order_relaxed); }
+  uint32_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+  static uint16_t crc16(const uint8_t *data, size_t length);
+
+  // Replace the sequence number of a complete frame and its CRC
+  static void setSequence(uint8_t *frame, size_t length, uint16_t sequence);
+
+  // -1.0..1.0 to int16 Q15, saturating
+  static int16_t toQ15(float value);
+
+private:
+  TelemetrySink &sink;
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> written;
+  std::atomic<uint32_t> dropped;
+};
+
+// Hands frames from the producing tasks to a slow sink on another task.
+// write() copies the frame into a bounded lock-free queue and returns at
+// once; drain() forwards queued frames to the real sink and runs on a
+// low-priority task. A full queue refuses the frame, which the writer counts
+// as a drop.
+//
+// Producers on different tasks can take sequence numbers in one order and
+// reach the queue in another, so drain(), the single consumer, numbers the
+// frames again in queue order. Frames the queue refused leave their gap
+// once the frames queued ahead of them have gone out.
+class QueuedTelemetrySink : public TelemetrySink
+{
+public:
+  static const size_t QUEUE_SIZE = 32; // frames, power of two
+
+  QueuedTelemetrySink();
+
+  bool write(const uint8_t *frame, size_t length);
+
+  // Forward up to maxFrames queued frames to out; returns the number taken
+  // from the queue. Frames out refuses are lost (and counted).
+  size_t drain(TelemetrySink &out, size_t maxFrames = QUEUE_SIZE);
+
+  // Frames the real sink refused in drain()
+  uint32_t getRefusedCount() const { return refused.load(std::memory_order_relaxed); }
+  size_t getQueuedCount() const { return queue.size(); }
+
+private:
+  struct Frame
+  {
+    uint8_t length;
+    uint8_t data[TelemetryWriter::MAX_FRAME];
+  };
+
+  LockFreeQueue<Frame, QUEUE_SIZE> queue;
+  std::atomic<uint32_t> refused;
+  std::atomic<uint32_t> full; // pushes refused since the last gap was left
+  uint32_t sequence;          // next number drain() gives out
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// Writes frames to a serial port. Frames that do not fit in the transmit
+// buffer are dropped instead of waiting for the UART.
+class StreamTelemetrySink : public TelemetrySink
+{
+public:
+  explicit StreamTelemetrySink(Print &out) : out(out) {}
+  bool write(const uint8_t *frame, size_t length);
+
+private:
+  Print &out;
+};
+#endif // ARDUINO
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <BLEDevice.h>
+#include <BLEServer.h>
+
+#define TELEMETRY_SERVICE_UUID "6e400001-7e1e-4e3a-9f6b-726f76657201"
+#define TELEMETRY_CHARACTERISTIC_UUID "6e400002-7e1e-4e3a-9f6b-726f76657201"
+
+// Notifies each frame on a GATT characteristic of a small telemetry service.
+// The host should request a large MTU: frames longer than MTU - 3 are cut.
+class BLENotifyTelemetrySink : public TelemetrySink
+{
+public:
+  BLENotifyTelemetrySink();
+
+  // Create the service and start advertising; BLEDevice must be initialized
+  bool begin();
+  bool write(const uint8_t *frame, size_t length);
+
+private:
+  BLECharacteristic *pCharacteristic;
+  std::atomic<bool> busy;
+};
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // TELEMETRY_H
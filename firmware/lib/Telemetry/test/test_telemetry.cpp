@@ -0,0 +1,212 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "Telemetry.h"
+
+// Sink that keeps every frame, or refuses them all when full is set
+class CaptureSink : public TelemetrySink
+{
+public:
+    std::vector<std::vector<uint8_t> > frames;
+    bool full;
+
+    CaptureSink() : full(false) {}
+
+    bool write(const uint8_t *frame, size_t length) {
+        if (full) {
+            return false;
+        }
+        frames.push_back(std::vector<uint8_t>(frame, frame + length));
+        return true;
+    }
+};
+
+static uint16_t readU16(const std::vector<uint8_t> &frame, size_t offset) {
+    return (uint16_t)(frame[offset] | (frame[offset + 1] << 8));
+}
+
+static uint32_t readU32(const std::vector<uint8_t> &frame, size_t offset) {
+    return (uint32_t)frame[offset] | ((uint32_t)frame[offset + 1] << 8) |
+           ((uint32_t)frame[offset + 2] << 16) | ((uint32_t)frame[offset + 3] << 24);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Test the CRC matches the CCITT-FALSE check value
+void test_crc_check_value(void) {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, TelemetryWriter::crc16(check, sizeof(check)));
+}
+
+// Test the frame header, payload and trailing CRC layout
+void test_frame_layout(void) {
+    CaptureSink sink;
+    TelemetryWriter writer(sink);
+    const uint8_t report[] = {0x01, 0x02, 0x03};
+
+    TEST_ASSERT_TRUE(writer.writeReport(0x12345678, report, sizeof(report)));
+    TEST_ASSERT_EQUAL_UINT32(1, sink.frames.size());
+
+    const std::vector<uint8_t> &frame = sink.frames[0];
+    TEST_ASSERT_EQUAL_UINT32(TelemetryWriter::HEADER_SIZE + 3 + TelemetryWriter::CRC_SIZE, frame.size());
+    TEST_ASSERT_EQUAL_HEX8(0xA5, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x5A, frame[1]);
+    TEST_ASSERT_EQUAL_UINT8(TelemetryWriter::RECORD_REPORT, frame[2]);
+    TEST_ASSERT_EQUAL_UINT8(3, frame[3]);
+    TEST_ASSERT_EQUAL_UINT16(0, readU16(frame, 4));
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, readU32(frame, 6));
+    TEST_ASSERT_EQUAL_MEMORY(report, &frame[10], 3);
+    TEST_ASSERT_EQUAL_HEX16(TelemetryWriter::crc16(&frame[2], frame.size() - 4),
+                            readU16(frame, frame.size() - 2));
+}
+
+// Test typed records encode Q15 values and loop timing
+void test_typed_records(void) {
+    CaptureSink sink;
+    TelemetryWriter writer(sink);
+
+    writer.writeInput(10, 1.0f, -1.0f, 0.5f, 0.0f);
+    writer.writeMotor(20, -0.25f, 2.0f);
+    writer.writeLoop(30, 20000, 350, 2);
+
+    const std::vector<uint8_t> &input = sink.frames[0];
+    TEST_ASSERT_EQUAL_UINT8(TelemetryWriter::RECORD_INPUT, input[2]);
+    TEST_ASSERT_EQUAL_INT16(32767, (int16_t)readU16(input, 10));
+    TEST_ASSERT_EQUAL_INT16(-32767, (int16_t)readU16(input, 12));
+    TEST_ASSERT_EQUAL_INT16(16383, (int16_t)readU16(input, 14));
+    TEST_ASSERT_EQUAL_INT16(0, (int16_t)readU16(input, 16));
+
+    const std::vector<uint8_t> &motor = sink.frames[1];
+    TEST_ASSERT_EQUAL_INT16(-8191, (int16_t)readU16(motor, 10));
+    TEST_ASSERT_EQUAL_INT16(32767, (int16_t)readU16(motor, 12)); // saturated
+
+    const std::vector<uint8_t> &loop = sink.frames[2];
+    TEST_ASSERT_EQUAL_UINT32(20000, readU32(loop, 10));
+    TEST_ASSERT_EQUAL_UINT32(350, readU32(loop, 14));
+    TEST_ASSERT_EQUAL_UINT32(2, readU32(loop, 18));
+    TEST_ASSERT_EQUAL_UINT16(2, readU16(loop, 4));
+}
+
+// Test dropped frames still consume a sequence number so the host sees a gap
+void test_drops_leave_sequence_gap(void) {
+    CaptureSink sink;
+    TelemetryWriter writer(sink);
+
+    writer.writeLoop(0, 1, 1, 0);
+    sink.full = true;
+    TEST_ASSERT_FALSE(writer.writeLoop(0, 1, 1, 0));
+    TEST_ASSERT_FALSE(writer.writeLoop(0, 1, 1, 0));
+    sink.full = false;
+    writer.writeLoop(0, 1, 1, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(2, writer.getWrittenCount());
+    TEST_ASSERT_EQUAL_UINT32(2, writer.getDroppedCount());
+    TEST_ASSERT_EQUAL_UINT16(0, readU16(sink.frames[0], 4));
+    TEST_ASSERT_EQUAL_UINT16(3, readU16(sink.frames[1], 4));
+}
+
+// Test oversized payloads are rejected without touching the sink
+void test_oversized_payload_rejected(void) {
+    CaptureSink sink;
+    TelemetryWriter writer(sink);
+    uint8_t big[TelemetryWriter::MAX_PAYLOAD + 1];
+    memset(big, 0, sizeof(big));
+
+    TEST_ASSERT_FALSE(writer.writeReport(0, big, sizeof(big)));
+    TEST_ASSERT_TRUE(writer.writeReport(0, big, TelemetryWriter::MAX_PAYLOAD));
+    TEST_ASSERT_EQUAL_UINT32(1, sink.frames.size());
+    TEST_ASSERT_EQUAL_UINT32(TelemetryWriter::MAX_FRAME, sink.frames[0].size());
+}
+
+// Test queued frames reach the real sink in order and a full queue drops
+void test_queued_sink(void) {
+    QueuedTelemetrySink queued;
+    CaptureSink sink;
+    TelemetryWriter writer(queued);
+
+    for (uint32_t i = 0; i < QueuedTelemetrySink::QUEUE_SIZE + 2; i++)
+        writer.writeLoop(i, 20000, 100, 0);
+    TEST_ASSERT_EQUAL_UINT32(QueuedTelemetrySink::QUEUE_SIZE, writer.getWrittenCount());
+    TEST_ASSERT_EQUAL_UINT32(2, writer.getDroppedCount());
+    TEST_ASSERT_EQUAL_UINT32(QueuedTelemetrySink::QUEUE_SIZE, queued.getQueuedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, sink.frames.size());
+
+    TEST_ASSERT_EQUAL_UINT32(4, queued.drain(sink, 4));
+    sink.full = true;
+    TEST_ASSERT_EQUAL_UINT32(1, queued.drain(sink, 1));
+    sink.full = false;
+    TEST_ASSERT_EQUAL_UINT32(QueuedTelemetrySink::QUEUE_SIZE - 5, queued.drain(sink));
+    TEST_ASSERT_EQUAL_UINT32(0, queued.drain(sink));
+    TEST_ASSERT_EQUAL_UINT32(1, queued.getRefusedCount());
+
+    TEST_ASSERT_EQUAL_UINT32(QueuedTelemetrySink::QUEUE_SIZE - 1, sink.frames.size());
+    TEST_ASSERT_EQUAL_UINT16(0, readU16(sink.frames[0], 4));
+    TEST_ASSERT_EQUAL_UINT16(5, readU16(sink.frames[4], 4));
+    TEST_ASSERT_EQUAL_UINT32(5, readU32(sink.frames[4], 6));
+
+    // The two refused frames leave their gap after the queued ones
+    writer.writeLoop(100, 20000, 100, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, queued.drain(sink));
+    TEST_ASSERT_EQUAL_UINT16(QueuedTelemetrySink::QUEUE_SIZE + 2, readU16(sink.frames.back(), 4));
+}
+
+// Test frames that reach the queue out of numbering order go out numbered
+// in queue order, with valid CRCs
+void test_queued_sink_numbers_in_queue_order(void) {
+    QueuedTelemetrySink queued;
+    CaptureSink sink;
+    // Two producers, each numbering from its own counter as a stand-in for
+    // two tasks that took numbers in one order and pushed in the other
+    TelemetryWriter control(queued);
+    TelemetryWriter notify(queued);
+    control.writeLoop(1, 20000, 100, 0);
+    control.writeLoop(2, 20000, 100, 0);
+    notify.writeLoop(3, 20000, 100, 0);
+    control.writeLoop(4, 20000, 100, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(4, queued.drain(sink));
+    for (uint16_t i = 0; i < 4; i++) {
+        const std::vector<uint8_t> &frame = sink.frames[i];
+        TEST_ASSERT_EQUAL_UINT16(i, readU16(frame, 4));
+        TEST_ASSERT_EQUAL_UINT32(i + 1, readU32(frame, 6));
+        TEST_ASSERT_EQUAL_UINT16(TelemetryWriter::crc16(&frame[2], frame.size() - 4),
+                                 readU16(frame, frame.size() - 2));
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_crc_check_value);
+    RUN_TEST(test_frame_layout);
+    RUN_TEST(test_typed_records);
+    RUN_TEST(test_drops_leave_sequence_gap);
+    RUN_TEST(test_queued_sink_numbers_in_queue_order);
+    RUN_TEST(test_oversized_payload_rejected);
+    RUN_TEST(test_queued_sink);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
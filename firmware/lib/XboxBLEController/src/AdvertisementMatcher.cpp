@@ -0,0 +1,82 @@
+#include "AdvertisementMatcher.h"
+
+#include <string.h>
+
+AdvertisementMatcher::AdvertisementMatcher()
+{
+  clear();
+  matchHidService = true;
+  addNamePrefix("Xbox");
+}
+
+void AdvertisementMatcher::clear()
+{
+  matchHidService = false;
+  namePrefixCount = 0;
+  addressPrefixCount = 0;
+}
+
+bool AdvertisementMatcher::addNamePrefix(const char *prefix)
+{
+  if (prefix == nullptr || namePrefixCount >= MAX_PREFIXES)
+  {
+    return false;
+  }
+  namePrefixes[namePrefixCount++] = prefix;
+  return true;
+}
+
+bool AdvertisementMatcher::addAddressPrefix(const uint8_t *prefix, uint8_t length)
+{
+  if (length == 0 || length > sizeof(addressPrefixes[0].bytes) || addressPrefixCount >= MAX_PREFIXES)
+  {
+    return false;
+  }
+  AddressPrefix &entry = addressPrefixes[addressPrefixCount++];
+  memcpy(entry.bytes, prefix, length);
+  entry.length = length;
+  return true;
+}
+
+bool AdvertisementMatcher::matches(const BLEAdvertisement &advertisement) const
+{
+  if (matchHidService && advertisement.advertisesHidService)
+  {
+    return true;
+  }
+
+  for (uint8_t i = 0; i < addressPrefixCount; i++)
+  {
+    if (memcmp(advertisement.address.bytes, addressPrefixes[i].bytes, addressPrefixes[i].length) == 0)
+    {
+      return true;
+    }
+  }
+
+  if (advertisement.haveName)
+  {
+    for (uint8_t i = 0; i < namePrefixCount; i++)
+    {
+      if (startsWithIgnoreCase(advertisement.name, namePrefixes[i]))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool AdvertisementMatcher::startsWithIgnoreCase(const char *text, const char *prefix)
+{
+  for (; *prefix != '\0'; text++, prefix++)
+  {
+    // ASCII only: fold A-Z onto a-z
+    char a = (*text >= 'A' && *text <= 'Z') ? *text + ('a' - 'A') : *text;
+    char b = (*prefix >= 'A' && *prefix <= 'Z') ? *prefix + ('a' - 'A') : *prefix;
+    if (a != b)
+    {
+      return false;
+    }
+  }
+  return true;
+}
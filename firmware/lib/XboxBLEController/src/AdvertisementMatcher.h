@@ -0,0 +1,54 @@
+#ifndef ADVERTISEMENT_MATCHER_H
+#define ADVERTISEMENT_MATCHER_H
+
+#include <stdint.h>
+
+#include "BLETransport.h"
+
+// Decides whether an advertisement comes from a controller worth connecting
+// to. Runs on the scan context for every advertisement, so it only compares
+// bytes in place: no copies, no lowercased strings, no allocation.
+//
+// An advertisement matches if any enabled rule does:
+//   - it lists the HID service
+//   - its name starts with one of the name prefixes (ASCII, any case)
+//   - its address starts with one of the address prefixes (e.g. a vendor
+//     OUI), compared against BLEPeerAddress::bytes from index 0
+//
+// The default matcher accepts the HID service and names starting "Xbox".
+class AdvertisementMatcher
+{
+public:
+  static const uint8_t MAX_PREFIXES = 4;
+
+  AdvertisementMatcher();
+
+  // Remove every rule; nothing matches until one is added
+  void clear();
+
+  void setMatchHidService(bool match) { matchHidService = match; }
+
+  // The string is kept by pointer and must outlive the matcher. Returns
+  // false when all slots are taken.
+  bool addNamePrefix(const char *prefix);
+  bool addAddressPrefix(const uint8_t *prefix, uint8_t length);
+
+  bool matches(const BLEAdvertisement &advertisement) const;
+
+private:
+  struct AddressPrefix
+  {
+    uint8_t bytes[6];
+    uint8_t length;
+  };
+
+  bool matchHidService;
+  const char *namePrefixes[MAX_PREFIXES];
+  uint8_t namePrefixCount;
+  AddressPrefix addressPrefixes[MAX_PREFIXES];
+  uint8_t addressPrefixCount;
+
+  static bool startsWithIgnoreCase(const char *text, const char *prefix);
+};
+
+#endif // ADVERTISEMENT_MATCHER_H
@@ -0,0 +1,138 @@
+#ifndef BLE_TRANSPORT_H
+#define BLE_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Address of a BLE peer (little endian, as used by the ESP-IDF stack)
+struct BLEPeerAddress
+{
+  uint8_t bytes[6];
+
+  bool operator==(const BLEPeerAddress &other) const
+  {
+    return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+  }
+  bool operator!=(const BLEPeerAddress &other) const { return !(*this == other); }
+};
+
+// One advertisement seen while scanning. Fixed size, so matching one never
+// allocates.
+struct BLEAdvertisement
+{
+  static const size_t MAX_NAME_LENGTH = 31; // a whole legacy advertising payload
+
+  BLEPeerAddress address;
+  char name[MAX_NAME_LENGTH + 1]; // NUL terminated, may be truncated
+  bool haveName;
+  bool advertisesHidService;
+  int8_t rssi;
+};
+
+// Scan timing: the radio listens for windowMs out of every intervalMs, so
+// window == interval scans continuously. Active scans also ask for scan
+// responses, which is where many peers put their name.
+struct BLEScanProfile
+{
+  uint16_t intervalMs;
+  uint16_t windowMs;
+  bool active;
+};
+
+// GATT layout of a bonded peer, kept so a reconnect can skip scanning and
+// service discovery. Handles are only meaningful to the transport that
+// produced them.
+struct BLEPeerCache
+{
+  BLEPeerAddress address;
+  bool bonded;
+  uint8_t reportId;            // input report ID from the Report Reference
+  uint16_t inputReportHandle;  // HID Report (input) value handle
+  uint16_t inputCccdHandle;    // its Client Characteristic Configuration
+  uint16_t reportMapHandle;    // HID Report Map, 0 if absent
+  uint16_t protocolModeHandle; // 0 if absent
+  uint16_t controlPointHandle; // 0 if absent
+};
+
+// Connection timing in BLE units: intervals in 1.25 ms steps (6 = 7.5 ms),
+// supervision timeout in 10 ms steps
+struct BLEConnectionParams
+{
+  uint16_t minInterval;
+  uint16_t maxInterval;
+  uint16_t latency; // connection events the peripheral may skip
+  uint16_t timeout;
+};
+
+// Thin client-side BLE transport used by XboxBLEController.
+//
+// Covers the scan -> connect -> discover -> subscribe -> notify sequence for
+// a single HID peripheral so the controller logic does not depend on the
+// ESP32 BLE stack and can run against a simulated peripheral on the host.
+class BLETransport
+{
+public:
+  // Called for every input report notification. Runs on the transport's
+  // notification context (the BLE task on ESP32), not on the caller's task.
+  typedef void (*NotifyCallback)(void *context, const uint8_t *data, size_t length);
+
+  // Called for every advertisement while scanning, on the transport's scan
+  // context. Return true to stop the scan. Must not block or allocate.
+  typedef bool (*ScanCallback)(void *context, const BLEAdvertisement &advertisement);
+
+  virtual ~BLETransport() {}
+
+  // Initialize the BLE stack
+  virtual bool begin() = 0;
+
+  // Scan with profile until callback returns true or durationMs has passed.
+  // Returns true if the callback stopped the scan.
+  virtual bool scan(uint32_t durationMs, const BLEScanProfile &profile, ScanCallback callback, void *context) = 0;
+
+  // Connect (and bond) to a peer
+  virtual bool connect(const BLEPeerAddress &address) = 0;
+
+  // Locate the HID input report characteristic and put the peer in Report Protocol
+  virtual bool discover() = 0;
+
+  // Copy the HID Report Map of the discovered service into buffer and return
+  // its length (0 if unavailable). reportId is set to the ID of the input
+  // report that subscribe() will deliver, or 0 if the peer did not say.
+  virtual size_t readReportMap(uint8_t *buffer, size_t capacity, uint8_t &reportId) = 0;
+
+  // Enable input report notifications and route them to callback
+  virtual bool subscribe(NotifyCallback callback, void *context) = 0;
+
+  // Describe the current connection for a later resume(); false if the
+  // peer has not been discovered
+  virtual bool getPeerCache(BLEPeerCache &cache) = 0;
+
+  // Directed connect to a cached peer that restores its handles instead of
+  // scanning and discovering. Returns false (disconnected) if the peer is
+  // unreachable or rejects the cached handles; subscribe() follows as usual.
+  virtual bool resume(const BLEPeerCache &cache) = 0;
+
+  // Drop the connection; no callbacks are delivered after this returns
+  virtual void disconnect() = 0;
+
+  virtual bool isConnected() = 0;
+
+  // Signal strength of the connection in dBm; false if not connected. May
+  // block for a radio round trip, so call it off the control loop.
+  virtual bool readRssi(int8_t &rssi) = 0;
+
+  // Ask for new connection parameters on the current connection, and use
+  // them as the preference for later connections. The peer may settle on
+  // other values. Returns false if the request could not be sent.
+  virtual bool requestConnectionParams(const BLEConnectionParams &params) = 0;
+
+  // Parameters in effect on the current connection, as last reported by the
+  // stack (minInterval == maxInterval == the interval in use). False while
+  // unknown. Non-blocking.
+  virtual bool getConnectionParams(BLEConnectionParams &params) = 0;
+};
+
+#endif // BLE_TRANSPORT_H
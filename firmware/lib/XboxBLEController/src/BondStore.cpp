@@ -0,0 +1,122 @@
+#include "BondStore.h"
+
+#include <string.h>
+
+MemoryBondStore::MemoryBondStore()
+    : saveCount(0)
+{
+  memset(records, 0, sizeof(records));
+  memset(valid, 0, sizeof(valid));
+}
+
+bool MemoryBondStore::load(uint8_t slot, BLEPeerCache &cache)
+{
+  if (slot >= MAX_SLOTS || !valid[slot])
+  {
+    return false;
+  }
+  cache = records[slot];
+  return true;
+}
+
+bool MemoryBondStore::save(uint8_t slot, const BLEPeerCache &cache)
+{
+  if (slot >= MAX_SLOTS)
+  {
+    return false;
+  }
+  records[slot] = cache;
+  valid[slot] = true;
+  saveCount++;
+  return true;
+}
+
+void MemoryBondStore::clear(uint8_t slot)
+{
+  if (slot < MAX_SLOTS)
+  {
+    valid[slot] = false;
+  }
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+
+// Bump when BLEPeerCache changes so stale blobs are ignored
+static const uint8_t BOND_RECORD_VERSION = 1;
+
+struct StoredBond
+{
+  uint8_t version;
+  BLEPeerCache cache;
+};
+
+static const char *BOND_NAMESPACE = "bonds";
+
+static void slotKey(uint8_t slot, char *key)
+{
+  key[0] = 'p';
+  key[1] = (char)('0' + slot);
+  key[2] = '\0';
+}
+
+bool NVSBondStore::load(uint8_t slot, BLEPeerCache &cache)
+{
+  if (slot >= MAX_SLOTS || !preferences.begin(BOND_NAMESPACE, true))
+  {
+    return false;
+  }
+  char key[3];
+  slotKey(slot, key);
+  StoredBond stored;
+  bool ok = preferences.getBytes(key, &stored, sizeof(stored)) == sizeof(stored) &&
+            stored.version == BOND_RECORD_VERSION;
+  preferences.end();
+  if (ok)
+  {
+    cache = stored.cache;
+  }
+  return ok;
+}
+
+bool NVSBondStore::save(uint8_t slot, const BLEPeerCache &cache)
+{
+  if (slot >= MAX_SLOTS)
+  {
+    return false;
+  }
+
+  // Skip the flash write when nothing changed
+  BLEPeerCache current;
+  if (load(slot, current) && memcmp(&current, &cache, sizeof(cache)) == 0)
+  {
+    return true;
+  }
+
+  if (!preferences.begin(BOND_NAMESPACE, false))
+  {
+    return false;
+  }
+  char key[3];
+  slotKey(slot, key);
+  StoredBond stored;
+  memset(&stored, 0, sizeof(stored));
+  stored.version = BOND_RECORD_VERSION;
+  stored.cache = cache;
+  bool ok = preferences.putBytes(key, &stored, sizeof(stored)) == sizeof(stored);
+  preferences.end();
+  return ok;
+}
+
+void NVSBondStore::clear(uint8_t slot)
+{
+  if (slot >= MAX_SLOTS || !preferences.begin(BOND_NAMESPACE, false))
+  {
+    return;
+  }
+  char key[3];
+  slotKey(slot, key);
+  preferences.remove(key);
+  preferences.end();
+}
+
+#endif // ARDUINO_ARCH_ESP32
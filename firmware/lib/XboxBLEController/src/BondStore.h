@@ -0,0 +1,56 @@
+#ifndef BOND_STORE_H
+#define BOND_STORE_H
+
+#include <stdint.h>
+
+#include "BLETransport.h"
+
+// Persistent storage for the last peer of each controller session, so a
+// reboot or a dropped link can reconnect with BLETransport::resume().
+class BondStore
+{
+public:
+  static const uint8_t MAX_SLOTS = 4;
+
+  virtual ~BondStore() {}
+
+  virtual bool load(uint8_t slot, BLEPeerCache &cache) = 0;
+  virtual bool save(uint8_t slot, const BLEPeerCache &cache) = 0;
+  virtual void clear(uint8_t slot) = 0;
+};
+
+// Keeps records in RAM only (host builds and tests)
+class MemoryBondStore : public BondStore
+{
+public:
+  MemoryBondStore();
+
+  bool load(uint8_t slot, BLEPeerCache &cache);
+  bool save(uint8_t slot, const BLEPeerCache &cache);
+  void clear(uint8_t slot);
+
+  uint32_t getSaveCount() const { return saveCount; }
+
+private:
+  BLEPeerCache records[MAX_SLOTS];
+  bool valid[MAX_SLOTS];
+  uint32_t saveCount;
+};
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <Preferences.h>
+
+// Keeps records in the NVS partition, one blob per slot
+class NVSBondStore : public BondStore
+{
+public:
+  bool load(uint8_t slot, BLEPeerCache &cache);
+  bool save(uint8_t slot, const BLEPeerCache &cache);
+  void clear(uint8_t slot);
+
+private:
+  Preferences preferences;
+};
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // BOND_STORE_H
@@ -0,0 +1,146 @@
+#include "ControllerArbiter.h"
+
+#include <string.h>
+
+ControllerArbiter::ControllerArbiter(const Config &config)
+    : config(config),
+      sourceCount(0),
+      lastSource(NO_SOURCE),
+      switchCount(0)
+{
+  memset(sources, 0, sizeof(sources));
+}
+
+int8_t ControllerArbiter::addSource(const XboxBLEController &controller, uint8_t priority, uint8_t weight)
+{
+  if (sourceCount >= MAX_SOURCES || weight == 0)
+  {
+    return NO_SOURCE;
+  }
+
+  Source &source = sources[sourceCount];
+  source.controller = &controller;
+  source.priority = priority;
+  source.weight = weight;
+  source.lastActiveMs = 0;
+  source.everActive = false;
+  return (int8_t)sourceCount++;
+}
+
+bool ControllerArbiter::hasInput(const XboxBLEController::ControllerState &state) const
+{
+  return state.leftStickX > config.stickThreshold || state.leftStickX < -config.stickThreshold ||
+         state.leftStickY > config.stickThreshold || state.leftStickY < -config.stickThreshold ||
+         state.leftTrigger > config.triggerThreshold || state.rightTrigger > config.triggerThreshold;
+}
+
+bool ControllerArbiter::arbitrate(uint32_t nowMs, Result &result)
+{
+  XboxBLEController::ControllerState states[MAX_SOURCES];
+  bool usable[MAX_SOURCES];
+  bool active[MAX_SOURCES];
+
+  // Classify every source from one snapshot each
+  int16_t bestActive = -1;
+  int16_t bestUsable = -1;
+  for (uint8_t i = 0; i < sourceCount; i++)
+  {
+    Source &source = sources[i];
+    states[i] = source.controller->snapshot();
+    const XboxBLEController::ControllerState &state = states[i];
+
+    bool input = state.connected && hasInput(state);
+    bool stale = config.staleAfterMs != 0 && (uint32_t)(nowMs - state.lastUpdateTime) > config.staleAfterMs;
+    usable[i] = state.connected && !(input && stale);
+    if (usable[i] && input)
+    {
+      source.lastActiveMs = nowMs;
+      source.everActive = true;
+    }
+    active[i] = usable[i] && source.everActive &&
+                (input || (uint32_t)(nowMs - source.lastActiveMs) < config.holdMs);
+
+    if (usable[i] && (int16_t)source.priority > bestUsable)
+      bestUsable = source.priority;
+    if (active[i] && (int16_t)source.priority > bestActive)
+      bestActive = source.priority;
+  }
+
+  memset(&result.state, 0, sizeof(result.state));
+  result.source = NO_SOURCE;
+  result.contributing = 0;
+  result.sourceMask = 0;
+
+  int16_t level = bestActive >= 0 ? bestActive : bestUsable;
+  if (level < 0)
+  {
+    if (lastSource != NO_SOURCE)
+      switchCount++;
+    lastSource = NO_SOURCE;
+    return false;
+  }
+  bool onlyActive = bestActive >= 0;
+
+  int32_t sumX = 0;
+  int32_t sumY = 0;
+  int32_t sumRX = 0;
+  int32_t sumRY = 0;
+  int32_t sumLT = 0;
+  int32_t sumRT = 0;
+  int32_t totalWeight = 0;
+  for (uint8_t i = 0; i < sourceCount; i++)
+  {
+    if (!usable[i] || sources[i].priority != level || (onlyActive && !active[i]))
+    {
+      continue;
+    }
+
+    if (config.mode == PRIORITY)
+    {
+      result.state = states[i];
+      result.source = (int8_t)i;
+      result.contributing = 1;
+      result.sourceMask = (uint8_t)(1u << i);
+      break;
+    }
+
+    int32_t weight = sources[i].weight;
+    sumX += weight * states[i].leftStickX;
+    sumY += weight * states[i].leftStickY;
+    sumRX += weight * states[i].rightStickX;
+    sumRY += weight * states[i].rightStickY;
+    sumLT += weight * states[i].leftTrigger;
+    sumRT += weight * states[i].rightTrigger;
+    totalWeight += weight;
+    // A button held on any blended controller counts; the first d-pad wins
+    result.state.buttons |= states[i].buttons;
+    if (result.state.hat == 0)
+      result.state.hat = states[i].hat;
+    if (result.contributing == 0 || (int32_t)(states[i].lastUpdateTime - result.state.lastUpdateTime) > 0)
+      result.state.lastUpdateTime = states[i].lastUpdateTime;
+    // Newest arrival, so latency tracing and change detection see every report
+    if (result.contributing == 0 || (int32_t)(states[i].arrivalUs - result.state.arrivalUs) > 0)
+      result.state.arrivalUs = states[i].arrivalUs;
+    result.source = result.contributing == 0 ? (int8_t)i : NO_SOURCE;
+    result.contributing++;
+    result.sourceMask |= (uint8_t)(1u << i);
+  }
+
+  if (config.mode == BLEND && totalWeight > 0)
+  {
+    result.state.leftStickX = (int16_t)(sumX / totalWeight);
+    result.state.leftStickY = (int16_t)(sumY / totalWeight);
+    result.state.rightStickX = (int16_t)(sumRX / totalWeight);
+    result.state.rightStickY = (int16_t)(sumRY / totalWeight);
+    result.state.leftTrigger = (uint16_t)(sumLT / totalWeight);
+    result.state.rightTrigger = (uint16_t)(sumRT / totalWeight);
+  }
+  result.state.connected = true;
+
+  if (result.source != lastSource)
+  {
+    switchCount++;
+    lastSource = result.source;
+  }
+  return true;
+}
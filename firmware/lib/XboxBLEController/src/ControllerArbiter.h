@@ -0,0 +1,87 @@
+#ifndef CONTROLLER_ARBITER_H
+#define CONTROLLER_ARBITER_H
+
+#include <stdint.h>
+
+#include "XboxBLEController.h"
+
+// Chooses the input the rover follows when several controller sessions are
+// connected, e.g. an operator and a supervisor who can take over.
+//
+// Runs in the control loop on lock-free snapshots of each session, so the
+// notification path of every controller is untouched. Each call:
+//   - drops sessions that are disconnected, or whose inputs are deflected
+//     but have not been refreshed within staleAfterMs
+//   - marks a session active while any input is past the thresholds, and for
+//     holdMs after it returns to rest, so an override does not flicker
+//   - picks the highest priority level that has an active session (or, if
+//     none is active, the highest usable level, whose inputs are at rest)
+//   - PRIORITY: the first session added at that level wins
+//     BLEND: inputs of all active sessions at that level are averaged by weight
+class ControllerArbiter
+{
+public:
+  enum Mode
+  {
+    PRIORITY,
+    BLEND
+  };
+
+  struct Config
+  {
+    Mode mode;
+    uint32_t staleAfterMs;     // 0 = reports never go stale
+    uint32_t holdMs;           // keep a source active this long after it rests
+    int16_t stickThreshold;    // |stick| above this counts as input
+    uint16_t triggerThreshold; // trigger above this counts as input
+  };
+
+  struct Result
+  {
+    XboxBLEController::ControllerState state; // inputs to apply
+    int8_t source;                            // winning source, -1 if none (or blended)
+    uint8_t contributing;                     // sources that went into state
+    uint8_t sourceMask;                       // bit i set when source i did
+  };
+
+  static const uint8_t MAX_SOURCES = XboxBLEController::MAX_SESSIONS;
+  static const int8_t NO_SOURCE = -1;
+
+  explicit ControllerArbiter(const Config &config);
+
+  // Register a session; higher priority overrides lower. Returns its index
+  // or NO_SOURCE when full.
+  int8_t addSource(const XboxBLEController &controller, uint8_t priority, uint8_t weight = 1);
+
+  // Combine the latest snapshots. Returns false (and rest inputs) when no
+  // source is usable.
+  bool arbitrate(uint32_t nowMs, Result &result);
+
+  void setConfig(const Config &newConfig) { config = newConfig; }
+  const Config &getConfig() const { return config; }
+  uint8_t getSourceCount() const { return sourceCount; }
+
+  // Times the winning source changed (e.g. supervisor takeovers and releases)
+  uint32_t getSwitchCount() const { return switchCount; }
+
+  // Any input past the configured thresholds
+  bool hasInput(const XboxBLEController::ControllerState &state) const;
+
+private:
+  struct Source
+  {
+    const XboxBLEController *controller;
+    uint8_t priority;
+    uint8_t weight;
+    uint32_t lastActiveMs;
+    bool everActive;
+  };
+
+  Config config;
+  Source sources[MAX_SOURCES];
+  uint8_t sourceCount;
+  int8_t lastSource;
+  uint32_t switchCount;
+};
+
+#endif // CONTROLLER_ARBITER_H
@@ -0,0 +1,879 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include "ESP32BLETransport.h"
+#include "esp_bt.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gattc_api.h"
+#include "esp_bt_main.h"
+
+#include "ArduinoUtils.h"
+
+NotificationDispatch ESP32BLETransport::notificationTable;
+std::atomic<uint32_t> ESP32BLETransport::resumedRoutes[NotificationDispatch::MAX_SLOTS];
+ESP32BLETransport *ESP32BLETransport::instances[NotificationDispatch::MAX_SLOTS] = {};
+
+static XboxSecurityCallbacks securityCallbacks;
+
+// The radio runs one scan at a time, so its state is shared by all instances
+BLETransport::ScanCallback ESP32BLETransport::scanCallback = nullptr;
+void *ESP32BLETransport::scanContext = nullptr;
+std::atomic<bool> ESP32BLETransport::scanActive(false);
+std::atomic<bool> ESP32BLETransport::scanMatched(false);
+std::atomic<bool> ESP32BLETransport::scanStopped(false);
+
+// How long a peer gets to finish pairing or restore encryption
+static const uint32_t AUTH_TIMEOUT_MS = 3000;
+// Upper bound for a single GATT read or write issued by handle
+static const uint32_t GATT_OP_TIMEOUT_MS = 1000;
+// Upper bound for the controller to answer a read-RSSI request
+static const uint32_t RSSI_TIMEOUT_MS = 200;
+// Upper bound for the stack to confirm a stopped scan
+static const uint32_t SCAN_STOP_TIMEOUT_MS = 100;
+// 16-bit UUID of the HID service in advertisements
+static const uint16_t HID_SERVICE_UUID16 = 0x1812;
+
+// Sessions are driven from one task, so one GATT operation is in flight at a time
+static const int32_t OP_PENDING = -1;
+static std::atomic<uint16_t> pendingHandle(0);
+static std::atomic<int32_t> pendingStatus(OP_PENDING);
+static uint8_t pendingValue[512];
+static volatile size_t pendingLength = 0;
+
+// -1 while pairing/encryption is in progress, then 0 (failed) or 1 (done)
+static std::atomic<int8_t> authState(-1);
+
+void XboxSecurityCallbacks::onAuthenticationComplete(esp_ble_auth_cmpl_t cmpl)
+{
+  ESP32BLETransport::authenticationComplete(cmpl.success);
+}
+
+void ESP32BLETransport::authenticationComplete(bool success)
+{
+  authState.store(success ? 1 : 0);
+}
+
+ESP32BLETransport::ESP32BLETransport()
+    : pClient(nullptr),
+      pInputReportCharacteristic(nullptr),
+      pReportMapCharacteristic(nullptr),
+      resumed(false),
+      hasPreferredParams(false),
+      acceptedKnown(false),
+      rssiState(0),
+      rssiValue(0),
+      notifySlot(NotificationDispatch::NO_SLOT)
+{
+  memset(&peer, 0, sizeof(peer));
+  memset(&preferredParams, 0, sizeof(preferredParams));
+  clearHandles();
+  for (uint8_t i = 0; i < NotificationDispatch::MAX_SLOTS; i++)
+  {
+    if (instances[i] == nullptr)
+    {
+      instances[i] = this;
+      break;
+    }
+  }
+}
+
+ESP32BLETransport::~ESP32BLETransport()
+{
+  for (uint8_t i = 0; i < NotificationDispatch::MAX_SLOTS; i++)
+  {
+    if (instances[i] == this)
+    {
+      instances[i] = nullptr;
+    }
+  }
+  disconnect();
+  if (pClient)
+  {
+    delete pClient;
+  }
+}
+
+bool ESP32BLETransport::begin()
+{
+  // The stack is shared: with one transport per controller session only the
+  // first begin() brings it up
+  if (BLEDevice::getInitialized())
+  {
+    return true;
+  }
+  BLEDevice::init("ESP32_Controller_Client");
+
+  // Enable bonding/pairing
+  esp_ble_auth_req_t auth_req = ESP_LE_AUTH_REQ_SC_MITM_BOND;
+  esp_ble_io_cap_t iocap = ESP_IO_CAP_NONE;
+  uint8_t key_size = 16;
+  uint8_t init_key = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+  uint8_t rsp_key = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+
+  esp_ble_gap_set_security_param(ESP_BLE_SM_AUTHEN_REQ_MODE, &auth_req, sizeof(uint8_t));
+  esp_ble_gap_set_security_param(ESP_BLE_SM_IOCAP_MODE, &iocap, sizeof(uint8_t));
+  esp_ble_gap_set_security_param(ESP_BLE_SM_MAX_KEY_SIZE, &key_size, sizeof(uint8_t));
+  esp_ble_gap_set_security_param(ESP_BLE_SM_SET_INIT_KEY, &init_key, sizeof(uint8_t));
+  esp_ble_gap_set_security_param(ESP_BLE_SM_SET_RSP_KEY, &rsp_key, sizeof(uint8_t));
+
+  // Sees every GATT client event before the BLE library does; needed for
+  // subscriptions restored by handle, which the library knows nothing about
+  BLEDevice::setCustomGattcHandler(gattcEventHandler);
+
+  // Scan results, connection parameter updates and RSSI reads
+  BLEDevice::setCustomGapHandler(gapEventHandler);
+
+  return true;
+}
+
+void ESP32BLETransport::gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+  switch (event)
+  {
+  case ESP_GAP_BLE_SCAN_RESULT_EVT:
+    handleScanResult(param->scan_rst);
+    break;
+  case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT:
+    scanStopped.store(true);
+    break;
+  case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+    handleConnectionUpdate(param->update_conn_params);
+    break;
+  case ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT:
+    handleReadRssi(param->read_rssi);
+    break;
+  default:
+    break;
+  }
+}
+
+void ESP32BLETransport::handleConnectionUpdate(const esp_ble_gap_cb_param_t::ble_update_conn_params_evt_param &update)
+{
+  if (update.status != ESP_BT_STATUS_SUCCESS)
+  {
+    LOG_WARN("Connection parameter update failed: %d", update.status);
+    return;
+  }
+
+  BLEConnectionParams params;
+  params.minInterval = update.conn_int;
+  params.maxInterval = update.conn_int;
+  params.latency = update.latency;
+  params.timeout = update.timeout;
+  for (uint8_t i = 0; i < NotificationDispatch::MAX_SLOTS; i++)
+  {
+    ESP32BLETransport *transport = instances[i];
+    if (transport && memcmp(transport->peer.bytes, update.bda, sizeof(transport->peer.bytes)) == 0)
+    {
+      transport->acceptedParams.write(params);
+      transport->acceptedKnown.store(true, std::memory_order_release);
+    }
+  }
+}
+
+void ESP32BLETransport::handleReadRssi(const esp_ble_gap_cb_param_t::ble_read_rssi_cmpl_evt_param &result)
+{
+  for (uint8_t i = 0; i < NotificationDispatch::MAX_SLOTS; i++)
+  {
+    ESP32BLETransport *transport = instances[i];
+    if (transport && transport->rssiState.load() == -1 &&
+        memcmp(transport->peer.bytes, result.remote_addr, sizeof(transport->peer.bytes)) == 0)
+    {
+      transport->rssiValue.store(result.rssi);
+      transport->rssiState.store(result.status == ESP_BT_STATUS_SUCCESS ? 1 : 0);
+    }
+  }
+}
+
+void ESP32BLETransport::gattcEventHandler(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf,
+                                          esp_ble_gattc_cb_param_t *param)
+{
+  switch (event)
+  {
+  case ESP_GATTC_NOTIFY_EVT:
+  {
+    uint32_t key = ((uint32_t)gattcIf << 24) | ((uint32_t)(param->notify.conn_id & 0xFF) << 16) |
+                   param->notify.handle;
+    for (uint8_t slot = 0; slot < NotificationDispatch::MAX_SLOTS; slot++)
+    {
+      if (resumedRoutes[slot].load(std::memory_order_acquire) == key)
+      {
+        notificationTable.dispatch(slot, param->notify.value, param->notify.value_len);
+        break;
+      }
+    }
+    break;
+  }
+  case ESP_GATTC_WRITE_DESCR_EVT:
+  case ESP_GATTC_WRITE_CHAR_EVT:
+    if (param->write.handle == pendingHandle.load())
+    {
+      pendingStatus.store(param->write.status);
+    }
+    break;
+  case ESP_GATTC_READ_CHAR_EVT:
+    if (param->read.handle == pendingHandle.load())
+    {
+      size_t length = param->read.value_len < sizeof(pendingValue) ? param->read.value_len : sizeof(pendingValue);
+      if (param->read.status == ESP_GATT_OK)
+      {
+        memcpy(pendingValue, param->read.value, length);
+      }
+      pendingLength = length;
+      pendingStatus.store(param->read.status);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void ESP32BLETransport::clearHandles()
+{
+  reportId = 0;
+  inputReportHandle = 0;
+  inputCccdHandle = 0;
+  reportMapHandle = 0;
+  protocolModeHandle = 0;
+  controlPointHandle = 0;
+}
+
+uint32_t ESP32BLETransport::routeKey(uint16_t handle) const
+{
+  return ((uint32_t)pClient->getGattcIf() << 24) | ((uint32_t)(pClient->getConnId() & 0xFF) << 16) | handle;
+}
+
+bool ESP32BLETransport::waitForAuthentication(uint32_t timeoutMs)
+{
+  uint32_t start = millis();
+  while (authState.load() < 0 && millis() - start < timeoutMs)
+  {
+    delay(10);
+  }
+  return authState.load() == 1;
+}
+
+bool ESP32BLETransport::writeHandle(uint16_t handle, const uint8_t *data, size_t length, bool descriptor,
+                                    bool withResponse)
+{
+  if (handle == 0 || !isConnected())
+  {
+    return false;
+  }
+  pendingStatus.store(OP_PENDING);
+  pendingHandle.store(handle);
+
+  esp_gatt_write_type_t type = withResponse ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP;
+  esp_err_t err;
+  if (descriptor)
+  {
+    err = esp_ble_gattc_write_char_descr(pClient->getGattcIf(), pClient->getConnId(), handle, length,
+                                         (uint8_t *)data, type, ESP_GATT_AUTH_REQ_NONE);
+  }
+  else
+  {
+    err = esp_ble_gattc_write_char(pClient->getGattcIf(), pClient->getConnId(), handle, length,
+                                   (uint8_t *)data, type, ESP_GATT_AUTH_REQ_NONE);
+  }
+  if (err != ESP_OK)
+  {
+    pendingHandle.store(0);
+    return false;
+  }
+
+  // Only a write with response is confirmed by the peer
+  uint32_t start = millis();
+  while (withResponse && pendingStatus.load() == OP_PENDING && millis() - start < GATT_OP_TIMEOUT_MS)
+  {
+    delay(1);
+  }
+  bool ok = !withResponse || pendingStatus.load() == ESP_GATT_OK;
+  pendingHandle.store(0);
+  return ok;
+}
+
+size_t ESP32BLETransport::readHandle(uint16_t handle, uint8_t *buffer, size_t capacity)
+{
+  if (handle == 0 || !isConnected())
+  {
+    return 0;
+  }
+  pendingStatus.store(OP_PENDING);
+  pendingHandle.store(handle);
+  if (esp_ble_gattc_read_char(pClient->getGattcIf(), pClient->getConnId(), handle, ESP_GATT_AUTH_REQ_NONE) !=
+      ESP_OK)
+  {
+    pendingHandle.store(0);
+    return 0;
+  }
+
+  uint32_t start = millis();
+  while (pendingStatus.load() == OP_PENDING && millis() - start < GATT_OP_TIMEOUT_MS)
+  {
+    delay(1);
+  }
+  size_t length = 0;
+  if (pendingStatus.load() == ESP_GATT_OK)
+  {
+    length = pendingLength < capacity ? pendingLength : capacity;
+    memcpy(buffer, pendingValue, length);
+  }
+  pendingHandle.store(0);
+  return length;
+}
+
+bool ESP32BLETransport::scan(uint32_t durationMs, const BLEScanProfile &profile, ScanCallback callback,
+                             void *context)
+{
+  // Raw GAP scan: advertisements are matched in gapEventHandler as they
+  // arrive instead of being collected as BLEAdvertisedDevice objects
+  esp_ble_scan_params_t params;
+  memset(&params, 0, sizeof(params));
+  params.scan_type = profile.active ? BLE_SCAN_TYPE_ACTIVE : BLE_SCAN_TYPE_PASSIVE;
+  params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  params.scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL;
+  params.scan_interval = msToScanUnits(profile.intervalMs);
+  params.scan_window = msToScanUnits(profile.windowMs < profile.intervalMs ? profile.windowMs : profile.intervalMs);
+  params.scan_duplicate = BLE_SCAN_DUPLICATE_DISABLE;
+  if (esp_ble_gap_set_scan_params(&params) != ESP_OK)
+  {
+    return false;
+  }
+
+  scanCallback = callback;
+  scanContext = context;
+  scanMatched.store(false);
+  scanStopped.store(false);
+  scanActive.store(true);
+  if (esp_ble_gap_start_scanning(0) != ESP_OK)
+  {
+    scanActive.store(false);
+    return false;
+  }
+
+  uint32_t start = millis();
+  while (!scanMatched.load() && millis() - start < durationMs)
+  {
+    delay(5);
+  }
+  scanActive.store(false);
+  esp_ble_gap_stop_scanning();
+
+  // Results are delivered on the BLE task; once the stop is confirmed no
+  // callback is running or still to come
+  start = millis();
+  while (!scanStopped.load() && millis() - start < SCAN_STOP_TIMEOUT_MS)
+  {
+    delay(1);
+  }
+  scanCallback = nullptr;
+  scanContext = nullptr;
+  return scanMatched.load();
+}
+
+uint16_t ESP32BLETransport::msToScanUnits(uint16_t ms)
+{
+  // 0.625 ms units, within the 2.5 ms to 10.24 s the controller accepts
+  uint32_t units = (uint32_t)ms * 8 / 5;
+  return units < 0x0004 ? 0x0004 : units > 0x4000 ? 0x4000 : (uint16_t)units;
+}
+
+void ESP32BLETransport::parseAdvertisement(const uint8_t *data, size_t length, BLEAdvertisement &advertisement)
+{
+  // AD structures: [length][type][length - 1 bytes of value]
+  size_t i = 0;
+  while (i + 1 < length)
+  {
+    size_t fieldLength = data[i];
+    if (fieldLength == 0 || i + 1 + fieldLength > length)
+    {
+      break;
+    }
+    uint8_t type = data[i + 1];
+    const uint8_t *value = data + i + 2;
+    size_t valueLength = fieldLength - 1;
+
+    switch (type)
+    {
+    case 0x08: // Shortened Local Name
+    case 0x09: // Complete Local Name, preferred
+      if (type == 0x09 || !advertisement.haveName)
+      {
+        size_t n = valueLength < BLEAdvertisement::MAX_NAME_LENGTH ? valueLength : BLEAdvertisement::MAX_NAME_LENGTH;
+        memcpy(advertisement.name, value, n);
+        advertisement.name[n] = '\0';
+        advertisement.haveName = true;
+      }
+      break;
+    case 0x02: // Incomplete List of 16-bit Service UUIDs
+    case 0x03: // Complete List of 16-bit Service UUIDs
+      for (size_t j = 0; j + 1 < valueLength; j += 2)
+      {
+        if ((value[j] | (value[j + 1] << 8)) == HID_SERVICE_UUID16)
+        {
+          advertisement.advertisesHidService = true;
+        }
+      }
+      break;
+    default:
+      break;
+    }
+    i += 1 + fieldLength;
+  }
+}
+
+void ESP32BLETransport::handleScanResult(const esp_ble_gap_cb_param_t::ble_scan_result_evt_param &result)
+{
+  if (result.search_evt != ESP_GAP_SEARCH_INQ_RES_EVT || !scanActive.load() || scanCallback == nullptr)
+  {
+    return;
+  }
+
+  // On the stack, copied from the event in place: nothing is allocated
+  BLEAdvertisement advertisement;
+  memcpy(advertisement.address.bytes, result.bda, sizeof(advertisement.address.bytes));
+  advertisement.name[0] = '\0';
+  advertisement.haveName = false;
+  advertisement.advertisesHidService = false;
+  advertisement.rssi = (int8_t)result.rssi;
+  size_t length = (size_t)result.adv_data_len + result.scan_rsp_len;
+  parseAdvertisement(result.ble_adv, length < sizeof(result.ble_adv) ? length : sizeof(result.ble_adv),
+                     advertisement);
+
+  if (scanCallback(scanContext, advertisement))
+  {
+    scanActive.store(false);
+    scanMatched.store(true);
+  }
+}
+
+bool ESP32BLETransport::openClient(const BLEPeerAddress &address, bool requireEncryption)
+{
+  // Create client
+  if (pClient)
+  {
+    delete pClient;
+  }
+  pClient = BLEDevice::createClient();
+  pInputReportCharacteristic = nullptr;
+  pReportMapCharacteristic = nullptr;
+  resumed = false;
+  clearHandles();
+
+  // Set security callbacks
+  BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT);
+  BLEDevice::setSecurityCallbacks(&securityCallbacks);
+
+  // Connect to the server
+  authState.store(-1);
+  acceptedKnown.store(false);
+  esp_bd_addr_t native;
+  memcpy(native, address.bytes, sizeof(native));
+  peer = address;
+
+  // Open the connection with the requested timing right away; the update
+  // after connecting covers peers that renegotiate
+  if (hasPreferredParams)
+  {
+    esp_ble_gap_set_prefer_conn_params(native, preferredParams.minInterval, preferredParams.maxInterval,
+                                       preferredParams.latency, preferredParams.timeout);
+  }
+  if (!pClient->connect(BLEAddress(native)))
+  {
+    return false;
+  }
+
+  // Wait for pairing (first contact) or encryption with the stored LTK
+  // (bonded peer) instead of sleeping for a fixed time
+  if (waitForAuthentication(AUTH_TIMEOUT_MS))
+  {
+    LOG_INFO("Connected securely!");
+  }
+  else if (requireEncryption)
+  {
+    LOG_WARN("Bonded peer did not restore encryption");
+    pClient->disconnect();
+    return false;
+  }
+  else
+  {
+    LOG_INFO("Connected!");
+  }
+
+  // Set MTU size (important for HID)
+  pClient->setMTU(517);
+  return true;
+}
+
+bool ESP32BLETransport::connect(const BLEPeerAddress &address)
+{
+  return openClient(address, false);
+}
+
+bool ESP32BLETransport::discover()
+{
+  LOG_INFO("Looking for HID service...");
+
+  // Get HID service
+  BLERemoteService *pRemoteService = pClient->getService(BLEUUID(XBOX_SERVICE_UUID));
+  if (pRemoteService == nullptr)
+  {
+    LOG_ERROR("Failed to find HID service!");
+    return false;
+  }
+
+  // Get all characteristics
+  std::map<std::string, BLERemoteCharacteristic *> *pCharacteristics =
+      pRemoteService->getCharacteristics();
+
+  // Store references to important characteristics
+  BLERemoteCharacteristic *pHIDControlPoint = nullptr;
+  BLERemoteCharacteristic *pProtocolMode = nullptr;
+  BLERemoteCharacteristic *pHIDInfo = nullptr;
+  BLERemoteCharacteristic *pReportMap = nullptr;
+
+  // Look for all HID characteristics
+  int reportCount = 0;
+
+  for (auto &pair : *pCharacteristics)
+  {
+    BLERemoteCharacteristic *pChar = pair.second;
+    std::string uuid = pChar->getUUID().toString();
+
+    // 0x2A4E is Protocol Mode
+    if (uuid == "00002a4e-0000-1000-8000-00805f9b34fb")
+    {
+      pProtocolMode = pChar;
+    }
+    // 0x2A4A is HID Information
+    else if (uuid == "00002a4a-0000-1000-8000-00805f9b34fb")
+    {
+      pHIDInfo = pChar;
+    }
+    // 0x2A4B is Report Map
+    else if (uuid == "00002a4b-0000-1000-8000-00805f9b34fb")
+    {
+      pReportMap = pChar;
+    }
+    // 0x2A4C is HID Control Point
+    else if (uuid == "00002a4c-0000-1000-8000-00805f9b34fb")
+    {
+      pHIDControlPoint = pChar;
+    }
+    // 0x2A4D is HID Report
+    else if (pChar->getUUID().equals(BLEUUID(XBOX_REPORT_UUID)))
+    {
+      reportCount++;
+
+      if (pChar->canNotify())
+      {
+
+        pInputReportCharacteristic = pChar;
+      }
+    }
+  }
+
+  if (pInputReportCharacteristic == nullptr)
+  {
+    LOG_ERROR("Failed to find notifiable HID Report characteristic!");
+    return false;
+  }
+  pReportMapCharacteristic = pReportMap;
+  inputReportHandle = pInputReportCharacteristic->getHandle();
+  reportMapHandle = pReportMap ? pReportMap->getHandle() : 0;
+  protocolModeHandle = pProtocolMode ? pProtocolMode->getHandle() : 0;
+  controlPointHandle = pHIDControlPoint ? pHIDControlPoint->getHandle() : 0;
+
+  // CRITICAL: Get the Client Characteristic Configuration Descriptor (CCCD)
+  // and manually enable notifications - sometimes registerForNotify isn't enough
+  BLERemoteDescriptor *pCCCD = pInputReportCharacteristic->getDescriptor(BLEUUID((uint16_t)0x2902));
+  if (pCCCD != nullptr)
+  {
+    inputCccdHandle = pCCCD->getHandle();
+    uint8_t notificationOn[] = {0x01, 0x00}; // Enable notifications
+    try
+    {
+      pCCCD->writeValue(notificationOn, 2, true);
+    }
+    catch (...)
+    {
+      LOG_ERROR("Failed to write CCCD");
+    }
+  }
+  else
+  {
+    LOG_WARN("CCCD not found!");
+  }
+
+  // Set Protocol Mode to Report Protocol (0x01)
+  // This is crucial - Report Protocol enables input reports
+  if (pProtocolMode != nullptr && pProtocolMode->canWrite())
+  {
+    uint8_t reportProtocol = 0x01; // 0=Boot Protocol, 1=Report Protocol
+    try
+    {
+      // With response: returns once the peer has applied it
+      pProtocolMode->writeValue(&reportProtocol, 1, true);
+      LOG_DEBUG("Protocol Mode set successfully");
+    }
+    catch (...)
+    {
+      LOG_ERROR("Failed to set Protocol Mode");
+    }
+  }
+  else
+  {
+    LOG_WARN("Protocol Mode characteristic not found or not writable!");
+  }
+
+  // Exit suspend mode
+  if (pHIDControlPoint != nullptr && pHIDControlPoint->canWriteNoResponse())
+  {
+    LOG_DEBUG("Sending exit suspend command...");
+    uint8_t exitSuspend = 0x00;
+    try
+    {
+      pHIDControlPoint->writeValue(&exitSuspend, 1, false); // without response
+      LOG_DEBUG("Exit suspend sent");
+    }
+    catch (...)
+    {
+      LOG_ERROR("Failed to send exit suspend");
+    }
+  }
+
+  return true;
+}
+
+size_t ESP32BLETransport::readReportMap(uint8_t *buffer, size_t capacity, uint8_t &reportId)
+{
+  if (resumed)
+  {
+    // No characteristic objects after a resume; read the map by handle
+    reportId = this->reportId;
+    return readHandle(reportMapHandle, buffer, capacity);
+  }
+
+  reportId = 0;
+  if (pInputReportCharacteristic == nullptr || pReportMapCharacteristic == nullptr ||
+      !pReportMapCharacteristic->canRead())
+  {
+    return 0;
+  }
+
+  // 0x2908 is Report Reference: [report ID, report type]
+  BLERemoteDescriptor *pReference = pInputReportCharacteristic->getDescriptor(BLEUUID((uint16_t)0x2908));
+  if (pReference != nullptr)
+  {
+    std::string reference = pReference->readValue();
+    if (reference.length() >= 1)
+    {
+      reportId = (uint8_t)reference[0];
+    }
+  }
+  this->reportId = reportId;
+
+  std::string reportMap = pReportMapCharacteristic->readValue();
+  size_t length = reportMap.length() < capacity ? reportMap.length() : capacity;
+  memcpy(buffer, reportMap.data(), length);
+  return length;
+}
+
+bool ESP32BLETransport::subscribe(NotifyCallback callback, void *context)
+{
+  if (pInputReportCharacteristic == nullptr && !resumed)
+  {
+    return false;
+  }
+
+  // Register for notifications
+  if (!resumed && !pInputReportCharacteristic->canNotify())
+  {
+    LOG_ERROR("Characteristic cannot notify!");
+    return false;
+  }
+
+  // Claim a slot for this subscription; disconnect() gives it back
+  if (notifySlot == NotificationDispatch::NO_SLOT)
+  {
+    notifySlot = notificationTable.acquire();
+    if (notifySlot == NotificationDispatch::NO_SLOT)
+    {
+      LOG_ERROR("No free notification slot!");
+      return false;
+    }
+  }
+  notificationTable.bind(notifySlot, callback, context);
+
+  if (resumed)
+  {
+    // resume() already enabled the CCCD; gattcEventHandler routes by handle
+    resumedRoutes[notifySlot].store(routeKey(inputReportHandle), std::memory_order_release);
+    LOG_INFO("Subscribed to notifications!");
+    return true;
+  }
+
+  // The callback captures only the slot index, which fits in std::function's
+  // inline storage, so registering does not allocate
+  uint8_t slot = (uint8_t)notifySlot;
+  pInputReportCharacteristic->registerForNotify(
+      [slot](BLERemoteCharacteristic *pCharacteristic, uint8_t *pData, size_t length, bool isNotify)
+      {
+        notificationTable.dispatch(slot, pData, length);
+      });
+
+  LOG_INFO("Subscribed to notifications!");
+  return true;
+}
+
+bool ESP32BLETransport::getPeerCache(BLEPeerCache &cache)
+{
+  // Without these two a resume cannot re-enable notifications
+  if (!isConnected() || inputReportHandle == 0 || inputCccdHandle == 0)
+  {
+    return false;
+  }
+  memset(&cache, 0, sizeof(cache));
+  cache.address = peer;
+  cache.bonded = authState.load() == 1;
+  cache.reportId = reportId;
+  cache.inputReportHandle = inputReportHandle;
+  cache.inputCccdHandle = inputCccdHandle;
+  cache.reportMapHandle = reportMapHandle;
+  cache.protocolModeHandle = protocolModeHandle;
+  cache.controlPointHandle = controlPointHandle;
+  return true;
+}
+
+bool ESP32BLETransport::resume(const BLEPeerCache &cache)
+{
+  if (!cache.bonded || cache.inputReportHandle == 0 || cache.inputCccdHandle == 0)
+  {
+    return false;
+  }
+  if (!openClient(cache.address, true))
+  {
+    return false;
+  }
+
+  // Skip service discovery: register and enable notifications by handle.
+  // A rejected CCCD write means the peer's GATT table changed
+  esp_bd_addr_t native;
+  memcpy(native, peer.bytes, sizeof(native));
+  esp_ble_gattc_register_for_notify(pClient->getGattcIf(), native, cache.inputReportHandle);
+  uint8_t notificationOn[] = {0x01, 0x00};
+  if (!writeHandle(cache.inputCccdHandle, notificationOn, sizeof(notificationOn), true, true))
+  {
+    LOG_WARN("Cached CCCD handle rejected");
+    disconnect();
+    return false;
+  }
+
+  uint8_t reportProtocol = 0x01;
+  if (!writeHandle(cache.protocolModeHandle, &reportProtocol, 1, false, true))
+  {
+    LOG_DEBUG("Protocol Mode not set on resume");
+  }
+  uint8_t exitSuspend = 0x00;
+  writeHandle(cache.controlPointHandle, &exitSuspend, 1, false, false);
+
+  reportId = cache.reportId;
+  inputReportHandle = cache.inputReportHandle;
+  inputCccdHandle = cache.inputCccdHandle;
+  reportMapHandle = cache.reportMapHandle;
+  protocolModeHandle = cache.protocolModeHandle;
+  controlPointHandle = cache.controlPointHandle;
+  resumed = true;
+  return true;
+}
+
+void ESP32BLETransport::disconnect()
+{
+  // Stop routing first; waits for a notification being delivered right now
+  if (notifySlot != NotificationDispatch::NO_SLOT)
+  {
+    resumedRoutes[notifySlot].store(0, std::memory_order_release);
+    notificationTable.release(notifySlot);
+    notifySlot = NotificationDispatch::NO_SLOT;
+  }
+  if (pClient && pClient->isConnected())
+  {
+    pClient->disconnect();
+  }
+  pInputReportCharacteristic = nullptr;
+  pReportMapCharacteristic = nullptr;
+  resumed = false;
+}
+
+bool ESP32BLETransport::isConnected()
+{
+  return pClient && pClient->isConnected();
+}
+
+bool ESP32BLETransport::readRssi(int8_t &rssi)
+{
+  if (!isConnected())
+  {
+    return false;
+  }
+  // Not BLEClient::getRssi(): it waits without a timeout for an event the
+  // library only hands to the most recently created client, so with two
+  // sessions the first one would never get its answer. The reply is
+  // matched to this peer in gapEventHandler instead.
+  esp_bd_addr_t native;
+  memcpy(native, peer.bytes, sizeof(native));
+  rssiState.store(-1);
+  if (esp_ble_gap_read_rssi(native) != ESP_OK)
+  {
+    rssiState.store(0);
+    return false;
+  }
+
+  uint32_t start = millis();
+  while (rssiState.load() == -1 && millis() - start < RSSI_TIMEOUT_MS)
+  {
+    delay(1);
+  }
+  // A late reply is dropped rather than taken for the next read
+  int8_t expected = -1;
+  if (rssiState.compare_exchange_strong(expected, 0))
+  {
+    LOG_DEBUG("RSSI read timed out");
+    return false;
+  }
+  if (rssiState.load() != 1)
+  {
+    return false;
+  }
+  rssi = rssiValue.load();
+  return true;
+}
+
+bool ESP32BLETransport::requestConnectionParams(const BLEConnectionParams &params)
+{
+  preferredParams = params;
+  hasPreferredParams = true;
+  if (!isConnected())
+  {
+    return false;
+  }
+
+  esp_ble_conn_update_params_t update;
+  memcpy(update.bda, peer.bytes, sizeof(update.bda));
+  update.min_int = params.minInterval;
+  update.max_int = params.maxInterval;
+  update.latency = params.latency;
+  update.timeout = params.timeout;
+  return esp_ble_gap_update_conn_params(&update) == ESP_OK;
+}
+
+bool ESP32BLETransport::getConnectionParams(BLEConnectionParams &params)
+{
+  if (!acceptedKnown.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  params = acceptedParams.read();
+  return true;
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,139 @@
+#ifndef ESP32_BLE_TRANSPORT_H
+#define ESP32_BLE_TRANSPORT_H
+
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BLEUtils.h>
+
+#include <atomic>
+
+#include "BLETransport.h"
+#include "NotificationDispatch.h"
+#include "SeqLock.h"
+
+// Xbox Controller BLE Service UUIDs (standard for Xbox One S/X/Series controllers)
+#define XBOX_SERVICE_UUID "00001812-0000-1000-8000-00805f9b34fb"    // HID Service
+#define XBOX_REPORT_UUID "00002a4d-0000-1000-8000-00805f9b34fb"     // HID Report
+#define XBOX_REPORT_MAP_UUID "00002a4b-0000-1000-8000-00805f9b34fb" // HID Report Map
+
+// Simple security callbacks implementation
+class XboxSecurityCallbacks : public BLESecurityCallbacks
+{
+  uint32_t onPassKeyRequest()
+  {
+
+    return 123456;
+  }
+
+  void onPassKeyNotify(uint32_t pass_key)
+  {
+  }
+
+  bool onConfirmPIN(uint32_t pass_key)
+  {
+    return true;
+  }
+
+  bool onSecurityRequest()
+  {
+
+    return true;
+  }
+
+  void onAuthenticationComplete(esp_ble_auth_cmpl_t cmpl);
+};
+
+// BLETransport backed by the ESP32 Arduino BLE library (Bluedroid)
+class ESP32BLETransport : public BLETransport
+{
+public:
+  ESP32BLETransport();
+  ~ESP32BLETransport();
+
+  bool begin();
+  bool scan(uint32_t durationMs, const BLEScanProfile &profile, ScanCallback callback, void *context);
+  bool connect(const BLEPeerAddress &address);
+  bool discover();
+  size_t readReportMap(uint8_t *buffer, size_t capacity, uint8_t &reportId);
+  bool subscribe(NotifyCallback callback, void *context);
+  bool getPeerCache(BLEPeerCache &cache);
+  bool resume(const BLEPeerCache &cache);
+  void disconnect();
+  bool isConnected();
+  bool readRssi(int8_t &rssi);
+  bool requestConnectionParams(const BLEConnectionParams &params);
+  bool getConnectionParams(BLEConnectionParams &params);
+
+  // Pairing/encryption result, reported by the security callbacks
+  static void authenticationComplete(bool success);
+
+private:
+  BLEClient *pClient;
+  BLERemoteCharacteristic *pInputReportCharacteristic;
+  BLERemoteCharacteristic *pReportMapCharacteristic;
+  BLEPeerAddress peer;
+
+  // GATT layout of the current peer (discovered or restored from a cache)
+  uint8_t reportId;
+  uint16_t inputReportHandle;
+  uint16_t inputCccdHandle;
+  uint16_t reportMapHandle;
+  uint16_t protocolModeHandle;
+  uint16_t controlPointHandle;
+
+  // Handles were restored by resume(): the BLE library has no characteristic
+  // objects, so notifications are routed by handle from gattcEventHandler
+  bool resumed;
+
+  // Requested timing, applied before every connect once set
+  BLEConnectionParams preferredParams;
+  bool hasPreferredParams;
+
+  // Timing the stack reported for the current connection (GAP task writes)
+  SeqLock<BLEConnectionParams> acceptedParams;
+  std::atomic<bool> acceptedKnown;
+
+  // Read-RSSI in flight: -1 while pending, then 0 (failed) or 1 (rssiValue set)
+  std::atomic<int8_t> rssiState;
+  std::atomic<int8_t> rssiValue;
+
+  bool openClient(const BLEPeerAddress &address, bool requireEncryption);
+  bool waitForAuthentication(uint32_t timeoutMs);
+  bool writeHandle(uint16_t handle, const uint8_t *data, size_t length, bool descriptor, bool withResponse);
+  size_t readHandle(uint16_t handle, uint8_t *buffer, size_t capacity);
+  void clearHandles();
+  uint32_t routeKey(uint16_t handle) const;
+
+  static void gattcEventHandler(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t *param);
+  static void gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+  static void handleConnectionUpdate(const esp_ble_gap_cb_param_t::ble_update_conn_params_evt_param &update);
+  static void handleScanResult(const esp_ble_gap_cb_param_t::ble_scan_result_evt_param &result);
+  static void handleReadRssi(const esp_ble_gap_cb_param_t::ble_read_rssi_cmpl_evt_param &result);
+  static void parseAdvertisement(const uint8_t *data, size_t length, BLEAdvertisement &advertisement);
+  static uint16_t msToScanUnits(uint16_t ms);
+
+  // Scan in progress, called from gapEventHandler on the BLE task
+  static ScanCallback scanCallback;
+  static void *scanContext;
+  static std::atomic<bool> scanActive;
+  static std::atomic<bool> scanMatched;
+  static std::atomic<bool> scanStopped;
+
+  // Every live transport, so GAP events can be matched to a peer
+  static ESP32BLETransport *instances[NotificationDispatch::MAX_SLOTS];
+
+  // Slot in the shared notification table, NO_SLOT when not subscribed
+  int8_t notifySlot;
+
+  // Routes notifications of every transport instance, one slot each
+  static NotificationDispatch notificationTable;
+
+  // Per slot: (gattc_if, conn_id, handle) of a resumed subscription, 0 if none
+  static std::atomic<uint32_t> resumedRoutes[NotificationDispatch::MAX_SLOTS];
+};
+
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // ESP32_BLE_TRANSPORT_H
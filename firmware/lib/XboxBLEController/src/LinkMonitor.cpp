@@ -0,0 +1,101 @@
+#include "LinkMonitor.h"
+
+#include <string.h>
+
+LinkMonitor::LinkMonitor(const XboxBLEController &controller, const Config &config)
+    : controller(controller),
+      config(config),
+      staleHandler(nullptr),
+      staleContext(nullptr),
+      scaleQ15(0),
+      lastUpdateMs(0),
+      started(false),
+      windowStartMs(0),
+      windowStartTotal(0)
+{
+  memset(&metrics, 0, sizeof(metrics));
+  // Nothing has been heard yet: start stale, ramp up on the first reports
+  metrics.stale = true;
+}
+
+void LinkMonitor::setStaleHandler(StaleHandler handler, void *context)
+{
+  staleHandler = handler;
+  staleContext = context;
+}
+
+const LinkMonitor::Metrics &LinkMonitor::update(uint32_t nowMs)
+{
+  uint32_t elapsedMs = started ? nowMs - lastUpdateMs : 0;
+  lastUpdateMs = nowMs;
+
+  XboxBLEController::ReportStats stats = controller.getReportStats();
+  XboxBLEController::ControllerState state = controller.snapshot();
+  bool connected = controller.isConnected();
+
+  updateRate(nowMs, stats.total);
+  started = true;
+  metrics.jitterUs = stats.jitterUs;
+  metrics.rssiDbm = controller.getRssi();
+
+  // A report can land between reading nowMs and the snapshot
+  int32_t age = (int32_t)(nowMs - state.lastUpdateTime);
+  metrics.ageMs = connected && age > 0 ? (uint32_t)age : 0;
+
+  bool stale = !connected || metrics.ageMs > config.staleAfterMs;
+  if (stale != metrics.stale)
+  {
+    metrics.stale = stale;
+    if (stale)
+    {
+      metrics.staleEvents++;
+      LOG_WARN("Input stale after %u ms", metrics.ageMs);
+    }
+    if (staleHandler)
+    {
+      staleHandler(staleContext, stale);
+    }
+  }
+
+  metrics.degraded = !stale && ((config.minRateHz != 0 && metrics.rateHz < config.minRateHz) ||
+                                (config.maxJitterUs != 0 && metrics.jitterUs > config.maxJitterUs) ||
+                                (config.minRssiDbm != 0 && metrics.rssiDbm != 0 &&
+                                 metrics.rssiDbm < config.minRssiDbm));
+
+  updateScale(elapsedMs);
+  return metrics;
+}
+
+void LinkMonitor::updateRate(uint32_t nowMs, uint32_t total)
+{
+  if (!started)
+  {
+    windowStartMs = nowMs;
+    windowStartTotal = total;
+    return;
+  }
+
+  uint32_t windowMs = nowMs - windowStartMs;
+  if (windowMs >= config.rateWindowMs && windowMs > 0)
+  {
+    metrics.rateHz = (uint16_t)((uint64_t)(total - windowStartTotal) * 1000 / windowMs);
+    windowStartMs = nowMs;
+    windowStartTotal = total;
+  }
+}
+
+void LinkMonitor::updateScale(uint32_t elapsedMs)
+{
+  int32_t target = metrics.stale ? 0 : FULL_SCALE;
+  if (config.rampDownMs == 0)
+  {
+    scaleQ15 = target;
+    return;
+  }
+
+  int32_t step = (int32_t)((uint64_t)FULL_SCALE * elapsedMs / config.rampDownMs);
+  if (scaleQ15 < target)
+    scaleQ15 = scaleQ15 + step < target ? scaleQ15 + step : target;
+  else if (scaleQ15 > target)
+    scaleQ15 = scaleQ15 - step > target ? scaleQ15 - step : target;
+}
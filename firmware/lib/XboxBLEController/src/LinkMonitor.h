@@ -0,0 +1,87 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <stdint.h>
+
+#include "XboxBLEController.h"
+
+// Link quality of one controller session, evaluated from the control loop.
+//
+// A connected but starved link looks healthy to isConnected() while the
+// rover keeps following the last report. update() reads the session's
+// lock-free counters and snapshot and derives:
+//   - age of the input (time since lastUpdateTime), notification rate over
+//     rateWindowMs, inter-arrival jitter and the last RSSI read by step()
+//   - stale: disconnected, or no report for staleAfterMs. Entering it calls
+//     the stale handler once; so does leaving it.
+//   - degraded: connected and fresh, but below minRateHz, above maxJitterUs
+//     or under minRssiDbm. Informational only.
+//   - the failsafe scale: full while fresh, falling linearly to zero over
+//     rampDownMs once stale (and climbing back at the same rate after), so
+//     the motors are at rest at most staleAfterMs + rampDownMs plus one
+//     control period after the last report
+class LinkMonitor
+{
+public:
+  // Called from update() when the stale state changes. Must not block.
+  typedef void (*StaleHandler)(void *context, bool stale);
+
+  struct Config
+  {
+    uint32_t staleAfterMs; // input older than this is stale
+    uint32_t rampDownMs;   // failsafe scale from full to zero
+    uint16_t minRateHz;    // 0 = no rate check
+    uint32_t maxJitterUs;  // 0 = no jitter check
+    int8_t minRssiDbm;     // 0 = no RSSI check
+    uint32_t rateWindowMs; // rate measurement window
+  };
+
+  struct Metrics
+  {
+    uint32_t ageMs;       // since the last report, 0 while disconnected
+    uint16_t rateHz;      // notifications per second over the last window
+    uint32_t jitterUs;    // smoothed inter-arrival deviation
+    int8_t rssiDbm;       // 0 = unknown
+    bool stale;
+    bool degraded;
+    uint32_t staleEvents; // times the link went stale
+  };
+
+  static const int16_t FULL_SCALE = 32767;
+
+  LinkMonitor(const XboxBLEController &controller, const Config &config);
+
+  void setStaleHandler(StaleHandler handler, void *context);
+
+  // Evaluate the link; call once per control tick
+  const Metrics &update(uint32_t nowMs);
+
+  const Metrics &getMetrics() const { return metrics; }
+  bool isStale() const { return metrics.stale; }
+
+  // Failsafe factor for the motor commands, Q15
+  int16_t getScaleQ15() const { return (int16_t)scaleQ15; }
+
+  // Scale a Q15 motor command by the failsafe factor
+  int16_t apply(int16_t commandQ15) const { return (int16_t)(((int32_t)commandQ15 * scaleQ15) >> 15); }
+
+  void setConfig(const Config &newConfig) { config = newConfig; }
+  const Config &getConfig() const { return config; }
+
+private:
+  const XboxBLEController &controller;
+  Config config;
+  Metrics metrics;
+  StaleHandler staleHandler;
+  void *staleContext;
+  int32_t scaleQ15;
+  uint32_t lastUpdateMs;
+  bool started;
+  uint32_t windowStartMs;
+  uint32_t windowStartTotal;
+
+  void updateRate(uint32_t nowMs, uint32_t total);
+  void updateScale(uint32_t elapsedMs);
+};
+
+#endif // LINK_MONITOR_H
@@ -0,0 +1,107 @@
+#include "NotificationDispatch.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <thread>
+#endif
+
+NotificationDispatch::NotificationDispatch()
+    : unrouted(0)
+{
+  for (uint8_t i = 0; i < MAX_SLOTS; i++)
+  {
+    slots[i].used.store(false);
+    slots[i].callback.store(nullptr);
+    slots[i].context.store(nullptr);
+    slots[i].inFlight.store(0);
+  }
+}
+
+int8_t NotificationDispatch::acquire()
+{
+  for (uint8_t i = 0; i < MAX_SLOTS; i++)
+  {
+    bool expected = false;
+    if (!slots[i].used.load(std::memory_order_relaxed) &&
+        slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+    {
+      return (int8_t)i;
+    }
+  }
+  return NO_SLOT;
+}
+
+bool NotificationDispatch::bind(int8_t slot, Callback callback, void *context)
+{
+  if (slot < 0 || slot >= MAX_SLOTS || !slots[slot].used.load(std::memory_order_relaxed))
+  {
+    return false;
+  }
+
+  // Context first: a dispatch that sees the callback also sees its context
+  slots[slot].context.store(context, std::memory_order_relaxed);
+  slots[slot].callback.store(callback, std::memory_order_release);
+  return true;
+}
+
+void NotificationDispatch::release(int8_t slot)
+{
+  if (slot < 0 || slot >= MAX_SLOTS)
+  {
+    return;
+  }
+
+  Slot &entry = slots[slot];
+  entry.callback.store(nullptr);
+
+  // dispatch() raises inFlight before loading the callback (both seq_cst), so
+  // once the count is seen at zero no dispatch can still be using the binding
+  while (entry.inFlight.load() != 0)
+  {
+#ifdef ARDUINO
+    delay(1);
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  entry.context.store(nullptr, std::memory_order_relaxed);
+  entry.used.store(false, std::memory_order_release);
+}
+
+bool NotificationDispatch::dispatch(uint8_t slot, const uint8_t *data, size_t length)
+{
+  if (slot >= MAX_SLOTS)
+  {
+    unrouted.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  Slot &entry = slots[slot];
+  entry.inFlight.fetch_add(1);
+  Callback callback = entry.callback.load();
+  bool routed = callback != nullptr;
+  if (routed)
+  {
+    callback(entry.context.load(std::memory_order_relaxed), data, length);
+  }
+  entry.inFlight.fetch_sub(1, std::memory_order_release);
+
+  if (!routed)
+  {
+    unrouted.fetch_add(1, std::memory_order_relaxed);
+  }
+  return routed;
+}
+
+uint8_t NotificationDispatch::getUsedCount() const
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < MAX_SLOTS; i++)
+  {
+    if (slots[i].used.load(std::memory_order_relaxed))
+      count++;
+  }
+  return count;
+}
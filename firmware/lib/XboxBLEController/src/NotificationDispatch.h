@@ -0,0 +1,58 @@
+#ifndef NOTIFICATION_DISPATCH_H
+#define NOTIFICATION_DISPATCH_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-capacity table routing BLE notifications to their subscriber.
+//
+// A subscriber acquires a slot once and binds its callback to it; the BLE
+// stack's per-characteristic callback captures only the slot index, so each
+// notification is an array index plus an indirect call, with no lookup and
+// no heap allocation on subscribe, notify or disconnect.
+//
+// release() unbinds the slot and waits until any dispatch already running on
+// another task has returned, so the subscriber's context can be destroyed as
+// soon as it returns. It must not be called from inside the callback.
+class NotificationDispatch
+{
+public:
+  typedef void (*Callback)(void *context, const uint8_t *data, size_t length);
+
+  static const uint8_t MAX_SLOTS = 4;
+  static const int8_t NO_SLOT = -1;
+
+  NotificationDispatch();
+
+  // Reserve a free slot; NO_SLOT when the table is full
+  int8_t acquire();
+
+  // Route the slot's notifications to callback(context, ...)
+  bool bind(int8_t slot, Callback callback, void *context);
+
+  // Stop routing and wait out in-flight dispatches, then free the slot
+  void release(int8_t slot);
+
+  // Deliver one notification; false if the slot is unbound
+  bool dispatch(uint8_t slot, const uint8_t *data, size_t length);
+
+  // Notifications that arrived on an unbound slot (late or after disconnect)
+  uint32_t getUnroutedCount() const { return unrouted.load(std::memory_order_relaxed); }
+
+  uint8_t getUsedCount() const;
+
+private:
+  struct Slot
+  {
+    std::atomic<bool> used;
+    std::atomic<Callback> callback;
+    std::atomic<void *> context;
+    std::atomic<uint32_t> inFlight;
+  };
+
+  Slot slots[MAX_SLOTS];
+  std::atomic<uint32_t> unrouted;
+};
+
+#endif // NOTIFICATION_DISPATCH_H
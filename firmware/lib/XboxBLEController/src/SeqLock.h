@@ -0,0 +1,85 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Single-writer, multi-reader sequence lock for small trivially copyable values.
+//
+// The writer bumps the sequence to an odd value, stores the payload and bumps
+// it back to even. Readers copy the payload and retry if the sequence changed
+// underneath them, so they never block the writer and never see a torn value.
+// The payload is held as relaxed atomic words so the concurrent copy is not a
+// data race; on 32-bit targets these compile to plain loads and stores.
+template <typename T>
+class SeqLock
+{
+public:
+  SeqLock() : sequence(0), retries(0)
+  {
+    for (size_t i = 0; i < WORDS; i++)
+    {
+      words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Publish a new value. Must only be called from one context at a time.
+  void write(const T &value)
+  {
+    uint32_t buffer[WORDS];
+    memcpy(buffer, &value, sizeof(T));
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++)
+    {
+      words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  // Return a consistent copy of the last published value.
+  T read() const
+  {
+    uint32_t buffer[WORDS];
+    while (true)
+    {
+      uint32_t before = sequence.load(std::memory_order_acquire);
+      if ((before & 1) == 0)
+      {
+        for (size_t i = 0; i < WORDS; i++)
+        {
+          buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+        {
+          break;
+        }
+      }
+      retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    T value;
+    memcpy(&value, buffer, sizeof(T));
+    return value;
+  }
+
+  // Number of times a reader had to retry because a write was in progress
+  uint32_t retryCount() const { return retries.load(std::memory_order_relaxed); }
+
+  // Number of values published so far
+  uint32_t writeCount() const { return sequence.load(std::memory_order_relaxed) / 2; }
+
+private:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> words[WORDS];
+  mutable std::atomic<uint32_t> retries;
+};
+
+#endif // SEQ_LOCK_H
@@ -0,0 +1,374 @@
+#ifndef ARDUINO
+
+#include "SimulatedBLETransport.h"
+
+#include <chrono>
+
+static int64_t steadyNowUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+SimulatedBLETransport::SimulatedBLETransport()
+    : reportMapId(0),
+      failConnect(false),
+      failDiscover(false),
+      scanCount(0),
+      advertisementCount(0),
+      connectCount(0),
+      discoverCount(0),
+      resumeCount(0),
+      handleOffset(0),
+      discovered(false),
+      peerMinInterval(6),
+      failConnectionUpdate(false),
+      connectionUpdateCount(0),
+      hasPreferredParams(false),
+      acceptedKnown(false),
+      connected(false),
+      subscribed(false),
+      notifyCallback(nullptr),
+      notifyContext(nullptr),
+      reportLength(0),
+      generator(nullptr),
+      generatorContext(nullptr),
+      streaming(false),
+      emitted(0),
+      withheld(0),
+      dropoutUntilUs(0),
+      rssi(-60)
+{
+  memset(report, 0, sizeof(report));
+  memset(&peer, 0, sizeof(peer));
+  memset(&lastScanProfile, 0, sizeof(lastScanProfile));
+  memset(&preferredParams, 0, sizeof(preferredParams));
+  memset(&acceptedParams, 0, sizeof(acceptedParams));
+}
+
+SimulatedBLETransport::~SimulatedBLETransport()
+{
+  stopStreaming();
+  disconnect();
+}
+
+void SimulatedBLETransport::addPeripheral(const BLEAdvertisement &advertisement, uint32_t firstSeenMs)
+{
+  Peripheral peripheral = {advertisement, firstSeenMs};
+  std::vector<Peripheral>::iterator it = peripherals.begin();
+  while (it != peripherals.end() && it->firstSeenMs <= firstSeenMs)
+  {
+    ++it;
+  }
+  peripherals.insert(it, peripheral);
+}
+
+void SimulatedBLETransport::setReport(const uint8_t *data, size_t length)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  reportLength = length < MAX_REPORT_SIZE ? length : MAX_REPORT_SIZE;
+  memcpy(report, data, reportLength);
+}
+
+void SimulatedBLETransport::setReportGenerator(ReportGenerator newGenerator, void *context)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  generator = newGenerator;
+  generatorContext = context;
+}
+
+void SimulatedBLETransport::setReportMap(const uint8_t *descriptor, size_t length, uint8_t reportId)
+{
+  reportMap.assign(descriptor, descriptor + length);
+  reportMapId = reportId;
+}
+
+void SimulatedBLETransport::dropLink()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  connected.store(false);
+  subscribed.store(false);
+}
+
+bool SimulatedBLETransport::emit(const uint8_t *data, size_t length)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!subscribed.load())
+  {
+    return false;
+  }
+  notifyCallback(notifyContext, data, length);
+  emitted.fetch_add(1);
+  return true;
+}
+
+bool SimulatedBLETransport::startStreaming(const StreamConfig &config)
+{
+  if (streaming.load() || config.rateHz == 0 || config.rateHz > 1000 || config.burstLength == 0)
+  {
+    return false;
+  }
+  if (streamThread.joinable())
+  {
+    streamThread.join();
+  }
+  streaming.store(true);
+  streamThread = std::thread(&SimulatedBLETransport::streamLoop, this, config);
+  return true;
+}
+
+void SimulatedBLETransport::stopStreaming()
+{
+  streaming.store(false);
+  waitForStreamEnd();
+}
+
+void SimulatedBLETransport::waitForStreamEnd()
+{
+  if (streamThread.joinable())
+  {
+    streamThread.join();
+  }
+}
+
+bool SimulatedBLETransport::begin()
+{
+  return true;
+}
+
+bool SimulatedBLETransport::scan(uint32_t durationMs, const BLEScanProfile &profile, ScanCallback callback,
+                                 void *context)
+{
+  scanCount++;
+  lastScanProfile = profile;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < peripherals.size() && peripherals[i].firstSeenMs < durationMs; i++)
+  {
+    std::this_thread::sleep_until(start + std::chrono::milliseconds(peripherals[i].firstSeenMs));
+    advertisementCount++;
+    if (callback(context, peripherals[i].advertisement))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SimulatedBLETransport::connect(const BLEPeerAddress &address)
+{
+  connectCount++;
+  if (failConnect)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < peripherals.size(); i++)
+  {
+    if (peripherals[i].advertisement.address == address)
+    {
+      peer = address;
+      discovered = false;
+      connected.store(true);
+      // Opened with the preferred timing, like the ESP32 stack
+      acceptedKnown = false;
+      if (hasPreferredParams)
+        negotiate(preferredParams);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SimulatedBLETransport::discover()
+{
+  discoverCount++;
+  discovered = connected.load() && !failDiscover;
+  return discovered;
+}
+
+size_t SimulatedBLETransport::readReportMap(uint8_t *buffer, size_t capacity, uint8_t &reportId)
+{
+  reportId = reportMapId;
+  if (!connected.load())
+  {
+    return 0;
+  }
+  size_t length = reportMap.size() < capacity ? reportMap.size() : capacity;
+  if (length > 0)
+  {
+    memcpy(buffer, &reportMap[0], length);
+  }
+  return length;
+}
+
+bool SimulatedBLETransport::subscribe(NotifyCallback callback, void *context)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!connected.load())
+  {
+    return false;
+  }
+  notifyCallback = callback;
+  notifyContext = context;
+  subscribed.store(true);
+  return true;
+}
+
+void SimulatedBLETransport::fillHandles(BLEPeerCache &cache) const
+{
+  // Fixed layout of the simulated HID service
+  cache.inputReportHandle = 0x0021 + handleOffset;
+  cache.inputCccdHandle = 0x0022 + handleOffset;
+  cache.reportMapHandle = 0x001E + handleOffset;
+  cache.protocolModeHandle = 0x0019 + handleOffset;
+  cache.controlPointHandle = 0x001C + handleOffset;
+}
+
+bool SimulatedBLETransport::getPeerCache(BLEPeerCache &cache)
+{
+  if (!connected.load() || !discovered)
+  {
+    return false;
+  }
+  memset(&cache, 0, sizeof(cache));
+  cache.address = peer;
+  cache.bonded = true;
+  cache.reportId = reportMapId;
+  fillHandles(cache);
+  return true;
+}
+
+bool SimulatedBLETransport::resume(const BLEPeerCache &cache)
+{
+  resumeCount++;
+  if (!connect(cache.address))
+  {
+    return false;
+  }
+
+  // Writing the CCCD through a stale handle fails on a real peer
+  BLEPeerCache current;
+  fillHandles(current);
+  if (cache.inputReportHandle != current.inputReportHandle ||
+      cache.inputCccdHandle != current.inputCccdHandle)
+  {
+    disconnect();
+    return false;
+  }
+  discovered = true;
+  return true;
+}
+
+void SimulatedBLETransport::disconnect()
+{
+  // Taking the lock waits out a delivery in progress on the stream thread
+  std::lock_guard<std::mutex> lock(mutex);
+  subscribed.store(false);
+  connected.store(false);
+  discovered = false;
+  notifyCallback = nullptr;
+  notifyContext = nullptr;
+}
+
+bool SimulatedBLETransport::isConnected()
+{
+  return connected.load();
+}
+
+bool SimulatedBLETransport::requestConnectionParams(const BLEConnectionParams &params)
+{
+  preferredParams = params;
+  hasPreferredParams = true;
+  if (!connected.load() || failConnectionUpdate)
+  {
+    return false;
+  }
+  connectionUpdateCount++;
+  negotiate(params);
+  return true;
+}
+
+bool SimulatedBLETransport::getConnectionParams(BLEConnectionParams &params)
+{
+  if (!connected.load() || !acceptedKnown)
+  {
+    return false;
+  }
+  params = acceptedParams;
+  return true;
+}
+
+void SimulatedBLETransport::negotiate(const BLEConnectionParams &params)
+{
+  uint16_t interval = params.minInterval > peerMinInterval ? params.minInterval : peerMinInterval;
+  acceptedParams.minInterval = interval;
+  acceptedParams.maxInterval = interval;
+  acceptedParams.latency = params.latency;
+  acceptedParams.timeout = params.timeout;
+  acceptedKnown = true;
+}
+
+bool SimulatedBLETransport::readRssi(int8_t &value)
+{
+  if (!connected.load())
+  {
+    return false;
+  }
+  value = rssi.load();
+  return true;
+}
+
+void SimulatedBLETransport::injectDropout(uint32_t durationMs)
+{
+  dropoutUntilUs.store(steadyNowUs() + (int64_t)durationMs * 1000);
+}
+
+size_t SimulatedBLETransport::nextReport(uint32_t index, uint8_t *buffer)
+{
+  if (generator)
+  {
+    return generator(generatorContext, index, buffer, MAX_REPORT_SIZE);
+  }
+  memcpy(buffer, report, reportLength);
+  return reportLength;
+}
+
+void SimulatedBLETransport::streamLoop(StreamConfig config)
+{
+  const std::chrono::microseconds period(1000000UL / config.rateHz);
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+  uint8_t buffer[MAX_REPORT_SIZE];
+  uint32_t index = 0;
+
+  while (streaming.load())
+  {
+    for (uint16_t i = 0; i < config.burstLength; i++)
+    {
+      if (config.count != 0 && index >= config.count)
+      {
+        streaming.store(false);
+        return;
+      }
+
+      if (steadyNowUs() < dropoutUntilUs.load())
+      {
+        index++;
+        withheld.fetch_add(1);
+        continue;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      size_t length = nextReport(index++, buffer);
+      if (subscribed.load())
+      {
+        notifyCallback(notifyContext, buffer, length);
+        emitted.fetch_add(1);
+      }
+    }
+
+    deadline += period;
+    std::this_thread::sleep_until(deadline);
+  }
+}
+
+#endif // ARDUINO
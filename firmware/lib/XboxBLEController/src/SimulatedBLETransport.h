@@ -0,0 +1,150 @@
+#ifndef SIMULATED_BLE_TRANSPORT_H
+#define SIMULATED_BLE_TRANSPORT_H
+
+#ifndef ARDUINO
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "BLETransport.h"
+
+// In-process HID peripheral for running the controller pipeline on the host.
+//
+// Advertisements added with addPeripheral() are delivered by scan(), in order
+// of their first-seen delay; connect,
+// discover and subscribe succeed unless a failure is injected. Input reports
+// are delivered either synchronously with emit() or from a background thread
+// started with startStreaming(), which plays the role of the BLE task.
+class SimulatedBLETransport : public BLETransport
+{
+public:
+  static const size_t MAX_REPORT_SIZE = 64;
+
+  // Fills report for the index-th emitted report and returns its length.
+  // Called on the streaming thread.
+  typedef size_t (*ReportGenerator)(void *context, uint32_t index, uint8_t *report, size_t capacity);
+
+  struct StreamConfig
+  {
+    uint32_t rateHz;      // bursts per second (up to 1000)
+    uint16_t burstLength; // reports sent back to back per burst
+    uint32_t count;       // stop after this many reports (0 = until stopped)
+  };
+
+  SimulatedBLETransport();
+  ~SimulatedBLETransport();
+
+  // Peripheral setup
+  // The peripheral is heard firstSeenMs into every scan. A scan with no match
+  // returns once the peripherals are exhausted instead of waiting out the
+  // duration.
+  void addPeripheral(const BLEAdvertisement &advertisement, uint32_t firstSeenMs = 0);
+  void setReport(const uint8_t *data, size_t length);
+  void setReportGenerator(ReportGenerator generator, void *context);
+  void setReportMap(const uint8_t *descriptor, size_t length, uint8_t reportId);
+
+  // Failure injection
+  void setFailConnect(bool fail) { failConnect = fail; }
+  void setHandleOffset(uint16_t offset) { handleOffset = offset; } // moves the GATT handles (peer firmware update)
+  void setFailDiscover(bool fail) { failDiscover = fail; }
+  void dropLink();
+
+  // Keep the link up but withhold streamed reports for durationMs from now
+  // (a starved connection); the reports are skipped, not queued
+  void injectDropout(uint32_t durationMs);
+  uint32_t getWithheldCount() const { return withheld.load(); }
+
+  void setRssi(int8_t value) { rssi.store(value); }
+
+  // The peer never accepts a connection interval below this (BLE units)
+  void setPeerMinInterval(uint16_t interval) { peerMinInterval = interval; }
+  void setFailConnectionUpdate(bool fail) { failConnectionUpdate = fail; }
+  uint32_t getConnectionUpdateCount() const { return connectionUpdateCount; }
+
+  // Report delivery
+  bool emit(const uint8_t *data, size_t length);
+  bool startStreaming(const StreamConfig &config);
+  void stopStreaming();
+  void waitForStreamEnd();
+  uint32_t getEmittedCount() const { return emitted.load(); } // reports delivered to the subscriber
+
+  // Call counters for tests
+  uint32_t getScanCount() const { return scanCount; }
+  uint32_t getAdvertisementCount() const { return advertisementCount; } // delivered to scan callbacks
+  const BLEScanProfile &getLastScanProfile() const { return lastScanProfile; }
+  uint32_t getConnectCount() const { return connectCount; }
+  uint32_t getDiscoverCount() const { return discoverCount; }
+  uint32_t getResumeCount() const { return resumeCount; }
+
+  // BLETransport
+  bool begin();
+  bool scan(uint32_t durationMs, const BLEScanProfile &profile, ScanCallback callback, void *context);
+  bool connect(const BLEPeerAddress &address);
+  bool discover();
+  size_t readReportMap(uint8_t *buffer, size_t capacity, uint8_t &reportId);
+  bool subscribe(NotifyCallback callback, void *context);
+  bool getPeerCache(BLEPeerCache &cache);
+  bool resume(const BLEPeerCache &cache);
+  void disconnect();
+  bool isConnected();
+  bool readRssi(int8_t &rssi);
+  bool requestConnectionParams(const BLEConnectionParams &params);
+  bool getConnectionParams(BLEConnectionParams &params);
+
+private:
+  struct Peripheral
+  {
+    BLEAdvertisement advertisement;
+    uint32_t firstSeenMs;
+  };
+
+  std::vector<Peripheral> peripherals;
+  std::vector<uint8_t> reportMap;
+  uint8_t reportMapId;
+  bool failConnect;
+  bool failDiscover;
+  uint32_t scanCount;
+  uint32_t advertisementCount;
+  BLEScanProfile lastScanProfile;
+  uint32_t connectCount;
+  uint32_t discoverCount;
+  uint32_t resumeCount;
+  uint16_t handleOffset;
+  BLEPeerAddress peer;
+  bool discovered;
+  uint16_t peerMinInterval;
+  bool failConnectionUpdate;
+  uint32_t connectionUpdateCount;
+  BLEConnectionParams preferredParams;
+  bool hasPreferredParams;
+  BLEConnectionParams acceptedParams;
+  bool acceptedKnown;
+
+  std::atomic<bool> connected;
+  std::atomic<bool> subscribed;
+  NotifyCallback notifyCallback;
+  void *notifyContext;
+
+  std::mutex mutex; // guards report state and serializes delivery against disconnect()
+  uint8_t report[MAX_REPORT_SIZE];
+  size_t reportLength;
+  ReportGenerator generator;
+  void *generatorContext;
+
+  std::thread streamThread;
+  std::atomic<bool> streaming;
+  std::atomic<uint32_t> emitted;
+  std::atomic<uint32_t> withheld;
+  std::atomic<int64_t> dropoutUntilUs; // steady clock
+  std::atomic<int8_t> rssi;
+
+  void fillHandles(BLEPeerCache &cache) const;
+  void negotiate(const BLEConnectionParams &params);
+  void streamLoop(StreamConfig config);
+  size_t nextReport(uint32_t index, uint8_t *buffer);
+};
+
+#endif // ARDUINO
+
+#endif // SIMULATED_BLE_TRANSPORT_H
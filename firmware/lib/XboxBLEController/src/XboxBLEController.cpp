@@ -1,20 +1,57 @@
 #include "XboxBLEController.h"
-#include "esp_bt.h"
-#include "esp_gap_ble_api.h"
-#include "esp_gattc_api.h"
-#include "esp_bt_main.h"
 
-#include "ArduinoUtils.h"
+XboxBLEController *XboxBLEController::claims[MAX_SESSIONS] = {};
 
-// Initialize static map
-std::map<BLERemoteCharacteristic *, XboxBLEController *> XboxBLEController::instanceMap;
+const BLEScanProfile XboxBLEController::SCAN_FAST = {100, 100, true};
+const BLEScanProfile XboxBLEController::SCAN_BALANCED = {160, 80, true};
+const BLEScanProfile XboxBLEController::SCAN_LOW_POWER = {640, 64, true};
 
-XboxBLEController::XboxBLEController()
-    : pClient(nullptr),
-      pInputReportCharacteristic(nullptr),
-      pServerAddress(nullptr),
-      initialized(false)
+// micros() is unsigned long on some cores
+static uint32_t microsClock(void)
 {
+  return micros();
+}
+
+XboxBLEController::XboxBLEController(BLETransport &transport)
+    : transport(transport),
+      connected(false),
+      initialized(false),
+      reportTap(nullptr),
+      reportTapContext(nullptr),
+      inputHandler(nullptr),
+      inputHandlerContext(nullptr),
+      clock(microsClock),
+      lastReportLength(0),
+      lastArrivalUs(0),
+      lastArrivalValid(false),
+      heldInputs(0),
+      peerFilterSet(false),
+      bondStore(nullptr),
+      bondSlot(0),
+      reportMapFromPeer(false),
+      linkState(LINK_IDLE),
+      linkStateSince(0),
+      linkScanTimeMs(5000),
+      linkBackoffMs(LINK_BACKOFF_MIN_MS),
+      linkAttemptStart(0),
+      linkResume(false),
+      rssi(0),
+      lastRssiMs(0),
+      connectionProfileSet(false),
+      scanProfile(SCAN_FAST),
+      scanStartMs(0)
+{
+  memset(&peerAddress, 0, sizeof(peerAddress));
+  memset(&history, 0, sizeof(history));
+  memset(&linkCache, 0, sizeof(linkCache));
+  memset(&peerFilter, 0, sizeof(peerFilter));
+  memset(&reconnectStats, 0, sizeof(reconnectStats));
+  memset(&reportMapPeer, 0, sizeof(reportMapPeer));
+  memset(&reportStats, 0, sizeof(reportStats));
+  memset(&connection, 0, sizeof(connection));
+  memset(&scanStats, 0, sizeof(scanStats));
+  memset(&scanMatch, 0, sizeof(scanMatch));
+  reportMap.loadDefault();
   resetState();
 }
 
@@ -24,33 +61,15 @@ XboxBLEController::~XboxBLEController()
   {
     disconnect();
   }
-  if (pServerAddress)
-  {
-    delete pServerAddress;
-  }
-  // Clean up instance map entry
-  if (pInputReportCharacteristic)
-  {
-    instanceMap.erase(pInputReportCharacteristic);
-  }
+  releaseClaim();
 }
 
 bool XboxBLEController::begin()
 {
-  BLEDevice::init("ESP32_Controller_Client");
-
-  // Enable bonding/pairing
-  esp_ble_auth_req_t auth_req = ESP_LE_AUTH_REQ_SC_MITM_BOND;
-  esp_ble_io_cap_t iocap = ESP_IO_CAP_NONE;
-  uint8_t key_size = 16;
-  uint8_t init_key = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
-  uint8_t rsp_key = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
-
-  esp_ble_gap_set_security_param(ESP_BLE_SM_AUTHEN_REQ_MODE, &auth_req, sizeof(uint8_t));
-  esp_ble_gap_set_security_param(ESP_BLE_SM_IOCAP_MODE, &iocap, sizeof(uint8_t));
-  esp_ble_gap_set_security_param(ESP_BLE_SM_MAX_KEY_SIZE, &key_size, sizeof(uint8_t));
-  esp_ble_gap_set_security_param(ESP_BLE_SM_SET_INIT_KEY, &init_key, sizeof(uint8_t));
-  esp_ble_gap_set_security_param(ESP_BLE_SM_SET_RSP_KEY, &rsp_key, sizeof(uint8_t));
+  if (!transport.begin())
+  {
+    return false;
+  }
 
   initialized = true;
   resetState();
@@ -64,256 +83,523 @@ bool XboxBLEController::scanAndConnect(uint32_t scanTimeMs)
     return false;
   }
 
-  // Create scanner
-  BLEScan *pBLEScan = BLEDevice::getScan();
-  pBLEScan->setActiveScan(true);
-  pBLEScan->setInterval(100);
-  pBLEScan->setWindow(99);
-
-  // Start scanning
-  BLEScanResults foundDevices = pBLEScan->start(scanTimeMs / 1000, false);
-
-  // Look for Xbox controller in results
-  for (int i = 0; i < foundDevices.getCount(); i++)
+  if (!scanForPeer(scanTimeMs))
   {
-    BLEAdvertisedDevice device = foundDevices.getDevice(i);
-
-    if (isXboxController(&device))
-    {
-      // Found Xbox controller - attempt to connect
-      pBLEScan->stop();
-
-      if (connectToController(device.getAddress()))
-      {
-        return true;
-      }
-    }
+    return false;
   }
-
-  pBLEScan->clearResults();
-  return false;
+  return connectToController(scanMatch.address);
 }
 
-bool XboxBLEController::connectToController(BLEAddress address)
+bool XboxBLEController::scanForPeer(uint32_t scanTimeMs)
 {
-  // Store address
-  if (pServerAddress)
+  scanStats.scans++;
+  scanStartMs = millis();
+  bool found = transport.scan(scanTimeMs, scanProfile, advertisementCallback, this);
+  if (found)
   {
-    delete pServerAddress;
+    scanStats.matches++;
+    LOG_DEBUG("Controller found after %u ms", scanStats.lastMatchMs);
   }
-  pServerAddress = new BLEAddress(address);
+  publishedScanStats.write(scanStats);
+  return found;
+}
 
-  // Create client
-  if (pClient)
+bool XboxBLEController::advertisementCallback(void *context, const BLEAdvertisement &advertisement)
+{
+  XboxBLEController *self = static_cast<XboxBLEController *>(context);
+  self->scanStats.advertisements++;
+  if (!self->isCandidate(advertisement))
   {
-    delete pClient;
+    return false;
   }
-  pClient = BLEDevice::createClient();
 
-  // Set security callbacks
-  BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT);
-  BLEDevice::setSecurityCallbacks(new XboxSecurityCallbacks());
+  self->scanMatch = advertisement;
+  uint32_t elapsedMs = millis() - self->scanStartMs;
+  self->scanStats.lastMatchMs = elapsedMs;
+  if (elapsedMs > self->scanStats.maxMatchMs)
+  {
+    self->scanStats.maxMatchMs = elapsedMs;
+  }
+  return true;
+}
 
-  // Connect to the server
-  if (!pClient->connect(*pServerAddress))
+bool XboxBLEController::isCandidate(const BLEAdvertisement &device)
+{
+  if (peerFilterSet && device.address != peerFilter)
   {
     return false;
   }
+  if (isClaimedByOther(this, device.address))
+  {
+    return false;
+  }
+  return matcher.matches(device);
+}
 
-  // Wait a moment for bonding to complete
-  delay(3000);
+void XboxBLEController::setPeerFilter(const BLEPeerAddress &address)
+{
+  peerFilter = address;
+  peerFilterSet = true;
+}
 
-  // Check if we're actually bonded
-  if (pClient->isConnected())
-    log(LogLevel::INFO, "Connected securely!");
-  else
-    log(LogLevel::INFO, "Connected!");
+bool XboxBLEController::isClaimedByOther(const XboxBLEController *session, const BLEPeerAddress &address)
+{
+  for (uint8_t i = 0; i < MAX_SESSIONS; i++)
+  {
+    if (claims[i] != nullptr && claims[i] != session && claims[i]->peerAddress == address)
+    {
+      return true;
+    }
+  }
+  return false;
+}
 
-  // Set MTU size (important for HID)
-  pClient->setMTU(517);
+bool XboxBLEController::claim(const BLEPeerAddress &address)
+{
+  releaseClaim();
+  for (uint8_t i = 0; i < MAX_SESSIONS; i++)
+  {
+    if (claims[i] == nullptr)
+    {
+      peerAddress = address;
+      claims[i] = this;
+      return true;
+    }
+  }
+  return false;
+}
 
-  // Find and subscribe to input report characteristic
-  if (!findInputReportCharacteristic())
+void XboxBLEController::releaseClaim()
+{
+  for (uint8_t i = 0; i < MAX_SESSIONS; i++)
   {
-    log(LogLevel::ERROR, "Failed to find input report characteristic");
-    pClient->disconnect();
-    return false;
+    if (claims[i] == this)
+    {
+      claims[i] = nullptr;
+    }
   }
+}
 
-  // Register for notifications
-  if (pInputReportCharacteristic->canNotify())
+void XboxBLEController::setBondStore(BondStore *store, uint8_t slot)
+{
+  bondStore = store;
+  bondSlot = slot;
+}
+
+bool XboxBLEController::reconnect(uint32_t scanTimeMs)
+{
+  if (!initialized)
   {
-    // Register this instance in the map
-    instanceMap[pInputReportCharacteristic] = this;
+    return false;
+  }
 
-    // Register the static callback
-    pInputReportCharacteristic->registerForNotify(notificationCallback);
+  uint32_t start = millis();
+  reconnectStats.attempts++;
 
-    // Alternative: Try reading the value first to test connection
-    try
+  bool ok = false;
+  BLEPeerCache cache;
+  if (loadUsableCache(cache))
+  {
+    ok = resumeController(cache);
+    if (ok)
     {
-      std::string value = pInputReportCharacteristic->readValue();
+      reconnectStats.fastPath++;
     }
-    catch (...)
+  }
+
+  if (!ok)
+  {
+    ok = scanAndConnect(scanTimeMs);
+    if (ok)
     {
-      log(LogLevel::ERROR, "Initial read failed (this may be normal)");
+      reconnectStats.slowPath++;
     }
-
-    log(LogLevel::INFO, "Subscribed to notifications!");
   }
-  else
+
+  if (!ok)
   {
-    log(LogLevel::ERROR, "Characteristic cannot notify!");
-    pClient->disconnect();
+    reconnectStats.failures++;
     return false;
   }
 
-  state.connected = true;
-  state.lastUpdateTime = millis();
+  recordReconnect(millis() - start);
   return true;
 }
 
-bool XboxBLEController::findInputReportCharacteristic()
+bool XboxBLEController::loadUsableCache(BLEPeerCache &cache)
 {
-  log(LogLevel::INFO, "Looking for HID service...");
+  return bondStore != nullptr && bondStore->load(bondSlot, cache) &&
+         (!peerFilterSet || cache.address == peerFilter) &&
+         !isClaimedByOther(this, cache.address);
+}
 
-  // Get HID service
-  BLERemoteService *pRemoteService = pClient->getService(BLEUUID(XBOX_SERVICE_UUID));
-  if (pRemoteService == nullptr)
+void XboxBLEController::recordReconnect(uint32_t elapsedMs)
+{
+  reconnectStats.lastMs = elapsedMs;
+  if (elapsedMs > reconnectStats.maxMs)
   {
-    log(LogLevel::ERROR, "Failed to find HID service!");
-    return false;
+    reconnectStats.maxMs = elapsedMs;
   }
+  LOG_INFO("Reconnected in %u ms", elapsedMs);
+}
 
-  // Get all characteristics
-  std::map<std::string, BLERemoteCharacteristic *> *pCharacteristics =
-      pRemoteService->getCharacteristics();
+void XboxBLEController::startLink(uint32_t scanTimeMs)
+{
+  linkScanTimeMs = scanTimeMs;
+  linkBackoffMs = LINK_BACKOFF_MIN_MS;
+  linkAttemptStart = millis();
+  reconnectStats.attempts++;
+  setLinkState(LINK_SCANNING, linkAttemptStart);
+}
 
-  // Store references to important characteristics
-  BLERemoteCharacteristic *pHIDControlPoint = nullptr;
-  BLERemoteCharacteristic *pProtocolMode = nullptr;
-  BLERemoteCharacteristic *pHIDInfo = nullptr;
-  BLERemoteCharacteristic *pReportMap = nullptr;
+void XboxBLEController::stopLink()
+{
+  disconnect();
+  setLinkState(LINK_IDLE, millis());
+}
 
-  // Look for all HID characteristics
-  int reportCount = 0;
+XboxBLEController::LinkState XboxBLEController::step(uint32_t nowMs)
+{
+  if (!initialized)
+  {
+    return getLinkState();
+  }
 
-  for (auto &pair : *pCharacteristics)
+  switch (getLinkState())
   {
-    BLERemoteCharacteristic *pChar = pair.second;
-    std::string uuid = pChar->getUUID().toString();
+  case LINK_IDLE:
+    break;
+
+  case LINK_SCANNING:
+    setLinkState(stepScanning(), nowMs);
+    break;
+
+  case LINK_CONNECTING:
+    setLinkState(stepConnecting(), nowMs);
+    break;
 
-    // 0x2A4E is Protocol Mode
-    if (uuid == "00002a4e-0000-1000-8000-00805f9b34fb")
+  case LINK_DISCOVERING:
+    if (transport.discover())
     {
-      pProtocolMode = pChar;
+      setLinkState(LINK_SUBSCRIBING, nowMs);
     }
-    // 0x2A4A is HID Information
-    else if (uuid == "00002a4a-0000-1000-8000-00805f9b34fb")
+    else
     {
-      pHIDInfo = pChar;
+      LOG_ERROR("Failed to find input report characteristic");
+      transport.disconnect();
+      releaseClaim();
+      setLinkState(enterBackoff(), nowMs);
     }
-    // 0x2A4B is Report Map
-    else if (uuid == "00002a4b-0000-1000-8000-00805f9b34fb")
+    break;
+
+  case LINK_SUBSCRIBING:
+    if (completeConnection(linkResume))
     {
-      pReportMap = pChar;
+      if (linkResume)
+        reconnectStats.fastPath++;
+      else
+        reconnectStats.slowPath++;
+      recordReconnect(nowMs - linkAttemptStart);
+      linkBackoffMs = LINK_BACKOFF_MIN_MS;
+      setLinkState(LINK_STREAMING, nowMs);
     }
-    // 0x2A4C is HID Control Point
-    else if (uuid == "00002a4c-0000-1000-8000-00805f9b34fb")
+    else
     {
-      pHIDControlPoint = pChar;
+      // completeConnection() already dropped the link
+      setLinkState(enterBackoff(), nowMs);
     }
-    // 0x2A4D is HID Report
-    else if (pChar->getUUID().equals(BLEUUID(XBOX_REPORT_UUID)))
-    {
-      reportCount++;
+    break;
 
-      if (pChar->canNotify())
-      {
+  case LINK_STREAMING:
+    if (!transport.isConnected())
+    {
+      // Retry at once: a bonded peer usually comes straight back
+      LOG_WARN("Link lost");
+      disconnect();
+      linkAttemptStart = nowMs;
+      reconnectStats.attempts++;
+      setLinkState(LINK_SCANNING, nowMs);
+      break;
+    }
+    pollConnectionParams();
+    if (nowMs - lastRssiMs >=
+        (rssi.load(std::memory_order_relaxed) == 0 ? LINK_RSSI_RETRY_MS : LINK_RSSI_INTERVAL_MS))
+    {
+      int8_t value;
+      if (transport.readRssi(value))
+        rssi.store(value, std::memory_order_relaxed);
+      lastRssiMs = nowMs;
+    }
+    break;
 
-        pInputReportCharacteristic = pChar;
-      }
+  case LINK_BACKOFF:
+    if (nowMs - getLinkStateSince() >= linkBackoffMs)
+    {
+      linkBackoffMs = linkBackoffMs * 2 < LINK_BACKOFF_MAX_MS ? linkBackoffMs * 2 : LINK_BACKOFF_MAX_MS;
+      reconnectStats.attempts++;
+      setLinkState(LINK_SCANNING, nowMs);
     }
+    break;
   }
+  return getLinkState();
+}
 
-  if (pInputReportCharacteristic == nullptr)
+XboxBLEController::LinkState XboxBLEController::stepScanning()
+{
+  // A usable bond cache skips the scan entirely
+  linkResume = loadUsableCache(linkCache);
+  if (linkResume)
   {
-    log(LogLevel::ERROR, "Failed to find notifiable HID Report characteristic!");
-    return false;
+    return LINK_CONNECTING;
   }
 
-  // CRITICAL: Get the Client Characteristic Configuration Descriptor (CCCD)
-  // and manually enable notifications - sometimes registerForNotify isn't enough
-  BLERemoteDescriptor *pCCCD = pInputReportCharacteristic->getDescriptor(BLEUUID((uint16_t)0x2902));
-  if (pCCCD != nullptr)
+  if (!scanForPeer(linkScanTimeMs))
   {
-    uint8_t notificationOn[] = {0x01, 0x00}; // Enable notifications
-    try
+    return enterBackoff();
+  }
+  return LINK_CONNECTING;
+}
+
+XboxBLEController::LinkState XboxBLEController::stepConnecting()
+{
+  if (linkResume)
+  {
+    if (!claim(linkCache.address))
     {
-      pCCCD->writeValue(notificationOn, 2, true);
+      return enterBackoff();
     }
-    catch (...)
+    if (transport.resume(linkCache))
     {
-      log(LogLevel::ERROR, "Failed to write CCCD");
+      return LINK_SUBSCRIBING;
     }
+
+    // Unreachable, or the peer's handles moved: scan right away
+    LOG_WARN("Cached peer rejected, falling back to scan");
+    reconnectStats.cacheRejected++;
+    bondStore->clear(bondSlot);
+    releaseClaim();
+    return LINK_SCANNING;
   }
-  else
+
+  // Another session may have taken this peer since the scan
+  const BLEPeerAddress &address = scanMatch.address;
+  if (isClaimedByOther(this, address))
   {
-    log(LogLevel::WARN, "CCCD not found!");
+    return enterBackoff();
   }
+  if (!claim(address))
+  {
+    LOG_ERROR("Too many controller sessions");
+    return enterBackoff();
+  }
+  if (!transport.connect(address))
+  {
+    releaseClaim();
+    return enterBackoff();
+  }
+  return LINK_DISCOVERING;
+}
+
+XboxBLEController::LinkState XboxBLEController::enterBackoff()
+{
+  reconnectStats.failures++;
+  LOG_DEBUG("Link retry in %u ms", linkBackoffMs);
+  return LINK_BACKOFF;
+}
 
-  // Set Protocol Mode to Report Protocol (0x01)
-  // This is crucial - Report Protocol enables input reports
-  if (pProtocolMode != nullptr && pProtocolMode->canWrite())
+void XboxBLEController::setLinkState(LinkState state, uint32_t nowMs)
+{
+  LinkState previous = getLinkState();
+  if (state == previous)
   {
-    uint8_t reportProtocol = 0x01; // 0=Boot Protocol, 1=Report Protocol
-    try
-    {
-      pProtocolMode->writeValue(&reportProtocol, 1, true); // with response
-      delay(200);
-
-      // Verify it was set
-      if (pProtocolMode->canRead())
-      {
-        std::string mode = pProtocolMode->readValue();
-      }
-      log(LogLevel::DEBUG, "Protocol Mode set successfully");
-    }
-    catch (...)
-    {
-      log(LogLevel::ERROR, "Failed to set Protocol Mode");
-    }
+    return;
+  }
+
+  LinkTransition &entry = history.entries[history.count % LINK_HISTORY_SIZE];
+  entry.atMs = nowMs;
+  entry.from = (uint8_t)previous;
+  entry.to = (uint8_t)state;
+  history.count++;
+  publishedHistory.write(history);
+
+  linkStateSince.store(nowMs, std::memory_order_release);
+  linkState.store((uint8_t)state, std::memory_order_release);
+  LOG_DEBUG("Link %s -> %s at %u ms", linkStateName(previous), linkStateName(state), nowMs);
+}
+
+const char *XboxBLEController::linkStateName(LinkState state)
+{
+  static const char *const names[] = {"idle", "scanning", "connecting", "discovering",
+                                      "subscribing", "streaming", "backoff"};
+  return (uint8_t)state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+bool XboxBLEController::connectToController(const BLEPeerAddress &address)
+{
+  if (!claim(address))
+  {
+    LOG_ERROR("Too many controller sessions");
+    return false;
+  }
+
+  // Connect to the server
+  if (!transport.connect(address))
+  {
+    releaseClaim();
+    return false;
+  }
+
+  // Find the input report characteristic
+  if (!transport.discover())
+  {
+    LOG_ERROR("Failed to find input report characteristic");
+    transport.disconnect();
+    releaseClaim();
+    return false;
   }
-  else
+
+  return completeConnection(false);
+}
+
+bool XboxBLEController::resumeController(const BLEPeerCache &cache)
+{
+  if (!claim(cache.address))
   {
-    log(LogLevel::WARN, "Protocol Mode characteristic not found or not writable!");
+    return false;
   }
 
-  // Exit suspend mode
-  if (pHIDControlPoint != nullptr && pHIDControlPoint->canWriteNoResponse())
+  if (!transport.resume(cache))
   {
-    log(LogLevel::DEBUG, "Sending exit suspend command...");
-    uint8_t exitSuspend = 0x00;
-    try
+    // Unreachable, or the peer's handles moved: rediscover next time
+    LOG_WARN("Cached peer rejected, falling back to scan");
+    reconnectStats.cacheRejected++;
+    bondStore->clear(bondSlot);
+    releaseClaim();
+    return false;
+  }
+
+  return completeConnection(true);
+}
+
+bool XboxBLEController::completeConnection(bool resumed)
+{
+  // Compile the report layout once, before any report arrives
+  loadReportMap(resumed);
+  lastReportLength = 0;
+
+  // Publish the connection time before the callback can start writing
+  pending.lastUpdateTime = millis();
+  published.write(pending);
+
+  // Register for notifications
+  if (!transport.subscribe(notificationCallback, this))
+  {
+    LOG_ERROR("Failed to subscribe to input reports");
+    transport.disconnect();
+    releaseClaim();
+    return false;
+  }
+
+  requestConnectionProfile();
+
+  // Remember the layout for a fast reconnect
+  BLEPeerCache cache;
+  if (!resumed && bondStore != nullptr && transport.getPeerCache(cache))
+  {
+    if (!bondStore->save(bondSlot, cache))
     {
-      pHIDControlPoint->writeValue(&exitSuspend, 1, false); // without response
-      delay(100);
-      log(LogLevel::DEBUG, "Exit suspend sent");
+      LOG_WARN("Failed to save bond cache");
     }
-    catch (...)
+  }
+
+  connected.store(true, std::memory_order_release);
+  return true;
+}
+
+void XboxBLEController::setConnectionProfile(const BLEConnectionParams &profile)
+{
+  connection.requested = profile;
+  connectionProfileSet = true;
+  publishedConnection.write(connection);
+  if (isConnected())
+  {
+    requestConnectionProfile();
+  }
+}
+
+void XboxBLEController::requestConnectionProfile()
+{
+  // The new link starts with unknown timing until the stack reports it
+  memset(&connection.accepted, 0, sizeof(connection.accepted));
+  if (connectionProfileSet)
+  {
+    connection.requests++;
+    if (!transport.requestConnectionParams(connection.requested))
     {
-      log(LogLevel::ERROR, "Failed to send exit suspend");
+      connection.failedRequests++;
+      LOG_WARN("Connection parameter request not sent");
     }
   }
+  pollConnectionParams();
+  publishedConnection.write(connection);
+}
+
+void XboxBLEController::pollConnectionParams()
+{
+  BLEConnectionParams accepted;
+  if (!transport.getConnectionParams(accepted) ||
+      memcmp(&accepted, &connection.accepted, sizeof(accepted)) == 0)
+  {
+    return;
+  }
+  connection.accepted = accepted;
+  publishedConnection.write(connection);
+  LOG_INFO("Connection interval %u x 1.25 ms, latency %u, timeout %u x 10 ms", accepted.minInterval,
+           accepted.latency, accepted.timeout);
+}
 
-  return true;
+uint32_t XboxBLEController::getReportRateHz() const
+{
+  uint32_t meanUs = getReportStats().meanIntervalUs;
+  return meanUs == 0 ? 0 : (1000000 + meanUs / 2) / meanUs;
+}
+
+void XboxBLEController::loadReportMap(bool resumed)
+{
+  // A resumed peer is the one the current map came from: keep it
+  if (resumed && reportMapFromPeer && reportMapPeer == peerAddress)
+  {
+    return;
+  }
+
+  uint8_t descriptor[512];
+  uint8_t reportId = 0;
+  size_t length = transport.readReportMap(descriptor, sizeof(descriptor), reportId);
+  if (length > 0 && reportMap.parse(descriptor, length, reportId))
+  {
+    LOG_DEBUG("Report map parsed");
+    reportMapPeer = peerAddress;
+    reportMapFromPeer = true;
+    return;
+  }
+
+  LOG_WARN("Report map unavailable, using default Xbox layout");
+  reportMap.loadDefault();
+  reportMapFromPeer = false;
 }
 
 bool XboxBLEController::update()
 {
-  if (!state.connected || !pClient || !pClient->isConnected())
+  // A managed link is watched by step(); the transport belongs to that task
+  if (getLinkState() != LINK_IDLE)
+  {
+    return isConnected();
+  }
+
+  if (!isConnected() || !transport.isConnected())
   {
-    state.connected = false;
+    connected.store(false, std::memory_order_release);
+    releaseClaim();
     return false;
   }
 
@@ -324,116 +610,208 @@ bool XboxBLEController::update()
 
 void XboxBLEController::disconnect()
 {
-  if (pClient && pClient->isConnected())
-  {
-    pClient->disconnect();
-  }
-  // Clean up instance map entry
-  if (pInputReportCharacteristic)
-  {
-    instanceMap.erase(pInputReportCharacteristic);
-  }
+  // No notifications are delivered once the transport has disconnected
+  transport.disconnect();
+  releaseClaim();
   resetState();
 }
 
+XboxBLEController::ControllerState XboxBLEController::snapshot() const
+{
+  ControllerState current = published.read();
+  current.connected = isConnected();
+  return current;
+}
+
+void XboxBLEController::setReportTap(ReportTap tap, void *context)
+{
+  reportTapContext = context;
+  reportTap = tap;
+}
+
+void XboxBLEController::setInputHandler(InputHandler handler, void *context)
+{
+  inputHandlerContext = context;
+  inputHandler = handler;
+}
+
+void XboxBLEController::setStateForTesting(const ControllerState &testState)
+{
+  pending = testState;
+  published.write(pending);
+  connected.store(testState.connected, std::memory_order_release);
+}
+
 float XboxBLEController::getLeftStickXNormalized() const
 {
-  return state.leftStickX / 32768.0f;
+  return normalizeStick(snapshot().leftStickX);
 }
 
 float XboxBLEController::getLeftStickYNormalized() const
 {
-  return state.leftStickY / 32768.0f;
+  return normalizeStick(snapshot().leftStickY);
 }
 
 float XboxBLEController::getLeftTriggerNormalized() const
 {
-  return state.leftTrigger / 255.0f;
+  return normalizeTrigger(snapshot().leftTrigger);
 }
 
 float XboxBLEController::getRightTriggerNormalized() const
 {
-  return state.rightTrigger / 255.0f;
+  return normalizeTrigger(snapshot().rightTrigger);
+}
+
+void XboxBLEController::notificationCallback(void *context, const uint8_t *data, size_t length)
+{
+  // Stamp first, so the latency trace includes the decode
+  XboxBLEController *controller = static_cast<XboxBLEController *>(context);
+  uint32_t arrivalUs = controller->clock();
+  controller->handleNotification(data, length, arrivalUs);
 }
 
-bool XboxBLEController::isXboxController(BLEAdvertisedDevice *device)
+void XboxBLEController::handleNotification(const uint8_t *data, size_t length, uint32_t arrivalUs)
 {
-  // Check for Xbox controller by name
-  if (device->haveName())
+  recordArrival(arrivalUs);
+  if (reportTap)
   {
-    std::string name = device->getName();
-    // Convert to lowercase for comparison
-    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    reportTap(reportTapContext, data, length, arrivalUs);
+  }
 
-    if (name.find("xbox") != std::string::npos ||
-        name.find("controller") != std::string::npos)
-    {
-      return true;
-    }
+  if (length < reportMap.getReportLength())
+  {
+    reportStats.tooShort++;
+    publishedReportStats.write(reportStats);
+    return;
+  }
+  if (length > MAX_REPORT_LENGTH)
+  {
+    reportStats.malformed++;
+    publishedReportStats.write(reportStats);
+    return;
   }
 
-  // Check for HID service UUID
-  if (device->haveServiceUUID())
+  // Controllers keep notifying while the sticks rest. A repeat only
+  // refreshes the liveness stamp; arrivalUs keeps the time the input
+  // actually changed.
+  if (length == lastReportLength && memcmp(data, lastReport, length) == 0)
   {
-    if (device->isAdvertisingService(BLEUUID(XBOX_SERVICE_UUID)))
-    {
-      return true;
-    }
+    reportStats.unchanged++;
+    publishedReportStats.write(reportStats);
+    pending.lastUpdateTime = millis();
+    published.write(pending);
+    return;
   }
 
-  return false;
+  if (!parseReport(data, length))
+  {
+    reportStats.malformed++;
+    lastReportLength = 0;
+    publishedReportStats.write(reportStats);
+    return;
+  }
+  memcpy(lastReport, data, length);
+  lastReportLength = length;
+  publishedReportStats.write(reportStats);
+
+  pending.lastUpdateTime = millis();
+  pending.arrivalUs = arrivalUs;
+  published.write(pending);
+  if (inputHandler)
+  {
+    inputHandler(inputHandlerContext, arrivalUs);
+  }
 }
 
-void XboxBLEController::notificationCallback(
-    BLERemoteCharacteristic *pCharacteristic,
-    uint8_t *pData,
-    size_t length,
-    bool isNotify)
+void XboxBLEController::recordArrival(uint32_t arrivalUs)
 {
-  // Look up the controller instance from the map
-  auto it = instanceMap.find(pCharacteristic);
-  if (it != instanceMap.end())
+  reportStats.total++;
+  if (lastArrivalValid)
   {
-    XboxBLEController *controller = it->second;
-    controller->parseReport(pData, length);
-    controller->state.lastUpdateTime = millis();
+    uint32_t interval = arrivalUs - lastArrivalUs;
+    reportStats.lastIntervalUs = interval;
+    if (reportStats.meanIntervalUs == 0)
+      reportStats.meanIntervalUs = interval;
+    else
+      reportStats.meanIntervalUs += ((int32_t)(interval - reportStats.meanIntervalUs)) >> 3;
+    if (interval > reportStats.maxIntervalUs)
+      reportStats.maxIntervalUs = interval;
+
+    // RFC 3550 style: deviation from the running mean, smoothed by 1/16
+    int32_t deviation = (int32_t)(interval - reportStats.meanIntervalUs);
+    deviation = deviation < 0 ? -deviation : deviation;
+    reportStats.jitterUs += (deviation - (int32_t)reportStats.jitterUs) >> 4;
   }
+  lastArrivalUs = arrivalUs;
+  lastArrivalValid = true;
 }
 
-void XboxBLEController::parseReport(const uint8_t *data, uint16_t length)
+bool XboxBLEController::parseReport(const uint8_t *data, uint16_t length)
 {
-  // Xbox One controller HID report format (simplified)
-  log(LogLevel::DEBUG, "Parsing report");
-
-  if (length >= 10)
+  int32_t values[HIDReportMap::TARGET_COUNT];
+  if (!reportMap.decode(data, length, values))
   {
-    // Parse stick (little endian)
-    state.leftStickX = (uint16_t)(data[0] | (data[1] << 8));
-    state.leftStickY = (uint16_t)(data[2] | (data[3] << 8));
-    // state.rightStickX = (uint16_t)(data[4] | (data[5] << 8));
-    // state.rightStickY = (uint16_t)(data[6] | (data[7] << 8));
+    return false;
+  }
+
+  pending.leftStickX = (int16_t)values[HIDReportMap::LEFT_STICK_X];
+  pending.leftStickY = (int16_t)values[HIDReportMap::LEFT_STICK_Y];
+  pending.rightStickX = (int16_t)values[HIDReportMap::RIGHT_STICK_X];
+  pending.rightStickY = (int16_t)values[HIDReportMap::RIGHT_STICK_Y];
+  pending.leftTrigger = (uint16_t)values[HIDReportMap::LEFT_TRIGGER];
+  pending.rightTrigger = (uint16_t)values[HIDReportMap::RIGHT_TRIGGER];
+  pending.buttons = (uint16_t)values[HIDReportMap::BUTTONS];
+  pending.hat = (uint8_t)values[HIDReportMap::HAT_SWITCH];
+  queueInputEdges(inputMask(pending), millis());
+
+  LOG_VERBOSE("Left Stick: X=%d Y=%d, Triggers: L=%u R=%u",
+              pending.leftStickX, pending.leftStickY,
+              pending.leftTrigger, pending.rightTrigger);
+  return true;
+}
 
-    // Parse triggers
-    state.leftTrigger = (uint16_t)(data[8] | (data[9] << 8));
-    state.rightTrigger = (uint16_t)(data[10] | (data[11] << 8));
-    // state.dpad = data[12];
-    // state.button1 = data[13];
-    // state.button2 = data[14];
+uint32_t XboxBLEController::inputMask(const ControllerState &state)
+{
+  // Hat value -> d-pad bits (up, right, down, left); out of range is released
+  static const uint8_t DPAD[16] = {0, 0x1, 0x3, 0x2, 0x6, 0x4, 0xC, 0x8, 0x9};
+  return state.buttons | ((uint32_t)DPAD[state.hat & 0x0F] << INPUT_DPAD_UP);
+}
 
-    char buffer[80];
-    sprintf(buffer, "  Left Stick: X=%d Y=%d, Triggers: L=%d R=%d",
-            state.leftStickX, state.leftStickY,
-            state.leftTrigger, state.rightTrigger);
-    log(LogLevel::INFO, buffer);
+void XboxBLEController::queueInputEdges(uint32_t inputs, uint32_t atMs)
+{
+  // One XOR finds every input that changed; only those are visited
+  uint32_t changed = inputs ^ heldInputs;
+  heldInputs = inputs;
+  while (changed != 0)
+  {
+    uint8_t input = (uint8_t)__builtin_ctz(changed);
+    changed &= changed - 1;
+    ButtonEvent event = {atMs, input, ((inputs >> input) & 1) != 0};
+    if (!buttonEvents.push(event))
+    {
+      reportStats.eventsDropped++;
+    }
   }
 }
 
 void XboxBLEController::resetState()
 {
-  state.leftStickX = 0;
-  state.leftStickY = 0;
-  state.leftTrigger = 0;
-  state.rightTrigger = 0;
-  state.connected = false;
-  state.lastUpdateTime = 0;
+  connected.store(false, std::memory_order_release);
+  memset(&pending, 0, sizeof(pending));
+  published.write(pending);
+
+  // Nothing stays held across a link loss
+  queueInputEdges(0, millis());
+
+  // The next connection starts with a fresh comparison and interval
+  lastReportLength = 0;
+  lastArrivalValid = false;
+  reportStats.lastIntervalUs = 0;
+  reportStats.meanIntervalUs = 0;
+  reportStats.maxIntervalUs = 0;
+  reportStats.jitterUs = 0;
+  publishedReportStats.write(reportStats);
+  rssi.store(0, std::memory_order_relaxed);
+  memset(&connection.accepted, 0, sizeof(connection.accepted));
+  publishedConnection.write(connection);
 }
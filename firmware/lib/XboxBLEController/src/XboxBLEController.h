@@ -1,113 +1,414 @@
 #ifndef XBOX_BLE_CONTROLLER_H
 #define XBOX_BLE_CONTROLLER_H
 
-#include <Arduino.h>
-#include <BLEDevice.h>
-#include <BLEUtils.h>
-#include <BLEScan.h>
-#include <algorithm>
-#include <map>
-
-// Xbox Controller BLE Service UUIDs (standard for Xbox One S/X/Series controllers)
-#define XBOX_SERVICE_UUID "00001812-0000-1000-8000-00805f9b34fb"    // HID Service
-#define XBOX_REPORT_UUID "00002a4d-0000-1000-8000-00805f9b34fb"     // HID Report
-#define XBOX_REPORT_MAP_UUID "00002a4b-0000-1000-8000-00805f9b34fb" // HID Report Map
-
-// Simple security callbacks implementation
-class XboxSecurityCallbacks : public BLESecurityCallbacks
+#include <atomic>
+
+#include "AdvertisementMatcher.h"
+#include "ArduinoUtils.h"
+#include "BLETransport.h"
+#include "BondStore.h"
+#include "HIDReportMap.h"
+#include "LockFreeQueue.h"
+#include "SeqLock.h"
+
+// One controller session: a BLE transport, the report layout of the peer
+// and the latest input snapshot. Several sessions can run side by side, one
+// transport each; a peer connected by one session is skipped by the others.
+class XboxBLEController
 {
-  uint32_t onPassKeyRequest()
+public:
+  // Latest input of a session. Ordered by size so it packs into 24 bytes
+  // without padding; copied whole by every snapshot().
+  struct ControllerState
   {
+    int16_t leftStickX;      // -32768 to 32767 (left to right)
+    int16_t leftStickY;      // -32768 to 32767 (up to down)
+    int16_t rightStickX;     // -32768 to 32767 (left to right)
+    int16_t rightStickY;     // -32768 to 32767 (up to down)
+    uint16_t leftTrigger;    // 0 to 255 (press)
+    uint16_t rightTrigger;   // 0 to 255 (press)
+    uint16_t buttons;        // Button bits, set while held
+    uint8_t hat;             // d-pad: 0 released, 1-8 = N, NE, E, ... NW
+    bool connected;
+    uint32_t lastUpdateTime; // millis() timestamp
+    uint32_t arrivalUs;      // micros() when the report's notification arrived, 0 before the first
+  };
 
-    return 123456;
-  }
+  // Bits of ControllerState::buttons: HID buttons 1-15 of the Xbox Wireless
+  // Controller (firmware 5.x), button n in bit n - 1. View arrives as
+  // Consumer AC Back and is decoded onto button 11's bit.
+  enum Button
+  {
+    BUTTON_A = 1 << 0,
+    BUTTON_B = 1 << 1,
+    BUTTON_X = 1 << 3,
+    BUTTON_Y = 1 << 4,
+    BUTTON_LB = 1 << 6,
+    BUTTON_RB = 1 << 7,
+    BUTTON_VIEW = 1 << 10,
+    BUTTON_MENU = 1 << 11,
+    BUTTON_XBOX = 1 << 12,
+    BUTTON_LS = 1 << 13,
+    BUTTON_RS = 1 << 14
+  };
 
-  void onPassKeyNotify(uint32_t pass_key)
+  // Inputs named by button events: input n < 16 is bit n of buttons, the
+  // d-pad directions follow (a diagonal holds two of them)
+  enum Input
   {
-  }
+    INPUT_DPAD_UP = 16,
+    INPUT_DPAD_RIGHT,
+    INPUT_DPAD_DOWN,
+    INPUT_DPAD_LEFT,
+    INPUT_COUNT
+  };
 
-  bool onConfirmPIN(uint32_t pass_key)
+  // A press or release, queued by the notification path
+  struct ButtonEvent
   {
-    return true;
-  }
+    uint32_t atMs; // millis() when the report was decoded
+    uint8_t input; // Input, or the bit index of a Button
+    bool pressed;
+  };
+
+  static const size_t BUTTON_EVENT_QUEUE_SIZE = 32;
+
+  // Sees every raw input report before it is decoded, on the notification
+  // context, with the micros() its notification arrived. Must not block.
+  typedef void (*ReportTap)(void *context, const uint8_t *data, size_t length, uint32_t arrivalUs);
+
+  // Called on the notification context once a report that changed the
+  // input has been published, so snapshot() already returns it. Repeats of
+  // the previous report do not call it. Must not block.
+  typedef void (*InputHandler)(void *context, uint32_t arrivalUs);
 
-  bool onSecurityRequest()
+  // Source of the arrival stamps, micros() by default
+  typedef uint32_t (*ClockFn)(void);
+
+  // Outcome of reconnect() calls
+  struct ReconnectStats
   {
+    uint32_t attempts;
+    uint32_t fastPath;      // resumed from the bond cache
+    uint32_t slowPath;      // scanned and discovered
+    uint32_t failures;      // neither path connected
+    uint32_t cacheRejected; // cached handles refused by the peer
+    uint32_t lastMs;        // duration of the last successful reconnect
+    uint32_t maxMs;         // slowest successful reconnect
+  };
 
-    return true;
-  }
+  // Notification path counters, a cheap link-health signal
+  struct ReportStats
+  {
+    uint32_t total;          // notifications received
+    uint32_t unchanged;      // identical to the previous report, not decoded
+    uint32_t malformed;      // oversized or not decodable with the layout
+    uint32_t tooShort;       // shorter than the layout's report length
+    uint32_t lastIntervalUs; // between the last two notifications
+    uint32_t meanIntervalUs; // smoothed over ~8 notifications
+    uint32_t maxIntervalUs;
+    uint32_t jitterUs;       // smoothed |interval - mean| over ~16 notifications
+    uint32_t eventsDropped;  // button events lost to a full queue
+  };
 
-  void onAuthenticationComplete(esp_ble_auth_cmpl_t cmpl)
+  // Requested and accepted connection timing of the session
+  struct ConnectionInfo
   {
-  }
-};
+    BLEConnectionParams requested; // the profile, all zero if none is set
+    BLEConnectionParams accepted;  // in effect now, all zero while unknown
+    uint32_t requests;             // sent, one per connection
+    uint32_t failedRequests;       // the transport could not send
+  };
 
-class XboxBLEController
-{
-public:
-  struct ControllerState
+  // Outcome of scans, which stop at the first matching advertisement
+  struct ScanStats
   {
-    uint16_t leftStickX;   // 0 to 65535 (left to right)
-    uint16_t leftStickY;   // 0 to 65535 (up to down)
-    uint16_t leftTrigger;  // 0 to 1023 (press)
-    uint16_t rightTrigger; // 0 to 1023 (press)
-    bool connected;
-    uint32_t lastUpdateTime; // millis() timestamp
+    uint32_t scans;
+    uint32_t matches;        // scans that found a peer; the rest timed out
+    uint32_t advertisements; // seen by the matcher, across all scans
+    uint32_t lastMatchMs;    // scan start to the first match, last successful scan
+    uint32_t maxMatchMs;
+  };
+
+  // Scan duty cycles: continuous, half, and a tenth of the time listening
+  static const BLEScanProfile SCAN_FAST;
+  static const BLEScanProfile SCAN_BALANCED;
+  static const BLEScanProfile SCAN_LOW_POWER;
+
+  // Larger notifications are counted as malformed and dropped
+  static const size_t MAX_REPORT_LENGTH = 64;
+
+  // Connection state machine driven by step(); see startLink()
+  enum LinkState
+  {
+    LINK_IDLE,        // not managed
+    LINK_SCANNING,    // looking for a peer (or picking the cached one)
+    LINK_CONNECTING,  // connecting to / resuming the chosen peer
+    LINK_DISCOVERING, // locating the HID service
+    LINK_SUBSCRIBING, // reading the report map and enabling notifications
+    LINK_STREAMING,   // reports flowing; watching for link loss
+    LINK_BACKOFF      // waiting before the next attempt
+  };
+
+  struct LinkTransition
+  {
+    uint32_t atMs; // nowMs passed to the step() that made the transition
+    uint8_t from;  // LinkState
+    uint8_t to;    // LinkState
   };
 
-  XboxBLEController();
+  // Most recent transitions, oldest first once full
+  static const uint8_t LINK_HISTORY_SIZE = 16;
+  struct LinkHistory
+  {
+    LinkTransition entries[LINK_HISTORY_SIZE];
+    uint32_t count; // total transitions; entry i is at (count - n + i) % size
+  };
+
+  // Delay before retrying after a failed attempt, doubled up to the max
+  static const uint32_t LINK_BACKOFF_MIN_MS = 250;
+  static const uint32_t LINK_BACKOFF_MAX_MS = 8000;
+
+  // RSSI is read by step() this often while streaming, and retried sooner
+  // until the first reading arrives; a read can block, so never every step
+  static const uint32_t LINK_RSSI_INTERVAL_MS = 1000;
+  static const uint32_t LINK_RSSI_RETRY_MS = 100;
+
+  explicit XboxBLEController(BLETransport &transport);
   ~XboxBLEController();
 
   // Initialize BLE
   bool begin();
 
-  // Scan for Xbox controllers and connect to the first one found
+  // Scan for a controller accepted by the matcher that no other session
+  // holds (and that matches the peer filter, if set) and connect to it. The
+  // scan ends at the first such advertisement or after scanTimeMs.
   bool scanAndConnect(uint32_t scanTimeMs = 5000);
 
+  // Rules deciding which advertisements are controllers; change them before
+  // scanning
+  AdvertisementMatcher &getMatcher() { return matcher; }
+
+  // Radio timing of every following scan (SCAN_FAST by default)
+  void setScanProfile(const BLEScanProfile &profile) { scanProfile = profile; }
+  const BLEScanProfile &getScanProfile() const { return scanProfile; }
+
+  // Consistent copy of the scan counters (safe from any task)
+  ScanStats getScanStats() const { return publishedScanStats.read(); }
+
+  // Only accept this peer in scanAndConnect()
+  void setPeerFilter(const BLEPeerAddress &address);
+  void clearPeerFilter() { peerFilterSet = false; }
+
+  // Address of the connected peer (valid while connected)
+  const BLEPeerAddress &getPeerAddress() const { return peerAddress; }
+
+  // Maximum number of sessions holding a peer at the same time
+  static const uint8_t MAX_SESSIONS = 4;
+
+  // Persist this session's peer in store under slot after each full
+  // discovery, and let reconnect() resume from it
+  void setBondStore(BondStore *store, uint8_t slot);
+
+  // Resume the cached peer with a directed connect; fall back to
+  // scanAndConnect() when there is no cache or the peer rejects it
+  bool reconnect(uint32_t scanTimeMs = 5000);
+
+  const ReconnectStats &getReconnectStats() const { return reconnectStats; }
+
+  // Hand connection management to step(): from now on the session scans,
+  // connects, resumes and recovers from link loss on its own. Call step()
+  // from one task only (not the control loop); update(), snapshot() and the
+  // link getters stay non-blocking and safe from any task.
+  void startLink(uint32_t scanTimeMs = 5000);
+
+  // Disconnect and return to LINK_IDLE (from the task calling step())
+  void stopLink();
+
+  // Advance the link by at most one state. A call blocks for all of the
+  // current state's transport work: a whole scan in LINK_SCANNING, and in
+  // LINK_SUBSCRIBING the report map read, the subscription, the connection
+  // parameter request and the peer cache read back to back. Each operation
+  // is bounded only by the transport's own timeouts.
+  LinkState step(uint32_t nowMs);
+
+  LinkState getLinkState() const { return (LinkState)linkState.load(std::memory_order_acquire); }
+
+  // nowMs of the transition into the current state
+  uint32_t getLinkStateSince() const { return linkStateSince.load(std::memory_order_acquire); }
+
+  // Consistent copy of the transition history
+  LinkHistory getLinkHistory() const { return publishedHistory.read(); }
+
+  static const char *linkStateName(LinkState state);
+
+  // Request this connection timing now (if connected) and after every
+  // connect or resume. Call before startLink() or from the task calling step().
+  void setConnectionProfile(const BLEConnectionParams &profile);
+
+  // Consistent copy of the requested and accepted timing (safe from any task)
+  ConnectionInfo getConnectionInfo() const { return publishedConnection.read(); }
+
+  // Notifications per second, from the smoothed inter-arrival time
+  uint32_t getReportRateHz() const;
+
+  // Last RSSI read by step() in dBm, 0 until one has been read on this link
+  int8_t getRssi() const { return rssi.load(std::memory_order_relaxed); }
+
   // Update controller state (call in loop)
   bool update();
 
   // Disconnect from controller
   void disconnect();
 
+  // Get a consistent copy of the latest report (lock-free, safe from any task)
+  ControllerState snapshot() const;
+
   // Get current controller state
-  ControllerState getState() const { return state; }
+  ControllerState getState() const { return snapshot(); }
+
+  // Number of snapshot reads that raced a notification and had to retry
+  uint32_t getSnapshotRetries() const { return published.retryCount(); }
+
+  // Consistent copy of the report counters (safe from any task). Counters
+  // accumulate across connections; intervals restart on each connection.
+  ReportStats getReportStats() const { return publishedReportStats.read(); }
 
   // Check if connected
-  bool isConnected() const { return state.connected; }
+  bool isConnected() const { return connected.load(std::memory_order_acquire); }
+
+  // Take the oldest button event; false when there is none. Held inputs
+  // are released when the link goes down. Call from one task.
+  bool pollButtonEvent(ButtonEvent &event) { return buttonEvents.pop(event); }
+
+  // Held buttons and d-pad directions of state as one mask, bit n = input n
+  static uint32_t inputMask(const ControllerState &state);
+
+  // Input number of a button in ButtonEvent::input
+  static uint8_t buttonInput(Button button) { return (uint8_t)__builtin_ctz(button); }
 
   // Get normalized values for robot control ()
+  // Each call takes its own snapshot; read several axes from one snapshot()
+  // with the static helpers below when they must belong to the same report.
   float getLeftStickXNormalized() const;   // -1.0 to 1.0
   float getLeftStickYNormalized() const;   // -1.0 to 1.0
   float getLeftTriggerNormalized() const;  // 0.0 to 1.0
   float getRightTriggerNormalized() const; // 0.0 to 1.0
 
+  static float normalizeStick(int16_t value) { return value / 32768.0f; }
+  static float normalizeTrigger(uint16_t value) { return value / 255.0f; }
+
+  // Report layout compiled at connect time
+  const HIDReportMap &getReportMap() const { return reportMap; }
+
+  // Install a raw report tap (nullptr to remove); set before connecting
+  void setReportTap(ReportTap tap, void *context);
+
+  // Install an input change handler (nullptr to remove); set before connecting
+  void setInputHandler(InputHandler handler, void *context);
+
+  // Stamp arrivals with another clock (e.g. a fake one in tests); set
+  // before connecting
+  void setClock(ClockFn newClock) { clock = newClock; }
+
   // For testing purposes
-  void setStateForTesting(const ControllerState &testState) { state = testState; }
+  void setStateForTesting(const ControllerState &testState);
 
 private:
-  BLEClient *pClient;
-  BLERemoteCharacteristic *pInputReportCharacteristic;
-  BLEAddress *pServerAddress;
-  ControllerState state;
+  BLETransport &transport;
+  HIDReportMap reportMap;
+
+  // Working copy owned by the notification path; published once per report
+  ControllerState pending;
+  SeqLock<ControllerState> published;
+  std::atomic<bool> connected;
   bool initialized;
+  ReportTap reportTap;
+  void *reportTapContext;
+  InputHandler inputHandler;
+  void *inputHandlerContext;
+  ClockFn clock;
+  BLEPeerAddress peerAddress;
+  BLEPeerAddress peerFilter;
+
+  // Previous decoded report and arrival, owned by the notification path
+  uint8_t lastReport[MAX_REPORT_LENGTH];
+  size_t lastReportLength;
+  uint32_t lastArrivalUs;
+  bool lastArrivalValid;
+  ReportStats reportStats;
+  SeqLock<ReportStats> publishedReportStats;
+
+  // Inputs held in the last decoded report, owned by the notification path
+  uint32_t heldInputs;
+  LockFreeQueue<ButtonEvent, BUTTON_EVENT_QUEUE_SIZE> buttonEvents;
+  bool peerFilterSet;
+  BondStore *bondStore;
+  uint8_t bondSlot;
+  ReconnectStats reconnectStats;
+
+  // Peer the current report map was read from, to skip re-reading it on resume
+  BLEPeerAddress reportMapPeer;
+  bool reportMapFromPeer;
 
-  // Static map to track characteristic -> controller instance mappings
-  static std::map<BLERemoteCharacteristic *, XboxBLEController *> instanceMap;
+  // Link state machine, owned by the task calling step()
+  std::atomic<uint8_t> linkState;
+  std::atomic<uint32_t> linkStateSince;
+  LinkHistory history;
+  SeqLock<LinkHistory> publishedHistory;
+  uint32_t linkScanTimeMs;
+  uint32_t linkBackoffMs;
+  uint32_t linkAttemptStart;
+  bool linkResume;
+  BLEPeerCache linkCache;
+  std::atomic<int8_t> rssi;
+  uint32_t lastRssiMs;
+  bool connectionProfileSet;
+  ConnectionInfo connection;
+  SeqLock<ConnectionInfo> publishedConnection;
+
+  // Scanning, owned by the task calling scanAndConnect() or step(); the
+  // match is written by the scan callback while that task waits in scan()
+  AdvertisementMatcher matcher;
+  BLEScanProfile scanProfile;
+  ScanStats scanStats;
+  SeqLock<ScanStats> publishedScanStats;
+  uint32_t scanStartMs;
+  BLEAdvertisement scanMatch;
+
+  void setLinkState(LinkState state, uint32_t nowMs);
+  LinkState stepScanning();
+  LinkState stepConnecting();
+  LinkState enterBackoff();
+  bool loadUsableCache(BLEPeerCache &cache);
+  bool isCandidate(const BLEAdvertisement &device);
+  bool scanForPeer(uint32_t scanTimeMs);
+  void recordReconnect(uint32_t elapsedMs);
+  void requestConnectionProfile();
+  void pollConnectionParams();
+
+  // Peers held by any session, so concurrent sessions never share one
+  static XboxBLEController *claims[MAX_SESSIONS];
+  static bool isClaimedByOther(const XboxBLEController *session, const BLEPeerAddress &address);
+  bool claim(const BLEPeerAddress &address);
+  void releaseClaim();
 
   // Helper functions
-  bool isXboxController(BLEAdvertisedDevice *device);
-  bool connectToController(BLEAddress address);
-  bool findInputReportCharacteristic();
-  void parseReport(const uint8_t *data, uint16_t length);
+  bool connectToController(const BLEPeerAddress &address);
+  bool resumeController(const BLEPeerCache &cache);
+  bool completeConnection(bool resumed);
+  void loadReportMap(bool resumed);
+  void handleNotification(const uint8_t *data, size_t length, uint32_t arrivalUs);
+  bool parseReport(const uint8_t *data, uint16_t length);
+  void recordArrival(uint32_t arrivalUs);
+  void queueInputEdges(uint32_t inputs, uint32_t atMs);
   void resetState();
 
-  // Static callback for notifications
-  static void notificationCallback(
-      BLERemoteCharacteristic *pCharacteristic,
-      uint8_t *pData,
-      size_t length,
-      bool isNotify);
+  // Static callbacks for notifications and scan results
+  static void notificationCallback(void *context, const uint8_t *data, size_t length);
+  static bool advertisementCallback(void *context, const BLEAdvertisement &advertisement);
 };
 
+static_assert(sizeof(XboxBLEController::ControllerState) == 24, "ControllerState must stay free of padding");
+
 #endif // XBOX_BLE_CONTROLLER_H
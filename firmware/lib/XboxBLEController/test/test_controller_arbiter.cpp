@@ -0,0 +1,216 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "ControllerArbiter.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+// Two simulated peripherals visible to every session's transport
+static const BLEAdvertisement PAD_A = {{{0xA1, 0, 0, 0, 0, 1}}, "Xbox Wireless Controller", true, true, -40};
+static const BLEAdvertisement PAD_B = {{{0xB2, 0, 0, 0, 0, 2}}, "Xbox Wireless Controller", true, true, -60};
+
+static const uint8_t OPERATOR = 0;
+static const uint8_t SUPERVISOR = 1;
+
+SimulatedBLETransport *transports[2];
+XboxBLEController *sessions[2];
+
+static const ControllerArbiter::Config PRIORITY_CONFIG = {ControllerArbiter::PRIORITY, 0, 200, 4000, 20};
+
+void setUp(void) {
+    for (int i = 0; i < 2; i++) {
+        transports[i] = new SimulatedBLETransport();
+        transports[i]->addPeripheral(PAD_A);
+        transports[i]->addPeripheral(PAD_B);
+        sessions[i] = new XboxBLEController(*transports[i]);
+        sessions[i]->begin();
+    }
+}
+
+void tearDown(void) {
+    for (int i = 0; i < 2; i++) {
+        delete sessions[i];
+        delete transports[i];
+    }
+}
+
+// Send a raw Xbox input report (sticks unsigned, centered at 32768)
+static void sendReport(uint8_t session, uint16_t lx, uint16_t ly, uint16_t lt, uint16_t rt) {
+    uint8_t report[16];
+    memset(report, 0, sizeof(report));
+    report[0] = lx & 0xFF; report[1] = lx >> 8;
+    report[2] = ly & 0xFF; report[3] = ly >> 8;
+    report[8] = lt & 0xFF; report[9] = lt >> 8;
+    report[10] = rt & 0xFF; report[11] = rt >> 8;
+    TEST_ASSERT_TRUE(transports[session]->emit(report, sizeof(report)));
+}
+
+static void connectBoth(void) {
+    TEST_ASSERT_TRUE(sessions[OPERATOR]->scanAndConnect(1000));
+    TEST_ASSERT_TRUE(sessions[SUPERVISOR]->scanAndConnect(1000));
+}
+
+// Test concurrent sessions never connect to the same peer
+void test_sessions_claim_distinct_peers(void) {
+    connectBoth();
+    TEST_ASSERT_TRUE(sessions[OPERATOR]->getPeerAddress() == PAD_A.address);
+    TEST_ASSERT_TRUE(sessions[SUPERVISOR]->getPeerAddress() == PAD_B.address);
+
+    // Once released, a peer is available to other sessions again
+    sessions[OPERATOR]->disconnect();
+    sessions[SUPERVISOR]->disconnect();
+    TEST_ASSERT_TRUE(sessions[SUPERVISOR]->scanAndConnect(1000));
+    TEST_ASSERT_TRUE(sessions[SUPERVISOR]->getPeerAddress() == PAD_A.address);
+}
+
+// Test a peer filter pins a session to one controller
+void test_peer_filter(void) {
+    sessions[SUPERVISOR]->setPeerFilter(PAD_B.address);
+    TEST_ASSERT_TRUE(sessions[SUPERVISOR]->scanAndConnect(1000));
+    TEST_ASSERT_TRUE(sessions[SUPERVISOR]->getPeerAddress() == PAD_B.address);
+    TEST_ASSERT_TRUE(sessions[OPERATOR]->scanAndConnect(1000));
+    TEST_ASSERT_TRUE(sessions[OPERATOR]->getPeerAddress() == PAD_A.address);
+}
+
+// Test the supervisor takes over while deflecting and hands back after the hold
+void test_supervisor_overrides_operator(void) {
+    connectBoth();
+    ControllerArbiter arbiter(PRIORITY_CONFIG);
+    arbiter.addSource(*sessions[OPERATOR], 1);
+    arbiter.addSource(*sessions[SUPERVISOR], 2);
+    ControllerArbiter::Result result;
+    uint32_t now = millis();
+
+    sendReport(OPERATOR, 65535, 32768, 0, 1023);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(now, result));
+    TEST_ASSERT_EQUAL_INT8(OPERATOR, result.source);
+    TEST_ASSERT_EQUAL_UINT16(255, result.state.rightTrigger);
+
+    sendReport(SUPERVISOR, 32768, 0, 1023, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(now + 10, result));
+    TEST_ASSERT_EQUAL_INT8(SUPERVISOR, result.source);
+    TEST_ASSERT_EQUAL_UINT16(255, result.state.leftTrigger);
+    TEST_ASSERT_EQUAL_UINT16(0, result.state.rightTrigger);
+
+    // Supervisor lets go: still in control during the hold time
+    sendReport(SUPERVISOR, 32768, 32768, 0, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(now + 100, result));
+    TEST_ASSERT_EQUAL_INT8(SUPERVISOR, result.source);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(now + 300, result));
+    TEST_ASSERT_EQUAL_INT8(OPERATOR, result.source);
+    TEST_ASSERT_EQUAL_UINT32(3, arbiter.getSwitchCount());
+}
+
+// Test an idle supervisor does not shadow an active operator, and a
+// disconnected one is ignored
+void test_idle_and_disconnected_sources(void) {
+    connectBoth();
+    ControllerArbiter arbiter(PRIORITY_CONFIG);
+    arbiter.addSource(*sessions[OPERATOR], 1);
+    arbiter.addSource(*sessions[SUPERVISOR], 2);
+    ControllerArbiter::Result result;
+
+    // Nobody touching anything: the highest priority idle source is reported
+    TEST_ASSERT_TRUE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_EQUAL_INT8(SUPERVISOR, result.source);
+
+    sendReport(OPERATOR, 32768, 0, 0, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_EQUAL_INT8(OPERATOR, result.source);
+
+    sessions[OPERATOR]->disconnect();
+    sessions[SUPERVISOR]->disconnect();
+    TEST_ASSERT_FALSE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_EQUAL_INT8(ControllerArbiter::NO_SOURCE, result.source);
+    TEST_ASSERT_FALSE(result.state.connected);
+}
+
+// Test deflected input that stopped updating loses its override
+void test_stale_input_dropped(void) {
+    connectBoth();
+    ControllerArbiter::Config config = PRIORITY_CONFIG;
+    config.staleAfterMs = 50;
+    config.holdMs = 0;
+    ControllerArbiter arbiter(config);
+    arbiter.addSource(*sessions[OPERATOR], 1);
+    arbiter.addSource(*sessions[SUPERVISOR], 2);
+    ControllerArbiter::Result result;
+
+    sendReport(SUPERVISOR, 65535, 32768, 0, 0);
+    sendReport(OPERATOR, 32768, 0, 0, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_EQUAL_INT8(SUPERVISOR, result.source);
+
+    // Only the operator keeps reporting
+    delay(80);
+    sendReport(OPERATOR, 32768, 0, 0, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_EQUAL_INT8(OPERATOR, result.source);
+
+    // Nothing fresh left
+    delay(80);
+    TEST_ASSERT_FALSE(arbiter.arbitrate(millis(), result));
+}
+
+// Test blending averages active sources of equal priority by weight
+void test_blend_equal_priority(void) {
+    connectBoth();
+    ControllerArbiter::Config config = PRIORITY_CONFIG;
+    config.mode = ControllerArbiter::BLEND;
+    ControllerArbiter arbiter(config);
+    arbiter.addSource(*sessions[OPERATOR], 1, 3);
+    arbiter.addSource(*sessions[SUPERVISOR], 1, 1);
+    ControllerArbiter::Result result;
+
+    sendReport(OPERATOR, 32768 + 20000, 32768, 1023, 0);
+    sendReport(SUPERVISOR, 32768 - 20000, 32768, 0, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_EQUAL_UINT8(2, result.contributing);
+    TEST_ASSERT_EQUAL_UINT8((1 << OPERATOR) | (1 << SUPERVISOR), result.sourceMask);
+    TEST_ASSERT_EQUAL_INT8(ControllerArbiter::NO_SOURCE, result.source);
+    TEST_ASSERT_EQUAL_INT16(10000, result.state.leftStickX);
+    TEST_ASSERT_EQUAL_UINT16(191, result.state.leftTrigger);
+    TEST_ASSERT_EQUAL_INT16(-32768, result.state.rightStickX); // both released (raw 0)
+
+    // The blend carries the newest arrival of its sources
+    uint32_t supervisorUs = sessions[SUPERVISOR]->snapshot().arrivalUs;
+    TEST_ASSERT_TRUE(supervisorUs != 0);
+    TEST_ASSERT_EQUAL_UINT32(supervisorUs, result.state.arrivalUs);
+    uint32_t sentUs = micros();
+    while (micros() == sentUs) {
+    }
+    sendReport(OPERATOR, 32768 + 21000, 32768, 1023, 0);
+    TEST_ASSERT_TRUE(arbiter.arbitrate(millis(), result));
+    TEST_ASSERT_TRUE(result.state.arrivalUs != supervisorUs);
+    TEST_ASSERT_EQUAL_UINT32(sessions[OPERATOR]->snapshot().arrivalUs, result.state.arrivalUs);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sessions_claim_distinct_peers);
+    RUN_TEST(test_peer_filter);
+    RUN_TEST(test_supervisor_overrides_operator);
+    RUN_TEST(test_idle_and_disconnected_sources);
+    RUN_TEST(test_stale_input_dropped);
+    RUN_TEST(test_blend_equal_priority);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
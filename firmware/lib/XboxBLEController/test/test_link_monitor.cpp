@@ -0,0 +1,252 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "LinkMonitor.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+SimulatedBLETransport* transport;
+XboxBLEController* controller;
+
+// 50 ms without a report is stale; zero command 100 ms later
+static const LinkMonitor::Config CONFIG = {50, 100, 100, 0, -80, 100};
+
+void setUp(void) {
+    transport = new SimulatedBLETransport();
+    controller = new XboxBLEController(*transport);
+}
+
+void tearDown(void) {
+    transport->stopStreaming();
+    delete controller;
+    delete transport;
+}
+
+static void connectSimulatedController(void) {
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport->addPeripheral(advertisement);
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+}
+
+static size_t movingReport(void *context, uint32_t index, uint8_t *report, size_t capacity) {
+    memset(report, 0, 16);
+    report[0] = index & 0xFF;
+    report[1] = 0x80;
+    report[3] = 0x80;
+    return 16;
+}
+
+struct StaleLog {
+    uint32_t raised;
+    uint32_t cleared;
+    uint32_t raisedAtMs;
+};
+
+static StaleLog staleLog;
+
+static void recordStale(void *context, bool stale) {
+    if (stale) {
+        staleLog.raised++;
+        staleLog.raisedAtMs = millis();
+    } else {
+        staleLog.cleared++;
+    }
+}
+
+// Run the monitor like the control loop does, until cond() or timeout
+template <typename Condition>
+static bool runUntil(LinkMonitor &monitor, Condition cond, uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (millis() - start < timeoutMs) {
+        monitor.update(millis());
+        if (cond(monitor)) {
+            return true;
+        }
+        delay(2);
+    }
+    return false;
+}
+
+static bool isFullScale(LinkMonitor &m) { return m.getScaleQ15() == LinkMonitor::FULL_SCALE; }
+static bool isZeroScale(LinkMonitor &m) { return m.getScaleQ15() == 0; }
+static bool isStale(LinkMonitor &m) { return m.isStale(); }
+
+// Test a healthy stream reports its rate and keeps the command at full scale
+void test_healthy_stream(void) {
+    connectSimulatedController();
+    LinkMonitor monitor(*controller, CONFIG);
+    TEST_ASSERT_TRUE(monitor.isStale());
+    TEST_ASSERT_EQUAL_INT16(0, monitor.getScaleQ15());
+
+    transport->setReportGenerator(movingReport, nullptr);
+    SimulatedBLETransport::StreamConfig stream = {500, 1, 0};
+    TEST_ASSERT_TRUE(transport->startStreaming(stream));
+
+    // Ramps up from the initial stale state within rampDownMs
+    TEST_ASSERT_TRUE(runUntil(monitor, isFullScale, 200));
+    delay(250);
+    monitor.update(millis());
+    const LinkMonitor::Metrics &metrics = monitor.update(millis());
+    TEST_ASSERT_FALSE(metrics.stale);
+    TEST_ASSERT_FALSE(metrics.degraded);
+    TEST_ASSERT_UINT32_WITHIN(150, 500, metrics.rateHz);
+    TEST_ASSERT_TRUE(metrics.ageMs < CONFIG.staleAfterMs);
+    TEST_ASSERT_EQUAL_UINT32(0, metrics.staleEvents);
+    TEST_ASSERT_EQUAL_INT16(16383, monitor.apply(16384)); // 32767/32768 of the command
+}
+
+// Test an injected dropout raises the stale event and zeroes the command in bounded time
+void test_dropout_ramps_down_and_recovers(void) {
+    connectSimulatedController();
+    staleLog = StaleLog();
+    LinkMonitor monitor(*controller, CONFIG);
+    monitor.setStaleHandler(recordStale, nullptr);
+
+    transport->setReportGenerator(movingReport, nullptr);
+    SimulatedBLETransport::StreamConfig stream = {500, 1, 0};
+    TEST_ASSERT_TRUE(transport->startStreaming(stream));
+    TEST_ASSERT_TRUE(runUntil(monitor, isFullScale, 200));
+    uint32_t clearedBefore = staleLog.cleared;
+
+    uint32_t dropoutMs = millis();
+    transport->injectDropout(400);
+    TEST_ASSERT_TRUE(runUntil(monitor, isZeroScale, 400));
+    uint32_t zeroAfterMs = millis() - dropoutMs;
+
+    TEST_ASSERT_EQUAL_UINT32(1, staleLog.raised);
+    TEST_ASSERT_UINT32_WITHIN(20, CONFIG.staleAfterMs + 10, staleLog.raisedAtMs - dropoutMs);
+    TEST_ASSERT_TRUE(zeroAfterMs <= CONFIG.staleAfterMs + CONFIG.rampDownMs + 20);
+    TEST_ASSERT_TRUE(zeroAfterMs >= CONFIG.staleAfterMs + CONFIG.rampDownMs - 10);
+    TEST_ASSERT_TRUE(controller->isConnected());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, transport->getWithheldCount());
+
+    // Reports resume after the dropout; the command climbs back
+    TEST_ASSERT_TRUE(runUntil(monitor, isFullScale, 600));
+    TEST_ASSERT_EQUAL_UINT32(clearedBefore + 1, staleLog.cleared);
+    TEST_ASSERT_EQUAL_UINT32(1, monitor.getMetrics().staleEvents);
+}
+
+// Test dropouts shorter than the threshold pass without a stale event
+void test_short_dropouts_tolerated(void) {
+    connectSimulatedController();
+    LinkMonitor monitor(*controller, CONFIG);
+
+    transport->setReportGenerator(movingReport, nullptr);
+    SimulatedBLETransport::StreamConfig stream = {500, 1, 0};
+    TEST_ASSERT_TRUE(transport->startStreaming(stream));
+    TEST_ASSERT_TRUE(runUntil(monitor, isFullScale, 200));
+
+    for (int i = 0; i < 5; i++) {
+        transport->injectDropout(20);
+        TEST_ASSERT_FALSE(runUntil(monitor, isStale, 60));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, monitor.getMetrics().staleEvents);
+    TEST_ASSERT_EQUAL_INT16(LinkMonitor::FULL_SCALE, monitor.getScaleQ15());
+    TEST_ASSERT_TRUE(controller->getReportStats().jitterUs > 0);
+}
+
+// Test link loss is stale at once, and a slow but live link is only degraded
+void test_link_loss_and_degraded_link(void) {
+    connectSimulatedController();
+    LinkMonitor monitor(*controller, CONFIG);
+
+    // 40 Hz is fresh enough for a 50 ms threshold but under the 100 Hz minimum
+    transport->setReportGenerator(movingReport, nullptr);
+    SimulatedBLETransport::StreamConfig stream = {40, 1, 0};
+    TEST_ASSERT_TRUE(transport->startStreaming(stream));
+    TEST_ASSERT_TRUE(runUntil(monitor, isFullScale, 300));
+    delay(250);
+    monitor.update(millis());
+    TEST_ASSERT_FALSE(monitor.isStale());
+    TEST_ASSERT_TRUE(monitor.getMetrics().degraded);
+    TEST_ASSERT_UINT32_WITHIN(15, 40, monitor.getMetrics().rateHz);
+
+    transport->dropLink();
+    controller->update();
+    monitor.update(millis());
+    TEST_ASSERT_TRUE(monitor.isStale());
+    TEST_ASSERT_FALSE(monitor.getMetrics().degraded);
+}
+
+// Test RSSI is sampled by step() and checked against the floor
+void test_rssi_from_link_task(void) {
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport->addPeripheral(advertisement);
+    TEST_ASSERT_TRUE(controller->begin());
+    controller->startLink(1000);
+    uint32_t t = controller->getLinkStateSince();
+    for (int i = 1; i <= 5; i++) {
+        controller->step(t + i * 10);
+    }
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->getLinkState());
+    TEST_ASSERT_EQUAL_INT8(-60, controller->getRssi());
+
+    transport->setRssi(-90);
+    controller->step(t + 500);
+    TEST_ASSERT_EQUAL_INT8(-60, controller->getRssi()); // not due yet
+    controller->step(t + 50 + XboxBLEController::LINK_RSSI_INTERVAL_MS);
+    TEST_ASSERT_EQUAL_INT8(-90, controller->getRssi());
+
+    LinkMonitor monitor(*controller, CONFIG);
+    transport->setReportGenerator(movingReport, nullptr);
+    SimulatedBLETransport::StreamConfig stream = {500, 1, 0};
+    TEST_ASSERT_TRUE(transport->startStreaming(stream));
+    delay(150);
+    monitor.update(millis());
+    delay(150);
+    monitor.update(millis());
+    TEST_ASSERT_EQUAL_INT8(-90, monitor.getMetrics().rssiDbm);
+    TEST_ASSERT_TRUE(monitor.getMetrics().degraded);
+}
+
+// Test a missing reading is retried at the retry interval, not every step
+void test_rssi_retry_is_rate_limited(void) {
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport->addPeripheral(advertisement);
+    transport->setRssi(0);
+    TEST_ASSERT_TRUE(controller->begin());
+    controller->startLink(1000);
+    uint32_t t = controller->getLinkStateSince();
+    for (int i = 1; i <= 5; i++) {
+        controller->step(t + i * 10);
+    }
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->getLinkState());
+    TEST_ASSERT_EQUAL_INT8(0, controller->getRssi());
+
+    // Read on one of the steps above, so the next step is too soon to retry
+    transport->setRssi(-70);
+    controller->step(t + 60);
+    TEST_ASSERT_EQUAL_INT8(0, controller->getRssi());
+    uint32_t due = t + 50 + XboxBLEController::LINK_RSSI_RETRY_MS;
+    controller->step(due);
+    TEST_ASSERT_EQUAL_INT8(-70, controller->getRssi());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_healthy_stream);
+    RUN_TEST(test_dropout_ramps_down_and_recovers);
+    RUN_TEST(test_short_dropouts_tolerated);
+    RUN_TEST(test_link_loss_and_degraded_link);
+    RUN_TEST(test_rssi_from_link_task);
+    RUN_TEST(test_rssi_retry_is_rate_limited);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
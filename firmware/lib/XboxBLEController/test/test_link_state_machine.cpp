@@ -0,0 +1,194 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include "BondStore.h"
+#include "SimulatedBLETransport.h"
+#include "XboxBLEController.h"
+
+SimulatedBLETransport* transport;
+XboxBLEController* controller;
+
+void setUp(void) {
+    transport = new SimulatedBLETransport();
+    controller = new XboxBLEController(*transport);
+}
+
+void tearDown(void) {
+    delete controller;
+    delete transport;
+}
+
+static void addSimulatedController(void) {
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport->addPeripheral(advertisement);
+}
+
+// Test each step() call advances one state and every transition is stamped
+void test_link_connects_one_state_per_step(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_IDLE, controller->getLinkState());
+
+    controller->startLink(1000);
+    uint32_t t = controller->getLinkStateSince();
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_CONNECTING, controller->step(t + 10));
+    TEST_ASSERT_FALSE(controller->update());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_DISCOVERING, controller->step(t + 20));
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_SUBSCRIBING, controller->step(t + 30));
+    TEST_ASSERT_FALSE(controller->update());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->step(t + 40));
+    TEST_ASSERT_TRUE(controller->update());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->step(t + 50));
+    TEST_ASSERT_EQUAL_UINT32(t + 40, controller->getLinkStateSince());
+
+    XboxBLEController::LinkHistory history = controller->getLinkHistory();
+    TEST_ASSERT_EQUAL_UINT32(5, history.count);
+    TEST_ASSERT_EQUAL_UINT8(XboxBLEController::LINK_IDLE, history.entries[0].from);
+    TEST_ASSERT_EQUAL_UINT8(XboxBLEController::LINK_SCANNING, history.entries[0].to);
+    TEST_ASSERT_EQUAL_UINT32(t + 30, history.entries[3].atMs);
+    TEST_ASSERT_EQUAL_UINT8(XboxBLEController::LINK_STREAMING, history.entries[4].to);
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getReconnectStats().slowPath);
+}
+
+// Test link loss is handled by step(), resuming the bonded peer without a scan
+void test_link_loss_resumes_from_bond_cache(void) {
+    MemoryBondStore store;
+    controller->setBondStore(&store, 0);
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    controller->startLink(1000);
+    uint32_t t = controller->getLinkStateSince();
+    for (int i = 1; i <= 4; i++) {
+        controller->step(t + i);
+    }
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->getLinkState());
+    uint32_t scans = transport->getScanCount();
+
+    transport->dropLink();
+    // update() does not touch the transport of a managed link
+    TEST_ASSERT_TRUE(controller->update());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_SCANNING, controller->step(t + 100));
+    TEST_ASSERT_FALSE(controller->update());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_CONNECTING, controller->step(t + 110));
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_SUBSCRIBING, controller->step(t + 120));
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->step(t + 130));
+    TEST_ASSERT_TRUE(controller->update());
+
+    TEST_ASSERT_EQUAL_UINT32(scans, transport->getScanCount());
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getResumeCount());
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getReconnectStats().fastPath);
+    TEST_ASSERT_EQUAL_UINT32(30, controller->getReconnectStats().lastMs);
+}
+
+// Test failed scans back off with a doubling delay and no scan in between
+void test_link_backs_off_without_peer(void) {
+    TEST_ASSERT_TRUE(controller->begin());
+    controller->startLink(1000);
+    uint32_t t = controller->getLinkStateSince();
+
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_BACKOFF, controller->step(t));
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getScanCount());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_BACKOFF, controller->step(t + XboxBLEController::LINK_BACKOFF_MIN_MS - 1));
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_SCANNING, controller->step(t + XboxBLEController::LINK_BACKOFF_MIN_MS));
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getScanCount());
+
+    uint32_t t2 = t + XboxBLEController::LINK_BACKOFF_MIN_MS;
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_BACKOFF, controller->step(t2));
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_BACKOFF, controller->step(t2 + XboxBLEController::LINK_BACKOFF_MIN_MS));
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_SCANNING, controller->step(t2 + 2 * XboxBLEController::LINK_BACKOFF_MIN_MS));
+    TEST_ASSERT_EQUAL_UINT32(2, transport->getScanCount());
+    TEST_ASSERT_EQUAL_UINT32(2, controller->getReconnectStats().failures);
+
+    // A controller showing up ends the backoff cycle
+    addSimulatedController();
+    uint32_t t3 = t2 + 2 * XboxBLEController::LINK_BACKOFF_MIN_MS;
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_CONNECTING, controller->step(t3));
+
+    controller->stopLink();
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_IDLE, controller->getLinkState());
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_IDLE, controller->step(t3 + 10));
+}
+
+// Step the link until it streams again
+static void stepUntilStreaming(uint32_t &t) {
+    for (int i = 0; i < 10 && controller->getLinkState() != XboxBLEController::LINK_STREAMING; i++) {
+        t += 10;
+        controller->step(t);
+    }
+    TEST_ASSERT_EQUAL(XboxBLEController::LINK_STREAMING, controller->getLinkState());
+}
+
+// Test the connection profile is requested on every connection and the peer's answer recorded
+void test_connection_profile_after_reconnect(void) {
+    MemoryBondStore store;
+    controller->setBondStore(&store, 0);
+    addSimulatedController();
+    transport->setPeerMinInterval(9); // peer settles on 11.25 ms at best
+    BLEConnectionParams profile = {6, 12, 0, 100};
+    controller->setConnectionProfile(profile);
+    TEST_ASSERT_TRUE(controller->begin());
+    controller->startLink(1000);
+    uint32_t t = controller->getLinkStateSince();
+    stepUntilStreaming(t);
+
+    XboxBLEController::ConnectionInfo info = controller->getConnectionInfo();
+    TEST_ASSERT_EQUAL_UINT32(1, info.requests);
+    TEST_ASSERT_EQUAL_UINT16(6, info.requested.minInterval);
+    TEST_ASSERT_EQUAL_UINT16(9, info.accepted.minInterval);
+    TEST_ASSERT_EQUAL_UINT16(0, info.accepted.latency);
+    TEST_ASSERT_EQUAL_UINT16(100, info.accepted.timeout);
+
+    // Resumed link: requested again
+    transport->dropLink();
+    controller->step(t += 10);
+    TEST_ASSERT_EQUAL_UINT16(0, controller->getConnectionInfo().accepted.minInterval);
+    stepUntilStreaming(t);
+    TEST_ASSERT_EQUAL_UINT32(1, transport->getResumeCount());
+    TEST_ASSERT_EQUAL_UINT32(2, controller->getConnectionInfo().requests);
+    TEST_ASSERT_EQUAL_UINT32(2, transport->getConnectionUpdateCount());
+
+    // A request that cannot be sent is counted; the link still opened with the preference
+    transport->setFailConnectionUpdate(true);
+    transport->dropLink();
+    controller->step(t += 10);
+    stepUntilStreaming(t);
+    info = controller->getConnectionInfo();
+    TEST_ASSERT_EQUAL_UINT32(3, info.requests);
+    TEST_ASSERT_EQUAL_UINT32(1, info.failedRequests);
+    TEST_ASSERT_EQUAL_UINT16(9, info.accepted.minInterval);
+
+    // A new profile applies to the live connection right away
+    transport->setFailConnectionUpdate(false);
+    BLEConnectionParams relaxed = {24, 40, 4, 400};
+    controller->setConnectionProfile(relaxed);
+    info = controller->getConnectionInfo();
+    TEST_ASSERT_EQUAL_UINT32(4, info.requests);
+    TEST_ASSERT_EQUAL_UINT16(24, info.accepted.minInterval);
+    TEST_ASSERT_EQUAL_UINT16(4, info.accepted.latency);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_link_connects_one_state_per_step);
+    RUN_TEST(test_link_loss_resumes_from_bond_cache);
+    RUN_TEST(test_link_backs_off_without_peer);
+    RUN_TEST(test_connection_profile_after_reconnect);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
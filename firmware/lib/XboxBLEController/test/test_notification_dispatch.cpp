@@ -0,0 +1,216 @@
+#ifdef UNIT_TEST
+
+#include <unity.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include "ArduinoUtils.h"
+#include "NotificationDispatch.h"
+
+struct Receiver
+{
+    uint32_t count;
+    uint32_t sum;
+};
+
+static void receive(void *context, const uint8_t *data, size_t length) {
+    Receiver *receiver = (Receiver *)context;
+    receiver->count++;
+    receiver->sum += data[0];
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Test notifications reach the callback bound to their slot
+void test_dispatch_to_bound_slot(void) {
+    NotificationDispatch table;
+    Receiver a = {0, 0};
+    Receiver b = {0, 0};
+    int8_t slotA = table.acquire();
+    int8_t slotB = table.acquire();
+    TEST_ASSERT_TRUE(table.bind(slotA, receive, &a));
+    TEST_ASSERT_TRUE(table.bind(slotB, receive, &b));
+
+    uint8_t data[] = {7};
+    TEST_ASSERT_TRUE(table.dispatch(slotA, data, 1));
+    TEST_ASSERT_TRUE(table.dispatch(slotB, data, 1));
+    TEST_ASSERT_TRUE(table.dispatch(slotB, data, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, a.count);
+    TEST_ASSERT_EQUAL_UINT32(2, b.count);
+}
+
+// Test the table has a fixed capacity and released slots are reused
+void test_capacity_and_reuse(void) {
+    NotificationDispatch table;
+    for (uint8_t i = 0; i < NotificationDispatch::MAX_SLOTS; i++) {
+        TEST_ASSERT_TRUE(table.acquire() != NotificationDispatch::NO_SLOT);
+    }
+    TEST_ASSERT_EQUAL_INT8(NotificationDispatch::NO_SLOT, table.acquire());
+
+    table.release(2);
+    TEST_ASSERT_EQUAL_INT8(2, table.acquire());
+    TEST_ASSERT_EQUAL_UINT8(NotificationDispatch::MAX_SLOTS, table.getUsedCount());
+}
+
+// Test late notifications after release are counted, not delivered
+void test_no_delivery_after_release(void) {
+    NotificationDispatch table;
+    Receiver receiver = {0, 0};
+    int8_t slot = table.acquire();
+    table.bind(slot, receive, &receiver);
+    table.release(slot);
+
+    uint8_t data[] = {1};
+    TEST_ASSERT_FALSE(table.dispatch(slot, data, 1));
+    TEST_ASSERT_FALSE(table.dispatch(NotificationDispatch::MAX_SLOTS, data, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.count);
+    TEST_ASSERT_EQUAL_UINT32(2, table.getUnroutedCount());
+}
+
+static std::atomic<bool> slowEntered;
+static std::atomic<bool> slowFinished;
+
+static void slowReceive(void *context, const uint8_t *data, size_t length) {
+    slowEntered.store(true);
+    delay(20);
+    slowFinished.store(true);
+}
+
+// Test release() waits for a callback already running on another thread
+void test_release_waits_for_in_flight_callback(void) {
+    NotificationDispatch table;
+    int8_t slot = table.acquire();
+    table.bind(slot, slowReceive, nullptr);
+    slowEntered.store(false);
+    slowFinished.store(false);
+
+    uint8_t data[] = {1};
+    std::thread notifier([&table, slot, &data]() { table.dispatch(slot, data, 1); });
+    while (!slowEntered.load()) {
+        std::this_thread::yield();
+    }
+
+    table.release(slot);
+    TEST_ASSERT_TRUE(slowFinished.load());
+    notifier.join();
+}
+
+// Benchmark: per-notification cost of the old map lookup vs the slot table
+void test_benchmark_map_vs_slot_table(void) {
+    const uint32_t ITERATIONS = 2000000;
+    uint8_t data[] = {1};
+
+    // Old scheme: characteristic pointer -> instance through a std::map
+    // holding one entry per live subscription
+    Receiver mapReceivers[4] = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+    int characteristics[4];
+    std::map<void *, Receiver *> instanceMap;
+    for (int i = 0; i < 4; i++) {
+        instanceMap[&characteristics[i]] = &mapReceivers[i];
+    }
+    void *volatile key = &characteristics[1];
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        std::map<void *, Receiver *>::iterator it = instanceMap.find((void *)key);
+        if (it != instanceMap.end()) {
+            receive(it->second, data, 1);
+        }
+    }
+    uint32_t mapUs = micros() - start;
+
+    // The map with the lock it needs to be safe against a concurrent erase
+    std::mutex mapMutex;
+    start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        std::map<void *, Receiver *>::iterator it = instanceMap.find((void *)key);
+        if (it != instanceMap.end()) {
+            receive(it->second, data, 1);
+        }
+    }
+    uint32_t lockedMapUs = micros() - start;
+
+    NotificationDispatch table;
+    Receiver slotReceivers[4] = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+    for (int i = 0; i < 4; i++) {
+        table.bind(table.acquire(), receive, &slotReceivers[i]);
+    }
+    volatile uint8_t slot = 1;
+
+    start = micros();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        table.dispatch(slot, data, 1);
+    }
+    uint32_t tableUs = micros() - start;
+
+    TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, mapReceivers[1].count);
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, slotReceivers[1].count);
+    printf("  notify: std::map %.1f ns, std::map + mutex %.1f ns, slot table %.1f ns\n",
+           mapUs * 1000.0 / ITERATIONS, lockedMapUs * 1000.0 / ITERATIONS,
+           tableUs * 1000.0 / ITERATIONS);
+}
+
+// Benchmark: subscribe/disconnect churn, where the map allocates a node
+void test_benchmark_reconnect_churn(void) {
+    const uint32_t CYCLES = 500000;
+    int characteristic;
+    Receiver receiver = {0, 0};
+
+    std::map<void *, Receiver *> instanceMap;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < CYCLES; i++) {
+        instanceMap[&characteristic] = &receiver;
+        instanceMap.erase(&characteristic);
+    }
+    uint32_t mapUs = micros() - start;
+
+    NotificationDispatch table;
+    start = micros();
+    for (uint32_t i = 0; i < CYCLES; i++) {
+        int8_t slot = table.acquire();
+        table.bind(slot, receive, &receiver);
+        table.release(slot);
+    }
+    uint32_t tableUs = micros() - start;
+
+    TEST_ASSERT_EQUAL_UINT8(0, table.getUsedCount());
+    printf("  reconnect: std::map insert/erase %.1f ns, slot acquire/bind/release %.1f ns\n",
+           mapUs * 1000.0 / CYCLES, tableUs * 1000.0 / CYCLES);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_dispatch_to_bound_slot);
+    RUN_TEST(test_capacity_and_reuse);
+    RUN_TEST(test_no_delivery_after_release);
+    RUN_TEST(test_release_waits_for_in_flight_callback);
+    RUN_TEST(test_benchmark_map_vs_slot_table);
+    RUN_TEST(test_benchmark_reconnect_churn);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
+}
+
+void loop() {
+    // Tests run once in setup()
+}
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
+
+#endif // UNIT_TEST
@@ -1,16 +1,56 @@
 #ifdef UNIT_TEST
 
 #include <unity.h>
+#include <atomic>
+#include <thread>
+#include "BondStore.h"
+#include "SimulatedBLETransport.h"
 #include "XboxBLEController.h"
 
+SimulatedBLETransport* transport;
 XboxBLEController* controller;
 
 void setUp(void) {
-    controller = new XboxBLEController();
+    transport = new SimulatedBLETransport();
+    controller = new XboxBLEController(*transport);
 }
 
 void tearDown(void) {
     delete controller;
+    delete transport;
+}
+
+// Build a raw Xbox input report (sticks unsigned, centered at 32768)
+static size_t makeReport(uint8_t *report, uint16_t lx, uint16_t ly, uint16_t lt, uint16_t rt) {
+    memset(report, 0, 16);
+    report[0] = lx & 0xFF; report[1] = lx >> 8;
+    report[2] = ly & 0xFF; report[3] = ly >> 8;
+    report[8] = lt & 0xFF; report[9] = lt >> 8;
+    report[10] = rt & 0xFF; report[11] = rt >> 8;
+    return 16;
+}
+
+// Same, with the right stick, d-pad (hat) and buttons
+static size_t makeFullReport(uint8_t *report, uint16_t lx, uint16_t ly, uint16_t rx, uint16_t ry,
+                             uint16_t lt, uint16_t rt, uint8_t hat, uint16_t buttons) {
+    makeReport(report, lx, ly, lt, rt);
+    report[4] = rx & 0xFF; report[5] = rx >> 8;
+    report[6] = ry & 0xFF; report[7] = ry >> 8;
+    report[12] = hat & 0x0F;
+    report[13] = buttons & 0xFF; report[14] = (buttons >> 8) & 0x7F;
+    return 16;
+}
+
+static void expectEvent(uint8_t input, bool pressed) {
+    XboxBLEController::ButtonEvent event;
+    TEST_ASSERT_TRUE(controller->pollButtonEvent(event));
+    TEST_ASSERT_EQUAL_UINT8(input, event.input);
+    TEST_ASSERT_EQUAL(pressed, event.pressed);
+}
+
+static void addSimulatedController(void) {
+    BLEAdvertisement advertisement = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    transport->addPeripheral(advertisement);
 }
 
 // Test initialization
@@ -26,7 +66,7 @@ void test_controller_initialization(void) {
 
 // Test normalized values at center
 void test_normalized_values_center(void) {
-    XboxBLEController::ControllerState testState = {0, 0, 0, 0, false, 0};
+    XboxBLEController::ControllerState testState = {0, 0, 0, 0, 0, 0, 0, 0, false, 0};
     controller->setStateForTesting(testState);
     
     TEST_ASSERT_FLOAT_WITHIN(0.001, 0.0f, controller->getLeftStickXNormalized());
@@ -37,7 +77,7 @@ void test_normalized_values_center(void) {
 
 // Test normalized values at maximum positive
 void test_normalized_values_max_positive(void) {
-    XboxBLEController::ControllerState testState = {32767, 32767, 255, 255, false, 0};
+    XboxBLEController::ControllerState testState = {32767, 32767, 0, 0, 255, 255, 0, 0, false, 0};
     controller->setStateForTesting(testState);
     
     TEST_ASSERT_FLOAT_WITHIN(0.001, 0.9999f, controller->getLeftStickXNormalized());
@@ -48,7 +88,7 @@ void test_normalized_values_max_positive(void) {
 
 // Test normalized values at maximum negative
 void test_normalized_values_max_negative(void) {
-    XboxBLEController::ControllerState testState = {-32768, -32768, 0, 0, false, 0};
+    XboxBLEController::ControllerState testState = {-32768, -32768, 0, 0, 0, 0, 0, 0, false, 0};
     controller->setStateForTesting(testState);
     
     TEST_ASSERT_FLOAT_WITHIN(0.001, -1.0f, controller->getLeftStickXNormalized());
@@ -59,7 +99,7 @@ void test_normalized_values_max_negative(void) {
 
 // Test half stick values
 void test_normalized_values_half(void) {
-    XboxBLEController::ControllerState testState = {16384, 16384, 128, 128, false, 0};
+    XboxBLEController::ControllerState testState = {16384, 16384, 0, 0, 128, 128, 0, 0, false, 0};
     controller->setStateForTesting(testState);
     
     TEST_ASSERT_FLOAT_WITHIN(0.01, 0.5f, controller->getLeftStickXNormalized());
@@ -72,7 +112,7 @@ void test_normalized_values_half(void) {
 void test_connection_state(void) {
     TEST_ASSERT_FALSE(controller->isConnected());
     
-    XboxBLEController::ControllerState testState = {0, 0, 0, 0, true, 1000};
+    XboxBLEController::ControllerState testState = {0, 0, 0, 0, 0, 0, 0, 0, true, 1000};
     controller->setStateForTesting(testState);
     
     TEST_ASSERT_TRUE(controller->isConnected());
@@ -80,7 +120,7 @@ void test_connection_state(void) {
 
 // Test state retrieval
 void test_get_state(void) {
-    XboxBLEController::ControllerState testState = {1234, -5678, 100, 200, true, 5000};
+    XboxBLEController::ControllerState testState = {1234, -5678, 0, 0, 100, 200, 0, 0, true, 5000};
     controller->setStateForTesting(testState);
     
     XboxBLEController::ControllerState retrieved = controller->getState();
@@ -95,7 +135,7 @@ void test_get_state(void) {
 
 // Test edge case: trigger overflow protection
 void test_trigger_range_limits(void) {
-    XboxBLEController::ControllerState testState = {0, 0, 255, 255, false, 0};
+    XboxBLEController::ControllerState testState = {0, 0, 0, 0, 255, 255, 0, 0, false, 0};
     controller->setStateForTesting(testState);
     
     float leftTrig = controller->getLeftTriggerNormalized();
@@ -107,7 +147,7 @@ void test_trigger_range_limits(void) {
 
 // Test edge case: stick overflow protection
 void test_stick_range_limits(void) {
-    XboxBLEController::ControllerState testState = {32767, -32768, 0, 0, false, 0};
+    XboxBLEController::ControllerState testState = {32767, -32768, 0, 0, 0, 0, 0, 0, false, 0};
     controller->setStateForTesting(testState);
     
     float stickX = controller->getLeftStickXNormalized();
@@ -117,10 +157,506 @@ void test_stick_range_limits(void) {
     TEST_ASSERT_TRUE(stickY >= -1.0f && stickY <= 1.0f);
 }
 
+// Test snapshots are never torn while a second thread publishes reports
+void test_snapshot_consistent_under_concurrent_writes(void) {
+    const uint32_t ITERATIONS = 200000;
+    std::atomic<bool> done(false);
+
+    // Every field is derived from the same counter so a mixed report is detectable
+    std::thread writer([&]() {
+        XboxBLEController::ControllerState s = {0, 0, 0, 0, 0, 0, 0, 0, true, 0};
+        for (uint32_t i = 1; i <= ITERATIONS; i++) {
+            s.leftStickX = (int16_t)i;
+            s.leftStickY = (int16_t)~i;
+            s.leftTrigger = (uint16_t)(i * 3);
+            s.rightTrigger = (uint16_t)(i * 7);
+            s.lastUpdateTime = i;
+            controller->setStateForTesting(s);
+        }
+        done.store(true);
+    });
+
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t lastSeen = 0;
+    bool monotonic = true;
+    while (!done.load() || reads == 0) {
+        XboxBLEController::ControllerState s = controller->snapshot();
+        uint32_t i = s.lastUpdateTime;
+        if (i != 0 &&
+            (s.leftStickX != (int16_t)i ||
+             s.leftStickY != (int16_t)~i ||
+             s.leftTrigger != (uint16_t)(i * 3) ||
+             s.rightTrigger != (uint16_t)(i * 7))) {
+            torn++;
+        }
+        if (i < lastSeen) {
+            monotonic = false;
+        }
+        lastSeen = i;
+        reads++;
+    }
+    writer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_TRUE(monotonic);
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, controller->snapshot().lastUpdateTime);
+
+    char buffer[80];
+    sprintf(buffer, "%u reads, %u retries", (unsigned)reads,
+            (unsigned)controller->getSnapshotRetries());
+    TEST_MESSAGE(buffer);
+}
+
+// Test the full scan -> connect -> subscribe -> parse pipeline on the simulated transport
+void test_connect_and_receive_report(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+    TEST_ASSERT_TRUE(controller->isConnected());
+    TEST_ASSERT_TRUE(controller->update());
+
+    uint8_t report[16];
+    size_t length = makeReport(report, 65535, 0, 1023, 512);
+    TEST_ASSERT_TRUE(transport->emit(report, length));
+
+    XboxBLEController::ControllerState state = controller->snapshot();
+    TEST_ASSERT_EQUAL_INT16(32767, state.leftStickX);
+    TEST_ASSERT_EQUAL_INT16(-32768, state.leftStickY);
+    TEST_ASSERT_EQUAL_UINT16(255, state.leftTrigger);
+    TEST_ASSERT_EQUAL_UINT16(128, state.rightTrigger);
+    TEST_ASSERT_TRUE(state.connected);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0f, controller->getLeftStickXNormalized());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -1.0f, controller->getLeftStickYNormalized());
+}
+
+// Test every control is decoded and changes become press/release events
+void test_full_decode_and_button_events(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    uint8_t report[16];
+    uint16_t held = XboxBLEController::BUTTON_A | XboxBLEController::BUTTON_RB;
+    makeFullReport(report, 32768, 32768, 65535, 0, 0, 0, 3, held); // d-pad right
+    TEST_ASSERT_TRUE(transport->emit(report, sizeof(report)));
+
+    XboxBLEController::ControllerState state = controller->snapshot();
+    TEST_ASSERT_EQUAL_INT16(32767, state.rightStickX);
+    TEST_ASSERT_EQUAL_INT16(-32768, state.rightStickY);
+    TEST_ASSERT_EQUAL_HEX16(held, state.buttons);
+    TEST_ASSERT_EQUAL_UINT8(3, state.hat);
+    TEST_ASSERT_EQUAL_HEX32(held | (1UL << XboxBLEController::INPUT_DPAD_RIGHT),
+                            XboxBLEController::inputMask(state));
+
+    // Lowest input first
+    expectEvent(0, true);
+    expectEvent(7, true);
+    expectEvent(XboxBLEController::INPUT_DPAD_RIGHT, true);
+    XboxBLEController::ButtonEvent event;
+    TEST_ASSERT_FALSE(controller->pollButtonEvent(event));
+
+    // A released, d-pad right -> down-right: only the changes are queued
+    makeFullReport(report, 32768, 32768, 65535, 0, 0, 0, 4, XboxBLEController::BUTTON_RB);
+    TEST_ASSERT_TRUE(transport->emit(report, sizeof(report)));
+    expectEvent(0, false);
+    expectEvent(XboxBLEController::INPUT_DPAD_DOWN, true);
+    TEST_ASSERT_FALSE(controller->pollButtonEvent(event));
+
+    // Stick movement alone is no event
+    makeFullReport(report, 0, 32768, 65535, 0, 0, 0, 4, XboxBLEController::BUTTON_RB);
+    TEST_ASSERT_TRUE(transport->emit(report, sizeof(report)));
+    TEST_ASSERT_FALSE(controller->pollButtonEvent(event));
+
+    // Link loss releases whatever was held
+    controller->disconnect();
+    expectEvent(7, false);
+    expectEvent(XboxBLEController::INPUT_DPAD_RIGHT, false);
+    expectEvent(XboxBLEController::INPUT_DPAD_DOWN, false);
+    TEST_ASSERT_FALSE(controller->pollButtonEvent(event));
+}
+
+// Test a full event queue drops and counts new events instead of blocking
+void test_button_event_overflow(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    uint8_t report[16];
+    const uint32_t TOGGLES = XboxBLEController::BUTTON_EVENT_QUEUE_SIZE + 8;
+    for (uint32_t i = 0; i < TOGGLES; i++) {
+        makeFullReport(report, 32768, 32768, 32768, 32768, 0, 0, 0, (i & 1) ? 0 : XboxBLEController::BUTTON_Y);
+        TEST_ASSERT_TRUE(transport->emit(report, sizeof(report)));
+    }
+
+    uint32_t polled = 0;
+    XboxBLEController::ButtonEvent event;
+    while (controller->pollButtonEvent(event)) {
+        TEST_ASSERT_EQUAL_UINT8(4, event.input);
+        TEST_ASSERT_EQUAL(polled % 2 == 0, event.pressed);
+        polled++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(XboxBLEController::BUTTON_EVENT_QUEUE_SIZE, polled);
+    TEST_ASSERT_EQUAL_UINT32(8, controller->getReportStats().eventsDropped);
+}
+
+// Test the report layout is taken from the peer's Report Map when available
+void test_report_map_from_peer(void) {
+    // Same controls as the default map but with 8-bit triggers packed first
+    static const uint8_t reportMap[] = {
+        0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+        0x05, 0x02, 0x09, 0xC5, 0x09, 0xC4, 0x15, 0x00, 0x26, 0xFF, 0x00,
+        0x75, 0x08, 0x95, 0x02, 0x81, 0x02,
+        0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x16, 0x00, 0x80, 0x26, 0xFF, 0x7F,
+        0x75, 0x10, 0x95, 0x02, 0x81, 0x02,
+        0xC0,
+    };
+    addSimulatedController();
+    transport->setReportMap(reportMap, sizeof(reportMap), 0);
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+    TEST_ASSERT_EQUAL(6, controller->getReportMap().getReportLength());
+
+    uint8_t report[6] = {200, 100, 0x00, 0x80, 0x00, 0x40};
+    TEST_ASSERT_TRUE(transport->emit(report, sizeof(report)));
+
+    XboxBLEController::ControllerState state = controller->snapshot();
+    TEST_ASSERT_EQUAL_UINT16(200, state.leftTrigger);
+    TEST_ASSERT_EQUAL_UINT16(100, state.rightTrigger);
+    TEST_ASSERT_EQUAL_INT16(-32768, state.leftStickX);
+    TEST_ASSERT_EQUAL_INT16(16384, state.leftStickY);
+}
+
+// Test short reports are ignored instead of read past their end
+void test_short_report_ignored(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    uint8_t report[16];
+    makeReport(report, 65535, 65535, 1023, 1023);
+    TEST_ASSERT_TRUE(transport->emit(report, 10));
+    TEST_ASSERT_EQUAL_INT16(0, controller->snapshot().leftStickX);
+    TEST_ASSERT_EQUAL_UINT16(0, controller->snapshot().rightTrigger);
+}
+
+// Test repeated reports are counted and skipped, changes still decode
+void test_unchanged_reports_suppressed(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    uint8_t report[16];
+    size_t length = makeReport(report, 40000, 30000, 100, 0);
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(transport->emit(report, length));
+    }
+    XboxBLEController::ControllerState first = controller->snapshot();
+    TEST_ASSERT_EQUAL_INT16(40000 - 32768, first.leftStickX);
+
+    makeReport(report, 40000, 30000, 104, 0);
+    TEST_ASSERT_TRUE(transport->emit(report, length));
+    TEST_ASSERT_TRUE(transport->emit(report, length));
+    XboxBLEController::ControllerState second = controller->snapshot();
+    TEST_ASSERT_EQUAL_UINT16(26, second.leftTrigger);
+    TEST_ASSERT_TRUE(second.arrivalUs != first.arrivalUs);
+
+    XboxBLEController::ReportStats stats = controller->getReportStats();
+    TEST_ASSERT_EQUAL_UINT32(7, stats.total);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.unchanged);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.malformed);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.tooShort);
+
+    // A new connection decodes its first report even if it repeats the last one
+    controller->disconnect();
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+    TEST_ASSERT_TRUE(transport->emit(report, length));
+    TEST_ASSERT_EQUAL_UINT16(26, controller->snapshot().leftTrigger);
+    TEST_ASSERT_EQUAL_UINT32(5, controller->getReportStats().unchanged);
+}
+
+// Test short and oversized reports are counted instead of dropped silently
+void test_bad_reports_counted(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    uint8_t report[XboxBLEController::MAX_REPORT_LENGTH + 1];
+    makeReport(report, 65535, 65535, 1023, 1023);
+    TEST_ASSERT_TRUE(transport->emit(report, 10));
+    TEST_ASSERT_TRUE(transport->emit(report, 0));
+    TEST_ASSERT_TRUE(transport->emit(report, sizeof(report)));
+    TEST_ASSERT_EQUAL_INT16(0, controller->snapshot().leftStickX);
+
+    XboxBLEController::ReportStats stats = controller->getReportStats();
+    TEST_ASSERT_EQUAL_UINT32(3, stats.total);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.tooShort);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.malformed);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.unchanged);
+}
+
+// Test nothing connects when no controller is advertising
+void test_scan_without_controller(void) {
+    BLEAdvertisement other = {{{1, 2, 3, 4, 5, 6}}, "Heart Rate", true, false, -70};
+    transport->addPeripheral(other);
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_FALSE(controller->scanAndConnect(1000));
+    TEST_ASSERT_EQUAL_UINT32(0, transport->getConnectCount());
+    TEST_ASSERT_FALSE(controller->isConnected());
+}
+
+// Test the scan stops at the first match and reports the time it took
+void test_scan_stops_at_first_match(void) {
+    BLEAdvertisement other = {{{1, 2, 3, 4, 5, 6}}, "Heart Rate", true, false, -70};
+    BLEAdvertisement pad = {{{0x11, 0x22, 0x33, 0x44, 0x55, 0x66}}, "Xbox Wireless Controller", true, true, -50};
+    BLEAdvertisement late = {{{0x77, 0, 0, 0, 0, 1}}, "Xbox Wireless Controller", true, true, -40};
+    transport->addPeripheral(other, 0);
+    transport->addPeripheral(pad, 120);
+    transport->addPeripheral(late, 600);
+    controller->setScanProfile(XboxBLEController::SCAN_LOW_POWER);
+    TEST_ASSERT_TRUE(controller->begin());
+
+    uint32_t start = millis();
+    TEST_ASSERT_TRUE(controller->scanAndConnect(3000));
+    uint32_t elapsed = millis() - start;
+    TEST_ASSERT_TRUE(controller->getPeerAddress() == pad.address);
+    TEST_ASSERT_TRUE(elapsed < 600);
+
+    XboxBLEController::ScanStats stats = controller->getScanStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.scans);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.matches);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.advertisements);
+    TEST_ASSERT_UINT32_WITHIN(50, 120, stats.lastMatchMs);
+    TEST_ASSERT_EQUAL_UINT32(2, transport->getAdvertisementCount());
+
+    // The profile reaches the radio as set
+    const BLEScanProfile &profile = transport->getLastScanProfile();
+    TEST_ASSERT_EQUAL_UINT16(XboxBLEController::SCAN_LOW_POWER.intervalMs, profile.intervalMs);
+    TEST_ASSERT_EQUAL_UINT16(XboxBLEController::SCAN_LOW_POWER.windowMs, profile.windowMs);
+}
+
+// Test the matcher rules: HID service, name prefix in any case, address prefix
+void test_advertisement_matcher(void) {
+    BLEAdvertisement hid = {{{1, 2, 3, 4, 5, 6}}, "Gamepad", true, true, -50};
+    BLEAdvertisement named = {{{1, 2, 3, 4, 5, 6}}, "XBOX Wireless Controller", true, false, -50};
+    BLEAdvertisement unnamed = {{{0x98, 0x7B, 0xF3, 4, 5, 6}}, "", false, false, -50};
+    BLEAdvertisement other = {{{1, 2, 3, 4, 5, 6}}, "Heart Rate", true, false, -50};
+
+    AdvertisementMatcher matcher;
+    TEST_ASSERT_TRUE(matcher.matches(hid));
+    TEST_ASSERT_TRUE(matcher.matches(named));
+    TEST_ASSERT_FALSE(matcher.matches(unnamed));
+    TEST_ASSERT_FALSE(matcher.matches(other));
+
+    matcher.clear();
+    TEST_ASSERT_FALSE(matcher.matches(hid));
+    TEST_ASSERT_TRUE(matcher.addNamePrefix("heart"));
+    const uint8_t oui[] = {0x98, 0x7B, 0xF3};
+    TEST_ASSERT_TRUE(matcher.addAddressPrefix(oui, sizeof(oui)));
+    TEST_ASSERT_TRUE(matcher.matches(other));
+    TEST_ASSERT_TRUE(matcher.matches(unnamed));
+    TEST_ASSERT_FALSE(matcher.matches(named));
+
+    // A session only connects to what its matcher accepts
+    transport->addPeripheral(other);
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_FALSE(controller->scanAndConnect(100));
+    controller->getMatcher().addNamePrefix("Heart");
+    TEST_ASSERT_TRUE(controller->scanAndConnect(100));
+    XboxBLEController::ScanStats stats = controller->getScanStats();
+    TEST_ASSERT_EQUAL_UINT32(2, stats.scans);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.matches);
+}
+
+// Test a failed discovery leaves the controller disconnected
+void test_discover_failure(void) {
+    addSimulatedController();
+    transport->setFailDiscover(true);
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_FALSE(controller->scanAndConnect(1000));
+    TEST_ASSERT_FALSE(controller->isConnected());
+    TEST_ASSERT_FALSE(transport->isConnected());
+}
+
+// Test link loss is reported by update()
+void test_link_loss(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+    transport->dropLink();
+    TEST_ASSERT_FALSE(controller->update());
+    TEST_ASSERT_FALSE(controller->isConnected());
+}
+
+static size_t counterReport(void *context, uint32_t index, uint8_t *report, size_t capacity) {
+    // Every axis carries the report index so mixed reports are detectable
+    return makeReport(report, (uint16_t)(index + 32768), (uint16_t)(~index + 32768),
+                      (index & 0xFF) << 2, 0);
+}
+
+// Test 1 kHz streaming with bursts while the control side keeps sampling
+void test_stream_at_1khz_with_bursts(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    transport->setReportGenerator(counterReport, nullptr);
+    SimulatedBLETransport::StreamConfig config = {1000, 4, 2000};
+    TEST_ASSERT_TRUE(transport->startStreaming(config));
+
+    uint32_t samples = 0;
+    uint32_t torn = 0;
+    while (transport->getEmittedCount() < config.count) {
+        if (transport->getEmittedCount() == 0) {
+            continue;
+        }
+        XboxBLEController::ControllerState s = controller->snapshot();
+        uint16_t index = (uint16_t)s.leftStickX;
+        int triggerError = (int)s.leftTrigger - (int)(index & 0xFF);
+        if (s.leftStickY != (int16_t)~index || triggerError < -1 || triggerError > 1) {
+            torn++;
+        }
+        samples++;
+        delayMicroseconds(100);
+    }
+    transport->waitForStreamEnd();
+
+    XboxBLEController::ControllerState last = controller->snapshot();
+    TEST_ASSERT_EQUAL_UINT32(config.count, transport->getEmittedCount());
+    TEST_ASSERT_EQUAL_INT16((int16_t)(config.count - 1), last.leftStickX);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, samples);
+}
+
+static uint32_t fakeArrivalUs;
+static uint32_t fakeArrivalClock(void) { return fakeArrivalUs; }
+
+// Test inter-arrival times of reports at known arrival stamps
+void test_report_intervals(void) {
+    addSimulatedController();
+    controller->setClock(fakeArrivalClock);
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    // 2 ms apart (500 reports/s), one late by 3 ms
+    uint8_t report[16];
+    fakeArrivalUs = 1000;
+    for (int i = 0; i < 40; i++) {
+        fakeArrivalUs += i == 20 ? 5000 : 2000;
+        TEST_ASSERT_TRUE(transport->emit(report, makeReport(report, 1000 + i, 0, 0, 0)));
+    }
+
+    XboxBLEController::ReportStats stats = controller->getReportStats();
+    TEST_ASSERT_EQUAL_UINT32(40, stats.total);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.unchanged);
+    TEST_ASSERT_EQUAL_UINT32(2000, stats.lastIntervalUs);
+    TEST_ASSERT_EQUAL_UINT32(5000, stats.maxIntervalUs);
+    // The late report has all but decayed from the 1/8 running mean
+    TEST_ASSERT_UINT32_WITHIN(50, 2000, stats.meanIntervalUs);
+    TEST_ASSERT_UINT32_WITHIN(15, 500, controller->getReportRateHz());
+    TEST_ASSERT_EQUAL_UINT32(fakeArrivalUs, controller->snapshot().arrivalUs);
+}
+
+// Test no report is delivered after disconnect() returns
+void test_no_reports_after_disconnect(void) {
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    SimulatedBLETransport::StreamConfig config = {1000, 8, 0};
+    uint8_t report[16];
+    transport->setReport(report, makeReport(report, 40000, 40000, 10, 10));
+    TEST_ASSERT_TRUE(transport->startStreaming(config));
+    delay(20);
+    controller->disconnect();
+
+    uint32_t emitted = transport->getEmittedCount();
+    delay(20);
+    transport->stopStreaming();
+    TEST_ASSERT_EQUAL_UINT32(emitted, transport->getEmittedCount());
+    TEST_ASSERT_EQUAL_INT16(0, controller->snapshot().leftStickX);
+}
+
 // Main test runner
-void setup() {
-    delay(2000); // Wait for serial connection
-    
+static size_t tappedLength;
+static uint8_t tappedFirstByte;
+
+static void recordTap(void *context, const uint8_t *data, size_t length, uint32_t arrivalUs) {
+    (*(int *)context)++;
+    tappedLength = length;
+    tappedFirstByte = data[0];
+}
+
+// Test the report tap sees raw reports, including ones too short to decode
+void test_report_tap(void) {
+    int taps = 0;
+    controller->setReportTap(recordTap, &taps);
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->scanAndConnect(1000));
+
+    uint8_t report[16];
+    size_t length = makeReport(report, 0x1234, 0, 0, 0);
+    transport->emit(report, length);
+    transport->emit(report, 4);
+
+    TEST_ASSERT_EQUAL_INT(2, taps);
+    TEST_ASSERT_EQUAL_UINT32(4, tappedLength);
+    TEST_ASSERT_EQUAL_HEX8(0x34, tappedFirstByte);
+}
+
+// Test a reconnect resumes the cached peer without scanning or discovery
+void test_reconnect_uses_bond_cache(void) {
+    MemoryBondStore store;
+    controller->setBondStore(&store, 0);
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+
+    // First connection has nothing cached: slow path, then saved
+    TEST_ASSERT_TRUE(controller->reconnect(1000));
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getReconnectStats().slowPath);
+    TEST_ASSERT_EQUAL_UINT32(1, store.getSaveCount());
+    uint32_t scans = transport->getScanCount();
+    uint32_t discoveries = transport->getDiscoverCount();
+
+    transport->dropLink();
+    TEST_ASSERT_FALSE(controller->update());
+    TEST_ASSERT_TRUE(controller->reconnect(1000));
+    TEST_ASSERT_TRUE(controller->isConnected());
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getReconnectStats().fastPath);
+    TEST_ASSERT_EQUAL_UINT32(scans, transport->getScanCount());
+    TEST_ASSERT_EQUAL_UINT32(discoveries, transport->getDiscoverCount());
+
+    // Reports still flow after a resume
+    uint8_t report[16];
+    size_t length = makeReport(report, 65535, 32768, 0, 0);
+    TEST_ASSERT_TRUE(transport->emit(report, length));
+    TEST_ASSERT_EQUAL_INT16(32767, controller->snapshot().leftStickX);
+}
+
+// Test stale cached handles fall back to a full scan and are replaced
+void test_reconnect_falls_back_when_handles_change(void) {
+    MemoryBondStore store;
+    controller->setBondStore(&store, 0);
+    addSimulatedController();
+    TEST_ASSERT_TRUE(controller->begin());
+    TEST_ASSERT_TRUE(controller->reconnect(1000));
+
+    controller->disconnect();
+    transport->setHandleOffset(8);
+    TEST_ASSERT_TRUE(controller->reconnect(1000));
+
+    const XboxBLEController::ReconnectStats &stats = controller->getReconnectStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.cacheRejected);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.slowPath);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.fastPath);
+
+    BLEPeerCache cache;
+    TEST_ASSERT_TRUE(store.load(0, cache));
+    TEST_ASSERT_EQUAL_HEX16(0x0021 + 8, cache.inputReportHandle);
+}
+
+int runUnityTests(void) {
     UNITY_BEGIN();
     
     RUN_TEST(test_controller_initialization);
@@ -132,12 +668,42 @@ void setup() {
     RUN_TEST(test_get_state);
     RUN_TEST(test_trigger_range_limits);
     RUN_TEST(test_stick_range_limits);
-    
-    UNITY_END();
+    RUN_TEST(test_snapshot_consistent_under_concurrent_writes);
+    RUN_TEST(test_connect_and_receive_report);
+    RUN_TEST(test_full_decode_and_button_events);
+    RUN_TEST(test_button_event_overflow);
+    RUN_TEST(test_report_map_from_peer);
+    RUN_TEST(test_short_report_ignored);
+    RUN_TEST(test_unchanged_reports_suppressed);
+    RUN_TEST(test_bad_reports_counted);
+    RUN_TEST(test_report_intervals);
+    RUN_TEST(test_scan_without_controller);
+    RUN_TEST(test_scan_stops_at_first_match);
+    RUN_TEST(test_advertisement_matcher);
+    RUN_TEST(test_discover_failure);
+    RUN_TEST(test_link_loss);
+    RUN_TEST(test_stream_at_1khz_with_bursts);
+    RUN_TEST(test_no_reports_after_disconnect);
+    RUN_TEST(test_report_tap);
+    RUN_TEST(test_reconnect_uses_bond_cache);
+    RUN_TEST(test_reconnect_falls_back_when_handles_change);
+
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000); // Wait for serial connection
+    runUnityTests();
 }
 
 void loop() {
     // Tests run once in setup()
 }
+#else
+int main(void) {
+    return runUnityTests();
+}
+#endif
 
 #endif // UNIT_TEST
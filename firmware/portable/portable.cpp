@@ -0,0 +1,134 @@
+// Arduino 101 bench check of the portable libraries (genuino101 env).
+//
+// The rover in src/ needs an ESP32 for its BLE host; this sketch runs the
+// rest of the drive path on the 101: a default-layout Xbox report is built
+// from keys typed on Serial, decoded by HIDReportMap, mixed by DriveMixer
+// and sent to the Motor Shield through AnalogWriteMotorBackend.
+//
+//   w / s   stick forward / back      a / d   stick left / right
+//   space   release the stick          1 - 3   throttle 30%, 60%, 100%
+//
+// A key holds for KEY_HOLD_MS, so the motors coast when typing stops.
+
+#include <Arduino.h>
+
+#include "AnalogWriteMotorBackend.h"
+#include "DriveMixer.h"
+#include "HIDReportMap.h"
+#include "MotorShield.h"
+
+#ifndef BAND_RATE
+#define BAND_RATE 115200
+#endif
+
+const uint32_t LOOP_MS = 20;
+const uint32_t KEY_HOLD_MS = 500;
+
+// D11 is not a PWM pin on the 101: bridge the shield's PWM B to D5
+const MotorShield::Config MOTOR_CONFIG = {{MOTOR_SHIELD_REV3_A, {13, 5, 8}}, 0, 8, 655, false, 1};
+AnalogWriteMotorBackend motorBackend;
+MotorShield motors(motorBackend, MOTOR_CONFIG);
+
+HIDReportMap reportMap;
+
+// Raw report values: sticks 0..65535 centered, triggers 0..1023
+uint16_t stickX = 32768;
+uint16_t stickY = 32768;
+uint16_t throttle = 1023;
+uint32_t lastKeyMs = 0;
+
+static void putU16(uint8_t *out, uint16_t value)
+{
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+static void readKeys(uint32_t nowMs)
+{
+  while (Serial.available() > 0)
+  {
+    switch (Serial.read())
+    {
+    case 'w':
+      stickY = 0;
+      break;
+    case 's':
+      stickY = 65535;
+      break;
+    case 'a':
+      stickX = 0;
+      break;
+    case 'd':
+      stickX = 65535;
+      break;
+    case ' ':
+      stickX = 32768;
+      stickY = 32768;
+      break;
+    case '1':
+      throttle = 307;
+      break;
+    case '2':
+      throttle = 614;
+      break;
+    case '3':
+      throttle = 1023;
+      break;
+    default:
+      continue;
+    }
+    lastKeyMs = nowMs;
+  }
+  if (nowMs - lastKeyMs >= KEY_HOLD_MS)
+  {
+    stickX = 32768;
+    stickY = 32768;
+  }
+}
+
+void setup()
+{
+  Serial.begin(BAND_RATE);
+  if (!reportMap.loadDefault())
+  {
+    Serial.println("Default report map did not parse");
+  }
+  if (!motors.begin())
+  {
+    Serial.println("Motor Shield backend refused the configuration");
+  }
+}
+
+void loop()
+{
+  uint32_t nowMs = millis();
+  readKeys(nowMs);
+
+  // Same 16-byte layout the controller sends
+  uint8_t report[16] = {0};
+  putU16(&report[0], stickX);
+  putU16(&report[2], stickY);
+  putU16(&report[4], 32768);
+  putU16(&report[6], 32768);
+  putU16(&report[10], throttle);
+
+  int32_t values[HIDReportMap::TARGET_COUNT];
+  XboxBLEController::ControllerState state = {};
+  if (reportMap.decode(report, sizeof(report), values))
+  {
+    state.leftStickX = (int16_t)values[HIDReportMap::LEFT_STICK_X];
+    state.leftStickY = (int16_t)values[HIDReportMap::LEFT_STICK_Y];
+    state.leftTrigger = (uint16_t)values[HIDReportMap::LEFT_TRIGGER];
+    state.rightTrigger = (uint16_t)values[HIDReportMap::RIGHT_TRIGGER];
+    state.connected = true;
+  }
+
+  DriveMixer::Output command = DriveMixer::mix(DriveMixer::normalize(state));
+  motors.set(MotorShield::CHANNEL_A, DriveSignal::toQ15(command.left));
+  motors.set(MotorShield::CHANNEL_B, DriveSignal::toQ15(command.right));
+  motors.apply();
+
+  uint32_t elapsedMs = millis() - nowMs;
+  if (elapsedMs < LOOP_MS)
+    delay(LOOP_MS - elapsedMs);
+}
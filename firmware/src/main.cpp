@@ -1,8 +1,31 @@
 #include <Arduino.h>
 
+#include "AdaptiveRate.h"
 #include "ArduinoUtils.h"
+#include "BondStore.h"
+#include "ControllerArbiter.h"
+#include "CurrentMonitor.h"
+#include "DriveMixer.h"
+#include "ESP32CurrentSampler.h"
+#include "ESP32MotorBackend.h"
+#include "ESP32BLETransport.h"
+#include "ESP32PcntEncoder.h"
+#include "FixedRateScheduler.h"
+#include "FlightRecorder.h"
+#include "InputShaper.h"
+#include "LatencyTrace.h"
+#include "LinkMonitor.h"
+#include "MotorShield.h"
+#include "SpeedController.h"
+#include "TaskMonitor.h"
+#include "Telemetry.h"
 #include "XboxBLEController.h"
 
+#include <LittleFS.h>
+#if defined(CONFIG_PM_ENABLE)
+#include <esp_pm.h>
+#endif
+
 #ifndef DEBUG_LEVEL
 #define DEBUG_LEVEL -1
 #endif
@@ -11,76 +34,778 @@
 #define BAND_RATE 115200
 #endif
 
+// 0 = off, 1 = binary frames on Serial, 2 = BLE notify
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+// 0 = lowest latency, 1 = balanced (fewer radio events, half-duty scans)
+#ifndef BLE_PROFILE
+#define BLE_PROFILE 0
+#endif
+
+// 1 = keep recent reports and motor commands in RAM, saved to flash on faults
+#ifndef FLIGHT_RECORDER
+#define FLIGHT_RECORDER 1
+#endif
 
-const uint8_t MAIN_LOOP_HZ = 50;
-const float MAIN_LOOP_MS = 1.0f / MAIN_LOOP_HZ * 1.0e3;
+// 0 = stick sets the duty, 1 = stick sets the wheel speed (needs encoders)
+#ifndef SPEED_CONTROL
+#define SPEED_CONTROL 0
+#endif
+
+// 1 = tick slowly while parked and wake on input changes, 0 = fixed rate
+#ifndef ADAPTIVE_RATE
+#define ADAPTIVE_RATE 1
+#endif
+
+
+const uint16_t MAIN_LOOP_HZ = 50;
+// Wheel speed loop, a multiple of MAIN_LOOP_HZ; with SPEED_CONTROL the
+// control task ticks at this rate and runs the input pipeline every
+// SPEED_LOOP_DIVIDER-th tick
+const uint16_t SPEED_LOOP_HZ = 250;
+const uint8_t SPEED_LOOP_DIVIDER = SPEED_LOOP_HZ / MAIN_LOOP_HZ;
 const uint32_t BLE_SCAN_MS = 3 * 1e3;
+const uint32_t LINK_STEP_MS = 10;
+const uint32_t LATENCY_REPORT_MS = 10 * 1e3;
+const uint32_t TRIP_HOLD_MS = 2 * 1e3;
+const uint32_t TELEMETRY_DRAIN_MS = 5;
+const uint32_t TASK_REPORT_MS = 10 * 1e3;
+
+uint32_t schedulerClock(void)
+{
+  return micros();
+}
+
+void schedulerSleep(uint32_t sleepUs)
+{
+  // Yield to other tasks for whole milliseconds, spin only for the
+  // remainder. A notification (an input change) ends the wait early.
+  if (sleepUs >= 1000)
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepUs / 1000));
+  else
+    delayMicroseconds(sleepUs);
+}
+
+// Task layout. Core 0 carries the radio: the BLE host (Bluedroid, pinned
+// there by the Arduino core, which also runs the notification callbacks),
+// the link task and current sampling. Core 1 runs the control task above
+// everything else on it. Telemetry output and the task reports run at the
+// lowest priority and only take idle time. Tasks hand data over through
+// SeqLocks and bounded lock-free queues, never a mutex.
+const TaskMonitor::TaskConfig CONTROL_TASK = {"control", 1, 10, 8192};
+const TaskMonitor::TaskConfig LINK_TASK = {"link", 0, 2, 8192};
+const TaskMonitor::TaskConfig TELEMETRY_TASK = {"telemetry", 1, 1, 6144};
+const TaskMonitor::TaskConfig CURRENT_TASK = {"current", 0, 5, 3072};
+// Created by the BLE stack and the logger; attached for their stack figures
+// and, with FreeRTOS run-time stats, their CPU time
+const TaskMonitor::TaskConfig BLE_HOST_TASK = {"BTC_TASK", 0, 19, 0};
+const TaskMonitor::TaskConfig LOG_TASK = {"log", TaskMonitor::ANY_CORE, 1, 3072};
+
+TaskMonitor taskMonitor(schedulerClock);
+int8_t controlTaskId = TaskMonitor::NO_TASK;
+int8_t linkTaskId = TaskMonitor::NO_TASK;
+int8_t telemetryTaskId = TaskMonitor::NO_TASK;
+
+// One BLE connection per controller; the supervisor overrides the operator
+ESP32BLETransport operatorTransport;
+ESP32BLETransport supervisorTransport;
+XboxBLEController operatorPad(operatorTransport);
+XboxBLEController supervisorPad(supervisorTransport);
+XboxBLEController *const controllers[] = {&operatorPad, &supervisorPad};
+const uint8_t CONTROLLER_COUNT = sizeof(controllers) / sizeof(controllers[0]);
+
+// Bonded peers and their GATT handles survive reboots; one slot per session
+NVSBondStore bondStore;
+
+// Connection timing requested after every connect (BLE units: 1.25 ms
+// intervals, 10 ms timeout). The controller decides what it accepts.
+// Scans end at the first controller; the profile sets how much of the scan
+// time the radio listens.
+#if BLE_PROFILE == 0
+// 7.5-15 ms interval, every event attended, 1 s supervision timeout
+const BLEConnectionParams CONNECTION_PROFILE = {6, 12, 0, 100};
+const BLEScanProfile &SCAN_PROFILE = XboxBLEController::SCAN_FAST;
+#else
+// 15-30 ms interval, may skip 2 events while idle, 2 s supervision timeout
+const BLEConnectionParams CONNECTION_PROFILE = {12, 24, 2, 200};
+const BLEScanProfile &SCAN_PROFILE = XboxBLEController::SCAN_BALANCED;
+#endif
+
+// Input older than 150 ms is stale and the motors wind down over 0.3 s, so
+// a starved link stops the rover within ~0.5 s. Under 50 reports/s, over
+// 20 ms jitter or under -85 dBm is reported as degraded.
+const LinkMonitor::Config LINK_MONITOR_CONFIG = {150, 300, 50, 20000, -85, 1000};
+LinkMonitor operatorLink(operatorPad, LINK_MONITOR_CONFIG);
+LinkMonitor supervisorLink(supervisorPad, LINK_MONITOR_CONFIG);
+LinkMonitor *const linkMonitors[] = {&operatorLink, &supervisorLink};
+
+// Priority pick, no staleness limit, 0.5 s override hold, ~12% stick / ~8% trigger to engage
+const ControllerArbiter::Config ARBITER_CONFIG = {ControllerArbiter::PRIORITY, 0, 500, 4000, 20};
+ControllerArbiter arbiter(ARBITER_CONFIG);
+
+#if ADAPTIVE_RATE
+// 10 Hz once the sticks have rested with the motors off for 2 s, 100 Hz
+// for 0.25 s after every input change, MAIN_LOOP_HZ while a command is
+// held. A changed report wakes an idle loop at once. With SPEED_CONTROL a
+// driven wheel needs every speed loop tick, so only idle drops the rate.
+const AdaptiveRate::Config CONTROL_RATE_CONFIG = {10, SPEED_CONTROL ? SPEED_LOOP_HZ : MAIN_LOOP_HZ,
+                                                  SPEED_CONTROL ? SPEED_LOOP_HZ : 100, 250, 2000};
+void controlSleep(uint32_t sleepUs);
+AdaptiveRate controlRate(CONTROL_RATE_CONFIG, schedulerClock, controlSleep);
+FixedRateScheduler &controlScheduler = controlRate.getScheduler();
+AdaptiveRate::Activity controlActivity = AdaptiveRate::ACTIVITY_NONE;
+uint32_t lastInputArrivalUs = 0;
+uint32_t lastControlUs = 0;
+// Set by the control task before its first tick, long before it can idle
+TaskHandle_t controlTaskHandle = nullptr;
+#else
+FixedRateScheduler controlScheduler(SPEED_CONTROL ? SPEED_LOOP_HZ : MAIN_LOOP_HZ, schedulerClock, schedulerSleep);
+#endif
+const uint32_t CONTROL_PERIOD_US = 1e6 / MAIN_LOOP_HZ;
+
+// Between the controller and the mixer: ~8% stick deadzone with a mild
+// expo, throttle and forward/back limited to full scale in 0.5 s so stick
+// reversals don't slam the motors
+const InputShaper::AxisProfile STEER_PROFILE = {2621, 9830, 0};
+const InputShaper::AxisProfile DRIVE_PROFILE = {2621, 9830, 65534};
+const InputShaper::AxisProfile BRAKE_PROFILE = {1311, 0, 0};
+const InputShaper::AxisProfile THROTTLE_PROFILE = {1311, 0, 65534};
+InputShaper shaper;
+
+// Button bindings: B held brakes, RB and LB step the speed limit up and
+// down, View saves a flight recording
+const int16_t SPEED_LIMITS_Q15[] = {9830, 19661, 32767}; // 30%, 60%, 100%
+const uint8_t SPEED_MODE_COUNT = sizeof(SPEED_LIMITS_Q15) / sizeof(SPEED_LIMITS_Q15[0]);
+uint8_t speedMode = SPEED_MODE_COUNT - 1;
+
+// Motor Shield channels wired to ESP32 GPIOs (direction, PWM, brake);
+// 20 kHz carrier above hearing, 10-bit duty, ~2% deadband, coast at zero
+const MotorShield::Config MOTOR_CONFIG = {{{25, 26, 27}, {32, 33, 14}}, 20000, 10, 655, false, 1};
+ESP32MotorBackend motorBackend;
+MotorShield motors(motorBackend, MOTOR_CONFIG);
+
+// Current sense A0/A1 wired to GPIO36/GPIO39 (ADC1 channels 0 and 3),
+// sampled at 20 kHz total and decimated to 1 kHz per channel. 1.8 A for
+// 2 ms trips the cut-off, well inside one control period.
+const adc1_channel_t CURRENT_CHANNELS[] = {ADC1_CHANNEL_0, ADC1_CHANNEL_3};
+const uint32_t CURRENT_SAMPLE_HZ = 20000;
+const CurrentMonitor::Config CURRENT_CONFIG = {3300, 12, 1650, 10, 3, 100, 1800, 2};
+CurrentMonitor currentMonitor(CURRENT_CONFIG);
+ESP32CurrentSampler currentSampler(currentMonitor);
+uint32_t tripStartMs = 0;
+bool tripHandled = false;
+
+#if SPEED_CONTROL
+// Quadrature wheel encoders on GPIO 18/19 (A) and 21/23 (B), counted by
+// PCNT units 0 and 1; channel B is mounted mirrored. 1320 counts per wheel
+// revolution, ~7000 counts/s at full speed on 12 V. Gains were tuned on
+// DCMotorPlant with this gearmotor's figures (test_speed_controller.cpp):
+// ~0.9 duty per unit speed feed-forward, 1.3% for dry friction, PI on top.
+const ESP32PcntEncoder::Config ENCODER_CONFIG = {{{18, 19}, {21, 23}}, 100, {false, true}};
+const SpeedController::Config SPEED_CONFIG = {7000, 3700, 413, 8192, 65536, 0, 16384, 16384};
+ESP32PcntEncoder encoders(ENCODER_CONFIG);
+SpeedController leftSpeed(SPEED_CONFIG);
+SpeedController rightSpeed(SPEED_CONFIG);
+SpeedController *const wheelSpeeds[] = {&leftSpeed, &rightSpeed};
+
+// Set by controlStep(), followed by speedStep()
+int16_t wheelTargets[MOTOR_CHANNEL_COUNT] = {0, 0};
+bool wheelsDriven = false;
+int32_t lastCounts[MOTOR_CHANNEL_COUNT] = {0, 0};
+uint32_t lastSpeedUs = 0;
+#endif
+
+#if FLIGHT_RECORDER
+// The last few seconds of input reports and motor commands, kept in RAM and
+// written to LittleFS by the telemetry task after a trip, a stale link or a
+// press of View. Recordings rotate through FLIGHT_FILES and replay on the
+// host with FlightReplay.
+FlightRecorder flightRecorder;
+const char *const FLIGHT_FILES[] = {"/flight0.bin", "/flight1.bin", "/flight2.bin", "/flight3.bin"};
+const uint8_t FLIGHT_FILE_COUNT = sizeof(FLIGHT_FILES) / sizeof(FLIGHT_FILES[0]);
+uint8_t nextFlightFile = 0;
+bool flightStorage = false;
+
+void saveFlight()
+{
+  if (!flightStorage)
+    return;
+  const char *path = FLIGHT_FILES[nextFlightFile];
+  nextFlightFile = (nextFlightFile + 1) % FLIGHT_FILE_COUNT;
+  uint32_t records;
+  if (flightRecorder.flushToFile(LittleFS, path, records))
+    LOG_INFO("Flight recording %s: %u records", path, records);
+  else
+    LOG_WARN("Failed to write flight recording %s", path);
+}
+
+void linkStale(void *context, bool stale)
+{
+  if (stale)
+    flightRecorder.trigger(FlightRecorder::REASON_LINK_STALE, micros());
+}
+#endif
+
+// Runs on the sampler task: cut the bridges without waiting for loop()
+void overcurrentTrip(void *context, uint8_t channel, uint16_t currentMa)
+{
+  motors.cutOff();
+#if FLIGHT_RECORDER
+  flightRecorder.trigger(FlightRecorder::REASON_OVERCURRENT, micros());
+#endif
+}
+
+// Hold the motors off for a while after a trip, then re-arm once the
+// current has settled
+void checkOvercurrent()
+{
+  if (!currentMonitor.isTripped())
+    return;
+  if (!tripHandled)
+  {
+    LOG_WARN("Overcurrent trip, motors cut off");
+    tripStartMs = millis();
+    tripHandled = true;
+  }
+  motors.stop(false);
+
+  CurrentMonitor::Stats stats = currentMonitor.getStats();
+  bool settled = stats.channels[0].filteredMa < CURRENT_CONFIG.tripMa &&
+                 stats.channels[1].filteredMa < CURRENT_CONFIG.tripMa;
+  if (settled && millis() - tripStartMs >= TRIP_HOLD_MS)
+  {
+    currentMonitor.reset();
+    motors.restore();
+    tripHandled = false;
+    LOG_INFO("Overcurrent cleared");
+  }
+}
+
+#if ADAPTIVE_RATE
+// Idle ticks need no precision: sleep to the next RTOS tick instead of
+// spinning out the remainder
+void controlSleep(uint32_t sleepUs)
+{
+  if (controlRate.getMode() == AdaptiveRate::MODE_IDLE)
+    sleepUs = (sleepUs + 999) / 1000 * 1000;
+  schedulerSleep(sleepUs);
+}
+
+// Notification context: a changed report ends an idle wait. Outside idle
+// there is no sleep to cut short; the loop picks the request up itself if it
+// goes idle before its next tick.
+void inputChanged(void *context, uint32_t arrivalUs)
+{
+  if (controlRate.wake() && controlTaskHandle)
+    xTaskNotifyGive(controlTaskHandle);
+}
+
+// Time per mode, CPU duty cycle of the control task and how fast an input
+// change ended an idle wait
+void reportControlRate()
+{
+  const AdaptiveRate::Stats &stats = controlRate.getStats();
+  for (uint8_t i = 0; i < AdaptiveRate::MODE_COUNT; i++)
+  {
+    LOG_INFO("Rate %s: %u ticks, %u ms", AdaptiveRate::modeName((AdaptiveRate::Mode)i), stats.ticks[i],
+             (uint32_t)(stats.modeUs[i] / 1000));
+  }
+  LOG_INFO("Rate: duty %u permille, %u switches", stats.dutyPermille(), stats.switches);
+  LOG_INFO("Rate: %u wakeups, latency mean %u us, max %u us", stats.wakeups, stats.meanWakeLatencyUs(),
+           stats.maxWakeLatencyUs);
+  controlRate.resetStats();
+}
+#endif
+
+// Report arrival -> consumed by loop() -> motor command applied
+LatencyTrace latency;
+uint32_t lastLatencyReportMs = 0;
+
+void reportLatency()
+{
+  for (uint8_t i = 0; i < LatencyTrace::STAGE_COUNT; i++)
+  {
+    const LatencyHistogram &histogram = latency.getHistogram((LatencyTrace::Stage)i);
+    LOG_INFO("Latency %s: p50 %u us, p99 %u us, max %u us", LatencyTrace::stageName((LatencyTrace::Stage)i),
+             histogram.percentileUs(50), histogram.percentileUs(99), histogram.getMaxUs());
+  }
+  latency.reset();
+}
+
+// Report counters per session: a falling rate or rising short/malformed
+// counts show a degrading link before it drops
+void reportLinkHealth()
+{
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+  {
+    XboxBLEController::ReportStats stats = controllers[i]->getReportStats();
+    LOG_INFO("Reports %u: %u total, %u unchanged, %u bad", i, stats.total, stats.unchanged,
+             stats.tooShort + stats.malformed);
+    LOG_INFO("Reports %u: interval mean %u us, max %u us", i, stats.meanIntervalUs, stats.maxIntervalUs);
+
+    XboxBLEController::ConnectionInfo connection = controllers[i]->getConnectionInfo();
+    LOG_INFO("Conn %u: interval %u us, latency %u, %u reports/s", i, connection.accepted.minInterval * 1250,
+             connection.accepted.latency, controllers[i]->getReportRateHz());
+
+    XboxBLEController::ScanStats scans = controllers[i]->getScanStats();
+    LOG_INFO("Scan %u: %u of %u matched, last after %u ms", i, scans.matches, scans.scans, scans.lastMatchMs);
+
+    const LinkMonitor::Metrics &metrics = linkMonitors[i]->getMetrics();
+    LOG_INFO("Link %u: %u Hz, jitter %u us, RSSI %d dBm", i, metrics.rateHz, metrics.jitterUs, metrics.rssiDbm);
+    if (metrics.degraded)
+      LOG_WARN("Link %u degraded, %u stale events", i, metrics.staleEvents);
+  }
+}
+
+#if TELEMETRY == 1
+StreamTelemetrySink telemetrySink(Serial);
+#elif TELEMETRY == 2
+BLENotifyTelemetrySink telemetrySink;
+#endif
+
+#if TELEMETRY
+// Producers only queue frames; the telemetry task feeds the sink
+QueuedTelemetrySink telemetryQueue;
+TelemetryWriter telemetry(telemetryQueue);
+uint32_t lastTickUs = 0;
+#endif
+
+// Raw reports on the notification path; context is the controller index
+void reportTap(void *context, const uint8_t *data, size_t length, uint32_t arrivalUs)
+{
+#if FLIGHT_RECORDER
+  flightRecorder.recordReport((uint8_t)(uintptr_t)context, arrivalUs, data, length);
+#endif
+#if TELEMETRY
+  telemetry.writeReport(arrivalUs, data, length);
+#endif
+}
+
+// CPU share and stack headroom per task, to size the stacks and check the
+// core split. Without FreeRTOS run-time stats the share is bracketed wall
+// time: it includes the link task's waits on the BLE stack and reads 0 for
+// tasks that do not call begin()/end(), like the BLE host.
+void reportTasks()
+{
+  TaskMonitor::TaskStats stats[TaskMonitor::MAX_TASKS];
+  uint8_t count = taskMonitor.sample(stats, TaskMonitor::MAX_TASKS);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    LOG_INFO("Task %s: core %d, %s %u permille, max run %u us", stats[i].name, stats[i].core,
+             stats[i].cpuFromScheduler ? "CPU" : "bracketed wall time", stats[i].cpuPermille, stats[i].maxRunUs);
+    LOG_INFO("Task %s: %u of %u stack bytes never used", stats[i].name, stats[i].stackFreeBytes,
+             stats[i].stackBytes);
+  }
+}
+
+// Advance every session's link state machine; blocking BLE calls stay here.
+// Its CPU share includes the time spent waiting in them.
+void linkTask(void *parameter)
+{
+  while (true)
+  {
+    taskMonitor.begin(linkTaskId);
+    for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+      controllers[i]->step(millis());
+    taskMonitor.end(linkTaskId);
+    delay(LINK_STEP_MS);
+  }
+}
 
-XboxBLEController xbox;
+// Lowest priority: write out queued telemetry and flight recordings, and
+// report the tasks
+void telemetryTask(void *parameter)
+{
+  uint32_t lastTaskReportMs = millis();
+  while (true)
+  {
+    taskMonitor.begin(telemetryTaskId);
+#if TELEMETRY
+    telemetryQueue.drain(telemetrySink);
+#endif
+#if FLIGHT_RECORDER
+    if (flightRecorder.takeTrigger())
+      saveFlight();
+#endif
+    if (millis() - lastTaskReportMs >= TASK_REPORT_MS)
+    {
+      reportTasks();
+      lastTaskReportMs = millis();
+    }
+    taskMonitor.end(telemetryTaskId);
+    delay(TELEMETRY_DRAIN_MS);
+  }
+}
+
+// Act on the button presses of the selected controller (any blended one
+// when source is NO_SOURCE). Every queue is drained so none fills up while
+// its controller is not in charge.
+void handleButtonEvents(bool selected, int8_t source)
+{
+  static const uint8_t SPEED_UP = XboxBLEController::buttonInput(XboxBLEController::BUTTON_RB);
+  static const uint8_t SPEED_DOWN = XboxBLEController::buttonInput(XboxBLEController::BUTTON_LB);
+  static const uint8_t SAVE_FLIGHT = XboxBLEController::buttonInput(XboxBLEController::BUTTON_VIEW);
+
+  XboxBLEController::ButtonEvent event;
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+  {
+    while (controllers[i]->pollButtonEvent(event))
+    {
+      if (!selected || (source != ControllerArbiter::NO_SOURCE && source != i) || !event.pressed)
+        continue;
+#if FLIGHT_RECORDER
+      if (event.input == SAVE_FLIGHT)
+      {
+        flightRecorder.trigger(FlightRecorder::REASON_COMMAND, micros());
+        continue;
+      }
+#endif
+      if (event.input == SPEED_UP && speedMode + 1 < SPEED_MODE_COUNT)
+        speedMode++;
+      else if (event.input == SPEED_DOWN && speedMode > 0)
+        speedMode--;
+      else
+        continue;
+      LOG_INFO("Speed mode %u", speedMode);
+    }
+  }
+}
+
+void controlStep();
+
+#if SPEED_CONTROL
+void speedStep();
+void reportSpeed();
+#endif
+
+// Runs the control step on absolute deadlines
+void controlTask(void *parameter)
+{
+#if ADAPTIVE_RATE
+  controlTaskHandle = xTaskGetCurrentTaskHandle();
+#endif
+#if SPEED_CONTROL
+  uint8_t tick = 0;
+#endif
+  while (true)
+  {
+#if ADAPTIVE_RATE && SPEED_CONTROL
+    // Wake-ups and idle ticks take the input at once
+    if (controlRate.waitForNextTick() || controlRate.getMode() == AdaptiveRate::MODE_IDLE)
+      tick = 0;
+#elif ADAPTIVE_RATE
+    controlRate.waitForNextTick();
+#else
+    controlScheduler.waitForNextTick();
+#endif
+    taskMonitor.begin(controlTaskId);
+#if SPEED_CONTROL
+    if (tick == 0)
+      controlStep();
+    tick = (tick + 1) % SPEED_LOOP_DIVIDER;
+    speedStep();
+#else
+    controlStep();
+#endif
+#if ADAPTIVE_RATE
+    controlRate.update(controlActivity);
+#endif
+    taskMonitor.end(controlTaskId);
+  }
+}
 
 void setup()
 {
-  log(LogLevel::INFO, "Started");
+  // Serial output is drained by a background task; never waits for a host
+  logBegin();
+  LOG_INFO("Started");
 
   // Initialize BLE
-  if (!xbox.begin())
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
   {
-    log(LogLevel::ERROR, "Failed to initialize BLE!");
-    sleep_forever();
+    if (!controllers[i]->begin())
+    {
+      LOG_ERROR("Failed to initialize BLE!");
+      sleep_forever();
+    }
+    controllers[i]->setBondStore(&bondStore, i);
+    controllers[i]->setConnectionProfile(CONNECTION_PROFILE);
+    controllers[i]->setScanProfile(SCAN_PROFILE);
   }
+  arbiter.addSource(operatorPad, 1);
+  arbiter.addSource(supervisorPad, 2);
+
+  shaper.setProfile(InputShaper::AXIS_STICK_X, STEER_PROFILE);
+  shaper.setProfile(InputShaper::AXIS_STICK_Y, DRIVE_PROFILE);
+  shaper.setProfile(InputShaper::AXIS_LEFT_TRIGGER, BRAKE_PROFILE);
+  shaper.setProfile(InputShaper::AXIS_RIGHT_TRIGGER, THROTTLE_PROFILE);
 
-  // Scan and connect to first controller found
-  if (xbox.scanAndConnect(BLE_SCAN_MS))
+  if (!motors.begin())
   {
-    log(LogLevel::INFO, "Connected to Xbox controller!");
+    LOG_ERROR("Failed to initialize motor PWM!");
+    sleep_forever();
   }
-  else
+#if SPEED_CONTROL
+  // From this core, like the control task, so the counter limit interrupt
+  // lands here too
+  if (!encoders.begin())
+  {
+    LOG_ERROR("Failed to start wheel encoders!");
+    sleep_forever();
+  }
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+    lastCounts[i] = encoders.read(i);
+  lastSpeedUs = micros();
+#endif
+  currentMonitor.setTripHandler(overcurrentTrip, nullptr);
+  if (!currentSampler.begin(CURRENT_CHANNELS, CURRENT_SAMPLE_HZ, CURRENT_TASK.priority, CURRENT_TASK.core))
   {
-    log(LogLevel::ERROR, "No Xbox controller found. Make sure it's in pairing mode.");
-    log(LogLevel::ERROR, "Press and hold the pairing button on the controller.");
+    LOG_ERROR("Failed to start current sensing!");
+    sleep_forever();
+  }
+
+#if TELEMETRY == 1
+  Serial.begin(BAND_RATE);
+#elif TELEMETRY == 2
+  if (!telemetrySink.begin())
+    LOG_WARN("Failed to start telemetry service");
+#endif
+#if FLIGHT_RECORDER
+  // Formatted on first use; recording to RAM goes on without it
+  flightStorage = LittleFS.begin(true);
+  if (!flightStorage)
+    LOG_WARN("Failed to mount LittleFS, flight recordings not saved");
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+    linkMonitors[i]->setStaleHandler(linkStale, nullptr);
+#endif
+#if TELEMETRY || FLIGHT_RECORDER
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+    controllers[i]->setReportTap(reportTap, (void *)(uintptr_t)i);
+#endif
+#if ADAPTIVE_RATE
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+    controllers[i]->setInputHandler(inputChanged, nullptr);
+#if defined(CONFIG_PM_ENABLE)
+  // Scale the CPU clock down while every task waits (APB stays at 80 MHz
+  // for the PWM), and light sleep between idle ticks where the SDK has
+  // tickless idle. The stock Arduino SDK has neither; its idle tasks then
+  // just halt the cores until the next interrupt.
+  esp_pm_config_esp32_t power = {240, 80, false};
+#if defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+  power.light_sleep_enable = true;
+#endif
+  if (esp_pm_configure(&power) != ESP_OK)
+    LOG_WARN("Failed to configure power management");
+#endif
+#endif
+
+  controlTaskId = taskMonitor.add(CONTROL_TASK);
+  linkTaskId = taskMonitor.add(LINK_TASK);
+  telemetryTaskId = taskMonitor.add(TELEMETRY_TASK);
+  taskMonitor.attach(taskMonitor.add(CURRENT_TASK), xTaskGetHandle(CURRENT_TASK.name));
+  taskMonitor.attach(taskMonitor.add(BLE_HOST_TASK), xTaskGetHandle(BLE_HOST_TASK.name));
+  taskMonitor.attach(taskMonitor.add(LOG_TASK), xTaskGetHandle(LOG_TASK.name));
+
+  // Connection management runs in its own task; scans, connects and
+  // reconnects never stall the control loop
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+    controllers[i]->startLink(BLE_SCAN_MS);
+  if (!taskMonitor.start(controlTaskId, controlTask, nullptr) ||
+      !taskMonitor.start(linkTaskId, linkTask, nullptr) ||
+      !taskMonitor.start(telemetryTaskId, telemetryTask, nullptr))
+  {
+    LOG_ERROR("Failed to start tasks!");
     sleep_forever();
   }
 }
 
 void loop()
 {
-  if (xbox.isConnected())
+  // Everything runs in the pinned tasks
+  vTaskDelete(nullptr);
+}
+
+void controlStep()
+{
+  uint32_t tickUs = micros();
+#if SPEED_CONTROL
+  wheelsDriven = false;
+#endif
+#if ADAPTIVE_RATE
+  // Ticks come at varying intervals; slew over the time that passed, but
+  // never more than one regular period's worth at once
+  uint32_t shapeUs = tickUs - lastControlUs;
+  if (shapeUs > CONTROL_PERIOD_US)
+    shapeUs = CONTROL_PERIOD_US;
+  lastControlUs = tickUs;
+  controlActivity = AdaptiveRate::ACTIVITY_NONE;
+#else
+  const uint32_t shapeUs = CONTROL_PERIOD_US;
+#endif
+
+  // Sessions are connected by the link task; this only reads their state
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
   {
-    // Update controller state
-    if (xbox.update())
+    controllers[i]->update();
+    linkMonitors[i]->update(millis());
+  }
+
+  // One snapshot per session, combined by priority. The loop keeps its rate
+  // during link loss.
+  ControllerArbiter::Result selected;
+  bool haveInput = arbiter.arbitrate(millis(), selected);
+  handleButtonEvents(haveInput, selected.source);
+  if (haveInput)
+  {
+    const XboxBLEController::ControllerState &input = selected.state;
+    latency.consume(input.arrivalUs, micros());
+
+    // Get normalized values for robot control and mix them for tank drive.
+    // DriveSignal picks the Q15 or float pipeline at compile time.
+    DriveMixer::Input normalized = DriveMixer::normalize(shaper.shape(input, shapeUs));
+    DriveMixer::Output command = DriveMixer::mix(normalized);
+
+    // A connected but starved link winds the motors down instead of holding
+    // the last command; a blend follows its most starved source. Sources were
+    // added in controllers[] order.
+    const LinkMonitor *link = linkMonitors[0];
+    int32_t lowestScale = LinkMonitor::FULL_SCALE + 1;
+    for (uint8_t i = 0; i < CONTROLLER_COUNT; i++)
+    {
+      if ((selected.sourceMask & (1u << i)) && linkMonitors[i]->getScaleQ15() < lowestScale)
+      {
+        link = linkMonitors[i];
+        lowestScale = link->getScaleQ15();
+      }
+    }
+    int16_t left = link->apply(DriveSignal::toQ15(command.left));
+    int16_t right = link->apply(DriveSignal::toQ15(command.right));
+    int32_t limit = SPEED_LIMITS_Q15[speedMode];
+    left = (int16_t)((left * limit) >> 15);
+    right = (int16_t)((right * limit) >> 15);
+    if (input.buttons & XboxBLEController::BUTTON_B)
+    {
+      left = 0;
+      right = 0;
+      motors.stop(true);
+    }
+    else
     {
-      // Get normalized values for robot control
-      float leftX = xbox.getLeftStickXNormalized();          // -1.0 to 1.0 (steering)
-      float leftY = xbox.getLeftStickYNormalized();          // -1.0 to 1.0 (forward/back)
-      float leftTrigger = xbox.getLeftTriggerNormalized();   // 0.0 to 1.0 (brake)
-      float rightTrigger = xbox.getRightTriggerNormalized(); // 0.0 to 1.0 (throttle)
-
-      // Example: Tank drive control
-      float forward = -leftY; // Invert Y (up is positive)
-      float turn = leftX;
-
-      float leftMotor = forward + turn;
-      float rightMotor = forward - turn;
-
-      // Clamp to -1.0 to 1.0
-      leftMotor = constrain(leftMotor, -1.0, 1.0);
-      rightMotor = constrain(rightMotor, -1.0, 1.0);
-
-      // Apply trigger modulation
-      float throttle = rightTrigger - leftTrigger;
-      leftMotor *= abs(throttle);
-      rightMotor *= abs(throttle);
+#if SPEED_CONTROL
+      // The commands become wheel speeds, held by speedStep()
+      wheelTargets[MotorShield::CHANNEL_A] = left;
+      wheelTargets[MotorShield::CHANNEL_B] = right;
+      wheelsDriven = true;
+#else
+      motors.set(MotorShield::CHANNEL_A, left);
+      motors.set(MotorShield::CHANNEL_B, right);
+#endif
     }
+
+#if ADAPTIVE_RATE
+    // arrivalUs only moves when a report changed the input
+    if (input.arrivalUs != lastInputArrivalUs)
+      controlActivity = AdaptiveRate::ACTIVITY_CHANGING;
+    else if (left != 0 || right != 0)
+      controlActivity = AdaptiveRate::ACTIVITY_HOLDING;
+    lastInputArrivalUs = input.arrivalUs;
+#endif
+
+#if FLIGHT_RECORDER
+    uint8_t recordSource = selected.source >= 0 ? (uint8_t)selected.source : FlightRecorder::NO_SOURCE;
+    flightRecorder.recordMotorQ15(recordSource, tickUs, left, right);
+#endif
+#if TELEMETRY
+    telemetry.writeInputQ15(tickUs, DriveSignal::toQ15(normalized.stickX),
+                            DriveSignal::toQ15(normalized.stickY),
+                            DriveSignal::toQ15(normalized.leftTrigger),
+                            DriveSignal::toQ15(normalized.rightTrigger));
+    telemetry.writeMotorQ15(tickUs, left, right);
+#endif
   }
   else
   {
-    log(LogLevel::INFO, "Controller disconnected!");
-    delay(1000);
+    // No usable controller: let the rover roll to a stop, and ramp up from
+    // zero once input is back
+    motors.stop(false);
+    shaper.reset();
+#if FLIGHT_RECORDER
+    flightRecorder.recordMotorQ15(FlightRecorder::NO_SOURCE, tickUs, 0, 0);
+#endif
+  }
+
+#if !SPEED_CONTROL
+  // Overrides the command while a trip is active
+  checkOvercurrent();
+
+  // Both channels change together, once per tick
+  motors.apply();
+  latency.apply(micros());
+#endif
+
+  if (millis() - lastLatencyReportMs >= LATENCY_REPORT_MS)
+  {
+    reportLatency();
+    reportLinkHealth();
+#if SPEED_CONTROL
+    reportSpeed();
+#endif
+#if ADAPTIVE_RATE
+    reportControlRate();
+#endif
+    lastLatencyReportMs = millis();
+  }
+
+#if TELEMETRY
+  telemetry.writeLoop(tickUs, tickUs - lastTickUs, micros() - tickUs,
+                      controlScheduler.getStats().overruns);
+  lastTickUs = tickUs;
+#endif
+}
+
+#if SPEED_CONTROL
+// Every tick at SPEED_LOOP_HZ: measure both wheels and drive them towards
+// the speeds the last controlStep() asked for. Stops, brakes and trips
+// leave the staged stop in place and clear the loops, so nothing winds up
+// while the bridge is not driving.
+void speedStep()
+{
+  uint32_t nowUs = micros();
+  uint32_t dtUs = nowUs - lastSpeedUs;
+  lastSpeedUs = nowUs;
 
-    // Try to reconnect
-    log(LogLevel::INFO, "Attempting to reconnect...");
-    xbox.scanAndConnect(BLE_SCAN_MS);
+  bool driven = wheelsDriven && !currentMonitor.isTripped();
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    int32_t count = encoders.read(i);
+    int32_t delta = count - lastCounts[i];
+    lastCounts[i] = count;
+    if (driven)
+      motors.set((MotorShield::Channel)i, wheelSpeeds[i]->update(wheelTargets[i], delta, dtUs));
+    else
+      wheelSpeeds[i]->reset();
   }
 
-  delay(MAIN_LOOP_MS);
+  // Overrides the command while a trip is active
+  checkOvercurrent();
+
+  // Both channels change together, once per tick
+  motors.apply();
+  latency.apply(micros());
 }
+
+// Loop state per wheel, and how many steps hit the duty limit since the
+// previous report
+void reportSpeed()
+{
+  for (uint8_t i = 0; i < MOTOR_CHANNEL_COUNT; i++)
+  {
+    const SpeedController::Terms &terms = wheelSpeeds[i]->getTerms();
+    LOG_INFO("Wheel %u: target %d, speed %d, duty %d (Q15)", i, wheelTargets[i], terms.speedQ15, terms.output);
+    LOG_INFO("Wheel %u: I %d, %u saturated steps", i, terms.integral, wheelSpeeds[i]->getSaturatedCount());
+    wheelSpeeds[i]->resetStats();
+  }
+}
+#endif
@@ -1,14 +1,302 @@
 #!/usr/bin/env python3
 """
 BLE Scanner and Explorer Tool
-Scan for BLE devices and explore their services/characteristics
+Scan for BLE devices and explore their services/characteristics,
+and decode the rover's binary telemetry stream
 """
 
 import asyncio
 import argparse
+import csv
+import struct
+import sys
 from bleak import BleakScanner, BleakClient
 
 
+# Telemetry frame layout, see firmware/lib/Telemetry/src/Telemetry.h
+TELEMETRY_SYNC = b"\xa5\x5a"
+TELEMETRY_HEADER = struct.Struct("<2sBBHI")  # sync, type, length, sequence, timestamp_us
+TELEMETRY_CRC_SIZE = 2
+TELEMETRY_MAX_PAYLOAD = 64
+TELEMETRY_CHARACTERISTIC_UUID = "6e400002-7e1e-4e3a-9f6b-726f76657201"
+
+RECORD_REPORT = 0x01
+RECORD_INPUT = 0x02
+RECORD_MOTOR = 0x03
+RECORD_LOOP = 0x04
+
+RECORD_NAMES = {
+    RECORD_REPORT: "report",
+    RECORD_INPUT: "input",
+    RECORD_MOTOR: "motor",
+    RECORD_LOOP: "loop",
+}
+
+RECORD_COLUMNS = {
+    RECORD_REPORT: ["length", "hex"],
+    RECORD_INPUT: ["stick_x", "stick_y", "left_trigger", "right_trigger"],
+    RECORD_MOTOR: ["left", "right"],
+    RECORD_LOOP: ["period_us", "work_us", "overruns"],
+}
+
+
+def crc16_ccitt(data):
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), as computed by the firmware."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def decode_payload(record_type, payload):
+    """Turn a record payload into a list of values matching RECORD_COLUMNS."""
+    if record_type == RECORD_REPORT:
+        return [len(payload), payload.hex()]
+    if record_type == RECORD_INPUT and len(payload) == 8:
+        return [v / 32767.0 for v in struct.unpack("<4h", payload)]
+    if record_type == RECORD_MOTOR and len(payload) == 4:
+        return [v / 32767.0 for v in struct.unpack("<2h", payload)]
+    if record_type == RECORD_LOOP and len(payload) == 12:
+        return list(struct.unpack("<3I", payload))
+    return None
+
+
+class TelemetryDecoder:
+    """
+    Incremental telemetry frame decoder.
+
+    Feed arbitrary chunks of the byte stream; complete frames are returned as
+    (type, sequence, timestamp_us, values) tuples. Bytes between frames (for
+    example text log lines on the same serial port) and frames with a bad CRC
+    are skipped. Sequence gaps are counted as lost frames; a frame a few
+    numbers behind the newest one arrived late and is counted as reordered
+    (and no longer lost), a larger step back as a restart of the writer.
+    """
+
+    # Steps back up to this far are late frames, not a wrapped sequence
+    REORDER_WINDOW = 64
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.lost = 0
+        self.reordered = 0
+        self.skipped_bytes = 0
+        self.last_sequence = None
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        records = []
+        while True:
+            start = self.buffer.find(TELEMETRY_SYNC)
+            if start < 0:
+                # Keep a trailing 0xA5 that may be the first half of a sync
+                keep = 1 if self.buffer.endswith(TELEMETRY_SYNC[:1]) else 0
+                self.skipped_bytes += len(self.buffer) - keep
+                del self.buffer[:len(self.buffer) - keep]
+                return records
+            if start > 0:
+                self.skipped_bytes += start
+                del self.buffer[:start]
+
+            if len(self.buffer) < TELEMETRY_HEADER.size:
+                return records
+            _, record_type, length, sequence, timestamp = TELEMETRY_HEADER.unpack_from(self.buffer)
+            if length > TELEMETRY_MAX_PAYLOAD:
+                # Not a real frame header: skip this sync and search again
+                self.skipped_bytes += 1
+                del self.buffer[:1]
+                continue
+
+            frame_size = TELEMETRY_HEADER.size + length + TELEMETRY_CRC_SIZE
+            if len(self.buffer) < frame_size:
+                return records
+
+            body = bytes(self.buffer[2:TELEMETRY_HEADER.size + length])
+            (crc,) = struct.unpack_from("<H", self.buffer, TELEMETRY_HEADER.size + length)
+            if crc != crc16_ccitt(body):
+                self.crc_errors += 1
+                self.skipped_bytes += 1
+                del self.buffer[:1]
+                continue
+
+            payload = body[TELEMETRY_HEADER.size - 2:]
+            del self.buffer[:frame_size]
+            self.frames += 1
+            self.track_sequence(sequence)
+
+            values = decode_payload(record_type, payload)
+            if values is not None:
+                records.append((record_type, sequence, timestamp, values))
+
+
+    def track_sequence(self, sequence):
+        if self.last_sequence is None:
+            self.last_sequence = sequence
+            return
+        step = (sequence - self.last_sequence) & 0xFFFF
+        if step > 0x10000 - self.REORDER_WINDOW:
+            # Late: its gap was already counted as lost when the newer frame came
+            self.reordered += 1
+            self.lost = max(0, self.lost - 1)
+        elif 0 < step < 0x8000:
+            self.lost += step - 1
+            self.last_sequence = sequence
+        else:
+            self.last_sequence = sequence
+
+
+class TelemetryOutput:
+    """Collects decoded records and writes one CSV per record type."""
+
+    def __init__(self, csv_prefix=None, quiet=False):
+        self.records = {record_type: [] for record_type in RECORD_NAMES}
+        self.csv_prefix = csv_prefix
+        self.quiet = quiet
+        self.files = {}
+        self.writers = {}
+
+    def add(self, records):
+        for record_type, sequence, timestamp, values in records:
+            self.records[record_type].append((sequence, timestamp, values))
+            if self.csv_prefix:
+                self._writer(record_type).writerow([sequence, timestamp] + values)
+            elif not self.quiet:
+                print(f"{RECORD_NAMES[record_type]},{sequence},{timestamp}," +
+                      ",".join(str(v) for v in values))
+
+    def _writer(self, record_type):
+        if record_type not in self.writers:
+            path = f"{self.csv_prefix}_{RECORD_NAMES[record_type]}.csv"
+            handle = open(path, "w", newline="")
+            writer = csv.writer(handle)
+            writer.writerow(["sequence", "timestamp_us"] + RECORD_COLUMNS[record_type])
+            self.files[record_type] = handle
+            self.writers[record_type] = writer
+        return self.writers[record_type]
+
+    def close(self):
+        for handle in self.files.values():
+            handle.close()
+            print(f"Wrote {handle.name}", file=sys.stderr)
+
+    def plot(self):
+        import matplotlib.pyplot as plt
+
+        figure, axes = plt.subplots(3, 1, sharex=True, figsize=(10, 8))
+
+        def series(record_type, column):
+            rows = self.records[record_type]
+            return ([t / 1e6 for _, t, _ in rows], [v[column] for _, _, v in rows])
+
+        for column, name in enumerate(RECORD_COLUMNS[RECORD_INPUT]):
+            axes[0].plot(*series(RECORD_INPUT, column), label=name)
+        axes[0].set_ylabel("input")
+        axes[0].legend(loc="upper right")
+
+        for column, name in enumerate(RECORD_COLUMNS[RECORD_MOTOR]):
+            axes[1].plot(*series(RECORD_MOTOR, column), label=name)
+        axes[1].set_ylabel("motor")
+        axes[1].legend(loc="upper right")
+
+        for column, name in enumerate(RECORD_COLUMNS[RECORD_LOOP][:2]):
+            axes[2].plot(*series(RECORD_LOOP, column), label=name)
+        axes[2].set_ylabel("loop (us)")
+        axes[2].set_xlabel("time (s)")
+        axes[2].legend(loc="upper right")
+
+        plt.tight_layout()
+        plt.show()
+
+
+def print_decode_summary(decoder, output):
+    print("\n" + "=" * 70, file=sys.stderr)
+    print(f"Frames: {decoder.frames}", file=sys.stderr)
+    for record_type, name in RECORD_NAMES.items():
+        print(f"  {name}: {len(output.records[record_type])}", file=sys.stderr)
+    print(f"Lost (sequence gaps): {decoder.lost}", file=sys.stderr)
+    print(f"Reordered: {decoder.reordered}", file=sys.stderr)
+    print(f"CRC errors: {decoder.crc_errors}", file=sys.stderr)
+    print(f"Skipped bytes: {decoder.skipped_bytes}", file=sys.stderr)
+
+
+def decode_file(path, decoder, output):
+    """Decode a captured stream from a file ('-' for stdin)."""
+    stream = sys.stdin.buffer if path == "-" else open(path, "rb")
+    try:
+        while True:
+            chunk = stream.read(4096)
+            if not chunk:
+                break
+            output.add(decoder.feed(chunk))
+    finally:
+        if stream is not sys.stdin.buffer:
+            stream.close()
+
+
+def decode_serial(port, baud, duration, decoder, output, capture=None):
+    """Decode frames arriving on a serial port for duration seconds."""
+    import time
+    import serial
+
+    print(f"Reading telemetry from {port} at {baud} baud for {duration}s...", file=sys.stderr)
+    deadline = time.monotonic() + duration
+    with serial.Serial(port, baud, timeout=0.1) as link:
+        try:
+            while time.monotonic() < deadline:
+                chunk = link.read(4096)
+                if chunk:
+                    if capture:
+                        capture.write(chunk)
+                    output.add(decoder.feed(chunk))
+        except KeyboardInterrupt:
+            print("\nStopping (Ctrl+C detected)...", file=sys.stderr)
+
+
+async def decode_ble(address, duration, decoder, output, capture=None):
+    """Decode frames notified on the rover's telemetry characteristic."""
+    print(f"Connecting to {address}...", file=sys.stderr)
+
+    def notification_handler(sender, data):
+        if capture:
+            capture.write(data)
+        output.add(decoder.feed(data))
+
+    async with BleakClient(address) as client:
+        print(f"Connected (MTU {client.mtu_size})", file=sys.stderr)
+        await client.start_notify(TELEMETRY_CHARACTERISTIC_UUID, notification_handler)
+        try:
+            await asyncio.sleep(duration)
+        except KeyboardInterrupt:
+            print("\nStopping (Ctrl+C detected)...", file=sys.stderr)
+        await client.stop_notify(TELEMETRY_CHARACTERISTIC_UUID)
+
+
+def decode_telemetry(args):
+    decoder = TelemetryDecoder()
+    output = TelemetryOutput(args.csv, quiet=args.plot)
+    capture = open(args.capture, "wb") if args.capture else None
+    try:
+        if args.serial:
+            decode_serial(args.serial, args.baud, args.time, decoder, output, capture)
+        elif args.ble:
+            asyncio.run(decode_ble(args.ble, args.time, decoder, output, capture))
+        else:
+            decode_file(args.source, decoder, output)
+    finally:
+        if capture:
+            capture.close()
+        output.close()
+
+    print_decode_summary(decoder, output)
+    if args.plot:
+        output.plot()
+
+
 async def scan_devices(scan_time=5.0):
     """
     Scan for BLE devices and display them with RSSI values.
@@ -302,6 +590,15 @@ Examples:
   
   # Subscribe for 60 seconds
   python ble_tool.py subscribe AA:BB:CC:DD:EE:FF 15 -t 60
+
+  # Decode rover telemetry from a serial port into CSV files
+  python ble_tool.py decode --serial /dev/ttyUSB0 -b 921600 --csv run1
+
+  # Record rover telemetry over BLE for 20 seconds and plot it
+  python ble_tool.py decode --ble AA:BB:CC:DD:EE:FF -t 20 --capture run1.bin --plot
+
+  # Decode a previously captured stream
+  python ble_tool.py decode run1.bin --csv run1
         """
     )
     
@@ -343,6 +640,55 @@ Examples:
         help='Monitoring duration in seconds (default: 30.0)'
     )
     
+    # Decode mode
+    decode_parser = subparsers.add_parser('decode', help='Decode rover binary telemetry')
+    decode_parser.add_argument(
+        'source',
+        type=str,
+        nargs='?',
+        default='-',
+        help='Captured telemetry file (default: stdin)'
+    )
+    decode_parser.add_argument(
+        '--serial',
+        type=str,
+        help='Read from a serial port instead of a file'
+    )
+    decode_parser.add_argument(
+        '-b', '--baud',
+        type=int,
+        default=115200,
+        help='Serial baud rate (default: 115200)'
+    )
+    decode_parser.add_argument(
+        '--ble',
+        type=str,
+        metavar='ADDRESS',
+        help='Subscribe to the rover telemetry characteristic instead of a file'
+    )
+    decode_parser.add_argument(
+        '-t', '--time',
+        type=float,
+        default=30.0,
+        help='Capture duration in seconds for --serial/--ble (default: 30.0)'
+    )
+    decode_parser.add_argument(
+        '--capture',
+        type=str,
+        help='Also save the raw --serial/--ble stream to this file'
+    )
+    decode_parser.add_argument(
+        '--csv',
+        type=str,
+        metavar='PREFIX',
+        help='Write PREFIX_<record>.csv files instead of printing records'
+    )
+    decode_parser.add_argument(
+        '--plot',
+        action='store_true',
+        help='Plot inputs, motor commands and loop timing'
+    )
+
     args = parser.parse_args()
     
     # Show help if no mode specified
@@ -357,6 +703,8 @@ Examples:
         asyncio.run(explore_device(args.address))
     elif args.mode == 'subscribe':
         asyncio.run(subscribe_characteristic(args.address, args.characteristic, args.time))
+    elif args.mode == 'decode':
+        decode_telemetry(args)
 
 if __name__ == "__main__":
     main()